@@ -0,0 +1,71 @@
+#include "animation.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// Sampling a skeleton clip frame by frame: AnimationClip with cursors
+// against the same tracks searched from scratch every frame, in nanoseconds
+// per joint (three tracks each).
+
+namespace {
+
+constexpr std::size_t kJoints = 10000;
+constexpr std::size_t kKeys = 60;  // two seconds at 30 keys per second
+constexpr std::size_t kFrames = 240;
+
+template <typename F>
+void report(const char* name, F fn) {
+  std::printf("%-28s %10.2f\n", name,
+              best_ns_per_item(kJoints * kFrames, fn, 3));
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  std::vector<float> times(kKeys);
+  for (std::size_t k = 0; k < kKeys; ++k) times[k] = k / 30.f;
+
+  std::vector<Vec3Track> translations;
+  std::vector<QuatTrack> rotations;
+  std::vector<Vec3Track> scales;
+  AnimationClip clip;
+  for (std::size_t j = 0; j < kJoints; ++j) {
+    std::vector<Vec3f> v(kKeys);
+    std::vector<Quat> q(kKeys);
+    for (auto& p : v) p = Vec3f(dist(gen), dist(gen), dist(gen));
+    for (auto& r : q) {
+      r = normalized(Quat(dist(gen), dist(gen), dist(gen), 2.f));
+    }
+    translations.emplace_back(times, v, Interpolation::catmull_rom);
+    rotations.emplace_back(times, q, Interpolation::linear);
+    scales.push_back(Vec3Track::constant(Vec3f(1.f, 1.f, 1.f)));
+    clip.add_joint(translations.back(), rotations.back(), scales.back());
+  }
+
+  std::vector<JointPose> poses(kJoints);
+  std::printf("%zu joints, %zu keys, %zu frames\n", kJoints, kKeys, kFrames);
+  std::printf("%-28s %10s\n", "method", "ns/joint");
+  report("clip, cursors", [&] {
+    auto cursor = clip.make_cursor();
+    for (std::size_t f = 0; f < kFrames; ++f) {
+      clip.sample(f / 120.f, cursor, poses);
+      do_not_optimize(poses.data());
+    }
+  });
+  report("tracks, binary search", [&] {
+    for (std::size_t f = 0; f < kFrames; ++f) {
+      float t = f / 120.f;
+      for (std::size_t j = 0; j < kJoints; ++j) {
+        poses[j].translation = translations[j].sample(t);
+        poses[j].rotation = rotations[j].sample(t);
+        poses[j].scale = scales[j].sample(t);
+      }
+      do_not_optimize(poses.data());
+    }
+  });
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+
+//--------------------------------------------
+// Timing helpers shared by the benchmarks
+//--------------------------------------------
+
+// Keeps the compiler from discarding a value that is otherwise unused.
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const T* sink;
+  sink = &value;
+#endif
+}
+
+// Runs fn() `reps` times and returns the fastest run in nanoseconds divided
+// by `items`, i.e. the best observed cost per item.
+template <typename F>
+double best_ns_per_item(std::size_t items, F&& fn, int reps = 5) {
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < reps; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed = stop - start;
+    best = std::min(best, elapsed.count() / static_cast<double>(items));
+  }
+  return best;
+}
+
+//--------------------------------------------
+// Error measurement
+//--------------------------------------------
+
+// Distance in units in the last place between a float result and the
+// correctly rounded value of a higher precision reference.
+inline int64_t ulp_distance(float value, double reference) {
+  float ref = static_cast<float>(reference);
+  if (value == ref) return 0;
+  if (std::isnan(value) || std::isnan(ref)) {
+    return std::numeric_limits<int32_t>::max();
+  }
+  auto ordered = [](float f) {
+    auto i = static_cast<int64_t>(std::bit_cast<int32_t>(f));
+    return i < 0 ? std::numeric_limits<int32_t>::min() - i : i;
+  };
+  auto d = ordered(value) - ordered(ref);
+  return d < 0 ? -d : d;
+}
+
+// Size of one unit in the last place of T at the magnitude of x.
+template <typename T>
+long double ulp_of(long double x) {
+  auto t = static_cast<T>(std::fabs(x));
+  if (t < std::numeric_limits<T>::min()) {
+    return std::numeric_limits<T>::denorm_min();
+  }
+  if (t == std::numeric_limits<T>::max()) {
+    return static_cast<long double>(t) - std::nextafter(t, T{0});
+  }
+  return static_cast<long double>(std::nextafter(
+             t, std::numeric_limits<T>::infinity())) -
+         t;
+}
+
+// Error of a T result against a higher precision reference, in ulps of T
+// taken at the magnitude `scale`. Passing the largest reference component as
+// scale gives the usual normwise error of a vector or matrix result.
+template <typename T>
+double ulp_error(T value, long double reference, long double scale) {
+  if (std::isnan(value) != std::isnan(reference)) {
+    return std::numeric_limits<double>::infinity();
+  }
+  if (std::isnan(value) || value == reference) return 0.;
+  return static_cast<double>(std::fabs(value - reference) / ulp_of<T>(scale));
+}
+
+// Accumulates max and mean of a series of error samples.
+class ErrorStats {
+ public:
+  void add(double err) {
+    m_max = std::max(m_max, err);
+    m_sum += err;
+    ++m_count;
+  }
+
+  double max() const { return m_max; }
+  double mean() const { return m_count ? m_sum / m_count : 0.; }
+  std::size_t count() const { return m_count; }
+
+ private:
+  double m_max = 0.;
+  double m_sum = 0.;
+  std::size_t m_count = 0;
+};
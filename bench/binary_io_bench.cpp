@@ -0,0 +1,79 @@
+#include "binary_io.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// Loading an array of points from a text file, with read_binary() and through
+// a MappedArray. The file is in the page cache after the first run, so the
+// numbers compare parsing and copying, not the disk.
+
+namespace {
+
+constexpr std::size_t N = 1 << 22;
+
+template <typename F>
+void report(const char* name, std::size_t bytes, F fn) {
+  auto ns = best_ns_per_item(N, fn, 3);
+  std::printf("%-16s %10.2f %10.2f\n", name, ns,
+              static_cast<double>(bytes) / (ns * N));
+}
+
+float sum(std::span<const Point3f> points) {
+  float s = 0.f;
+  for (const auto& p : points) s += p.x() + p.y() + p.z();
+  return s;
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> dist(-1000.f, 1000.f);
+  std::vector<Point3f> points(N);
+  for (auto& p : points) p = Point3f(dist(gen), dist(gen), dist(gen));
+
+  auto dir = std::filesystem::temp_directory_path();
+  auto text = (dir / "math_binary_io_bench.xyz").string();
+  auto binary = (dir / "math_binary_io_bench.bin").string();
+  {
+    std::ofstream out(text);
+    for (const auto& p : points) {
+      out << p.x() << ' ' << p.y() << ' ' << p.z() << '\n';
+    }
+  }
+  write_binary(binary, points);
+  auto text_bytes = std::filesystem::file_size(text);
+  auto binary_bytes = std::filesystem::file_size(binary);
+
+  std::printf("%zu points\n", N);
+  std::printf("%-16s %10s %10s\n", "method", "ns/point", "GB/s");
+  report("istream text", text_bytes, [&] {
+    std::ifstream in(text);
+    std::vector<Point3f> loaded;
+    loaded.reserve(N);
+    float x, y, z;
+    while (in >> x >> y >> z) loaded.emplace_back(x, y, z);
+    do_not_optimize(sum(loaded));
+  });
+  report("read_binary", binary_bytes, [&] {
+    auto loaded = read_binary<Point3f>(binary);
+    do_not_optimize(sum(loaded));
+  });
+  report("MappedArray", binary_bytes, [&] {
+    MappedArray<Point3f> mapped(binary);
+    do_not_optimize(sum(mapped));
+  });
+  report("MappedArray open", binary_bytes, [&] {
+    MappedArray<Point3f> mapped(binary);
+    do_not_optimize(mapped.data());
+  });
+
+  std::filesystem::remove(text);
+  std::filesystem::remove(binary);
+  return 0;
+}
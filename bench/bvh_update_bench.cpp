@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "bvh.h"
+#include "dynamic_bvh.h"
+#include "scenes.h"
+#include "wavefront.h"
+
+// An animated terrain whose triangles swirl about its centre, faster
+// further out, so that neighbours drift apart; slowly, then four times as
+// fast. Over kFrames frames the tree is rebuilt, refit, or refit and
+// rotated once per frame; then the camera rays of the last frame are
+// traced through it. A DynamicBvh takes the same triangles one by one and
+// moves a hundredth of them per frame.
+
+namespace {
+
+constexpr int kFrames = 16;
+
+std::vector<Trianglef> swirl(const std::vector<Trianglef>& rest, float speed,
+                             int frame) {
+  auto move = [&](const Point3f& p) {
+    float r = std::sqrt(p.x() * p.x() + p.z() * p.z());
+    float angle = speed * static_cast<float>(frame) * r;
+    float c = std::cos(angle), s = std::sin(angle);
+    return Point3f(c * p.x() + s * p.z(), p.y(), c * p.z() - s * p.x());
+  };
+  std::vector<Trianglef> out(rest.size());
+  for (std::size_t i = 0; i < rest.size(); ++i) {
+    out[i] = {move(rest[i].a), move(rest[i].b), move(rest[i].c)};
+  }
+  return out;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+}  // namespace
+
+int main() {
+  std::vector<Trianglef> rest = terrain(300);
+  Mat4f view = view_transform(Point3f(0.f, 25.f, 60.f),
+                              Point3f(0.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f));
+  Mat4f projection = perspective(30.f, 16.f / 9.f, 0.1f, 500.f);
+  RayQueue camera;
+  generate_camera_rays(view, projection, 640, 360, camera);
+  std::vector<Ray> rays(camera.count);
+  for (std::size_t i = 0; i < rays.size(); ++i) rays[i] = camera.ray(i);
+  auto trace = [&](const auto& tree) {
+    return best_ns_per_item(rays.size(), [&] {
+      for (const Ray& ray : rays) do_not_optimize(tree.intersect(ray));
+    });
+  };
+  auto report = [&](const char* name, double seconds, const auto& tree) {
+    std::printf("%-16s %12.2f %10.1f %10.1f\n", name,
+                seconds * 1e3 / kFrames, tree.sah_cost(), trace(tree));
+  };
+  std::printf("%zu triangles, %d frames, %u workers\n", rest.size(), kFrames,
+              default_thread_pool().size());
+
+  for (float speed : {0.001f, 0.004f}) {
+    std::vector<std::vector<Trianglef>> frames;
+    for (int f = 0; f <= kFrames; ++f) frames.push_back(swirl(rest, speed, f));
+    auto frame = [&](int f) { return std::span<const Trianglef>(frames[f]); };
+
+    std::printf("\nswirl %.3f rad per unit of radius and frame\n", speed);
+    std::printf("%-16s %12s %10s %10s\n", "update", "ms/frame", "SAH cost",
+                "ns/ray");
+    Bvhf rebuilt{frame(0)};
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 1; f <= kFrames; ++f) rebuilt = Bvhf(frame(f));
+    report("rebuild", seconds_since(start), rebuilt);
+
+    Bvhf refit{frame(0)};
+    start = std::chrono::steady_clock::now();
+    for (int f = 1; f <= kFrames; ++f) refit.refit(frame(f));
+    report("refit", seconds_since(start), refit);
+
+    Bvhf rotated{frame(0)};
+    start = std::chrono::steady_clock::now();
+    for (int f = 1; f <= kFrames; ++f) {
+      rotated.refit(frame(f));
+      rotated.rotate();
+    }
+    report("refit + rotate", seconds_since(start), rotated);
+
+    DynamicBvhf dynamic;
+    start = std::chrono::steady_clock::now();
+    for (const Trianglef& t : frames[0]) dynamic.insert(t);
+    double insert = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (int f = 1; f <= kFrames; ++f) {
+      for (uint32_t id = f % 100; id < rest.size(); id += 100) {
+        dynamic.update(id, frames[f][id]);
+      }
+    }
+    double moves = seconds_since(start);
+    std::printf("%-16s %12s %10s %10s\n", "dynamic", "ns/triangle",
+                "SAH cost", "ns/ray");
+    std::printf("%-16s %12.1f\n", "insert",
+                insert * 1e9 / static_cast<double>(rest.size()));
+    std::printf("%-16s %12.1f %10.1f %10.1f\n", "update 1%/frame",
+                moves * 1e9 / static_cast<double>(kFrames * rest.size() / 100),
+                dynamic.sah_cost(), trace(dynamic));
+  }
+}
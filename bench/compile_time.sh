@@ -0,0 +1,57 @@
+#!/bin/sh
+# Compile time of N generated translation units that use Vec3f, Point3f and
+# Mat4f, built once instantiating everything in each unit and once against
+# the extern template declarations of math_instantiated.
+#
+#   bench/compile_time.sh [units] [compiler flags...]
+#   bench/compile_time.sh 64 -O2
+
+set -e
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+units=${1:-32}
+[ $# -gt 0 ] && shift
+flags=${*:--O2}
+cxx=${CXX:-c++}
+jobs=$(nproc 2>/dev/null || echo 4)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+i=0
+while [ "$i" -lt "$units" ]; do
+  cat >"$work/tu$i.cpp" <<EOF
+#include "mat4.h"
+#include "normal3.h"
+#include "point3.h"
+#include "vec2.h"
+
+Vec4f tu$i(const Point3f& eye, const Vec3f& axis, float angle) {
+  Mat4f m = view_transform(eye, Point3f(0.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f));
+  m = m * rotationOverY(angle) * scale(normalized(axis) * 2.f);
+  Vec3f c = cross(axis, Vec3f(1.f, 0.f, 0.f)) + axis / 3.f;
+  Normal3f n = normalized(Normal3f(c.x(), c.y(), c.z()));
+  Vec2f uv = normalized(Vec2f(n.x(), n.y()));
+  return m * Vec4f(c.x() * uv.x(), c.y() * uv.y(), dot(c, axis), 1.f);
+}
+EOF
+  i=$((i + 1))
+done
+
+build() {
+  start=$(date +%s.%N)
+  ls "$work"/tu*.cpp | xargs -P "$jobs" -I{} \
+    $cxx -std=c++20 $flags $1 -I"$root/src" -c {} -o {}.o
+  end=$(date +%s.%N)
+  size=$(cat "$work"/tu*.o | wc -c)
+  rm -f "$work"/tu*.o
+  awk -v a="$start" -v b="$end" -v s="$size" -v u="$units" \
+    'BEGIN {printf "%8.2f s %10d bytes of objects (%d units)\n", b - a, s, u}'
+}
+
+$cxx -std=c++20 $flags -I"$root/src" -c "$root/src/math_instantiated.cpp" \
+  -o "$work/math_instantiated.o"
+
+printf "%-24s" "header only:"
+build ""
+printf "%-24s" "MATH_EXTERN_TEMPLATES:"
+build "-DMATH_EXTERN_TEMPLATES"
@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "bvh.h"
+#include "compressed_bvh.h"
+#include "scenes.h"
+#include "wavefront.h"
+
+// Memory and traversal time of a Bvh and the CompressedBvh collapsed from
+// it, for the camera rays of a terrain and for diffuse bounces off the
+// points they hit. Memory counts nodes, triangles and indices.
+
+int main() {
+  std::vector<Trianglef> triangles = terrain(400);
+  Bvhf bvh{std::span<const Trianglef>(triangles)};
+  CompressedBvh wide(bvh);
+  Mat4f view = view_transform(Point3f(0.f, 25.f, 60.f),
+                              Point3f(0.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f));
+  Mat4f projection = perspective(30.f, 16.f / 9.f, 0.1f, 500.f);
+
+  RayQueue camera;
+  generate_camera_rays(view, projection, 960, 540, camera);
+  std::vector<Ray> primary(camera.count);
+  for (std::size_t i = 0; i < camera.count; ++i) primary[i] = camera.ray(i);
+  std::vector<TriangleHit<float>> hits(camera.count);
+  extend(bvh, camera, std::span(hits));
+  std::vector<Ray> bounces;
+  for (std::size_t i = 0; i < camera.count; ++i) {
+    if (!hits[i].hit()) continue;
+    Vec3f n = normalized(triangles[hits[i].triangle].normal());
+    if (dot(n, primary[i].direction()) > 0.f) n = -n;
+    auto pixel = static_cast<uint32_t>(i);
+    Ray ray(primary[i].position(hits[i].t),
+            cosine_direction(n, hash_float(pixel, 0), hash_float(pixel, 1)));
+    ray.setMinRange(1e-3f);
+    bounces.push_back(ray);
+  }
+
+  auto mib = [](std::size_t bytes) { return bytes / (1024. * 1024.); };
+  std::size_t shared = triangles.size() * (sizeof(Trianglef) + 4);
+  std::printf("%zu triangles, %u workers\n", triangles.size(),
+              default_thread_pool().size());
+  std::printf("%-14s %8s %10s %10s\n", "tree", "nodes", "node MiB",
+              "total MiB");
+  std::printf("%-14s %8zu %10.2f %10.2f\n", "Bvh", bvh.node_count(),
+              mib(bvh.node_count() * sizeof(BvhNode<float>)),
+              mib(bvh.node_count() * sizeof(BvhNode<float>) + shared));
+  std::printf("%-14s %8zu %10.2f %10.2f\n", "CompressedBvh", wide.node_count(),
+              mib(wide.node_count() * sizeof(CompressedBvhNode)),
+              mib(wide.node_count() * sizeof(CompressedBvhNode) + shared));
+
+  std::printf("%-22s %10s %10s\n", "query, ns/ray", "Bvh", "Compressed");
+  auto row = [&](const char* name, const std::vector<Ray>& rays, auto query) {
+    std::size_t count = 0;
+    double binary = best_ns_per_item(rays.size(), [&] {
+      count = 0;
+      for (const Ray& ray : rays) count += query(bvh, ray);
+    });
+    std::size_t wide_count = 0;
+    double compressed = best_ns_per_item(rays.size(), [&] {
+      wide_count = 0;
+      for (const Ray& ray : rays) wide_count += query(wide, ray);
+    });
+    std::printf("%-22s %10.1f %10.1f%s\n", name, binary, compressed,
+                count == wide_count ? "" : "  (hit counts differ)");
+  };
+  auto nearest = [](const auto& tree, const Ray& ray) {
+    return tree.intersect(ray).hit();
+  };
+  auto any = [](const auto& tree, const Ray& ray) {
+    return tree.occluded(ray);
+  };
+  row("camera, intersect", primary, nearest);
+  row("bounce, intersect", bounces, nearest);
+  row("bounce, occluded", bounces, any);
+}
@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "vec3_expr.h"
+
+// Eager operators against the expr:: layer. CMake also builds this file as
+// expr_bench_O1, expr_bench_O2 and expr_bench_O3; run all three to see how
+// much of the eager version's cost is temporaries the optimizer did not
+// remove at that level.
+
+#ifndef MATH_BENCH_OPT_LEVEL
+#define MATH_BENCH_OPT_LEVEL "default"
+#endif
+
+namespace {
+
+constexpr std::size_t N = 1 << 20;
+
+template <typename Eager, typename Lazy>
+void report(const char* name, Eager eager, Lazy lazy) {
+  auto eager_ns = best_ns_per_item(N, eager);
+  auto lazy_ns = best_ns_per_item(N, lazy);
+  std::printf("%-24s %10.2f %10.2f %8.2fx\n", name, eager_ns, lazy_ns,
+              eager_ns / lazy_ns);
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dist(-10.f, 10.f);
+  std::vector<Vec3f> a(N), b(N), c(N), out(N);
+  std::vector<Quat> q(N);
+  for (std::size_t i = 0; i < N; ++i) {
+    a[i] = Vec3f(dist(gen), dist(gen), dist(gen));
+    b[i] = normalized(Vec3f(dist(gen), dist(gen), dist(gen)));
+    c[i] = Vec3f(dist(gen), dist(gen), dist(gen));
+    q[i] = normalized(angle_axis(dist(gen), c[i]));
+  }
+
+  std::printf("optimization: %s, fma contraction: %s\n", MATH_BENCH_OPT_LEVEL,
+#ifdef FP_FAST_FMAF
+              "yes"
+#else
+              "no"
+#endif
+  );
+  std::printf("%-24s %10s %10s %9s\n", "expression", "eager ns", "lazy ns",
+              "speedup");
+
+  report(
+      "a + b * s - c * t",
+      [&] {
+        for (std::size_t i = 0; i < N; ++i) {
+          out[i] = a[i] + b[i] * 0.5f - c[i] * 1.5f;
+        }
+        do_not_optimize(out.data());
+      },
+      [&] {
+        for (std::size_t i = 0; i < N; ++i) {
+          out[i] = expr::lazy(a[i]) + b[i] * 0.5f - c[i] * 1.5f;
+        }
+        do_not_optimize(out.data());
+      });
+
+  report(
+      "dot(a, b)",
+      [&] {
+        float sum = 0.f;
+        for (std::size_t i = 0; i < N; ++i) sum += dot(a[i], b[i]);
+        do_not_optimize(sum);
+      },
+      [&] {
+        float sum = 0.f;
+        for (std::size_t i = 0; i < N; ++i) {
+          sum += expr::dot(expr::lazy(a[i]), b[i]);
+        }
+        do_not_optimize(sum);
+      });
+
+  report(
+      "reflect(a, n)",
+      [&] {
+        for (std::size_t i = 0; i < N; ++i) out[i] = reflect(a[i], b[i]);
+        do_not_optimize(out.data());
+      },
+      [&] {
+        for (std::size_t i = 0; i < N; ++i) out[i] = expr::reflect(a[i], b[i]);
+        do_not_optimize(out.data());
+      });
+
+  report(
+      "Quat * Vec3f",
+      [&] {
+        for (std::size_t i = 0; i < N; ++i) out[i] = q[i] * a[i];
+        do_not_optimize(out.data());
+      },
+      [&] {
+        for (std::size_t i = 0; i < N; ++i) out[i] = expr::rotate(q[i], a[i]);
+        do_not_optimize(out.data());
+      });
+
+  report(
+      "cross(a, b) * s + c",
+      [&] {
+        for (std::size_t i = 0; i < N; ++i) {
+          out[i] = cross(a[i], b[i]) * 2.f + c[i];
+        }
+        do_not_optimize(out.data());
+      },
+      [&] {
+        for (std::size_t i = 0; i < N; ++i) {
+          out[i] = expr::cross(expr::lazy(a[i]), b[i]) * 2.f + c[i];
+        }
+        do_not_optimize(out.data());
+      });
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include "fast_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// Accuracy and speed of the fast:: kernels next to their libm counterparts.
+// The ulp columns are measured against double precision results; the timing
+// columns are the best of five runs over the same random inputs.
+
+namespace {
+
+constexpr std::size_t N = 1 << 20;
+
+std::vector<float> uniform(float lo, float hi) {
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> dist(lo, hi);
+  std::vector<float> out(N);
+  for (auto& x : out) x = dist(gen);
+  return out;
+}
+
+// Near the zeros of sin and cos a relative bound is meaningless, so their
+// error is taken in ulps of max(|reference|, 1e-3): absolute error there.
+double trig_error(float value, double reference) {
+  return ulp_error<float>(value, reference,
+                          std::max(std::fabs(reference), 1e-3));
+}
+
+template <typename Fast, typename Exact, typename Ref>
+void report(const char* name, const std::vector<float>& in, Fast fast_fn,
+            Exact exact_fn, Ref ref_fn, bool trig = false) {
+  ErrorStats stats;
+  for (float x : in) {
+    stats.add(trig ? trig_error(fast_fn(x), ref_fn(x))
+                   : static_cast<double>(ulp_distance(fast_fn(x), ref_fn(x))));
+  }
+  auto exact_ns = best_ns_per_item(in.size(), [&] {
+    for (float x : in) do_not_optimize(exact_fn(x));
+  });
+  auto fast_ns = best_ns_per_item(in.size(), [&] {
+    for (float x : in) do_not_optimize(fast_fn(x));
+  });
+  std::printf("%-12s %10.0f %10.3f %12.2f %12.2f %8.2fx\n", name, stats.max(),
+              stats.mean(), exact_ns, fast_ns, exact_ns / fast_ns);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%-12s %10s %10s %12s %12s %9s\n", "function", "max ulp",
+              "mean ulp", "libm ns", "fast ns", "speedup");
+
+  auto positive = uniform(1e-6f, 1e6f);
+  report(
+      "rsqrt", positive, [](float x) { return fast::rsqrt(x); },
+      [](float x) { return 1.f / std::sqrt(x); },
+      [](float x) { return 1. / std::sqrt(static_cast<double>(x)); });
+
+  // Covers many zeros of sin and cos; see trig_error().
+  auto angles = uniform(-100.f, 100.f);
+  report(
+      "sin", angles, [](float x) { return fast::sin(x); },
+      [](float x) { return std::sin(x); },
+      [](float x) { return std::sin(static_cast<double>(x)); }, true);
+  report(
+      "cos", angles, [](float x) { return fast::cos(x); },
+      [](float x) { return std::cos(x); },
+      [](float x) { return std::cos(static_cast<double>(x)); }, true);
+  ErrorStats sincos_err;
+  for (float x : angles) {
+    float s, c;
+    fast::sincos(x, s, c);
+    auto d = static_cast<double>(x);
+    sincos_err.add(
+        std::max(trig_error(s, std::sin(d)), trig_error(c, std::cos(d))));
+  }
+  auto exact_ns = best_ns_per_item(N, [&] {
+    for (float x : angles) {
+      do_not_optimize(std::sin(x));
+      do_not_optimize(std::cos(x));
+    }
+  });
+  auto fast_ns = best_ns_per_item(N, [&] {
+    for (float x : angles) {
+      float s, c;
+      fast::sincos(x, s, c);
+      do_not_optimize(s);
+      do_not_optimize(c);
+    }
+  });
+  std::printf("%-12s %10.0f %10.3f %12.2f %12.2f %8.2fx\n", "sincos",
+              sincos_err.max(), sincos_err.mean(), exact_ns, fast_ns,
+              exact_ns / fast_ns);
+
+  auto unit = uniform(-1.f, 1.f);
+  report(
+      "acos", unit, [](float x) { return fast::acos(x); },
+      [](float x) { return std::acos(x); },
+      [](float x) { return std::acos(static_cast<double>(x)); });
+
+  auto wide = uniform(-1000.f, 1000.f);
+  report(
+      "atan2", wide, [](float x) { return fast::atan2(x, 3.7f); },
+      [](float x) { return std::atan2(x, 3.7f); },
+      [](float x) { return std::atan2(static_cast<double>(x), 3.7); });
+
+  // Vector and matrix level call sites.
+  std::vector<Vec3f> vecs(N);
+  for (std::size_t i = 0; i < N; ++i) {
+    vecs[i] = Vec3f(wide[i], angles[i], unit[i] + 2.f);
+  }
+  ErrorStats norm_err;
+  for (const auto& v : vecs) {
+    auto n = fast::normalized(v);
+    auto exact = normalized(Vec3d(v.x(), v.y(), v.z()));
+    norm_err.add(static_cast<double>(ulp_distance(n.x(), exact.x())));
+  }
+  exact_ns = best_ns_per_item(N, [&] {
+    for (const auto& v : vecs) do_not_optimize(normalized(v));
+  });
+  fast_ns = best_ns_per_item(N, [&] {
+    for (const auto& v : vecs) do_not_optimize(fast::normalized(v));
+  });
+  std::printf("%-12s %10.0f %10.3f %12.2f %12.2f %8.2fx\n", "normalized",
+              norm_err.max(), norm_err.mean(), exact_ns, fast_ns,
+              exact_ns / fast_ns);
+
+  exact_ns = best_ns_per_item(N, [&] {
+    for (float a : angles) do_not_optimize(rotationOverY(a));
+  });
+  fast_ns = best_ns_per_item(N, [&] {
+    for (float a : angles) do_not_optimize(fast::rotationOverY(a));
+  });
+  std::printf("%-12s %10s %10s %12.2f %12.2f %8.2fx\n", "rotationOverY", "-",
+              "-", exact_ns, fast_ns, exact_ns / fast_ns);
+
+  exact_ns = best_ns_per_item(N, [&] {
+    for (std::size_t i = 0; i < N; ++i) {
+      do_not_optimize(angle_axis(angles[i], vecs[i]));
+    }
+  });
+  fast_ns = best_ns_per_item(N, [&] {
+    for (std::size_t i = 0; i < N; ++i) {
+      do_not_optimize(fast::angle_axis(angles[i], vecs[i]));
+    }
+  });
+  std::printf("%-12s %10s %10s %12.2f %12.2f %8.2fx\n", "angle_axis", "-", "-",
+              exact_ns, fast_ns, exact_ns / fast_ns);
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include "hash_grid.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// One simulation step's worth of grid work for 1M particles at about 30
+// neighbours each: a full rebuild, an update after every particle moved a
+// twentieth of the radius, and a neighbour loop over all particles in grid
+// order. Milliseconds per step.
+
+namespace {
+
+constexpr std::size_t N = 1 << 20;
+constexpr float kRadius = 1.f;
+
+template <typename F>
+void report(const char* name, F fn) {
+  std::printf("%-24s %10.3f\n", name, best_ns_per_item(1, fn, 5) * 1e-6);
+}
+
+}  // namespace
+
+int main() {
+  // 30 neighbours in a ball of radius 1: density 30 / (4/3 pi).
+  float side = std::cbrt(static_cast<float>(N) * 4.18879f / 30.f);
+  std::mt19937 gen(13);
+  std::uniform_real_distribution<float> dist(0.f, side);
+  std::vector<Point3f> points(N);
+  for (auto& p : points) p = Point3f(dist(gen), dist(gen), dist(gen));
+  std::vector<Point3f> moved = points;
+  std::uniform_real_distribution<float> step(-0.05f * kRadius,
+                                             0.05f * kRadius);
+  for (auto& p : moved) {
+    p = Point3f(p.x() + step(gen), p.y() + step(gen), p.z() + step(gen));
+  }
+
+  std::printf("%zu particles, %u workers\n", N, default_thread_pool().size());
+  std::printf("%-24s %10s\n", "operation", "ms");
+  HashGridf grid;
+  report("rebuild", [&] {
+    grid.rebuild(std::span<const Point3f>(points), kRadius);
+  });
+  // Every call moves the particles between the two positions.
+  std::size_t changed = 0;
+  bool forth = true;
+  report("update", [&] {
+    changed = grid.update(std::span<const Point3f>(forth ? moved : points));
+    forth = !forth;
+  });
+  std::printf("  %zu particles changed cell\n", changed);
+
+  std::vector<float> density(N);
+  report("neighbour loop", [&] {
+    auto order = grid.order();
+    parallel_for(0, N, 1024, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t s = begin; s < end; ++s) {
+        uint32_t i = order[s];
+        float sum = 0.f;
+        grid.for_each_neighbor(moved[i], [&](uint32_t, float d2) {
+          sum += kRadius * kRadius - d2;
+        });
+        density[i] = sum;
+      }
+    });
+    do_not_optimize(density.data());
+  });
+}
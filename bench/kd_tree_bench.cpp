@@ -0,0 +1,63 @@
+#include "kd_tree.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// Build time and batched query cost of KdTree on uniform random points.
+// Sizes are given on the command line, in millions (default 1 and 4; 100
+// needs about 4 GB):
+//
+//   kd_tree_bench 1 10 100
+
+namespace {
+
+constexpr std::size_t kQueries = 1 << 16;
+constexpr std::size_t kK = 8;
+
+void run(std::size_t n) {
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<float> dist(0.f, 1000.f);
+  std::vector<Point3f> points(n);
+  for (auto& p : points) p = Point3f(dist(gen), dist(gen), dist(gen));
+  std::vector<Point3f> queries(kQueries);
+  for (auto& q : queries) q = Point3f(dist(gen), dist(gen), dist(gen));
+
+  KdTreef tree;
+  double build = best_ns_per_item(
+      n, [&] { tree = KdTreef(std::span<const Point3f>(points)); }, 1);
+
+  std::vector<Neighbor<float>> out(kQueries * 4 * kK);
+  double knn = best_ns_per_item(kQueries, [&] {
+    tree.knn(std::span<const Point3f>(queries), kK, std::span(out));
+    do_not_optimize(out.data());
+  });
+  // About kK points per ball on average.
+  float r = 1000.f * std::cbrt(kK / (4.18879f * static_cast<float>(n)));
+  std::vector<uint32_t> counts(kQueries);
+  double radius = best_ns_per_item(kQueries, [&] {
+    tree.radius(std::span<const Point3f>(queries), r, 4 * kK, std::span(out),
+                std::span(counts));
+    do_not_optimize(out.data());
+  });
+  std::printf("%8zuM %14.1f %14.1f %14.1f\n", n >> 20, build, knn, radius);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::printf("%u workers, %zu queries, k = %zu\n",
+              default_thread_pool().size(), kQueries, kK);
+  std::printf("%9s %14s %14s %14s\n", "points", "build ns/pt", "knn ns/q",
+              "radius ns/q");
+  if (argc < 2) {
+    run(std::size_t{1} << 20);
+    run(std::size_t{4} << 20);
+  }
+  for (int i = 1; i < argc; ++i) {
+    run(static_cast<std::size_t>(std::atof(argv[i]) * (1 << 20)));
+  }
+}
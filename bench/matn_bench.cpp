@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "mat4.h"
+#include "matn.h"
+
+// Mat4 determinant by Mat3 minors, as Mat4 used to compute it, against the
+// closed form by 2x2 minors it shares with Matrix now, and the 4x4 and 6x6
+// kernels of Matrix. Time per matrix.
+
+template <int N>
+Matrix<double, N, N> random_matrix(std::mt19937& gen) {
+  std::uniform_real_distribution<double> dist(-1., 1.);
+  auto m = Matrix<double, N, N>::generate([&](int, int) { return dist(gen); });
+  for (int i = 0; i < N; ++i) m[i][i] += N;
+  return m;
+}
+
+int main() {
+  constexpr std::size_t kCount = 1 << 16;
+  std::mt19937 gen(49);
+  std::vector<Mat4d> m4(kCount), inv4(kCount);
+  std::vector<Matrix<double, 6, 6>> m6(kCount), out6(kCount);
+  std::vector<double> det(kCount);
+  for (std::size_t i = 0; i < kCount; ++i) {
+    m4[i] = Mat4d(random_matrix<4>(gen));
+    m6[i] = random_matrix<6>(gen);
+  }
+
+  std::printf("%zu matrices\n", kCount);
+  std::printf("%-28s %12s\n", "", "ns/matrix");
+  double ns = best_ns_per_item(kCount, [&] {
+    for (std::size_t i = 0; i < kCount; ++i) {
+      double d = 0;
+      for (int j = 0; j < 4; ++j) d += m4[i][0][j] * m4[i].coFactor(0, j);
+      det[i] = d;
+    }
+    do_not_optimize(det.data());
+  });
+  std::printf("%-28s %12.2f\n", "Mat4d det, Mat3 minors", ns);
+  ns = best_ns_per_item(kCount, [&] {
+    for (std::size_t i = 0; i < kCount; ++i) det[i] = m4[i].determinant();
+    do_not_optimize(det.data());
+  });
+  std::printf("%-28s %12.2f\n", "Mat4d det, 2x2 minors", ns);
+  ns = best_ns_per_item(kCount, [&] {
+    for (std::size_t i = 0; i < kCount; ++i) inv4[i] = m4[i].inverse();
+    do_not_optimize(inv4.data());
+  });
+  std::printf("%-28s %12.2f\n", "Mat4d inverse", ns);
+  ns = best_ns_per_item(kCount, [&] {
+    for (std::size_t i = 0; i < kCount; ++i) det[i] = m6[i].determinant();
+    do_not_optimize(det.data());
+  });
+  std::printf("%-28s %12.2f\n", "Mat6d det", ns);
+  ns = best_ns_per_item(kCount, [&] {
+    for (std::size_t i = 0; i < kCount; ++i) out6[i] = m6[i].inverse();
+    do_not_optimize(out6.data());
+  });
+  std::printf("%-28s %12.2f\n", "Mat6d inverse", ns);
+  ns = best_ns_per_item(kCount, [&] {
+    for (std::size_t i = 0; i < kCount; ++i) out6[i] = m6[i] * m6[i];
+    do_not_optimize(out6.data());
+  });
+  std::printf("%-28s %12.2f\n", "Mat6d * Mat6d", ns);
+}
@@ -0,0 +1,100 @@
+#include "mesh_io.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+
+// Loads a generated grid mesh from OBJ and binary PLY files with one thread
+// and with all of them. The files are in the page cache after the first run.
+
+namespace {
+
+constexpr int kGrid = 1024;
+
+std::vector<Point3f> grid_points() {
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<float> noise(-0.01f, 0.01f);
+  std::vector<Point3f> points;
+  for (int j = 0; j < kGrid; ++j) {
+    for (int i = 0; i < kGrid; ++i) {
+      points.emplace_back(i * 0.1f, j * 0.1f, noise(gen));
+    }
+  }
+  return points;
+}
+
+template <typename F>
+void for_each_quad(F fn) {
+  for (int j = 0; j + 1 < kGrid; ++j) {
+    for (int i = 0; i + 1 < kGrid; ++i) {
+      uint32_t a = j * kGrid + i;
+      fn(a, a + 1, a + kGrid + 1, a + kGrid);
+    }
+  }
+}
+
+void report(const std::string& path, unsigned threads) {
+  auto bytes = std::filesystem::file_size(path);
+  std::size_t items = std::size_t{kGrid} * kGrid;
+  auto ns = best_ns_per_item(items, [&] {
+    MeshBuffers mesh;
+    load_mesh(path, mesh, {.threads = threads});
+    do_not_optimize(mesh.indices.data());
+  }, 3);
+  std::printf("%-6s %8u %12.2f %10.0f\n",
+              path.substr(path.size() - 3).c_str(), threads, ns,
+              static_cast<double>(bytes) * 1e3 / (ns * items));
+}
+
+}  // namespace
+
+int main() {
+  auto points = grid_points();
+  auto dir = std::filesystem::temp_directory_path();
+  auto obj = (dir / "math_mesh_io_bench.obj").string();
+  auto ply = (dir / "math_mesh_io_bench.ply").string();
+  {
+    std::ofstream out(obj, std::ios::binary);
+    std::string text(points.size() * max_formatted_size<Point3f>(2), '\0');
+    text.resize(format_points(points, std::span<char>(text), "v ").size);
+    out << text;
+    for_each_quad([&](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+      out << "f " << a + 1 << ' ' << b + 1 << ' ' << c + 1 << ' ' << d + 1
+          << '\n';
+    });
+  }
+  {
+    std::ofstream out(ply, std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\nelement vertex "
+        << points.size()
+        << "\nproperty float x\nproperty float y\nproperty float z\n"
+           "element face "
+        << (kGrid - 1) * (kGrid - 1)
+        << "\nproperty list uchar int vertex_indices\nend_header\n";
+    out.write(reinterpret_cast<const char*>(points.data()),
+              points.size() * sizeof(Point3f));
+    for_each_quad([&](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+      uint8_t n = 4;
+      int32_t idx[] = {int32_t(a), int32_t(b), int32_t(c), int32_t(d)};
+      out.write(reinterpret_cast<const char*>(&n), 1);
+      out.write(reinterpret_cast<const char*>(idx), sizeof(idx));
+    });
+  }
+
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::printf("%d x %d grid\n", kGrid, kGrid);
+  std::printf("%-6s %8s %12s %10s\n", "format", "threads", "ns/vertex",
+              "MB/s");
+  for (const auto& path : {obj, ply}) {
+    report(path, 1);
+    if (threads > 1) report(path, threads);
+  }
+  std::filesystem::remove(obj);
+  std::filesystem::remove(ply);
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "bvh.h"
+#include "scenes.h"
+#include "wavefront.h"
+
+// Shadow rays from the visible points of a terrain to a light low over its
+// hills, traced for the nearest hit and with the any-hit query. Both count
+// the same shadowed points; the time is per ray.
+
+int main() {
+  std::vector<Trianglef> triangles = terrain(400);
+  Bvhf bvh{std::span<const Trianglef>(triangles)};
+  Mat4f view = view_transform(Point3f(0.f, 25.f, 60.f),
+                              Point3f(0.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f));
+  Mat4f projection = perspective(30.f, 16.f / 9.f, 0.1f, 500.f);
+  Point3f light(-40.f, 12.f, -30.f);
+
+  RayQueue camera;
+  generate_camera_rays(view, projection, 960, 540, camera);
+  std::vector<TriangleHit<float>> hits(camera.count);
+  extend(bvh, camera, std::span(hits));
+  std::vector<Ray> shadows;
+  for (std::size_t i = 0; i < camera.count; ++i) {
+    if (!hits[i].hit()) continue;
+    Point3f at = camera.ray(i).position(hits[i].t);
+    Ray ray(at, light - at);
+    ray.setMinRange(1e-3f);
+    ray.setMaxRange(1.f);
+    shadows.push_back(ray);
+  }
+  std::size_t n = shadows.size();
+
+  std::printf("%zu triangles, %zu shadow rays, %u workers\n",
+              triangles.size(), n, default_thread_pool().size());
+  std::size_t nearest_count = 0;
+  double nearest = best_ns_per_item(n, [&] {
+    nearest_count = 0;
+    for (const Ray& ray : shadows) nearest_count += bvh.intersect(ray).hit();
+  });
+  std::size_t any_count = 0;
+  double any = best_ns_per_item(n, [&] {
+    any_count = 0;
+    for (const Ray& ray : shadows) any_count += bvh.occluded(ray);
+  });
+  std::vector<uint8_t> blocked(n);
+  double batch = best_ns_per_item(n, [&] {
+    bvh.occluded(std::span<const Ray>(shadows), std::span(blocked));
+    do_not_optimize(blocked.data());
+  });
+
+  std::printf("%-22s %10s %10s\n", "query", "ns/ray", "shadowed");
+  std::printf("%-22s %10.1f %10zu\n", "intersect().hit()", nearest,
+              nearest_count);
+  std::printf("%-22s %10.1f %10zu\n", "occluded()", any, any_count);
+  std::printf("%-22s %10.1f\n", "occluded(), batch", batch);
+}
@@ -0,0 +1,61 @@
+#include "octree.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// Build time and query cost of Octree over points on a sphere, a sparse
+// surface as from a scan, at increasing depths.
+
+namespace {
+
+constexpr std::size_t N = 1 << 21;
+constexpr std::size_t kQueries = 1 << 16;
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(17);
+  std::normal_distribution<float> normal(0.f, 1.f);
+  std::vector<Point3f> points(N);
+  for (auto& p : points) {
+    Vec3f v(normal(gen), normal(gen), normal(gen));
+    p = Point3f(0.f, 0.f, 0.f) + v / v.length() * 100.f;
+  }
+  // Rays from outside towards random points on the sphere, so most hit.
+  std::uniform_real_distribution<float> jitter(-5.f, 5.f);
+  std::vector<Ray> rays(kQueries);
+  for (auto& r : rays) {
+    Point3f target = points[gen() % N];
+    Point3f from(jitter(gen) * 40.f, jitter(gen) * 40.f, 300.f);
+    r = Ray(from, target - from);
+  }
+
+  std::printf("%zu points, %u workers\n", N, default_thread_pool().size());
+  std::printf("%6s %10s %12s %14s %12s\n", "depth", "voxels", "build ns/pt",
+              "raycast ns/q", "find ns/q");
+  for (int depth : {8, 12, 16}) {
+    Octreef tree;
+    double build = best_ns_per_item(
+        N, [&] { tree = Octreef(std::span<const Point3f>(points), depth); },
+        1);
+    std::vector<OctreeHit<float>> hits(kQueries);
+    double raycast = best_ns_per_item(kQueries, [&] {
+      for (std::size_t i = 0; i < kQueries; ++i) {
+        hits[i] = tree.raycast(rays[i]);
+      }
+      do_not_optimize(hits.data());
+    });
+    std::vector<uint32_t> found(kQueries);
+    double find = best_ns_per_item(kQueries, [&] {
+      for (std::size_t i = 0; i < kQueries; ++i) {
+        found[i] = tree.find_voxel(points[i * 31]);
+      }
+      do_not_optimize(found.data());
+    });
+    std::printf("%6d %10zu %12.1f %14.1f %12.1f\n", depth, tree.voxel_count(),
+                build, raycast, find);
+  }
+}
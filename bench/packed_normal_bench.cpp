@@ -0,0 +1,81 @@
+#include "packed_normal.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// Scalar against batch pack/unpack, and a Lambert term summed over an array
+// of Normal3f next to the same array packed, where the packed loop reads a
+// third or a sixth of the memory.
+
+namespace {
+
+constexpr std::size_t N = 1 << 22;
+
+template <typename F>
+void report(const char* name, F fn) {
+  std::printf("%-28s %10.2f\n", name, best_ns_per_item(N, fn, 5));
+}
+
+template <typename U>
+void run(const char* label, const std::vector<Normal3f>& normals) {
+  std::vector<PackedNormal<U>> packed(N);
+  std::vector<Normal3f> unpacked(N);
+  Vec3f light = normalized(Vec3f(1.f, 2.f, 3.f));
+  char name[64];
+
+  std::snprintf(name, sizeof(name), "pack scalar %s", label);
+  report(name, [&] {
+    for (std::size_t i = 0; i < N; ++i) {
+      packed[i] = PackedNormal<U>(normals[i]);
+    }
+    do_not_optimize(packed.data());
+  });
+  std::snprintf(name, sizeof(name), "pack batch %s", label);
+  report(name, [&] {
+    pack(std::span<const Normal3f>(normals), std::span(packed));
+    do_not_optimize(packed.data());
+  });
+  std::snprintf(name, sizeof(name), "unpack scalar %s", label);
+  report(name, [&] {
+    for (std::size_t i = 0; i < N; ++i) unpacked[i] = packed[i].unpack();
+    do_not_optimize(unpacked.data());
+  });
+  std::snprintf(name, sizeof(name), "unpack batch %s", label);
+  report(name, [&] {
+    unpack(std::span<const PackedNormal<U>>(packed), std::span(unpacked));
+    do_not_optimize(unpacked.data());
+  });
+  std::snprintf(name, sizeof(name), "lambert packed %s", label);
+  report(name, [&] {
+    float sum = 0.f;
+    for (const auto& p : packed) sum += std::max(dot(p, light), 0.f);
+    do_not_optimize(sum);
+  });
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(5);
+  std::normal_distribution<float> dist;
+  std::vector<Normal3f> normals(N);
+  for (auto& n : normals) {
+    n = normalized(Normal3f(dist(gen), dist(gen), dist(gen)));
+  }
+
+  std::printf("%zu normals\n", N);
+  std::printf("%-28s %10s\n", "method", "ns/normal");
+  Vec3f light = normalized(Vec3f(1.f, 2.f, 3.f));
+  report("lambert Normal3f", [&] {
+    float sum = 0.f;
+    for (const auto& n : normals) {
+      sum += std::max(dot(Vec3f(n.x(), n.y(), n.z()), light), 0.f);
+    }
+    do_not_optimize(sum);
+  });
+  run<uint16_t>("16", normals);
+  run<uint32_t>("32", normals);
+}
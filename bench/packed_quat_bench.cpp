@@ -0,0 +1,61 @@
+#include "packed_quat.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// Decoding packed quaternions into a Quat array, scalar against batch, in
+// nanoseconds and millions of quaternions per second on one thread.
+
+namespace {
+
+constexpr std::size_t N = 1 << 22;
+
+template <typename F>
+void report(const char* name, F fn) {
+  double ns = best_ns_per_item(N, fn, 5);
+  std::printf("%-20s %10.2f %10.0f\n", name, ns, 1e3 / ns);
+}
+
+template <int N>
+void run(const char* label, const std::vector<Quat>& quats) {
+  std::vector<PackedQuat<N>> packed(quats.size());
+  std::vector<Quat> unpacked(quats.size());
+  char name[64];
+
+  std::snprintf(name, sizeof(name), "pack %s", label);
+  report(name, [&] {
+    pack(std::span<const Quat>(quats), std::span(packed));
+    do_not_optimize(packed.data());
+  });
+  std::snprintf(name, sizeof(name), "unpack scalar %s", label);
+  report(name, [&] {
+    for (std::size_t i = 0; i < packed.size(); ++i) {
+      unpacked[i] = packed[i].unpack();
+    }
+    do_not_optimize(unpacked.data());
+  });
+  std::snprintf(name, sizeof(name), "unpack batch %s", label);
+  report(name, [&] {
+    unpack(std::span<const PackedQuat<N>>(packed), std::span(unpacked));
+    do_not_optimize(unpacked.data());
+  });
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(6);
+  std::normal_distribution<float> dist;
+  std::vector<Quat> quats(N);
+  for (auto& q : quats) {
+    q = normalized(Quat(dist(gen), dist(gen), dist(gen), dist(gen)));
+  }
+
+  std::printf("%zu quaternions\n", N);
+  std::printf("%-20s %10s %10s\n", "method", "ns/quat", "M/s");
+  run<10>("32", quats);
+  run<15>("48", quats);
+}
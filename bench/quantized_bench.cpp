@@ -0,0 +1,64 @@
+#include "quantized.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// Batch conversion between float and the storage scalars next to a loop
+// converting one value at a time. quantized_bench_native is the same
+// program built with -march=native, which enables the F16C and AVX-512
+// paths for half.
+
+namespace {
+
+constexpr std::size_t N = 1 << 22;
+
+template <typename F>
+void report(const char* name, F fn) {
+  std::printf("%-24s %10.3f\n", name, best_ns_per_item(N, fn, 5));
+}
+
+template <typename S>
+void run(const char* label, const std::vector<float>& values) {
+  std::vector<S> packed(N);
+  std::vector<float> unpacked(N);
+  char name[64];
+
+  std::snprintf(name, sizeof(name), "%s encode loop", label);
+  report(name, [&] {
+    for (std::size_t i = 0; i < N; ++i) packed[i] = values[i];
+    do_not_optimize(packed.data());
+  });
+  std::snprintf(name, sizeof(name), "%s encode batch", label);
+  report(name, [&] {
+    convert(std::span<const float>(values), std::span(packed));
+    do_not_optimize(packed.data());
+  });
+  std::snprintf(name, sizeof(name), "%s decode loop", label);
+  report(name, [&] {
+    for (std::size_t i = 0; i < N; ++i) unpacked[i] = packed[i];
+    do_not_optimize(unpacked.data());
+  });
+  std::snprintf(name, sizeof(name), "%s decode batch", label);
+  report(name, [&] {
+    convert(std::span<const S>(packed), std::span(unpacked));
+    do_not_optimize(unpacked.data());
+  });
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(2);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  std::vector<float> values(N);
+  for (auto& v : values) v = dist(gen);
+
+  std::printf("%zu values\n", N);
+  std::printf("%-24s %10s\n", "method", "ns/value");
+  run<half>("half", values);
+  run<unorm8>("unorm8", values);
+  run<snorm16>("snorm16", values);
+}
@@ -0,0 +1,77 @@
+#include "ray_sort.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "bvh.h"
+#include "scenes.h"
+
+// Traversal of one bounce of diffuse rays off a terrain: in the order the
+// pixels produced them, shuffled as after a few bounces of compaction, and
+// the shuffled rays after sorting by ray_sort_key(). Nanoseconds per ray.
+
+namespace {
+
+constexpr uint32_t kWidth = 960;
+constexpr uint32_t kHeight = 540;
+
+}  // namespace
+
+int main() {
+  std::vector<Trianglef> triangles = terrain(400);
+  Bvhf bvh{std::span<const Trianglef>(triangles)};
+  Mat4f view = view_transform(Point3f(0.f, 25.f, 60.f),
+                              Point3f(0.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f));
+  Mat4f projection = perspective(30.f, 16.f / 9.f, 0.1f, 500.f);
+
+  // Primary hits, then one cosine-distributed bounce from each.
+  RayQueue primary, bounces;
+  generate_camera_rays(view, projection, kWidth, kHeight, primary);
+  std::vector<TriangleHit<float>> hits(primary.count);
+  extend(bvh, primary, std::span(hits));
+  shade(primary, std::span<const TriangleHit<float>>(hits),
+        [&](Path& path, const TriangleHit<float>& hit) {
+          if (!hit.hit()) return false;
+          Vec3f n = normalized(triangles[hit.triangle].normal());
+          if (dot(n, path.ray.direction()) > 0.f) n = n * -1.f;
+          Vec3f d = cosine_direction(n, hash_float(path.pixel, 0),
+                                     hash_float(path.pixel, 1));
+          path.ray = Ray(path.ray.position(hit.t), d);
+          path.ray.setMinRange(1e-3f);
+          return true;
+        });
+  compact(primary, bounces);
+  std::size_t n = bounces.count;
+
+  std::printf("%zu triangles, %zu bounce rays, %u workers\n",
+              triangles.size(), n, default_thread_pool().size());
+  auto traverse = [&](const RayQueue& queue) {
+    return best_ns_per_item(n, [&] {
+      extend(bvh, queue, std::span(hits));
+      do_not_optimize(hits.data());
+    });
+  };
+
+  std::vector<uint32_t> order(n);
+  for (uint32_t i = 0; i < n; ++i) order[i] = i;
+  std::shuffle(order.begin(), order.end(), std::mt19937(1));
+  RayQueue shuffled(n);
+  shuffled.resize(n);
+  for (std::size_t i = 0; i < n; ++i) shuffled.copy(i, bounces, order[i]);
+
+  RaySorter sorter;
+  RayQueue sorted;
+  double sort = best_ns_per_item(n, [&] {
+    sorted = shuffled;
+    sorter.sort(sorted, bvh.bounds());
+  });
+
+  std::printf("%-24s %10s\n", "stage", "ns/ray");
+  std::printf("%-24s %10.1f\n", "extend, pixel order", traverse(bounces));
+  std::printf("%-24s %10.1f\n", "extend, shuffled", traverse(shuffled));
+  std::printf("%-24s %10.1f\n", "sort (incl. copy)", sort);
+  std::printf("%-24s %10.1f\n", "extend, sorted", traverse(sorted));
+}
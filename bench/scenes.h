@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "orthonormal.h"
+#include "point3.h"
+#include "triangle.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Test scenes shared by the ray tracing benchmarks
+//--------------------------------------------
+
+// Rolling hills over [-50, 50]^2 in x and z, n x n quads of two triangles.
+inline std::vector<Trianglef> terrain(int n) {
+  auto height = [](float x, float z) {
+    return 4.f * std::sin(x * 0.15f) * std::cos(z * 0.11f) +
+           std::sin(x * 0.9f + z * 0.7f);
+  };
+  auto vertex = [&](int i, int j) {
+    float x = -50.f + 100.f * static_cast<float>(i) / static_cast<float>(n);
+    float z = -50.f + 100.f * static_cast<float>(j) / static_cast<float>(n);
+    return Point3f(x, height(x, z), z);
+  };
+  std::vector<Trianglef> triangles;
+  triangles.reserve(2 * static_cast<std::size_t>(n) * n);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      triangles.push_back({vertex(i, j), vertex(i, j + 1), vertex(i + 1, j)});
+      triangles.push_back(
+          {vertex(i + 1, j), vertex(i, j + 1), vertex(i + 1, j + 1)});
+    }
+  }
+  return triangles;
+}
+
+// Uniform float in [0, 1) from two integers, the same on every run.
+inline float hash_float(uint32_t a, uint32_t b) {
+  uint32_t h = a * 0x9e3779b9u ^ (b + 0x7f4a7c15u) * 0x85ebca6bu;
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
+  return static_cast<float>(h >> 8) * 0x1p-24f;
+}
+
+// Cosine-weighted direction about the unit normal n, from two uniform
+// numbers.
+inline Vec3f cosine_direction(const Vec3f& n, float u1, float u2) {
+  OrthoNormalBasis basis;
+  basis.buildFromW(n);
+  float r = std::sqrt(u1);
+  float phi = 6.2831853f * u2;
+  return basis.local(r * std::cos(phi), r * std::sin(phi),
+                     std::sqrt(1.f - u1));
+}
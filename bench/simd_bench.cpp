@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "mat4.h"
+#include "simd.h"
+#include "vec3.h"
+#include "vec4.h"
+
+// The same dot/normalized/reflect and Mat4 * Vec4 source on Vec3f one
+// vector at a time and on Vec3<Simd> over the arrays of x, y and z, a
+// register of vectors at a time. Time per vector.
+
+template <typename S>
+double reflect_lanes(const std::vector<float> (&d)[3],
+                     const std::vector<float> (&n)[3],
+                     std::vector<float> (&out)[3]) {
+  constexpr int kLanes = S::size();
+  return best_ns_per_item(d[0].size(), [&] {
+    for (std::size_t i = 0; i < d[0].size(); i += kLanes) {
+      Vec3<S> dv(S::load(&d[0][i]), S::load(&d[1][i]), S::load(&d[2][i]));
+      Vec3<S> nv(S::load(&n[0][i]), S::load(&n[1][i]), S::load(&n[2][i]));
+      Vec3<S> r = reflect(dv, normalized(nv));
+      r.x().store(&out[0][i]);
+      r.y().store(&out[1][i]);
+      r.z().store(&out[2][i]);
+    }
+    do_not_optimize(out[0].data());
+  });
+}
+
+template <typename S>
+double transform_lanes(const Mat4f& m, const std::vector<float> (&p)[3],
+                       std::vector<float> (&out)[3]) {
+  constexpr int kLanes = S::size();
+  Mat4<S> ms;
+  for (int r = 0; r < 4; ++r) {
+    ms[r] = Vec4<S>(m[r].x(), m[r].y(), m[r].z(), m[r].w());
+  }
+  return best_ns_per_item(p[0].size(), [&] {
+    for (std::size_t i = 0; i < p[0].size(); i += kLanes) {
+      Vec4<S> v(S::load(&p[0][i]), S::load(&p[1][i]), S::load(&p[2][i]),
+                S(1.f));
+      Vec4<S> r = ms * v;
+      r.x().store(&out[0][i]);
+      r.y().store(&out[1][i]);
+      r.z().store(&out[2][i]);
+    }
+    do_not_optimize(out[0].data());
+  });
+}
+
+int main() {
+  constexpr std::size_t kCount = 1 << 20;
+  std::mt19937 gen(48);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  std::vector<float> d[3], n[3], out[3];
+  std::vector<Vec3f> dv(kCount), nv(kCount), outv(kCount);
+  std::vector<Vec4f> pv(kCount), transformed(kCount);
+  for (int a = 0; a < 3; ++a) {
+    d[a].resize(kCount);
+    n[a].resize(kCount);
+    out[a].resize(kCount);
+    for (std::size_t i = 0; i < kCount; ++i) {
+      d[a][i] = dist(gen);
+      n[a][i] = dist(gen);
+    }
+  }
+  for (std::size_t i = 0; i < kCount; ++i) {
+    dv[i] = Vec3f(d[0][i], d[1][i], d[2][i]);
+    nv[i] = Vec3f(n[0][i], n[1][i], n[2][i]);
+    pv[i] = Vec4f(d[0][i], d[1][i], d[2][i], 1.f);
+  }
+  Mat4f m = translation(1.f, 2.f, 3.f) * rotationOverY(0.7f);
+
+  std::printf("%zu vectors, %d-byte registers\n", kCount, kSimdBytes);
+  std::printf("%-12s %12s %12s %12s\n", "ns/vector", "Vec3f", "Simd4f",
+              "Simd8f");
+  double scalar = best_ns_per_item(kCount, [&] {
+    for (std::size_t i = 0; i < kCount; ++i) {
+      outv[i] = reflect(dv[i], normalized(nv[i]));
+    }
+    do_not_optimize(outv.data());
+  });
+  std::printf("%-12s %12.2f %12.2f %12.2f\n", "reflect", scalar,
+              reflect_lanes<Simd4f>(d, n, out),
+              reflect_lanes<Simd8f>(d, n, out));
+  scalar = best_ns_per_item(kCount, [&] {
+    for (std::size_t i = 0; i < kCount; ++i) transformed[i] = m * pv[i];
+    do_not_optimize(transformed.data());
+  });
+  std::printf("%-12s %12.2f %12.2f %12.2f\n", "Mat4 * Vec4", scalar,
+              transform_lanes<Simd4f>(m, d, out),
+              transform_lanes<Simd8f>(m, d, out));
+}
@@ -0,0 +1,77 @@
+#include "spatial_sort.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+
+// Sorting 64-bit keys with radix_sort against std::sort, the cost of the
+// whole spatial_sort, and what it buys: splatting the points into a 256^3
+// grid (64 MB) before and after reordering, in nanoseconds per point.
+
+namespace {
+
+constexpr std::size_t N = 1 << 22;
+constexpr int kGrid = 256;
+
+template <typename F>
+void report(const char* name, F fn) {
+  std::printf("%-28s %10.3f\n", name, best_ns_per_item(N, fn, 3));
+}
+
+void splat(const std::vector<Point3f>& points, std::vector<float>& grid) {
+  for (const auto& p : points) {
+    auto x = static_cast<int>(p.x()), y = static_cast<int>(p.y()),
+         z = static_cast<int>(p.z());
+    grid[(std::size_t{static_cast<unsigned>(z)} * kGrid + y) * kGrid + x] +=
+        1.f;
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937_64 gen(8);
+  std::vector<uint64_t> random_keys(N);
+  for (auto& k : random_keys) k = gen() >> 1;
+  std::vector<uint64_t> keys(N);
+  std::vector<uint32_t> values(N);
+
+  std::printf("%zu points, %u workers\n", N, default_thread_pool().size());
+  std::printf("%-28s %10s\n", "method", "ns/point");
+  report("std::sort keys", [&] {
+    keys = random_keys;
+    std::sort(keys.begin(), keys.end());
+    do_not_optimize(keys.data());
+  });
+  report("radix_sort keys + values", [&] {
+    keys = random_keys;
+    std::iota(values.begin(), values.end(), 0u);
+    radix_sort(std::span(keys), std::span(values));
+    do_not_optimize(keys.data());
+  });
+
+  std::uniform_real_distribution<float> dist(0.f, kGrid - 0.001f);
+  std::vector<Point3f> points(N);
+  for (auto& p : points) p = Point3f(dist(gen), dist(gen), dist(gen));
+  std::vector<float> grid(std::size_t{kGrid} * kGrid * kGrid);
+  report("splat, input order", [&] {
+    splat(points, grid);
+    do_not_optimize(grid.data());
+  });
+  for (SpaceCurve curve : {SpaceCurve::morton, SpaceCurve::hilbert}) {
+    bool morton = curve == SpaceCurve::morton;
+    std::vector<Point3f> sorted;
+    report(morton ? "spatial_sort morton" : "spatial_sort hilbert", [&] {
+      sorted = points;
+      spatial_sort(curve, std::span(sorted));
+    });
+    report(morton ? "splat, morton order" : "splat, hilbert order", [&] {
+      splat(sorted, grid);
+      do_not_optimize(grid.data());
+    });
+  }
+}
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "bench.h"
+#include "symmetric_eigen.h"
+#include "thread_pool.h"
+
+// Eigen-decompositions of random covariances one Mat3 at a time and in
+// SoA batches a Simd register at a time, on one thread, and the
+// covariances of 16-point neighbourhoods. Time per matrix.
+
+template <typename T>
+SymmetricMat3SoA<T> random_covariances(std::size_t n, std::mt19937& gen) {
+  std::uniform_real_distribution<T> dist(-1, 1);
+  SymmetricMat3SoA<T> soa;
+  soa.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    Covariance3<T> c;
+    for (int k = 0; k < 16; ++k) {
+      c.add(Point3<T>(dist(gen), dist(gen), T(0.1) * dist(gen)));
+    }
+    soa.set(i, c.matrix());
+  }
+  return soa;
+}
+
+template <typename T>
+void run(const char* name, std::size_t n, std::mt19937& gen) {
+  ThreadPool serial{0};
+  SymmetricMat3SoA<T> soa = random_covariances<T>(n, gen);
+  std::vector<Mat3<T>> mats(n);
+  for (std::size_t i = 0; i < n; ++i) mats[i] = soa.get(i);
+  std::vector<SymmetricEigen3<T>> out(n);
+  double scalar = best_ns_per_item(n, [&] {
+    for (std::size_t i = 0; i < n; ++i) out[i] = eigen_symmetric(mats[i]);
+    do_not_optimize(out.data());
+  });
+  double batch = best_ns_per_item(n, [&] {
+    eigen_symmetric(soa, std::span(out), serial);
+    do_not_optimize(out.data());
+  });
+  std::printf("%-10s %12.2f %12.2f\n", name, scalar, batch);
+}
+
+int main() {
+  constexpr std::size_t kCount = 1 << 18;
+  std::mt19937 gen(50);
+  std::printf("%zu matrices, %d-byte registers, one thread\n", kCount,
+              kSimdBytes);
+  std::printf("%-10s %12s %12s\n", "ns/matrix", "Mat3", "SoA batch");
+  run<float>("float", kCount, gen);
+  run<double>("double", kCount, gen);
+
+  std::uniform_real_distribution<float> dist(-1, 1);
+  std::vector<Point3f> points(kCount);
+  for (auto& p : points) p = Point3f(dist(gen), dist(gen), dist(gen));
+  constexpr std::size_t kK = 16;
+  std::vector<Neighbor<float>> rows(kCount * kK);
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    rows[i].index = static_cast<uint32_t>(gen() % kCount);
+  }
+  ThreadPool serial{0};
+  SymmetricMat3SoA<float> cov;
+  double ns = best_ns_per_item(kCount, [&] {
+    neighborhood_covariances<float>(points, rows, kK, cov, serial);
+    do_not_optimize(cov.xx.data());
+  });
+  std::printf("%-10s %12.2f  (16 neighbours)\n", "covariance", ns);
+}
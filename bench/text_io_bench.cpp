@@ -0,0 +1,72 @@
+#include "text_io.h"
+
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+
+// Throughput of parse_points/format_points next to the stream operators, in
+// MB of text per second on a generated OBJ vertex list.
+
+namespace {
+
+constexpr std::size_t N = 1 << 21;
+
+template <typename F>
+void report(const char* name, std::size_t bytes, F fn) {
+  auto ns = best_ns_per_item(N, fn, 3);
+  std::printf("%-24s %10.2f %10.0f\n", name, ns,
+              static_cast<double>(bytes) * 1e3 / (ns * N));
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<float> dist(-1000.f, 1000.f);
+  std::vector<Point3f> points(N);
+  for (auto& p : points) p = Point3f(dist(gen), dist(gen), dist(gen));
+
+  std::string text(N * max_formatted_size<Point3f>(2), '\0');
+  text.resize(format_points(points, std::span<char>(text), "v ").size);
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::printf("%zu points, %zu bytes of text\n", N, text.size());
+  std::printf("%-24s %10s %10s\n", "method", "ns/point", "MB/s");
+  report("istream >> Vec3f", text.size(), [&] {
+    std::istringstream in(text);
+    std::vector<Vec3f> loaded;
+    loaded.reserve(N);
+    std::string tag;
+    Vec3f v;
+    while (in >> tag >> v) loaded.push_back(v);
+    do_not_optimize(loaded.data());
+  });
+  report("parse_points", text.size(), [&] {
+    auto loaded = parse_points(text);
+    do_not_optimize(loaded.data());
+  });
+  std::string name = "parse_points, " + std::to_string(threads) + " threads";
+  report(name.c_str(), text.size(), [&] {
+    auto loaded = parse_points(text, threads);
+    do_not_optimize(loaded.data());
+  });
+
+  report("ostream << x y z", text.size(), [&] {
+    std::ostringstream out;
+    for (const auto& p : points) {
+      out << "v " << p.x() << ' ' << p.y() << ' ' << p.z() << '\n';
+    }
+    do_not_optimize(out.str().data());
+  });
+  std::string buffer(text.size() + 64, '\0');
+  report("format_points", text.size(), [&] {
+    auto r = format_points(points, std::span<char>(buffer), "v ");
+    do_not_optimize(r);
+  });
+  return 0;
+}
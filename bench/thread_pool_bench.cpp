@@ -0,0 +1,55 @@
+#include "thread_pool.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "aabb.h"
+#include "bench.h"
+#include "transform.h"
+
+// Bulk operations on pools of 0 (the calling thread only), 1, 3 and
+// hardware_concurrency() - 1 workers, in nanoseconds per point, plus the
+// cost of an empty parallel_for per task it runs.
+
+namespace {
+
+constexpr std::size_t N = 1 << 22;
+
+template <typename F>
+void report(const char* name, unsigned workers, std::size_t items, F fn) {
+  std::printf("%-24s %8u %10.3f\n", name, workers,
+              best_ns_per_item(items, fn, 5));
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(5);
+  std::uniform_real_distribution<float> dist(-100.f, 100.f);
+  std::vector<Point3f> points(N);
+  for (auto& p : points) p = Point3f(dist(gen), dist(gen), dist(gen));
+  std::vector<Point3f> out(N);
+  Mat4f m = translation(1.f, 2.f, 3.f) * scale(2.f, 2.f, 2.f);
+
+  std::printf("%zu points, %u hardware threads\n", N,
+              std::thread::hardware_concurrency());
+  std::printf("%-24s %8s %10s\n", "operation", "workers", "ns/item");
+  unsigned counts[] = {0, 1, 3, default_thread_pool().size()};
+  for (unsigned workers : counts) {
+    ThreadPool pool(workers);
+    report("bounds", workers, N, [&] {
+      auto box = bounds(std::span<const Point3f>(points), pool);
+      do_not_optimize(&box);
+    });
+    report("transform_points", workers, N, [&] {
+      transform_points(m, std::span<const Point3f>(points), std::span(out),
+                       pool);
+      do_not_optimize(out.data());
+    });
+    constexpr std::size_t kTasks = 1 << 16;
+    report("empty tasks", workers, kTasks, [&] {
+      parallel_for(pool, 0, kTasks, 1, [](std::size_t, std::size_t) {});
+    });
+  }
+}
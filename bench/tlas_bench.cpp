@@ -0,0 +1,107 @@
+#include "tlas.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "bench.h"
+#include "scenes.h"
+#include "wavefront.h"
+
+// A forest: one 2k-triangle mesh placed kSide x kSide times with its own
+// rotation and scale, traced as instances of one shared Bvh and as one
+// Bvh over every placed triangle. Memory is that of the acceleration
+// structures; the time is per camera ray.
+
+namespace {
+
+constexpr int kSide = 64;
+
+std::size_t bvh_bytes(const Bvhf& bvh) {
+  return bvh.node_count() * sizeof(BvhNode<float>) +
+         bvh.size() * (sizeof(Trianglef) + sizeof(uint32_t));
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+}  // namespace
+
+int main() {
+  std::vector<Trianglef> tree = terrain(32);
+  std::vector<Bvhf> meshes;
+  meshes.emplace_back(std::span<const Trianglef>(tree));
+
+  std::vector<Instancef> instances;
+  std::vector<Trianglef> flat;
+  for (int i = 0; i < kSide; ++i) {
+    for (int j = 0; j < kSide; ++j) {
+      uint32_t id = static_cast<uint32_t>(i * kSide + j);
+      float s = 0.02f + 0.01f * hash_float(id, 0);
+      Mat4f m = translation(3.f * static_cast<float>(i - kSide / 2), 0.f,
+                            3.f * static_cast<float>(j - kSide / 2)) *
+                rotationOverY(6.28f * hash_float(id, 1)) *
+                rotationOverX(1.57f) * scale(s, s, 0.1f);
+      instances.push_back({0, m});
+      for (const Trianglef& t : tree) {
+        auto place = [&](const Point3f& p) {
+          Vec4f w = m * Vec4f(p.x(), p.y(), p.z(), 1.f);
+          return Point3f(w.x(), w.y(), w.z());
+        };
+        flat.push_back({place(t.a), place(t.b), place(t.c)});
+      }
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  Tlasf tlas{std::span<const Bvhf>(meshes),
+             std::span<const Instancef>(instances)};
+  double tlas_build = seconds_since(start);
+  start = std::chrono::steady_clock::now();
+  Bvhf bvh{std::span<const Trianglef>(flat)};
+  double flat_build = seconds_since(start);
+
+  Mat4f view = view_transform(Point3f(0.f, 30.f, 110.f),
+                              Point3f(0.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f));
+  Mat4f projection = perspective(40.f, 16.f / 9.f, 0.1f, 500.f);
+  RayQueue camera;
+  generate_camera_rays(view, projection, 640, 360, camera);
+  std::vector<Ray> rays(camera.count);
+  for (std::size_t i = 0; i < rays.size(); ++i) rays[i] = camera.ray(i);
+
+  std::vector<InstanceHit<float>> instance_hits(rays.size());
+  double two_level = best_ns_per_item(rays.size(), [&] {
+    tlas.intersect(std::span<const Ray>(rays), std::span(instance_hits));
+    do_not_optimize(instance_hits.data());
+  });
+  std::vector<TriangleHit<float>> hits(rays.size());
+  double flattened = best_ns_per_item(rays.size(), [&] {
+    bvh.intersect(std::span<const Ray>(rays), std::span(hits));
+    do_not_optimize(hits.data());
+  });
+  std::size_t instance_count = 0, flat_count = 0;
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    instance_count += instance_hits[i].hit();
+    flat_count += hits[i].hit();
+  }
+
+  // The top level is its nodes and one 3x4 matrix and two indices per
+  // instance.
+  std::size_t tlas_bytes =
+      bvh_bytes(meshes[0]) + tlas.node_count() * sizeof(BvhNode<float>) +
+      tlas.size() * (12 * sizeof(float) + 2 * sizeof(uint32_t));
+  std::printf("%zu instances of %zu triangles, %zu rays, %u workers\n",
+              instances.size(), tree.size(), rays.size(),
+              default_thread_pool().size());
+  std::printf("%-12s %10s %10s %10s %8s\n", "structure", "MiB", "build s",
+              "ns/ray", "hits");
+  std::printf("%-12s %10.1f %10.3f %10.1f %8zu\n", "two-level",
+              static_cast<double>(tlas_bytes) / (1 << 20), tlas_build,
+              two_level, instance_count);
+  std::printf("%-12s %10.1f %10.3f %10.1f %8zu\n", "flattened",
+              static_cast<double>(bvh_bytes(bvh)) / (1 << 20),
+              flat_build, flattened, flat_count);
+}
@@ -0,0 +1,106 @@
+#include "wavefront.h"
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "bvh.h"
+#include "scenes.h"
+
+// A diffuse path tracer lit by a white sky, one sample per pixel and up to
+// kBounces bounces, run as a single-ray loop (each pixel's whole path at
+// once) and as wavefront stages. Both draw the same image; the time is per
+// frame.
+
+namespace {
+
+constexpr uint32_t kWidth = 640;
+constexpr uint32_t kHeight = 360;
+constexpr int kBounces = 4;
+constexpr float kAlbedo = 0.6f;
+
+struct Scene {
+  std::vector<Trianglef> triangles = terrain(300);
+  Bvhf bvh{std::span<const Trianglef>(triangles)};
+};
+
+// Continues the path from its hit; false once it has left the scene or
+// reached the last bounce. On leaving, the path's throughput is its
+// pixel's light.
+bool bounce(const Scene& scene, Path& path, const TriangleHit<float>& hit,
+            int depth) {
+  if (!hit.hit()) return false;
+  if (depth + 1 == kBounces) {
+    path.throughput = Vec3f(0.f, 0.f, 0.f);
+    return false;
+  }
+  Vec3f n = normalized(scene.triangles[hit.triangle].normal());
+  Vec3f d = path.ray.direction();
+  if (dot(n, d) > 0.f) n = n * -1.f;
+  Point3f at = path.ray.position(hit.t);
+  float u1 = hash_float(path.pixel, 2 * depth);
+  float u2 = hash_float(path.pixel, 2 * depth + 1);
+  path.ray = Ray(at, cosine_direction(n, u1, u2));
+  path.ray.setMinRange(1e-3f);
+  path.throughput = path.throughput * kAlbedo;
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  Scene scene;
+  Mat4f view = view_transform(Point3f(0.f, 25.f, 60.f),
+                              Point3f(0.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f));
+  Mat4f projection = perspective(30.f, 16.f / 9.f, 0.1f, 500.f);
+  std::size_t pixels = std::size_t{kWidth} * kHeight;
+  std::vector<Vec3f> image(pixels);
+
+  std::printf("%zu triangles, %ux%u pixels, %d bounces, %u workers\n",
+              scene.triangles.size(), kWidth, kHeight, kBounces,
+              default_thread_pool().size());
+
+  RayQueue camera;
+  generate_camera_rays(view, projection, kWidth, kHeight, camera);
+  double single = best_ns_per_item(1, [&] {
+    parallel_for(0, pixels, 64, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        Path path{camera.ray(i), Vec3f(1.f, 1.f, 1.f), camera.pixel[i]};
+        for (int depth = 0;; ++depth) {
+          if (!bounce(scene, path, scene.bvh.intersect(path.ray), depth)) {
+            break;
+          }
+        }
+        image[i] = path.throughput;
+      }
+    });
+  });
+  double single_sum = 0.;
+  for (const auto& c : image) single_sum += c.x();
+
+  RayQueue a(pixels), b(pixels);
+  std::vector<TriangleHit<float>> hits(pixels);
+  double wavefront = best_ns_per_item(1, [&] {
+    generate_camera_rays(view, projection, kWidth, kHeight, a);
+    for (int depth = 0; a.count > 0; ++depth) {
+      extend(scene.bvh, a, std::span(hits));
+      shade(a, std::span<const TriangleHit<float>>(hits),
+            [&](Path& path, const TriangleHit<float>& hit) {
+              bool on = bounce(scene, path, hit, depth);
+              if (!on) image[path.pixel] = path.throughput;
+              return on;
+            });
+      compact(a, b);
+      std::swap(a, b);
+    }
+  });
+  double wavefront_sum = 0.;
+  for (const auto& c : image) wavefront_sum += c.x();
+
+  std::printf("%-12s %10s %12s\n", "loop", "ms/frame", "image sum");
+  std::printf("%-12s %10.2f %12.2f\n", "single-ray", single * 1e-6,
+              single_sum);
+  std::printf("%-12s %10.2f %12.2f\n", "wavefront", wavefront * 1e-6,
+              wavefront_sum);
+}
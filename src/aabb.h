@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+
+#include "point3.h"
+#include "thread_pool.h"
+#include "types.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Axis-aligned bounding box
+//--------------------------------------------
+//
+// A default-constructed box is empty: min at +max() and max at lowest(), so
+// expanding it by anything gives that thing's bounds and merging it changes
+// nothing.
+
+template <numeric T>
+class AABB {
+ public:
+  AABB() = default;
+  AABB(const Point3<T>& min, const Point3<T>& max) : m_min{min}, m_max{max} {}
+  explicit AABB(const Point3<T>& p) : m_min{p}, m_max{p} {}
+
+  const Point3<T>& min() const { return m_min; }
+  const Point3<T>& max() const { return m_max; }
+
+  bool empty() const {
+    return m_min.x() > m_max.x() || m_min.y() > m_max.y() ||
+           m_min.z() > m_max.z();
+  }
+
+  void expand(const Point3<T>& p) {
+    m_min = Point3<T>(std::min(m_min.x(), p.x()), std::min(m_min.y(), p.y()),
+                      std::min(m_min.z(), p.z()));
+    m_max = Point3<T>(std::max(m_max.x(), p.x()), std::max(m_max.y(), p.y()),
+                      std::max(m_max.z(), p.z()));
+  }
+
+  void expand(const AABB<T>& b) {
+    if (b.empty()) return;
+    expand(b.m_min);
+    expand(b.m_max);
+  }
+
+  bool contains(const Point3<T>& p) const {
+    return p.x() >= m_min.x() && p.x() <= m_max.x() && p.y() >= m_min.y() &&
+           p.y() <= m_max.y() && p.z() >= m_min.z() && p.z() <= m_max.z();
+  }
+
+  Vec3<T> extent() const { return m_max - m_min; }
+
+  Point3<T> centroid() const {
+    return Point3<T>((m_min.x() + m_max.x()) / T{2},
+                     (m_min.y() + m_max.y()) / T{2},
+                     (m_min.z() + m_max.z()) / T{2});
+  }
+
+  T surface_area() const {
+    if (empty()) return T{0};
+    Vec3<T> e = extent();
+    return T{2} * (e.x() * e.y() + e.y() * e.z() + e.z() * e.x());
+  }
+
+  // Axis of the largest extent: 0, 1 or 2.
+  int longest_axis() const {
+    Vec3<T> e = extent();
+    if (e.x() >= e.y() && e.x() >= e.z()) return 0;
+    return e.y() >= e.z() ? 1 : 2;
+  }
+
+  bool operator==(const AABB<T>&) const = default;
+
+ private:
+  Point3<T> m_min{std::numeric_limits<T>::max(), std::numeric_limits<T>::max(),
+                  std::numeric_limits<T>::max()};
+  Point3<T> m_max{std::numeric_limits<T>::lowest(),
+                  std::numeric_limits<T>::lowest(),
+                  std::numeric_limits<T>::lowest()};
+};
+
+using AABBf = AABB<float>;
+using AABBd = AABB<double>;
+
+template <numeric T>
+AABB<T> merge(AABB<T> a, const AABB<T>& b) {
+  a.expand(b);
+  return a;
+}
+
+//--------------------------------------------
+// Bounds of a point set
+//--------------------------------------------
+// Split across the pool in fixed chunks; min and max are exact, so the
+// result is the same as a serial pass.
+
+template <numeric T>
+AABB<T> bounds(std::span<const Point3<T>> points, ThreadPool& pool) {
+  constexpr std::size_t kGrain = std::size_t{1} << 14;
+  return parallel_reduce(
+      pool, 0, points.size(), kGrain, AABB<T>(),
+      [&](std::size_t begin, std::size_t end) {
+        AABB<T> box;
+        for (std::size_t i = begin; i < end; ++i) box.expand(points[i]);
+        return box;
+      },
+      [](const AABB<T>& a, const AABB<T>& b) { return merge(a, b); });
+}
+
+template <numeric T>
+AABB<T> bounds(std::span<const Point3<T>> points) {
+  return bounds(points, default_thread_pool());
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "quat.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Keyframe tracks
+//--------------------------------------------
+//
+// A track is a sorted array of key times with one value per key, stored as
+// separate arrays (times, values, tangents) so a key search only touches
+// the times. Sampling clamps to the first and last key.
+//
+// Sampling takes a TrackCursor holding the segment found last time. Frames
+// move forward by a fraction of a key, so the search walks a few keys from
+// there and only falls back to a binary search after a jump (a seek, a
+// loop). AnimationClip packs the translation, rotation and scale tracks of
+// every joint of a skeleton into shared arrays and samples them all in one
+// pass.
+
+enum class Interpolation {
+  step,         // hold each key until the next one
+  linear,       // lerp for Vec3f, nlerp for Quat
+  slerp,        // Quat only
+  catmull_rom,  // Vec3f only, tangents from the neighbouring keys
+  hermite,      // Vec3f only, an in and an out tangent given per key
+};
+
+struct TrackCursor {
+  uint32_t key = 0;
+};
+
+namespace detail {
+
+// Keys the cursor walks before a binary search takes over.
+constexpr uint32_t kCursorWalk = 4;
+
+// Index k of the segment [times[k], times[k + 1]) holding t: 0 before the
+// first key and count - 1 from the last key on.
+inline uint32_t find_key(const float* times, uint32_t count, float t,
+                         uint32_t& cursor) {
+  uint32_t k = std::min(cursor, count - 1);
+  if (times[k] <= t) {
+    for (uint32_t i = 0; i < kCursorWalk && k + 1 < count; ++i, ++k) {
+      if (times[k + 1] > t) break;
+    }
+    if (k + 1 < count && times[k + 1] <= t) {
+      auto it = std::upper_bound(times + k + 1, times + count, t);
+      k = static_cast<uint32_t>(it - times) - 1;
+    }
+  } else {
+    for (uint32_t i = 0; i < kCursorWalk && k > 0; ++i) {
+      if (times[--k] <= t) break;
+    }
+    if (k > 0 && times[k] > t) {
+      auto it = std::upper_bound(times, times + k, t);
+      k = it == times ? 0 : static_cast<uint32_t>(it - times) - 1;
+    }
+  }
+  cursor = k;
+  return k;
+}
+
+// Cubic Hermite segment from p0 to p1, tangents already scaled to the
+// segment length.
+inline Vec3f hermite(const Vec3f& p0, const Vec3f& m0, const Vec3f& p1,
+                     const Vec3f& m1, float u) {
+  float u2 = u * u;
+  float u3 = u2 * u;
+  return p0 * (2.f * u3 - 3.f * u2 + 1.f) + m0 * (u3 - 2.f * u2 + u) +
+         p1 * (3.f * u2 - 2.f * u3) + m1 * (u3 - u2);
+}
+
+// Finite-difference (Catmull-Rom) tangent at key i, per unit of time, so
+// unevenly spaced keys stay smooth; one-sided at the ends.
+inline Vec3f catmull_rom_tangent(const float* times, const Vec3f* values,
+                                 uint32_t count, uint32_t i) {
+  uint32_t prev = i == 0 ? 0 : i - 1;
+  uint32_t next = i + 1 == count ? i : i + 1;
+  return (values[next] - values[prev]) / (times[next] - times[prev]);
+}
+
+struct Segment {
+  uint32_t key;
+  float u;  // position in [times[key], times[key + 1]], in [0, 1]
+  bool last;
+};
+
+inline Segment find_segment(const float* times, uint32_t count, float t,
+                            uint32_t& cursor) {
+  uint32_t k = find_key(times, count, t, cursor);
+  if (k + 1 == count) return {k, 0.f, true};
+  float u = (t - times[k]) / (times[k + 1] - times[k]);
+  return {k, std::clamp(u, 0.f, 1.f), false};
+}
+
+inline Vec3f sample(const float* times, const Vec3f* values,
+                    const Vec3f* tangents, uint32_t count, Interpolation mode,
+                    float t, uint32_t& cursor) {
+  auto [k, u, last] = find_segment(times, count, t, cursor);
+  if (last || mode == Interpolation::step) return values[k];
+  if (mode == Interpolation::catmull_rom || mode == Interpolation::hermite) {
+    float dt = times[k + 1] - times[k];
+    Vec3f m0 = mode == Interpolation::hermite
+                   ? tangents[2 * k + 1]
+                   : catmull_rom_tangent(times, values, count, k);
+    Vec3f m1 = mode == Interpolation::hermite
+                   ? tangents[2 * k + 2]
+                   : catmull_rom_tangent(times, values, count, k + 1);
+    return hermite(values[k], m0 * dt, values[k + 1], m1 * dt, u);
+  }
+  return values[k] + (values[k + 1] - values[k]) * u;
+}
+
+inline Quat sample(const float* times, const Quat* values, const Vec3f*,
+                   uint32_t count, Interpolation mode, float t,
+                   uint32_t& cursor) {
+  auto [k, u, last] = find_segment(times, count, t, cursor);
+  if (last || mode == Interpolation::step) return values[k];
+  if (mode == Interpolation::slerp) return slerp(values[k], values[k + 1], u);
+  return nlerp(values[k], values[k + 1], u);
+}
+
+}  // namespace detail
+
+template <typename V>
+  requires std::same_as<V, Vec3f> || std::same_as<V, Quat>
+class Track {
+ public:
+  Track(std::vector<float> times, std::vector<V> values,
+        Interpolation mode = Interpolation::linear)
+      : m_times{std::move(times)}, m_values{std::move(values)}, m_mode{mode} {
+    validate();
+  }
+
+  // Hermite curve: `tangents` holds the in and the out tangent of every key,
+  // in that order, as derivatives per unit of time.
+  Track(std::vector<float> times, std::vector<V> values,
+        std::vector<Vec3f> tangents)
+    requires std::same_as<V, Vec3f>
+      : m_times{std::move(times)},
+        m_values{std::move(values)},
+        m_tangents{std::move(tangents)},
+        m_mode{Interpolation::hermite} {
+    validate();
+  }
+
+  static Track constant(const V& value) {
+    return Track({0.f}, {value}, Interpolation::step);
+  }
+
+  std::span<const float> times() const { return m_times; }
+  std::span<const V> values() const { return m_values; }
+  std::span<const Vec3f> tangents() const { return m_tangents; }
+  Interpolation interpolation() const { return m_mode; }
+  std::size_t size() const { return m_times.size(); }
+
+  float start_time() const { return m_times.front(); }
+  float end_time() const { return m_times.back(); }
+
+  V sample(float t, TrackCursor& cursor) const {
+    return detail::sample(m_times.data(), m_values.data(), m_tangents.data(),
+                          static_cast<uint32_t>(m_times.size()), m_mode, t,
+                          cursor.key);
+  }
+
+  // Without a cursor: a binary search every call.
+  V sample(float t) const {
+    TrackCursor cursor{static_cast<uint32_t>(m_times.size() / 2)};
+    return sample(t, cursor);
+  }
+
+ private:
+  void validate() const {
+    if (m_times.empty() || m_times.size() != m_values.size()) {
+      throw std::invalid_argument("Track needs one value per key time");
+    }
+    if (m_times.size() > UINT32_MAX / 2) {
+      throw std::invalid_argument("Track has too many keys");
+    }
+    for (std::size_t i = 1; i < m_times.size(); ++i) {
+      if (!(m_times[i - 1] < m_times[i])) {
+        throw std::invalid_argument("Track key times must be increasing");
+      }
+    }
+    bool quat_mode = m_mode == Interpolation::slerp;
+    bool curve_mode = m_mode == Interpolation::catmull_rom ||
+                      m_mode == Interpolation::hermite;
+    if ((std::same_as<V, Quat> && curve_mode) ||
+        (std::same_as<V, Vec3f> && quat_mode)) {
+      throw std::invalid_argument("Interpolation does not apply to track");
+    }
+    if (m_mode == Interpolation::hermite &&
+        m_tangents.size() != 2 * m_times.size()) {
+      throw std::invalid_argument("Hermite track needs two tangents per key");
+    }
+  }
+
+  std::vector<float> m_times;
+  std::vector<V> m_values;
+  std::vector<Vec3f> m_tangents;
+  Interpolation m_mode;
+};
+
+using Vec3Track = Track<Vec3f>;
+using QuatTrack = Track<Quat>;
+
+//--------------------------------------------
+// Skeleton clips
+//--------------------------------------------
+
+struct JointPose {
+  Vec3f translation;
+  Quat rotation;
+  Vec3f scale = Vec3f(1.f, 1.f, 1.f);
+};
+
+class AnimationClip {
+ public:
+  // One TrackCursor per track. The clip is not modified by sampling, so
+  // every playing instance keeps its own cursor and shares the clip.
+  using Cursor = std::vector<TrackCursor>;
+
+  // Copies the joint's tracks into the clip; returns the joint's index.
+  std::size_t add_joint(const Vec3Track& translation,
+                        const QuatTrack& rotation, const Vec3Track& scale) {
+    m_tracks.push_back(append(translation));
+    m_tracks.push_back(append(rotation));
+    m_tracks.push_back(append(scale));
+    m_duration = std::max({m_duration, translation.end_time(),
+                           rotation.end_time(), scale.end_time()});
+    return joint_count() - 1;
+  }
+
+  std::size_t joint_count() const { return m_tracks.size() / 3; }
+  float duration() const { return m_duration; }
+
+  Cursor make_cursor() const { return Cursor(m_tracks.size()); }
+
+  // Evaluates every joint at time t into poses[0, joint_count()).
+  void sample(float t, Cursor& cursor, std::span<JointPose> poses) const {
+    if (poses.size() < joint_count()) {
+      throw std::out_of_range("Output span is too small");
+    }
+    if (cursor.size() != m_tracks.size()) cursor.resize(m_tracks.size());
+    for (std::size_t j = 0; j < joint_count(); ++j) {
+      poses[j].translation = sample_vec3(3 * j, t, cursor);
+      poses[j].rotation = sample_quat(3 * j + 1, t, cursor);
+      poses[j].scale = sample_vec3(3 * j + 2, t, cursor);
+    }
+  }
+
+ private:
+  // Where one track's keys live in the shared arrays.
+  struct Range {
+    uint32_t times;
+    uint32_t values;
+    uint32_t tangents;
+    uint32_t count;
+    Interpolation mode;
+  };
+
+  Range append(const Vec3Track& track) {
+    Range r{size32(m_times), size32(m_vec3), size32(m_tangents),
+            size32(track.times()), track.interpolation()};
+    m_times.insert(m_times.end(), track.times().begin(), track.times().end());
+    m_vec3.insert(m_vec3.end(), track.values().begin(), track.values().end());
+    m_tangents.insert(m_tangents.end(), track.tangents().begin(),
+                      track.tangents().end());
+    return r;
+  }
+
+  Range append(const QuatTrack& track) {
+    Range r{size32(m_times), size32(m_quats), 0, size32(track.times()),
+            track.interpolation()};
+    m_times.insert(m_times.end(), track.times().begin(), track.times().end());
+    m_quats.insert(m_quats.end(), track.values().begin(),
+                   track.values().end());
+    return r;
+  }
+
+  template <typename C>
+  static uint32_t size32(const C& c) {
+    if (c.size() > UINT32_MAX / 2) {
+      throw std::length_error("Animation clip is too large");
+    }
+    return static_cast<uint32_t>(c.size());
+  }
+
+  Vec3f sample_vec3(std::size_t i, float t, Cursor& cursor) const {
+    const Range& r = m_tracks[i];
+    return detail::sample(&m_times[r.times], &m_vec3[r.values],
+                          m_tangents.data() + r.tangents, r.count, r.mode, t,
+                          cursor[i].key);
+  }
+
+  Quat sample_quat(std::size_t i, float t, Cursor& cursor) const {
+    const Range& r = m_tracks[i];
+    return detail::sample(&m_times[r.times], &m_quats[r.values], nullptr,
+                          r.count, r.mode, t, cursor[i].key);
+  }
+
+  std::vector<Range> m_tracks;  // translation, rotation, scale per joint
+  std::vector<float> m_times;
+  std::vector<Vec3f> m_vec3;
+  std::vector<Vec3f> m_tangents;
+  std::vector<Quat> m_quats;
+  float m_duration = 0.f;
+};
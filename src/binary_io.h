@@ -0,0 +1,427 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MATH_HAS_MMAP 1
+#endif
+
+#include "mat2.h"
+#include "mat3.h"
+#include "mat4.h"
+#include "normal3.h"
+#include "point3.h"
+#include "quat.h"
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+
+//--------------------------------------------
+// Binary array files
+//--------------------------------------------
+//
+// A file holds one array of a single element type:
+//
+//   offset  0  BinaryHeader (64 bytes)
+//   offset 64  count * sizeof(T) bytes, the elements exactly as in memory
+//
+// The header records the format version, the byte order of the writer and
+// the element type, so a reader rejects a file of the wrong type instead of
+// reinterpreting it. The payload starts 64 bytes in, which keeps it aligned
+// for every element type when the file is mapped at a page boundary.
+// MappedArray exposes it in place, so opening a file costs page faults and
+// no parsing or copying; read_binary() copies it into a vector and also
+// accepts files written with the other byte order.
+
+enum class BinaryEndian : uint8_t { little = 1, big = 2 };
+
+struct BinaryHeader {
+  static constexpr char kMagic[4] = {'M', 'T', 'H', 'A'};
+  static constexpr uint16_t kVersion = 1;
+  static constexpr uint64_t kDataOffset = 64;
+
+  char magic[4];
+  uint16_t version;
+  BinaryEndian endian;
+  uint8_t scalar_size;
+  uint32_t element;
+  uint32_t element_size;
+  uint64_t count;
+  uint64_t data_offset;
+  uint8_t reserved[32];
+};
+
+static_assert(sizeof(BinaryHeader) == BinaryHeader::kDataOffset);
+static_assert(std::endian::native == std::endian::little ||
+                  std::endian::native == std::endian::big,
+              "mixed endian targets are not supported");
+
+// Element type tag stored in the header: shape in the high 16 bits, scalar in
+// the low ones. Only types specialised here can be written or mapped.
+template <typename T>
+struct binary_element;
+
+namespace detail {
+
+enum class BinaryShape : uint32_t {
+  vec2 = 1,
+  vec3,
+  vec4,
+  point3,
+  normal3,
+  mat2,
+  mat3,
+  mat4,
+  quat
+};
+
+template <typename S>
+constexpr uint32_t scalar_code() {
+  if constexpr (std::is_same_v<S, int32_t>) return 1;
+  if constexpr (std::is_same_v<S, float>) return 2;
+  if constexpr (std::is_same_v<S, double>) return 3;
+  return 0;
+}
+
+template <BinaryShape Shape, typename S, std::size_t Components>
+struct binary_element_base {
+  static_assert(scalar_code<S>() != 0, "unsupported scalar type");
+  using scalar = S;
+  static constexpr uint32_t tag =
+      static_cast<uint32_t>(Shape) << 16 | scalar_code<S>();
+  static constexpr std::size_t components = Components;
+};
+
+}  // namespace detail
+
+template <numeric T>
+struct binary_element<Vec2<T>>
+    : detail::binary_element_base<detail::BinaryShape::vec2, T, 2> {};
+template <numeric T>
+struct binary_element<Vec3<T>>
+    : detail::binary_element_base<detail::BinaryShape::vec3, T, 3> {};
+template <numeric T>
+struct binary_element<Vec4<T>>
+    : detail::binary_element_base<detail::BinaryShape::vec4, T, 4> {};
+template <numeric T>
+struct binary_element<Point3<T>>
+    : detail::binary_element_base<detail::BinaryShape::point3, T, 3> {};
+template <numeric T>
+struct binary_element<Normal3<T>>
+    : detail::binary_element_base<detail::BinaryShape::normal3, T, 3> {};
+template <numeric T>
+struct binary_element<Mat2<T>>
+    : detail::binary_element_base<detail::BinaryShape::mat2, T, 4> {};
+template <numeric T>
+struct binary_element<Mat3<T>>
+    : detail::binary_element_base<detail::BinaryShape::mat3, T, 9> {};
+template <numeric T>
+struct binary_element<Mat4<T>>
+    : detail::binary_element_base<detail::BinaryShape::mat4, T, 16> {};
+template <>
+struct binary_element<Quat>
+    : detail::binary_element_base<detail::BinaryShape::quat, float, 4> {};
+
+// The payload is the in-memory representation, so the element must be a
+// packed array of its scalars.
+template <typename T>
+concept binary_serializable =
+    requires { binary_element<T>::tag; } && std::is_trivially_copyable_v<T> &&
+    sizeof(T) == binary_element<T>::components *
+                     sizeof(typename binary_element<T>::scalar);
+
+namespace detail {
+
+constexpr BinaryEndian native_endian() {
+  return std::endian::native == std::endian::little ? BinaryEndian::little
+                                                    : BinaryEndian::big;
+}
+
+template <binary_serializable T>
+BinaryHeader make_header(uint64_t count) {
+  BinaryHeader h{};
+  std::memcpy(h.magic, BinaryHeader::kMagic, sizeof(h.magic));
+  h.version = BinaryHeader::kVersion;
+  h.endian = native_endian();
+  h.scalar_size = sizeof(typename binary_element<T>::scalar);
+  h.element = binary_element<T>::tag;
+  h.element_size = sizeof(T);
+  h.count = count;
+  h.data_offset = BinaryHeader::kDataOffset;
+  return h;
+}
+
+template <typename U>
+U byteswap(U v) {
+  auto bytes = std::bit_cast<std::array<unsigned char, sizeof(U)>>(v);
+  std::reverse(bytes.begin(), bytes.end());
+  return std::bit_cast<U>(bytes);
+}
+
+// Turns a header written on a machine with the other byte order into a
+// native one; endian itself is a single byte and keeps telling the truth.
+inline void swap_header(BinaryHeader& h) {
+  h.version = byteswap(h.version);
+  h.element = byteswap(h.element);
+  h.element_size = byteswap(h.element_size);
+  h.count = byteswap(h.count);
+  h.data_offset = byteswap(h.data_offset);
+}
+
+inline void swap_scalars(unsigned char* data, std::size_t bytes,
+                         std::size_t scalar_size) {
+  for (std::size_t i = 0; i + scalar_size <= bytes; i += scalar_size) {
+    std::reverse(data + i, data + i + scalar_size);
+  }
+}
+
+// Validates a native-order header against T and the size of the file it
+// came from.
+template <binary_serializable T>
+void check_header(const BinaryHeader& h, uint64_t file_size) {
+  if (std::memcmp(h.magic, BinaryHeader::kMagic, sizeof(h.magic)) != 0) {
+    throw std::runtime_error("Not a math binary array file");
+  }
+  if (h.version == 0 || h.version > BinaryHeader::kVersion) {
+    throw std::runtime_error("Unsupported binary array version " +
+                             std::to_string(h.version));
+  }
+  if (h.element != binary_element<T>::tag || h.element_size != sizeof(T)) {
+    throw std::runtime_error("Binary array holds a different element type");
+  }
+  if (h.data_offset < sizeof(BinaryHeader) || h.data_offset % alignof(T)) {
+    throw std::runtime_error("Invalid binary array data offset");
+  }
+  if (h.count > (file_size - std::min(file_size, h.data_offset)) / sizeof(T)) {
+    throw std::runtime_error("Binary array file is truncated");
+  }
+}
+
+}  // namespace detail
+
+//--------------------------------------------
+// Writing and reading
+//--------------------------------------------
+
+template <binary_serializable T>
+void write_binary(std::ostream& out, std::span<const T> items) {
+  auto header = detail::make_header<T>(items.size());
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(items.data()),
+            static_cast<std::streamsize>(items.size_bytes()));
+  if (!out) throw std::runtime_error("Failed to write binary array");
+}
+
+template <binary_serializable T>
+void write_binary(const std::string& path, std::span<const T> items) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw std::runtime_error("Cannot open " + path + " for writing");
+  write_binary(out, items);
+}
+
+template <binary_serializable T>
+void write_binary(const std::string& path, const std::vector<T>& items) {
+  write_binary(path, std::span<const T>(items));
+}
+
+template <binary_serializable T>
+std::vector<T> read_binary(std::istream& in) {
+  in.seekg(0, std::ios::end);
+  auto file_size = static_cast<uint64_t>(in.tellg());
+  in.seekg(0, std::ios::beg);
+
+  BinaryHeader h;
+  if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))) {
+    throw std::runtime_error("Binary array file is truncated");
+  }
+  bool swapped = h.endian != detail::native_endian();
+  if (swapped) detail::swap_header(h);
+  detail::check_header<T>(h, file_size);
+
+  std::vector<T> items(h.count);
+  in.seekg(static_cast<std::streamoff>(h.data_offset), std::ios::beg);
+  auto bytes = h.count * sizeof(T);
+  if (!in.read(reinterpret_cast<char*>(items.data()),
+               static_cast<std::streamsize>(bytes))) {
+    throw std::runtime_error("Binary array file is truncated");
+  }
+  if (swapped) {
+    detail::swap_scalars(reinterpret_cast<unsigned char*>(items.data()), bytes,
+                         h.scalar_size);
+  }
+  return items;
+}
+
+template <binary_serializable T>
+std::vector<T> read_binary(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw std::runtime_error("Cannot open " + path);
+  return read_binary<T>(in);
+}
+
+//--------------------------------------------
+// Memory-mapped view
+//--------------------------------------------
+
+#ifdef MATH_HAS_MMAP
+
+// A whole file mapped read-only into memory. Pages are read on first access
+// and can be dropped again by the kernel, so files larger than RAM work.
+class MappedFile {
+ public:
+  MappedFile() = default;
+
+  explicit MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Cannot stat " + path);
+    }
+    m_length = static_cast<std::size_t>(st.st_size);
+    if (m_length == 0) {
+      ::close(fd);
+      return;
+    }
+    m_base = ::mmap(nullptr, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m_base == MAP_FAILED) {
+      m_base = nullptr;
+      m_length = 0;
+      throw std::runtime_error("Cannot map " + path);
+    }
+  }
+
+  ~MappedFile() { unmap(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      unmap();
+      m_base = std::exchange(other.m_base, nullptr);
+      m_length = std::exchange(other.m_length, 0);
+    }
+    return *this;
+  }
+
+  const char* data() const { return static_cast<const char*>(m_base); }
+  std::size_t size() const { return m_length; }
+  std::string_view view() const { return {data(), m_length}; }
+
+  // Hints that the whole file is about to be read front to back.
+  void will_need() const {
+    if (!m_base) return;
+    ::madvise(m_base, m_length, MADV_SEQUENTIAL);
+    ::madvise(m_base, m_length, MADV_WILLNEED);
+  }
+
+  // Hints that bytes [offset, offset + length) are about to be read, for
+  // readers that go through files larger than RAM a window at a time.
+  void will_need(std::size_t offset, std::size_t length) const {
+    if (!m_base || offset >= m_length) return;
+    static const std::size_t page =
+        static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t begin = offset / page * page;
+    std::size_t end = std::min(m_length, offset + length);
+    ::madvise(static_cast<char*>(m_base) + begin, end - begin,
+              MADV_WILLNEED);
+  }
+
+ private:
+  void unmap() {
+    if (m_base) ::munmap(m_base, m_length);
+    m_base = nullptr;
+    m_length = 0;
+  }
+
+  void* m_base = nullptr;
+  std::size_t m_length = 0;
+};
+
+// Read-only view of a binary array file mapped into memory. The elements are
+// used in place; pages are read on first access. The file must have been
+// written with the native byte order (use read_binary() to convert others).
+template <binary_serializable T>
+class MappedArray {
+ public:
+  MappedArray() = default;
+
+  explicit MappedArray(const std::string& path) : m_file{path} {
+    if (m_file.size() < sizeof(BinaryHeader)) {
+      throw std::runtime_error("Binary array file is truncated");
+    }
+    const auto& h = header();
+    if (h.endian != detail::native_endian()) {
+      throw std::runtime_error(
+          "Binary array has foreign byte order, use read_binary");
+    }
+    detail::check_header<T>(h, m_file.size());
+    m_data = reinterpret_cast<const T*>(m_file.data() + h.data_offset);
+    m_size = h.count;
+  }
+
+  MappedArray(MappedArray&& other) noexcept
+      : m_file{std::move(other.m_file)},
+        m_data{std::exchange(other.m_data, nullptr)},
+        m_size{std::exchange(other.m_size, 0)} {}
+
+  MappedArray& operator=(MappedArray&& other) noexcept {
+    m_file = std::move(other.m_file);
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    return *this;
+  }
+
+  // Throws if nothing is mapped (default-constructed or moved from).
+  const BinaryHeader& header() const {
+    if (!m_file.data()) throw std::runtime_error("No binary array is mapped");
+    return *reinterpret_cast<const BinaryHeader*>(m_file.data());
+  }
+
+  std::span<const T> span() const { return {m_data, m_size}; }
+  operator std::span<const T>() const { return span(); }
+
+  const T* data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  const T* begin() const { return m_data; }
+  const T* end() const { return m_data + m_size; }
+
+  const T& operator[](std::size_t i) const {
+    if (i >= m_size) throw std::out_of_range("Index out of range");
+    return m_data[i];
+  }
+
+  void will_need() const { m_file.will_need(); }
+
+ private:
+  MappedFile m_file;
+  const T* m_data = nullptr;
+  std::size_t m_size = 0;
+};
+
+#endif  // MATH_HAS_MMAP
@@ -0,0 +1,656 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "point3.h"
+#include "ray.h"
+#include "spatial_sort.h"
+#include "thread_pool.h"
+#include "triangle.h"
+#include "types.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Bounding volume hierarchy over triangles
+//--------------------------------------------
+//
+// A binary tree of boxes. The two children of an inner node are stored
+// next to each other, so a node is its box and two 32-bit words: the index
+// of its left child (the right one follows it) or, for a leaf, the first of
+// its `count` triangles. The triangles are copied in leaf order.
+//
+// The build is top down with the surface area heuristic evaluated over
+// kBins bins of centroids per axis, as in Wald, "On fast Construction of
+// SAH-based Bounding Volume Hierarchies" (2007). Large ranges are binned on
+// the pool and the two halves of every large split are built in parallel;
+// nodes are taken from a shared counter, so their order depends on
+// scheduling but the tree does not. Results refer to triangles by their
+// index in the span the tree was built from.
+
+template <numeric T>
+struct BvhNode {
+  AABB<T> box;
+  uint32_t first = 0;  // left child, or first triangle of a leaf
+  uint32_t count = 0;  // triangles of a leaf; 0 for inner nodes
+
+  bool leaf() const { return count > 0; }
+};
+
+namespace detail {
+
+// A ray prepared for slab tests against many boxes.
+template <numeric T>
+struct SlabRay {
+  SlabRay(const Point3<T>& o, const Vec3<T>& d) {
+    // A tiny stand-in for zero keeps 0 * inf out of the slab test.
+    constexpr T kTiny = static_cast<T>(1e-20);
+    for (int a = 0; a < 3; ++a) {
+      T da = a == 0 ? d.x() : a == 1 ? d.y() : d.z();
+      if (std::abs(da) < kTiny) da = std::copysign(kTiny, da);
+      origin[a] = a == 0 ? o.x() : a == 1 ? o.y() : o.z();
+      inv[a] = T{1} / da;
+    }
+  }
+
+  // Where the ray enters box within [tmin, tmax], or infinity if it
+  // misses it.
+  T enter(const AABB<T>& box, T tmin, T tmax) const {
+    const Point3<T>& lo = box.min();
+    const Point3<T>& hi = box.max();
+    T t0x = (lo.x() - origin[0]) * inv[0], t1x = (hi.x() - origin[0]) * inv[0];
+    T t0y = (lo.y() - origin[1]) * inv[1], t1y = (hi.y() - origin[1]) * inv[1];
+    T t0z = (lo.z() - origin[2]) * inv[2], t1z = (hi.z() - origin[2]) * inv[2];
+    T enter = std::max({tmin, std::min(t0x, t1x), std::min(t0y, t1y),
+                        std::min(t0z, t1z)});
+    T exit = std::min({tmax, std::max(t0x, t1x), std::max(t0y, t1y),
+                       std::max(t0z, t1z)});
+    return enter <= exit ? enter : std::numeric_limits<T>::infinity();
+  }
+
+  T origin[3];
+  T inv[3];
+};
+
+template <numeric T>
+Point3<T> point_from(const Point3f& p) {
+  return Point3<T>(static_cast<T>(p.x()), static_cast<T>(p.y()),
+                   static_cast<T>(p.z()));
+}
+
+template <numeric T>
+Vec3<T> vector_from(const Vec3f& v) {
+  return Vec3<T>(static_cast<T>(v.x()), static_cast<T>(v.y()),
+                 static_cast<T>(v.z()));
+}
+
+// Below this depth splits are at the median, which bounds the depth, and
+// so the traversal stack, on any input. Bvh::rotate() keeps the bound: it
+// makes no subtree reach past this depth that did not already.
+constexpr int kBvhSahDepth = 48;
+constexpr int kBvhStackSize = kBvhSahDepth + 40;
+
+// The binned SAH build of a tree of BvhNodes over any boxes. Leaves refer
+// to ranges of `indices`, which lists the boxes in leaf order.
+template <numeric T>
+class BvhBuilder {
+ public:
+  static constexpr uint32_t kMaxLeafSize = 8;
+  static constexpr int kBins = 16;
+
+  static void build(std::span<const AABB<T>> boxes,
+                    std::vector<BvhNode<T>>& nodes,
+                    std::vector<uint32_t>& indices, ThreadPool& pool) {
+    if (boxes.size() >= UINT32_MAX / 2) {
+      throw std::length_error("Too many primitives for a BVH");
+    }
+    std::size_t n = boxes.size();
+    nodes.clear();
+    indices.resize(n);
+    if (n == 0) return;
+    BvhBuilder builder(boxes, nodes, indices);
+    parallel_for(pool, 0, n, std::size_t{1} << 14,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     builder.m_centroids[i] = boxes[i].centroid();
+                     indices[i] = static_cast<uint32_t>(i);
+                   }
+                 });
+    nodes.resize(2 * n - 1);
+    builder.split(0, 0, n, 0, pool);
+    nodes.resize(builder.m_next_node.load());
+  }
+
+ private:
+  static constexpr std::size_t kParallelBuild = std::size_t{1} << 12;
+  static constexpr std::size_t kParallelBinning = std::size_t{1} << 16;
+
+  BvhBuilder(std::span<const AABB<T>> boxes, std::vector<BvhNode<T>>& nodes,
+             std::vector<uint32_t>& indices)
+      : m_boxes(boxes),
+        m_centroids(boxes.size()),
+        m_nodes(nodes),
+        m_indices(indices) {}
+
+  struct Bin {
+    AABB<T> box;
+    uint32_t count = 0;
+  };
+
+  // Bounds of the boxes and of the centroids of a range, and per axis the
+  // bins of its centroids over the centroid bounds.
+  struct Binning {
+    AABB<T> box;
+    AABB<T> centroids;
+    std::array<std::array<Bin, kBins>, 3> bins{};
+  };
+
+  // Point3::operator[] range-checks; the axis here is always valid.
+  static T coord(const Point3<T>& p, int axis) {
+    return axis == 0 ? p.x() : axis == 1 ? p.y() : p.z();
+  }
+
+  static int bin_of(const AABB<T>& centroids, const Point3<T>& c, int axis) {
+    T lo = coord(centroids.min(), axis);
+    T extent = coord(centroids.max(), axis) - lo;
+    if (!(extent > T{0})) return 0;
+    int b = static_cast<int>((coord(c, axis) - lo) / extent * T{kBins});
+    return std::clamp(b, 0, kBins - 1);
+  }
+
+  // Bounds of the range; bins over `centroids` unless it is empty.
+  Binning bin(std::size_t begin, std::size_t end, const AABB<T>& centroids,
+              ThreadPool& pool) const {
+    auto add = [&](Binning& b, std::size_t from, std::size_t to) {
+      for (std::size_t i = from; i < to; ++i) {
+        uint32_t t = m_indices[i];
+        b.box.expand(m_boxes[t]);
+        b.centroids.expand(m_centroids[t]);
+        if (centroids.empty()) continue;
+        for (int a = 0; a < 3; ++a) {
+          Bin& slot = b.bins[a][bin_of(centroids, m_centroids[t], a)];
+          slot.box.expand(m_boxes[t]);
+          ++slot.count;
+        }
+      }
+    };
+    if (end - begin < kParallelBinning) {
+      Binning b;
+      add(b, begin, end);
+      return b;
+    }
+    return parallel_reduce(
+        pool, begin, end, kParallelBinning / 4, Binning(),
+        [&](std::size_t from, std::size_t to) {
+          Binning b;
+          add(b, from, to);
+          return b;
+        },
+        [](Binning a, const Binning& b) {
+          a.box.expand(b.box);
+          a.centroids.expand(b.centroids);
+          for (int axis = 0; axis < 3; ++axis) {
+            for (int i = 0; i < kBins; ++i) {
+              a.bins[axis][i].box.expand(b.bins[axis][i].box);
+              a.bins[axis][i].count += b.bins[axis][i].count;
+            }
+          }
+          return a;
+        });
+  }
+
+  void split(uint32_t node, std::size_t begin, std::size_t end,
+             int depth, ThreadPool& pool) {
+    // One pass for the bounds, and one for the bins over the centroid
+    // bounds found by the first.
+    Binning range = bin(begin, end, AABB<T>(), pool);
+    BvhNode<T>& out = m_nodes[node];
+    out.box = range.box;
+    std::size_t count = end - begin;
+    auto make_leaf = [&] {
+      out.first = static_cast<uint32_t>(begin);
+      out.count = static_cast<uint32_t>(count);
+    };
+    if (count <= 2) return make_leaf();
+
+    // Split cost relative to intersecting everything in the range: one
+    // traversal step plus each side's boxes weighted by its share of the
+    // area.
+    std::size_t mid = begin;
+    int axis = range.centroids.longest_axis();
+    T extent = coord(range.centroids.max(), axis) -
+               coord(range.centroids.min(), axis);
+    if (!(extent > T{0})) {
+      if (count <= kMaxLeafSize) return make_leaf();
+      mid = begin + count / 2;  // all centroids equal
+    } else if (depth >= kBvhSahDepth) {
+      mid = begin + count / 2;
+      std::nth_element(
+          m_indices.begin() + begin, m_indices.begin() + mid,
+          m_indices.begin() + end, [&](uint32_t a, uint32_t b) {
+            return coord(m_centroids[a], axis) <
+                   coord(m_centroids[b], axis);
+          });
+    } else {
+      Binning binned = bin(begin, end, range.centroids, pool);
+      T best_cost = std::numeric_limits<T>::infinity();
+      int best_axis = 0, best_bin = 0;
+      for (int a = 0; a < 3; ++a) {
+        // Area times count of everything right of each bin boundary.
+        std::array<T, kBins> right_cost{};
+        AABB<T> box;
+        uint32_t n = 0;
+        for (int b = kBins - 1; b > 0; --b) {
+          box.expand(binned.bins[a][b].box);
+          n += binned.bins[a][b].count;
+          right_cost[b] = box.surface_area() * static_cast<T>(n);
+        }
+        box = AABB<T>();
+        n = 0;
+        for (int b = 0; b < kBins - 1; ++b) {
+          box.expand(binned.bins[a][b].box);
+          n += binned.bins[a][b].count;
+          T cost = box.surface_area() * static_cast<T>(n) + right_cost[b + 1];
+          if (n > 0 && n < count && cost < best_cost) {
+            best_cost = cost;
+            best_axis = a;
+            best_bin = b;
+          }
+        }
+      }
+      T area = range.box.surface_area();
+      T leaf_cost = static_cast<T>(count);
+      T split_cost = T{1} + (area > T{0} ? best_cost / area : leaf_cost);
+      if (count <= kMaxLeafSize && split_cost >= leaf_cost) {
+        return make_leaf();
+      }
+      if (best_cost == std::numeric_limits<T>::infinity()) {
+        mid = begin + count / 2;  // every centroid in one bin
+      } else {
+        auto it = std::partition(
+            m_indices.begin() + begin, m_indices.begin() + end,
+            [&](uint32_t t) {
+              return bin_of(range.centroids, m_centroids[t], best_axis) <=
+                     best_bin;
+            });
+        mid = static_cast<std::size_t>(it - m_indices.begin());
+      }
+    }
+
+    uint32_t left = m_next_node.fetch_add(2);
+    out.first = left;
+    out.count = 0;
+    if (count < kParallelBuild) {
+      split(left, begin, mid, depth + 1, pool);
+      split(left + 1, mid, end, depth + 1, pool);
+      return;
+    }
+    parallel_for(pool, 0, 2, 1, [&](std::size_t half, std::size_t) {
+      if (half == 0) {
+        split(left, begin, mid, depth + 1, pool);
+      } else {
+        split(left + 1, mid, end, depth + 1, pool);
+      }
+    });
+  }
+
+  std::span<const AABB<T>> m_boxes;
+  std::vector<Point3<T>> m_centroids;
+  std::vector<BvhNode<T>>& m_nodes;
+  std::vector<uint32_t>& m_indices;
+  std::atomic<uint32_t> m_next_node{1};
+};
+
+}  // namespace detail
+
+template <numeric T>
+class Bvh {
+ public:
+  static constexpr uint32_t kMaxLeafSize = detail::BvhBuilder<T>::kMaxLeafSize;
+  static constexpr int kBins = detail::BvhBuilder<T>::kBins;
+
+  Bvh() = default;
+
+  Bvh(std::span<const Triangle<T>> triangles, ThreadPool& pool) {
+    build(triangles, pool);
+  }
+
+  explicit Bvh(std::span<const Triangle<T>> triangles)
+      : Bvh(triangles, default_thread_pool()) {}
+
+  std::size_t size() const { return m_triangles.size(); }
+  bool empty() const { return m_triangles.empty(); }
+  std::size_t node_count() const { return m_nodes.size(); }
+
+  // Root first.
+  std::span<const BvhNode<T>> nodes() const { return m_nodes; }
+  // The triangles in leaf order, and the input index of each.
+  std::span<const Triangle<T>> triangles() const { return m_triangles; }
+  std::span<const uint32_t> indices() const { return m_indices; }
+
+  AABB<T> bounds() const { return empty() ? AABB<T>() : m_nodes[0].box; }
+
+  // Expected work of a ray through the root under the surface area
+  // heuristic: one unit per inner node and per triangle of a leaf, weighted
+  // by the node's area relative to the root's. Compares trees over the
+  // same triangles; lower is better.
+  T sah_cost() const {
+    if (empty()) return T{0};
+    T total{0};
+    for (const BvhNode<T>& n : m_nodes) {
+      T work = n.leaf() ? static_cast<T>(n.count) : T{1};
+      total += n.box.surface_area() * work;
+    }
+    T root = m_nodes[0].box.surface_area();
+    return root > T{0} ? total / root : total;
+  }
+
+  //--------------------------------------------
+  // Updates
+  //--------------------------------------------
+  // For triangles that move between frames but stay the same triangles.
+  // refit() keeps the tree and recomputes its boxes; rotate() then swaps
+  // subtrees where that shrinks them, as in Kopta et al., "Fast, Effective
+  // BVH Updates for Animated Scenes" (2012). Both run bottom up, the two
+  // halves of nodes near the root in parallel, and cost a fraction of a
+  // build; the tree still drifts from a rebuilt one under large motion.
+
+  // triangles holds the new positions in input order, as given to the
+  // constructor.
+  void refit(std::span<const Triangle<T>> triangles, ThreadPool& pool) {
+    if (triangles.size() != size()) {
+      throw std::invalid_argument("refit needs the same triangles");
+    }
+    if (empty()) return;
+    gather(std::span<const uint32_t>(m_indices), triangles,
+           std::span(m_triangles), pool);
+    refit_node(0, 0, pool);
+  }
+
+  void refit(std::span<const Triangle<T>> triangles) {
+    refit(triangles, default_thread_pool());
+  }
+
+  // At every inner node, swaps a child with the grandchild on the other
+  // side whose sibling box shrinks most, if any does. Returns the number
+  // of swaps; passes over later frames keep improving the tree. A swap
+  // that would take leaves below kBvhSahDepth, and deeper than they were,
+  // is skipped, so the tree stays as shallow as the build left it or
+  // kBvhSahDepth, whichever is deeper.
+  std::size_t rotate(ThreadPool& pool) {
+    if (empty()) return 0;
+    m_heights.resize(m_nodes.size());
+    return rotate_node(0, 0, pool);
+  }
+
+  std::size_t rotate() { return rotate(default_thread_pool()); }
+
+  //--------------------------------------------
+  // Nearest hit
+  //--------------------------------------------
+
+  // The nearest triangle along origin + t * direction for t in
+  // [tmin, tmax), or a TriangleHit without a triangle.
+  TriangleHit<T> intersect(const Point3<T>& origin, const Vec3<T>& direction,
+                           T tmin, T tmax) const {
+    TriangleHit<T> hit;
+    if (empty()) return hit;
+    hit.t = tmax;
+    detail::SlabRay<T> slab(origin, direction);
+    constexpr T kMiss = std::numeric_limits<T>::infinity();
+    if (slab.enter(m_nodes[0].box, tmin, tmax) == kMiss) return {};
+
+    // Pending far children and where the ray enters them.
+    std::pair<uint32_t, T> stack[kStackSize];
+    int top = 0;
+    uint32_t node = 0;
+    while (true) {
+      const BvhNode<T>& n = m_nodes[node];
+      if (n.leaf()) {
+        for (uint32_t s = n.first; s < n.first + n.count; ++s) {
+          if (::intersect(m_triangles[s], origin, direction, tmin, hit)) {
+            hit.triangle = m_indices[s];
+          }
+        }
+      } else {
+        T near = slab.enter(m_nodes[n.first].box, tmin, hit.t);
+        T far = slab.enter(m_nodes[n.first + 1].box, tmin, hit.t);
+        uint32_t near_node = n.first, far_node = n.first + 1;
+        if (far < near) {
+          std::swap(near, far);
+          std::swap(near_node, far_node);
+        }
+        if (near != kMiss) {
+          if (far != kMiss) stack[top++] = {far_node, far};
+          node = near_node;
+          continue;
+        }
+      }
+      // Next pending node the ray still reaches before the nearest hit.
+      while (top > 0 && stack[top - 1].second >= hit.t) --top;
+      if (top == 0) break;
+      node = stack[--top].first;
+    }
+    return hit.hit() ? hit : TriangleHit<T>{};
+  }
+
+  TriangleHit<T> intersect(const Ray& ray) const {
+    return intersect(detail::point_from<T>(ray.origin()),
+                     detail::vector_from<T>(ray.direction()),
+                     static_cast<T>(ray.getMinRange()),
+                     static_cast<T>(ray.getMaxRange()));
+  }
+
+  // hits[i] is the nearest hit of rays[i].
+  void intersect(std::span<const Ray> rays, std::span<TriangleHit<T>> hits,
+                 ThreadPool& pool) const {
+    if (hits.size() < rays.size()) {
+      throw std::out_of_range("Output span is too small");
+    }
+    parallel_for(pool, 0, rays.size(), kQueryGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     hits[i] = intersect(rays[i]);
+                   }
+                 });
+  }
+
+  void intersect(std::span<const Ray> rays,
+                 std::span<TriangleHit<T>> hits) const {
+    intersect(rays, hits, default_thread_pool());
+  }
+
+  //--------------------------------------------
+  // Any hit
+  //--------------------------------------------
+  // For shadow and visibility rays: stops at the first triangle found,
+  // visits children in storage order instead of nearest first, and never
+  // forms a hit record.
+
+  // Whether any triangle lies on origin + t * direction for t in
+  // [tmin, tmax).
+  bool occluded(const Point3<T>& origin, const Vec3<T>& direction, T tmin,
+                T tmax) const {
+    if (empty()) return false;
+    detail::SlabRay<T> slab(origin, direction);
+    constexpr T kMiss = std::numeric_limits<T>::infinity();
+    if (slab.enter(m_nodes[0].box, tmin, tmax) == kMiss) return false;
+
+    uint32_t stack[kStackSize];
+    int top = 0;
+    uint32_t node = 0;
+    while (true) {
+      const BvhNode<T>& n = m_nodes[node];
+      if (n.leaf()) {
+        for (uint32_t s = n.first; s < n.first + n.count; ++s) {
+          if (occludes(m_triangles[s], origin, direction, tmin, tmax)) {
+            return true;
+          }
+        }
+      } else {
+        bool left = slab.enter(m_nodes[n.first].box, tmin, tmax) != kMiss;
+        bool right = slab.enter(m_nodes[n.first + 1].box, tmin, tmax) != kMiss;
+        if (left || right) {
+          if (left && right) stack[top++] = n.first + 1;
+          node = left ? n.first : n.first + 1;
+          continue;
+        }
+      }
+      if (top == 0) return false;
+      node = stack[--top];
+    }
+  }
+
+  bool occluded(const Ray& ray) const {
+    return occluded(detail::point_from<T>(ray.origin()),
+                    detail::vector_from<T>(ray.direction()),
+                    static_cast<T>(ray.getMinRange()),
+                    static_cast<T>(ray.getMaxRange()));
+  }
+
+  // occluded[i] is 1 if rays[i] is occluded and 0 if not.
+  void occluded(std::span<const Ray> rays, std::span<uint8_t> occluded,
+                ThreadPool& pool) const {
+    if (occluded.size() < rays.size()) {
+      throw std::out_of_range("Output span is too small");
+    }
+    parallel_for(pool, 0, rays.size(), kQueryGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     occluded[i] = this->occluded(rays[i]);
+                   }
+                 });
+  }
+
+  void occluded(std::span<const Ray> rays, std::span<uint8_t> occluded) const {
+    this->occluded(rays, occluded, default_thread_pool());
+  }
+
+ private:
+  static constexpr int kStackSize = detail::kBvhStackSize;
+  static constexpr std::size_t kQueryGrain = 64;
+  // Updates split the two halves of nodes above this depth across the pool.
+  static constexpr int kParallelDepth = 6;
+  // Rotations must shrink a box by this share of its parent's area.
+  static constexpr T kMinRotationGain = static_cast<T>(1e-4);
+
+  template <typename F>
+  void for_children(const BvhNode<T>& n, int depth, ThreadPool& pool,
+                    F&& f) {
+    if (depth >= kParallelDepth) {
+      f(n.first);
+      f(n.first + 1);
+      return;
+    }
+    parallel_for(pool, 0, 2, 1, [&](std::size_t half, std::size_t) {
+      f(n.first + static_cast<uint32_t>(half));
+    });
+  }
+
+  void refit_node(uint32_t node, int depth, ThreadPool& pool) {
+    BvhNode<T>& n = m_nodes[node];
+    if (n.leaf()) {
+      AABB<T> box;
+      for (uint32_t s = n.first; s < n.first + n.count; ++s) {
+        box.expand(m_triangles[s].bounds());
+      }
+      n.box = box;
+      return;
+    }
+    for_children(n, depth, pool,
+                 [&](uint32_t child) { refit_node(child, depth + 1, pool); });
+    n.box = merge(m_nodes[n.first].box, m_nodes[n.first + 1].box);
+  }
+
+  // Also records the height of every node of the subtree in m_heights.
+  std::size_t rotate_node(uint32_t node, int depth, ThreadPool& pool) {
+    const BvhNode<T>& n = m_nodes[node];
+    if (n.leaf()) {
+      m_heights[node] = 0;
+      return 0;
+    }
+    std::array<std::size_t, 2> below{};
+    for_children(n, depth, pool, [&](uint32_t child) {
+      below[child - n.first] = rotate_node(child, depth + 1, pool);
+    });
+    bool swapped = rotate_at(n, depth);
+    m_heights[node] = 1 + std::max(m_heights[n.first], m_heights[n.first + 1]);
+    return below[0] + below[1] + swapped;
+  }
+
+  // Swapping child x with grandchild g, a child of x's sibling y, leaves
+  // n's box alone and makes y bound x and g's sibling instead. Node
+  // records hold their children, so swapping two records moves the whole
+  // subtrees.
+  // n is at `depth`; the heights of its descendants are in m_heights.
+  bool rotate_at(const BvhNode<T>& n, int depth) {
+    T best = -kMinRotationGain * n.box.surface_area();
+    uint32_t x = 0, g = 0, y = 0;
+    int old_height =
+        1 + std::max(m_heights[n.first], m_heights[n.first + 1]);
+    for (uint32_t side = 0; side < 2; ++side) {
+      uint32_t child = n.first + side, sibling = n.first + 1 - side;
+      const BvhNode<T>& other = m_nodes[sibling];
+      if (other.leaf()) continue;
+      T area = other.box.surface_area();
+      for (uint32_t pick = 0; pick < 2; ++pick) {
+        uint32_t kept_node = other.first + 1 - pick;
+        const AABB<T>& kept = m_nodes[kept_node].box;
+        T gain = merge(m_nodes[child].box, kept).surface_area() - area;
+        int height = 1 + std::max(m_heights[other.first + pick],
+                                  1 + std::max(m_heights[child],
+                                               m_heights[kept_node]));
+        if (height > old_height && depth + height > detail::kBvhSahDepth) {
+          continue;
+        }
+        if (gain < best) {
+          best = gain;
+          x = child;
+          g = other.first + pick;
+          y = sibling;
+        }
+      }
+    }
+    if (x == g) return false;
+    std::swap(m_nodes[x], m_nodes[g]);
+    std::swap(m_heights[x], m_heights[g]);
+    BvhNode<T>& parent = m_nodes[y];
+    parent.box = merge(m_nodes[parent.first].box,
+                       m_nodes[parent.first + 1].box);
+    m_heights[y] = 1 + std::max(m_heights[parent.first],
+                                m_heights[parent.first + 1]);
+    return true;
+  }
+
+  void build(std::span<const Triangle<T>> triangles, ThreadPool& pool) {
+    std::vector<AABB<T>> boxes(triangles.size());
+    parallel_for(pool, 0, triangles.size(), std::size_t{1} << 14,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     boxes[i] = triangles[i].bounds();
+                   }
+                 });
+    detail::BvhBuilder<T>::build(boxes, m_nodes, m_indices, pool);
+    m_triangles.resize(triangles.size());
+    gather(std::span<const uint32_t>(m_indices), triangles,
+           std::span(m_triangles), pool);
+  }
+
+  std::vector<BvhNode<T>> m_nodes;      // root first
+  std::vector<Triangle<T>> m_triangles;  // in leaf order
+  std::vector<uint32_t> m_indices;       // of m_triangles in the input
+  std::vector<int> m_heights;  // of each node's subtree, for rotate()
+};
+
+using Bvhf = Bvh<float>;
+using Bvhd = Bvh<double>;
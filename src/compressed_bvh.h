@@ -0,0 +1,382 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATH_COMPRESSED_BVH_SSE2 1
+#endif
+
+#include "aabb.h"
+#include "bvh.h"
+#include "point3.h"
+#include "ray.h"
+#include "thread_pool.h"
+#include "triangle.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Compressed wide bounding volume hierarchy
+//--------------------------------------------
+//
+// A four-wide BVH collapsed from a Bvhf, with child boxes quantized to 8
+// bits per plane on a grid over the parent's box, as in Ylitie et al.,
+// "Efficient Incoherent Ray Traversal on GPUs Through Compressed Wide
+// BVHs" (2017). Per axis a node stores the grid origin in float and its
+// step as a power of two, 2^exponent, chosen so that 255 steps cover the
+// box. A child's planes are rounded outwards, so its decoded box always
+// contains the exact one and no hit is lost, only a few more boxes are
+// entered.
+//
+// A node is 53 bytes, padded to one 64-byte cache line, against the 32
+// bytes per child of a Bvh node, which also needs one node per inner child
+// and twice as many levels. Inner children of a node are stored next to
+// each other, and the triangles of its leaf children too, so the node keeps
+// one base index for each. With SSE2 the four children are decoded and
+// slab-tested at once.
+
+struct alignas(64) CompressedBvhNode {
+  float origin[3];         // grid origin, the parent box's minimum
+  int8_t exponent[3];      // grid step 2^exponent per axis
+  uint8_t inner;           // bit c set if child c is a node
+  uint8_t leaf;            // bit c set if child c is a leaf
+  uint8_t meta[4];         // leaf: first triangle - triangle_base << 3
+                           //       | count - 1
+  uint32_t child_base;     // first inner child node
+  uint32_t triangle_base;  // first triangle of the leaf children
+  uint8_t lo[3][4];        // per axis and child, in grid steps
+  uint8_t hi[3][4];
+};
+
+class CompressedBvh {
+ public:
+  static constexpr int kWidth = 4;
+  static_assert(Bvhf::kMaxLeafSize <= 8, "leaf sizes are stored in 3 bits");
+
+  CompressedBvh() = default;
+
+  // A copy of bvh's tree and triangles; bvh may go away after.
+  explicit CompressedBvh(const Bvhf& bvh) { collapse(bvh); }
+
+  std::size_t size() const { return m_triangles.size(); }
+  bool empty() const { return m_triangles.empty(); }
+  std::size_t node_count() const { return m_nodes.size(); }
+
+  std::span<const CompressedBvhNode> nodes() const { return m_nodes; }
+  std::span<const Trianglef> triangles() const { return m_triangles; }
+  std::span<const uint32_t> indices() const { return m_indices; }
+
+  // Decoded box of child c of node, which contains the exact one.
+  static AABBf child_bounds(const CompressedBvhNode& node, int c) {
+    float lo[3], hi[3];
+    for (int a = 0; a < 3; ++a) {
+      float step = power_of_two(node.exponent[a]);
+      lo[a] = node.origin[a] + static_cast<float>(node.lo[a][c]) * step;
+      hi[a] = node.origin[a] + static_cast<float>(node.hi[a][c]) * step;
+    }
+    return AABBf(Point3f(lo[0], lo[1], lo[2]), Point3f(hi[0], hi[1], hi[2]));
+  }
+
+  //--------------------------------------------
+  // Queries
+  //--------------------------------------------
+  // As Bvh's.
+
+  TriangleHit<float> intersect(const Point3f& origin, const Vec3f& direction,
+                               float tmin, float tmax) const {
+    TriangleHit<float> hit;
+    hit.t = tmax;
+    traverse(origin, direction, tmin, hit.t,
+             [&](uint32_t first, uint32_t count) {
+               for (uint32_t s = first; s < first + count; ++s) {
+                 if (::intersect(m_triangles[s], origin, direction, tmin,
+                                 hit)) {
+                   hit.triangle = m_indices[s];
+                 }
+               }
+               return false;
+             });
+    return hit.hit() ? hit : TriangleHit<float>{};
+  }
+
+  TriangleHit<float> intersect(const Ray& ray) const {
+    return intersect(ray.origin(), ray.direction(), ray.getMinRange(),
+                     ray.getMaxRange());
+  }
+
+  void intersect(std::span<const Ray> rays, std::span<TriangleHit<float>> hits,
+                 ThreadPool& pool) const {
+    if (hits.size() < rays.size()) {
+      throw std::out_of_range("Output span is too small");
+    }
+    parallel_for(pool, 0, rays.size(), kQueryGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     hits[i] = intersect(rays[i]);
+                   }
+                 });
+  }
+
+  void intersect(std::span<const Ray> rays,
+                 std::span<TriangleHit<float>> hits) const {
+    intersect(rays, hits, default_thread_pool());
+  }
+
+  bool occluded(const Point3f& origin, const Vec3f& direction, float tmin,
+                float tmax) const {
+    bool blocked = false;
+    traverse(origin, direction, tmin, tmax,
+             [&](uint32_t first, uint32_t count) {
+               for (uint32_t s = first; s < first + count && !blocked; ++s) {
+                 blocked = occludes(m_triangles[s], origin, direction, tmin,
+                                    tmax);
+               }
+               return blocked;
+             });
+    return blocked;
+  }
+
+  bool occluded(const Ray& ray) const {
+    return occluded(ray.origin(), ray.direction(), ray.getMinRange(),
+                    ray.getMaxRange());
+  }
+
+ private:
+  // Up to three pending children per level of the Bvh it came from.
+  static constexpr int kStackSize = 3 * detail::kBvhStackSize;
+  static constexpr std::size_t kQueryGrain = 64;
+
+  static float power_of_two(int exponent) {
+    return std::bit_cast<float>(static_cast<uint32_t>(exponent + 127) << 23);
+  }
+
+  //--------------------------------------------
+  // Build
+  //--------------------------------------------
+
+  void collapse(const Bvhf& bvh) {
+    m_nodes.clear();
+    m_triangles.clear();
+    m_indices.clear();
+    if (bvh.empty()) return;
+    m_triangles.reserve(bvh.size());
+    m_indices.reserve(bvh.size());
+    m_nodes.emplace_back();
+    collapse(bvh, 0, 0);
+  }
+
+  // Fills wide node `out` from binary node `node` and its descendants.
+  void collapse(const Bvhf& bvh, uint32_t out, uint32_t node) {
+    auto nodes = bvh.nodes();
+    // Open the largest inner child until there are kWidth of them.
+    std::array<uint32_t, kWidth> children{};
+    int count = 0;
+    if (nodes[node].leaf()) {
+      children[count++] = node;
+    } else {
+      children[count++] = nodes[node].first;
+      children[count++] = nodes[node].first + 1;
+    }
+    while (count < kWidth) {
+      int open = -1;
+      float largest = -1.f;
+      for (int c = 0; c < count; ++c) {
+        const BvhNode<float>& n = nodes[children[c]];
+        if (!n.leaf() && n.box.surface_area() > largest) {
+          largest = n.box.surface_area();
+          open = c;
+        }
+      }
+      if (open < 0) break;
+      uint32_t first = nodes[children[open]].first;
+      children[open] = first;
+      children[count++] = first + 1;
+    }
+
+    CompressedBvhNode wide{};
+    wide.child_base = static_cast<uint32_t>(m_nodes.size());
+    wide.triangle_base = static_cast<uint32_t>(m_triangles.size());
+    quantize(wide, nodes[node].box, children, count, nodes);
+    std::array<uint32_t, kWidth> inner{};
+    int inner_count = 0;
+    for (int c = 0; c < count; ++c) {
+      const BvhNode<float>& n = nodes[children[c]];
+      if (!n.leaf()) {
+        wide.inner |= static_cast<uint8_t>(1u << c);
+        inner[inner_count++] = children[c];
+        continue;
+      }
+      uint32_t offset =
+          static_cast<uint32_t>(m_triangles.size()) - wide.triangle_base;
+      wide.leaf |= static_cast<uint8_t>(1u << c);
+      wide.meta[c] = static_cast<uint8_t>(offset << 3 | (n.count - 1));
+      for (uint32_t s = n.first; s < n.first + n.count; ++s) {
+        m_triangles.push_back(bvh.triangles()[s]);
+        m_indices.push_back(bvh.indices()[s]);
+      }
+    }
+    m_nodes[out] = wide;
+    m_nodes.resize(m_nodes.size() + static_cast<std::size_t>(inner_count));
+    for (int i = 0; i < inner_count; ++i) {
+      collapse(bvh, wide.child_base + static_cast<uint32_t>(i), inner[i]);
+    }
+  }
+
+  // Sets the grid of wide over box and the children's planes on it.
+  static void quantize(CompressedBvhNode& wide, const AABBf& box,
+                       const std::array<uint32_t, kWidth>& children,
+                       int count, std::span<const BvhNode<float>> nodes) {
+    for (int a = 0; a < 3; ++a) {
+      float lo = box.min()[a], hi = box.max()[a];
+      int exponent = -126;
+      if (hi > lo) {
+        std::frexp((hi - lo) / 255.f, &exponent);
+        exponent = std::clamp(exponent, -126, 127);
+      }
+      while (exponent < 127 && lo + 255.f * power_of_two(exponent) < hi) {
+        ++exponent;
+      }
+      wide.origin[a] = lo;
+      wide.exponent[a] = static_cast<int8_t>(exponent);
+      float step = power_of_two(exponent);
+      auto decode = [&](int q) { return lo + static_cast<float>(q) * step; };
+      for (int c = 0; c < kWidth; ++c) {
+        if (c >= count) {
+          wide.lo[a][c] = 255;
+          wide.hi[a][c] = 0;
+          continue;
+        }
+        const AABBf& child = nodes[children[c]].box;
+        float cmin = child.min()[a], cmax = child.max()[a];
+        int qlo = std::clamp(
+            static_cast<int>(std::floor((cmin - lo) / step)), 0, 255);
+        int qhi = std::clamp(
+            static_cast<int>(std::ceil((cmax - lo) / step)), 0, 255);
+        // Outwards past any rounding of the division.
+        while (qlo > 0 && decode(qlo) > cmin) --qlo;
+        while (qhi < 255 && decode(qhi) < cmax) ++qhi;
+        wide.lo[a][c] = static_cast<uint8_t>(qlo);
+        wide.hi[a][c] = static_cast<uint8_t>(qhi);
+      }
+    }
+  }
+
+  //--------------------------------------------
+  // Traversal
+  //--------------------------------------------
+
+  // Where the ray enters each child of node within [tmin, tmax]; returns
+  // the children it enters as a bit mask.
+  static unsigned enter(const CompressedBvhNode& node,
+                        const detail::SlabRay<float>& ray, float tmin,
+                        float tmax, float (&t)[kWidth]) {
+#ifdef MATH_COMPRESSED_BVH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    auto widen = [&](const uint8_t (&q)[4]) {
+      uint32_t bytes;
+      std::memcpy(&bytes, q, 4);
+      __m128i v = _mm_cvtsi32_si128(static_cast<int>(bytes));
+      v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero);
+      return _mm_cvtepi32_ps(v);
+    };
+    __m128 near = _mm_set1_ps(tmin);
+    __m128 far = _mm_set1_ps(tmax);
+    for (int a = 0; a < 3; ++a) {
+      __m128 origin = _mm_set1_ps(node.origin[a]);
+      __m128 step = _mm_set1_ps(power_of_two(node.exponent[a]));
+      __m128 o = _mm_set1_ps(ray.origin[a]);
+      __m128 inv = _mm_set1_ps(ray.inv[a]);
+      __m128 lo = _mm_add_ps(origin, _mm_mul_ps(widen(node.lo[a]), step));
+      __m128 hi = _mm_add_ps(origin, _mm_mul_ps(widen(node.hi[a]), step));
+      __m128 t0 = _mm_mul_ps(_mm_sub_ps(lo, o), inv);
+      __m128 t1 = _mm_mul_ps(_mm_sub_ps(hi, o), inv);
+      near = _mm_max_ps(near, _mm_min_ps(t0, t1));
+      far = _mm_min_ps(far, _mm_max_ps(t0, t1));
+    }
+    _mm_storeu_ps(t, near);
+    auto mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmple_ps(near, far)));
+    return mask & (node.inner | node.leaf);
+#else
+    unsigned mask = 0;
+    for (int c = 0; c < kWidth; ++c) {
+      float near = tmin, far = tmax;
+      for (int a = 0; a < 3; ++a) {
+        float step = power_of_two(node.exponent[a]);
+        float lo = node.origin[a] + static_cast<float>(node.lo[a][c]) * step;
+        float hi = node.origin[a] + static_cast<float>(node.hi[a][c]) * step;
+        float t0 = (lo - ray.origin[a]) * ray.inv[a];
+        float t1 = (hi - ray.origin[a]) * ray.inv[a];
+        near = std::max(near, std::min(t0, t1));
+        far = std::min(far, std::max(t0, t1));
+      }
+      t[c] = near;
+      if (near <= far) mask |= 1u << c;
+    }
+    return mask & (node.inner | node.leaf);
+#endif
+  }
+
+  // Calls visit(first, count) for the triangle range of every leaf whose
+  // box the ray enters before tmax, which visit may lower, nearest first,
+  // until visit returns true.
+  template <typename Visit>
+  void traverse(const Point3f& origin, const Vec3f& direction, float tmin,
+                const float& tmax, Visit&& visit) const {
+    if (empty()) return;
+    detail::SlabRay<float> ray(origin, direction);
+    // A node (count 0) or a leaf's triangles, and where the ray enters it.
+    struct Entry {
+      uint32_t first;
+      uint32_t count;
+      float t;
+    };
+    Entry stack[kStackSize];
+    int top = 0;
+    stack[top++] = {0, 0, tmin};
+    while (top > 0) {
+      Entry entry = stack[--top];
+      if (entry.t >= tmax) continue;
+      if (entry.count > 0) {
+        if (visit(entry.first, entry.count)) return;
+        continue;
+      }
+      const CompressedBvhNode& node = m_nodes[entry.first];
+      float t[kWidth];
+      unsigned mask = enter(node, ray, tmin, tmax, t);
+      // Push the entered children farthest first, so the nearest is
+      // popped next.
+      Entry found[kWidth];
+      int n = 0;
+      for (int c = 0; c < kWidth; ++c) {
+        if (!(mask >> c & 1u)) continue;
+        Entry e;
+        if (node.inner >> c & 1u) {
+          unsigned below = node.inner & ((1u << c) - 1u);
+          e = {node.child_base + static_cast<uint32_t>(std::popcount(below)),
+               0, t[c]};
+        } else {
+          e = {node.triangle_base + (node.meta[c] >> 3u),
+               (node.meta[c] & 7u) + 1u, t[c]};
+        }
+        int i = n++;
+        for (; i > 0 && found[i - 1].t < e.t; --i) found[i] = found[i - 1];
+        found[i] = e;
+      }
+      for (int i = 0; i < n; ++i) stack[top++] = found[i];
+    }
+  }
+
+  std::vector<CompressedBvhNode> m_nodes;  // root first
+  std::vector<Trianglef> m_triangles;      // in leaf order
+  std::vector<uint32_t> m_indices;         // of m_triangles in the input
+};
@@ -3,10 +3,10 @@
 #include <cmath>
 #include <limits>
 
-const float PI = acos(-1.);
-const float InvPI = 1.f / PI;
+inline const float PI = acos(-1.);
+inline const float InvPI = 1.f / PI;
 constexpr float EPS = std::numeric_limits<float>::epsilon();
 constexpr float EPS1 = 0.000002f;
-const float RAD = 360.f;
+inline const float RAD = 360.f;
 constexpr float DEG2RAD = 0.0174533f;
 constexpr float RAD2DEG = 57.2958f;
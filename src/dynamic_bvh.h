@@ -0,0 +1,399 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "bvh.h"
+#include "point3.h"
+#include "ray.h"
+#include "triangle.h"
+#include "types.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Incrementally updated bounding volume hierarchy
+//--------------------------------------------
+//
+// A binary tree with one triangle per leaf that takes triangles one at a
+// time, for scenes where they come and go. Each node links its parent and
+// children, and removed nodes and ids are reused, so nothing moves when
+// the tree changes.
+//
+// insert() places the new leaf next to the node that adds the least
+// surface area to the tree: the area of their joint box plus the growth of
+// every ancestor's box. A best-first search finds it and skips subtrees
+// whose growth alone already costs more than the best node so far, as in
+// Bittner et al., "Fast Insertion-Based Optimization of Bounding Volume
+// Hierarchies" (2013). On the way back to the root every ancestor is refit
+// and tries the same child-grandchild rotations as Bvh::rotate(), which
+// keeps the tree from degrading as the order of insertions would make it.
+//
+// Ids are handed out by insert() and stay valid until remove(); hits name
+// triangles by them. Queries match Bvh's.
+
+template <numeric T>
+class DynamicBvh {
+ public:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  DynamicBvh() = default;
+
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_root == kNone; }
+  std::size_t node_count() const { return empty() ? 0 : 2 * m_size - 1; }
+
+  AABB<T> bounds() const {
+    return empty() ? AABB<T>() : m_nodes[m_root].box;
+  }
+
+  // As Bvh::sah_cost(), with a leaf per triangle.
+  T sah_cost() const {
+    if (empty()) return T{0};
+    T total{0};
+    std::vector<uint32_t> pending = {m_root};
+    while (!pending.empty()) {
+      const Node& n = m_nodes[pending.back()];
+      pending.pop_back();
+      total += n.box.surface_area();
+      if (n.leaf()) continue;
+      pending.push_back(n.child[0]);
+      pending.push_back(n.child[1]);
+    }
+    T root = m_nodes[m_root].box.surface_area();
+    return root > T{0} ? total / root : total;
+  }
+
+  bool contains(uint32_t id) const {
+    return id < m_leaf.size() && m_leaf[id] != kNone;
+  }
+
+  // Throws std::out_of_range if id is not in the tree.
+  const Triangle<T>& triangle(uint32_t id) const {
+    check(id);
+    return m_triangles[id];
+  }
+
+  //--------------------------------------------
+  // Updates
+  //--------------------------------------------
+
+  // Adds the triangle; returns its id.
+  uint32_t insert(const Triangle<T>& triangle) {
+    uint32_t id;
+    if (m_free_ids.empty()) {
+      if (m_leaf.size() >= UINT32_MAX / 2) {
+        throw std::length_error("Too many triangles for a BVH");
+      }
+      id = static_cast<uint32_t>(m_leaf.size());
+      m_leaf.push_back(kNone);
+      m_triangles.push_back(triangle);
+    } else {
+      id = m_free_ids.back();
+      m_free_ids.pop_back();
+      m_triangles[id] = triangle;
+    }
+    insert_leaf(id);
+    ++m_size;
+    return id;
+  }
+
+  // Throws std::out_of_range if id is not in the tree.
+  void remove(uint32_t id) {
+    check(id);
+    remove_leaf(id);
+    m_free_ids.push_back(id);
+    --m_size;
+  }
+
+  // Moves the triangle with this id: it is taken out and put back where
+  // it now fits best. Throws std::out_of_range if id is not in the tree.
+  void update(uint32_t id, const Triangle<T>& triangle) {
+    check(id);
+    remove_leaf(id);
+    m_triangles[id] = triangle;
+    insert_leaf(id);
+  }
+
+  void clear() {
+    m_nodes.clear();
+    m_triangles.clear();
+    m_leaf.clear();
+    m_free_ids.clear();
+    m_free_node = kNone;
+    m_root = kNone;
+    m_size = 0;
+  }
+
+  //--------------------------------------------
+  // Queries
+  //--------------------------------------------
+
+  // The nearest triangle along origin + t * direction for t in
+  // [tmin, tmax), or a TriangleHit without a triangle.
+  TriangleHit<T> intersect(const Point3<T>& origin, const Vec3<T>& direction,
+                           T tmin, T tmax) const {
+    TriangleHit<T> hit;
+    hit.t = tmax;
+    traverse(origin, direction, tmin, hit.t, [&](uint32_t id) {
+      if (::intersect(m_triangles[id], origin, direction, tmin, hit)) {
+        hit.triangle = id;
+      }
+      return false;
+    });
+    return hit.hit() ? hit : TriangleHit<T>{};
+  }
+
+  TriangleHit<T> intersect(const Ray& ray) const {
+    return intersect(detail::point_from<T>(ray.origin()),
+                     detail::vector_from<T>(ray.direction()),
+                     static_cast<T>(ray.getMinRange()),
+                     static_cast<T>(ray.getMaxRange()));
+  }
+
+  // Whether any triangle lies on origin + t * direction for t in
+  // [tmin, tmax).
+  bool occluded(const Point3<T>& origin, const Vec3<T>& direction, T tmin,
+                T tmax) const {
+    bool blocked = false;
+    traverse(origin, direction, tmin, tmax, [&](uint32_t id) {
+      blocked = occludes(m_triangles[id], origin, direction, tmin, tmax);
+      return blocked;
+    });
+    return blocked;
+  }
+
+  bool occluded(const Ray& ray) const {
+    return occluded(detail::point_from<T>(ray.origin()),
+                    detail::vector_from<T>(ray.direction()),
+                    static_cast<T>(ray.getMinRange()),
+                    static_cast<T>(ray.getMaxRange()));
+  }
+
+ private:
+  static constexpr int kStackSize = 64;
+  // Rotations must shrink a box by this share of its parent's area.
+  static constexpr T kMinRotationGain = static_cast<T>(1e-4);
+
+  struct Node {
+    AABB<T> box;
+    uint32_t parent = kNone;
+    uint32_t child[2] = {kNone, kNone};  // the next free node if unused
+    uint32_t id = kNone;                 // triangle of a leaf
+    uint32_t height = 0;                 // 0 for leaves
+
+    bool leaf() const { return id != kNone; }
+  };
+
+  void check(uint32_t id) const {
+    if (!contains(id)) throw std::out_of_range("No triangle with this id");
+  }
+
+  uint32_t allocate() {
+    if (m_free_node == kNone) {
+      m_nodes.emplace_back();
+      return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+    uint32_t node = m_free_node;
+    m_free_node = m_nodes[node].child[0];
+    m_nodes[node] = Node();
+    return node;
+  }
+
+  void release(uint32_t node) {
+    m_nodes[node].id = kNone;
+    m_nodes[node].child[0] = m_free_node;
+    m_free_node = node;
+  }
+
+  // The node whose box grows the tree least when joined with box.
+  uint32_t best_sibling(const AABB<T>& box) const {
+    // Nodes to look at with the growth of their ancestors' boxes.
+    using Entry = std::pair<T, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    T area = box.surface_area();
+    uint32_t best = m_root;
+    T best_cost = merge(m_nodes[m_root].box, box).surface_area();
+    open.push({T{0}, m_root});
+    while (!open.empty()) {
+      auto [inherited, node] = open.top();
+      open.pop();
+      // Any node below costs at least the new leaf's own area on top.
+      if (inherited + area >= best_cost) break;
+      const Node& n = m_nodes[node];
+      T joint = merge(n.box, box).surface_area();
+      if (joint + inherited < best_cost) {
+        best_cost = joint + inherited;
+        best = node;
+      }
+      if (n.leaf()) continue;
+      T below = inherited + joint - n.box.surface_area();
+      if (below + area < best_cost) {
+        open.push({below, n.child[0]});
+        open.push({below, n.child[1]});
+      }
+    }
+    return best;
+  }
+
+  void insert_leaf(uint32_t id) {
+    uint32_t leaf = allocate();
+    m_nodes[leaf].box = m_triangles[id].bounds();
+    m_nodes[leaf].id = id;
+    m_leaf[id] = leaf;
+    if (m_root == kNone) {
+      m_root = leaf;
+      return;
+    }
+    uint32_t sibling = best_sibling(m_nodes[leaf].box);
+    uint32_t old_parent = m_nodes[sibling].parent;
+    uint32_t parent = allocate();
+    m_nodes[parent].parent = old_parent;
+    m_nodes[parent].child[0] = sibling;
+    m_nodes[parent].child[1] = leaf;
+    m_nodes[sibling].parent = parent;
+    m_nodes[leaf].parent = parent;
+    if (old_parent == kNone) {
+      m_root = parent;
+    } else {
+      Node& p = m_nodes[old_parent];
+      p.child[p.child[0] == sibling ? 0 : 1] = parent;
+    }
+    refit_up(parent);
+  }
+
+  void remove_leaf(uint32_t id) {
+    uint32_t leaf = m_leaf[id];
+    m_leaf[id] = kNone;
+    uint32_t parent = m_nodes[leaf].parent;
+    release(leaf);
+    if (parent == kNone) {
+      m_root = kNone;
+      return;
+    }
+    const Node& p = m_nodes[parent];
+    uint32_t sibling = p.child[p.child[0] == leaf ? 1 : 0];
+    uint32_t grandparent = p.parent;
+    m_nodes[sibling].parent = grandparent;
+    release(parent);
+    if (grandparent == kNone) {
+      m_root = sibling;
+      return;
+    }
+    Node& g = m_nodes[grandparent];
+    g.child[g.child[0] == parent ? 0 : 1] = sibling;
+    refit_up(grandparent);
+  }
+
+  // Refits and rotates from node up to the root.
+  void refit_up(uint32_t node) {
+    while (node != kNone) {
+      fit(node);
+      rotate(node);
+      node = m_nodes[node].parent;
+    }
+  }
+
+  void fit(uint32_t node) {
+    Node& n = m_nodes[node];
+    const Node& a = m_nodes[n.child[0]];
+    const Node& b = m_nodes[n.child[1]];
+    n.box = merge(a.box, b.box);
+    n.height = 1 + std::max(a.height, b.height);
+  }
+
+  // The best swap of a child with a grandchild on the other side, as in
+  // Bvh::rotate(), if it shrinks anything.
+  void rotate(uint32_t node) {
+    const Node& n = m_nodes[node];
+    T best = -kMinRotationGain * n.box.surface_area();
+    int x = -1, g = -1;
+    for (int side = 0; side < 2; ++side) {
+      const Node& other = m_nodes[n.child[1 - side]];
+      if (other.leaf()) continue;
+      T area = other.box.surface_area();
+      for (int pick = 0; pick < 2; ++pick) {
+        const AABB<T>& kept = m_nodes[other.child[1 - pick]].box;
+        T gain = merge(m_nodes[n.child[side]].box, kept).surface_area() - area;
+        if (gain < best) {
+          best = gain;
+          x = side;
+          g = pick;
+        }
+      }
+    }
+    if (x < 0) return;
+    uint32_t child = n.child[x];
+    uint32_t sibling = n.child[1 - x];
+    uint32_t grandchild = m_nodes[sibling].child[g];
+    m_nodes[node].child[x] = grandchild;
+    m_nodes[grandchild].parent = node;
+    m_nodes[sibling].child[g] = child;
+    m_nodes[child].parent = sibling;
+    fit(sibling);
+    fit(node);
+  }
+
+  // Calls visit(id) for every triangle whose leaf box the ray enters
+  // before tmax, which visit may lower, until visit returns true.
+  template <typename Visit>
+  void traverse(const Point3<T>& origin, const Vec3<T>& direction, T tmin,
+                const T& tmax, Visit&& visit) const {
+    if (empty()) return;
+    detail::SlabRay<T> slab(origin, direction);
+    constexpr T kMiss = std::numeric_limits<T>::infinity();
+    if (slab.enter(m_nodes[m_root].box, tmin, tmax) == kMiss) return;
+
+    // Pending far children and where the ray enters them; at most one per
+    // level.
+    std::pair<uint32_t, T> local[kStackSize];
+    std::vector<std::pair<uint32_t, T>> deep;
+    std::pair<uint32_t, T>* stack = local;
+    if (m_nodes[m_root].height >= kStackSize) {
+      deep.resize(m_nodes[m_root].height);
+      stack = deep.data();
+    }
+    int top = 0;
+    uint32_t node = m_root;
+    while (true) {
+      const Node& n = m_nodes[node];
+      if (n.leaf()) {
+        if (visit(n.id)) return;
+      } else {
+        T near = slab.enter(m_nodes[n.child[0]].box, tmin, tmax);
+        T far = slab.enter(m_nodes[n.child[1]].box, tmin, tmax);
+        uint32_t near_node = n.child[0], far_node = n.child[1];
+        if (far < near) {
+          std::swap(near, far);
+          std::swap(near_node, far_node);
+        }
+        if (near != kMiss) {
+          if (far != kMiss) stack[top++] = {far_node, far};
+          node = near_node;
+          continue;
+        }
+      }
+      while (top > 0 && stack[top - 1].second >= tmax) --top;
+      if (top == 0) return;
+      node = stack[--top].first;
+    }
+  }
+
+  std::vector<Node> m_nodes;
+  std::vector<Triangle<T>> m_triangles;  // by id
+  std::vector<uint32_t> m_leaf;          // leaf node of each id, or kNone
+  std::vector<uint32_t> m_free_ids;
+  uint32_t m_free_node = kNone;          // list through child[0]
+  uint32_t m_root = kNone;
+  std::size_t m_size = 0;
+};
+
+using DynamicBvhf = DynamicBvh<float>;
+using DynamicBvhd = DynamicBvh<double>;
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include "constants.h"
+#include "mat4.h"
+#include "quat.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Approximate single precision kernels
+//--------------------------------------------
+//
+// Opt-in replacements for the libm calls used by the vector, matrix and
+// quaternion code. Everything lives in namespace fast so a call site chooses
+// its own speed/accuracy trade-off:
+//
+//   Vec3f n = fast::normalized(v);      // instead of normalized(v)
+//   Mat4f r = fast::rotationOverY(a);   // instead of rotationOverY(a)
+//
+// The error bounds below are the maximum measured over the stated domain
+// against a double precision reference, in units in the last place of the
+// correctly rounded float result. bench/fast_math_bench.cpp reproduces them
+// together with the timings; note that acos is only on par with a good
+// libm in scalar code, its gain is being inlinable and branch-light.
+//
+//   function    domain              max error
+//   rsqrt       [FLT_MIN, FLT_MAX]  3 ulp (SSE), 12 ulp (portable)
+//   sin/cos     [-8192, 8192]       2 ulp, 1e-7 absolute near the zeros
+//   sincos      [-8192, 8192]       same as sin/cos
+//   acos        [-1, 1]             1 ulp
+//   atan        any finite x        3 ulp
+//   atan2       any finite y, x     3 ulp
+//   normalized  non-zero Vec3f      4 ulp per component
+
+namespace fast {
+
+namespace detail {
+
+// 2/PI and PI/2 split in three parts for Cody-Waite range reduction. The
+// first part has 8 significant bits so k * PIO2_1 is exact for |k| < 2^16.
+constexpr float TwoOverPI = 0.636619772367581343f;
+constexpr float PIO2_1 = 1.5703125f;
+constexpr float PIO2_2 = 4.837512969970703125e-4f;
+constexpr float PIO2_3 = 7.54978995489188216e-8f;
+constexpr float PIO2 = 1.57079632679489661923f;
+constexpr float PIO4 = 0.78539816339744830962f;
+constexpr float Pi = 3.14159265358979323846f;
+
+// Rounds to the nearest integer without leaving the float pipeline. Valid
+// for |x| < 2^22.
+inline float round_nearest(float x) {
+  constexpr float magic = 12582912.f;  // 1.5 * 2^23
+  return (x + magic) - magic;
+}
+
+// Square root of an argument known to be non-negative, without the errno
+// handling of std::sqrt.
+inline float sqrt_nonneg(float x) {
+#if defined(__SSE__) || defined(_M_X64)
+  return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+#else
+  return std::sqrt(x);
+#endif
+}
+
+// Minimax polynomials on [-PI/4, PI/4], z = r * r.
+inline float sin_poly(float r, float z) {
+  float p = -1.9515295891e-4f;
+  p = p * z + 8.3321608736e-3f;
+  p = p * z - 1.6666654611e-1f;
+  return r + r * z * p;
+}
+
+inline float cos_poly(float z) {
+  float p = 2.443315711809948e-5f;
+  p = p * z - 1.388731625493765e-3f;
+  p = p * z + 4.166664568298827e-2f;
+  return 1.f - 0.5f * z + z * z * p;
+}
+
+// Minimax polynomial for asin on [0, 0.5].
+inline float asin_poly(float x) {
+  float z = x * x;
+  float p = 4.2163199048e-2f;
+  p = p * z + 2.4181311049e-2f;
+  p = p * z + 4.5470025998e-2f;
+  p = p * z + 7.4953002686e-2f;
+  p = p * z + 1.6666752422e-1f;
+  return x + x * z * p;
+}
+
+// Minimax polynomial for atan on [-tan(PI/8), tan(PI/8)].
+inline float atan_poly(float x) {
+  float z = x * x;
+  float p = 8.05374449538e-2f;
+  p = p * z - 1.38776856032e-1f;
+  p = p * z + 1.99777106478e-1f;
+  p = p * z - 3.33329491539e-1f;
+  return x + x * z * p;
+}
+
+}  // namespace detail
+
+//--------------------------------------------
+// Scalar kernels
+//--------------------------------------------
+
+// 1 / sqrt(x) for finite x > 0: hardware estimate (or the bit-level initial
+// guess) refined with one Newton-Raphson step.
+inline float rsqrt(float x) {
+#if defined(__SSE__) || defined(_M_X64)
+  float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+  return y * (1.5f - 0.5f * x * y * y);
+#else
+  // Moroz et al. initial guess with a tuned Newton step.
+  auto bits = 0x5F1FFFF9u - (std::bit_cast<uint32_t>(x) >> 1);
+  float y = std::bit_cast<float>(bits);
+  y *= 0.703952253f * (2.38924456f - x * y * y);
+  return y * (1.5f - 0.5f * x * y * y);
+#endif
+}
+
+// sin(x) and cos(x) sharing one range reduction. The quadrant fix-up is
+// done on the bit patterns so random arguments do not cost mispredictions.
+inline void sincos(float x, float& s, float& c) {
+  float k = detail::round_nearest(x * detail::TwoOverPI);
+  float r = x - k * detail::PIO2_1;
+  r -= k * detail::PIO2_2;
+  r -= k * detail::PIO2_3;
+  float z = r * r;
+  auto ps = std::bit_cast<uint32_t>(detail::sin_poly(r, z));
+  auto pc = std::bit_cast<uint32_t>(detail::cos_poly(z));
+  auto q = static_cast<uint32_t>(static_cast<int32_t>(k));
+  uint32_t swap = 0u - (q & 1u);
+  uint32_t sb = (ps & ~swap) | (pc & swap);
+  uint32_t cb = (pc & ~swap) | (ps & swap);
+  s = std::bit_cast<float>(sb ^ ((q & 2u) << 30));
+  c = std::bit_cast<float>(cb ^ (((q + 1u) & 2u) << 30));
+}
+
+inline float sin(float x) {
+  float s, c;
+  sincos(x, s, c);
+  return s;
+}
+
+inline float cos(float x) {
+  float s, c;
+  sincos(x, s, c);
+  return c;
+}
+
+// acos(x) for x in [-1, 1]; the argument is clamped. Uses
+// acos(a) = 2 * asin(sqrt((1 - a) / 2)) for a > 0.5 and
+// acos(a) = PI/2 - asin(a) below. The polynomial argument is simply the
+// smaller of the two candidates, so only one polynomial is evaluated.
+inline float acos(float x) {
+  float a = std::fabs(x);
+  a = a > 1.f ? 1.f : a;
+  float t = detail::sqrt_nonneg(0.5f * (1.f - a));
+  float p = detail::asin_poly(t < a ? t : a);
+  float r = a > 0.5f ? 2.f * p : detail::PIO2 - p;
+  return x < 0.f ? detail::Pi - r : r;
+}
+
+inline float atan(float x) {
+  float a = std::fabs(x);
+  float offset = 0.f;
+  if (a > 2.414213562373095f) {  // tan(3PI/8)
+    offset = detail::PIO2;
+    a = -1.f / a;
+  } else if (a > 0.4142135623730950f) {  // tan(PI/8)
+    offset = detail::PIO4;
+    a = (a - 1.f) / (a + 1.f);
+  }
+  float r = offset + detail::atan_poly(a);
+  return x < 0.f ? -r : r;
+}
+
+inline float atan2(float y, float x) {
+  if (x == 0.f) {
+    if (y == 0.f) return 0.f;
+    return y < 0.f ? -detail::PIO2 : detail::PIO2;
+  }
+  float r = atan(y / x);
+  if (x < 0.f) r += y < 0.f ? -detail::Pi : detail::Pi;
+  return r;
+}
+
+//--------------------------------------------
+// Vector and quaternion operations
+//--------------------------------------------
+
+inline float length(const Vec3f& v) {
+  float sq = dot(v, v);
+  if (sq < std::numeric_limits<float>::min()) return std::sqrt(sq);
+  return sq * rsqrt(sq);
+}
+
+inline Vec3f normalized(const Vec3f& v) {
+  float sq = dot(v, v);
+  if (sq < std::numeric_limits<float>::min()) return v;
+  return v * rsqrt(sq);
+}
+
+inline void normalize(Vec3f& v) { v = normalized(v); }
+
+inline float length(const Quat& q) {
+  auto sq_length = q.squared_length();
+  return sq_length < EPS ? 0.f : sq_length * rsqrt(sq_length);
+}
+
+inline void normalize(Quat& q) {
+  auto sq_length = q.squared_length();
+  if (sq_length < EPS) return;
+  auto length_inv = rsqrt(sq_length);
+  q = q * length_inv;
+}
+
+inline Quat normalized(const Quat& q) {
+  auto sq_length = q.squared_length();
+  if (sq_length < EPS) {
+    return Quat();
+  }
+  return q * rsqrt(sq_length);
+}
+
+inline Quat angle_axis(float angle, const Vec3f& axis) {
+  Vec3f norm = normalized(axis);
+  float s, c;
+  sincos(angle * 0.5f, s, c);
+  return Quat(norm.x() * s, norm.y() * s, norm.z() * s, c);
+}
+
+inline float get_angle(const Quat& quat) { return 2.f * acos(quat.w()); }
+
+//--------------------------------------------
+// Rotation matrices
+//--------------------------------------------
+
+inline Mat4f rotationOverX(float rad) {
+  float s, c;
+  sincos(rad, s, c);
+  Mat4f ret;
+  ret[1][1] = c;
+  ret[1][2] = -s;
+  ret[2][1] = s;
+  ret[2][2] = c;
+  return ret;
+}
+
+inline Mat4f rotationOverY(float rad) {
+  float s, c;
+  sincos(rad, s, c);
+  Mat4f ret;
+  ret[0][0] = c;
+  ret[0][2] = s;
+  ret[2][0] = -s;
+  ret[2][2] = c;
+  return ret;
+}
+
+inline Mat4f rotationOverZ(float rad) {
+  float s, c;
+  sincos(rad, s, c);
+  Mat4f ret;
+  ret[0][0] = c;
+  ret[0][1] = -s;
+  ret[1][0] = s;
+  ret[1][1] = c;
+  return ret;
+}
+
+}  // namespace fast
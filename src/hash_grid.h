@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "point3.h"
+#include "spatial_sort.h"
+#include "thread_pool.h"
+#include "types.h"
+
+//--------------------------------------------
+// Uniform spatial hash grid
+//--------------------------------------------
+//
+// Fixed-radius neighbour search for particles, after the compact hashing
+// of Ihmsen et al. ("A Parallel SPH Implementation on Multi-Core CPUs",
+// 2011). Space is cut into cubic cells of side `radius`, and the points
+// are sorted by the Morton key of their cell, so every occupied cell is a
+// contiguous range of that order and cells close in space are mostly close
+// in memory. A hash table sized by the number of occupied cells, not by
+// the extent of the scene, maps a cell to its range; a neighbour query
+// looks up the 27 cells around it and checks distances.
+//
+// rebuild() sorts from scratch with radix_sort(). update() is for points
+// that moved a little since the last build: only the points that changed
+// cell are sorted, then merged with the ones that stayed, which keep their
+// order. Both leave the points in the same order.
+//
+// Cell coordinates are clamped to 21 bits (about a million cells either
+// way from the origin); points beyond share the border cells, which is
+// slower but still correct.
+
+template <numeric T>
+class HashGrid {
+ public:
+  HashGrid() = default;
+
+  HashGrid(std::span<const Point3<T>> points, T radius, ThreadPool& pool) {
+    rebuild(points, radius, pool);
+  }
+
+  HashGrid(std::span<const Point3<T>> points, T radius)
+      : HashGrid(points, radius, default_thread_pool()) {}
+
+  T radius() const { return m_radius; }
+  std::size_t size() const { return m_order.size(); }
+  std::size_t cell_count() const { return m_cells.size(); }
+
+  // Point indices in cell order. Iterating particles in this order keeps
+  // neighbouring particles' data close in cache.
+  std::span<const uint32_t> order() const { return m_order; }
+
+  void rebuild(std::span<const Point3<T>> points, T radius, ThreadPool& pool) {
+    if (!(radius > T{0})) {
+      throw std::invalid_argument("HashGrid radius must be positive");
+    }
+    if (points.size() >= UINT32_MAX) {
+      throw std::length_error("Too many points for a hash grid");
+    }
+    m_radius = radius;
+    m_inv_cell = T{1} / radius;
+    std::size_t n = points.size();
+    m_keys.resize(n);
+    m_order.resize(n);
+    parallel_for(pool, 0, n, kGrain, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        m_keys[i] = cell_key(points[i]);
+        m_order[i] = static_cast<uint32_t>(i);
+      }
+    });
+    radix_sort(std::span(m_keys), std::span(m_order), pool);
+    finish(points, pool);
+  }
+
+  void rebuild(std::span<const Point3<T>> points, T radius) {
+    rebuild(points, radius, default_thread_pool());
+  }
+
+  // Re-sorts after the points (the same ones, moved) changed. Falls back to
+  // rebuild() when the count changed or many points left their cell.
+  // Returns how many points changed cell.
+  std::size_t update(std::span<const Point3<T>> points, ThreadPool& pool) {
+    std::size_t n = points.size();
+    if (n != m_order.size() || n == 0) {
+      rebuild(points, m_radius, pool);
+      return n;
+    }
+    // New cell of every slot, and how many slots changed, per block.
+    std::size_t blocks = std::min<std::size_t>(
+        (n + kGrain - 1) / kGrain, 8 * (std::size_t{pool.size()} + 1));
+    auto block_begin = [&](std::size_t b) { return n * b / blocks; };
+    std::vector<uint64_t> next(n);
+    std::vector<std::size_t> moved_before(blocks + 1, 0);
+    parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+      std::size_t moved = 0;
+      for (std::size_t s = block_begin(b); s < block_begin(b + 1); ++s) {
+        next[s] = cell_key(points[m_order[s]]);
+        moved += next[s] != m_keys[s];
+      }
+      moved_before[b + 1] = moved;
+    });
+    for (std::size_t b = 0; b < blocks; ++b) {
+      moved_before[b + 1] += moved_before[b];
+    }
+    std::size_t moved = moved_before[blocks];
+    if (moved > n / kRebuildFraction) {
+      rebuild(points, m_radius, pool);
+      return moved;
+    }
+
+    // Movers sorted by new cell (then index, as rebuild() orders them);
+    // stayers compacted in their old order, which is already sorted.
+    std::vector<Entry> movers(moved);
+    std::vector<Entry> stayers(n - moved);
+    parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+      std::size_t m = moved_before[b];
+      std::size_t k = block_begin(b) - m;
+      for (std::size_t s = block_begin(b); s < block_begin(b + 1); ++s) {
+        Entry e{next[s], m_order[s]};
+        if (next[s] != m_keys[s]) {
+          movers[m++] = e;
+        } else {
+          stayers[k++] = e;
+        }
+      }
+    });
+    std::sort(movers.begin(), movers.end());
+
+    // Parallel merge. Block b starts at the first cell of its share of the
+    // stayers, in both sequences.
+    std::vector<std::pair<std::size_t, std::size_t>> splits(blocks + 1);
+    splits[blocks] = {stayers.size(), movers.size()};
+    for (std::size_t b = 1; b < blocks; ++b) {
+      Entry at{stayers.empty() ? 0 : stayers[stayers.size() * b / blocks].key,
+               0};
+      splits[b] = {
+          std::lower_bound(stayers.begin(), stayers.end(), at) -
+              stayers.begin(),
+          std::lower_bound(movers.begin(), movers.end(), at) - movers.begin()};
+    }
+    parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+      auto [s, m] = splits[b];
+      auto [s_end, m_end] = splits[b + 1];
+      for (std::size_t out = s + m; s < s_end || m < m_end; ++out) {
+        bool mover = s == s_end || (m < m_end && movers[m] < stayers[s]);
+        const Entry& e = mover ? movers[m++] : stayers[s++];
+        m_keys[out] = e.key;
+        m_order[out] = e.index;
+      }
+    });
+    finish(points, pool);
+    return moved;
+  }
+
+  std::size_t update(std::span<const Point3<T>> points) {
+    return update(points, default_thread_pool());
+  }
+
+  // Calls fn(index, distance2) for every point within radius() of q, in no
+  // particular order. Safe to call from many threads at once.
+  template <typename F>
+  void for_each_neighbor(const Point3<T>& q, F&& fn) const {
+    if (m_cells.empty()) return;
+    uint32_t x = cell(q.x()), y = cell(q.y()), z = cell(q.z());
+    T r2 = m_radius * m_radius;
+    for (uint32_t dz = z - 1; dz <= z + 1; ++dz) {
+      for (uint32_t dy = y - 1; dy <= y + 1; ++dy) {
+        for (uint32_t dx = x - 1; dx <= x + 1; ++dx) {
+          uint32_t c = find(morton_key(dx, dy, dz));
+          if (c == kEmpty) continue;
+          for (uint32_t s = m_cell_start[c]; s < m_cell_start[c + 1]; ++s) {
+            const Point3<T>& p = m_points[s];
+            T ex = p.x() - q.x(), ey = p.y() - q.y(), ez = p.z() - q.z();
+            T d2 = ex * ex + ey * ey + ez * ez;
+            if (d2 <= r2) fn(m_order[s], d2);
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr std::size_t kGrain = std::size_t{1} << 14;
+  // update() rebuilds when more than 1/kRebuildFraction of the points moved.
+  static constexpr std::size_t kRebuildFraction = 4;
+  static constexpr uint32_t kEmpty = UINT32_MAX;
+
+  struct Entry {
+    uint64_t key;
+    uint32_t index;
+
+    bool operator<(const Entry& o) const {
+      return key < o.key || (key == o.key && index < o.index);
+    }
+  };
+
+  // Cell coordinate, offset to be unsigned and kept one cell inside the 21
+  // bits so that the neighbours of any cell have valid keys.
+  uint32_t cell(T v) const {
+    constexpr double kBias = 1 << (kSpatialKeyBits - 1);
+    constexpr double kLast = (1 << kSpatialKeyBits) - 2;
+    double c = std::floor(static_cast<double>(v * m_inv_cell)) + kBias;
+    return static_cast<uint32_t>(std::clamp(c, 1., kLast));
+  }
+
+  uint64_t cell_key(const Point3<T>& p) const {
+    return morton_key(cell(p.x()), cell(p.y()), cell(p.z()));
+  }
+
+  std::size_t slot(uint64_t key) const {
+    return (key * 0x9e3779b97f4a7c15) >> m_shift;
+  }
+
+  uint32_t find(uint64_t key) const {
+    for (std::size_t i = slot(key);; i = (i + 1) & m_table_mask) {
+      uint32_t c = m_table[i];
+      if (c == kEmpty || m_cells[c] == key) return c;
+    }
+  }
+
+  // Cell ranges and the hash table from the sorted keys, and the points in
+  // that order.
+  void finish(std::span<const Point3<T>> points, ThreadPool& pool) {
+    std::size_t n = m_keys.size();
+    m_points.resize(n);
+
+    // Slots that start a cell, counted then written per block.
+    std::size_t blocks = std::max<std::size_t>(
+        std::min<std::size_t>(n / kGrain, 8 * (std::size_t{pool.size()} + 1)),
+        1);
+    auto block_begin = [&](std::size_t b) { return n * b / blocks; };
+    auto starts_cell = [&](std::size_t s) {
+      return s == 0 || m_keys[s] != m_keys[s - 1];
+    };
+    std::vector<std::size_t> cells_before(blocks + 1, 0);
+    parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+      std::size_t count = 0;
+      for (std::size_t s = block_begin(b); s < block_begin(b + 1); ++s) {
+        count += starts_cell(s);
+        m_points[s] = points[m_order[s]];
+      }
+      cells_before[b + 1] = count;
+    });
+    for (std::size_t b = 0; b < blocks; ++b) {
+      cells_before[b + 1] += cells_before[b];
+    }
+    std::size_t cells = cells_before[blocks];
+    m_cells.resize(cells);
+    m_cell_start.resize(cells + 1);
+    m_cell_start[cells] = static_cast<uint32_t>(n);
+    parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+      std::size_t c = cells_before[b];
+      for (std::size_t s = block_begin(b); s < block_begin(b + 1); ++s) {
+        if (!starts_cell(s)) continue;
+        m_cells[c] = m_keys[s];
+        m_cell_start[c++] = static_cast<uint32_t>(s);
+      }
+    });
+
+    // Open addressing at most half full, filled with compare-and-swap.
+    std::size_t size = std::bit_ceil(std::max<std::size_t>(2 * cells, 64));
+    m_table_mask = size - 1;
+    m_shift = 64 - std::countr_zero(size);
+    m_table.assign(size, kEmpty);
+    parallel_for(pool, 0, cells, kGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t c = begin; c < end; ++c) {
+                     insert(static_cast<uint32_t>(c));
+                   }
+                 });
+  }
+
+  void insert(uint32_t c) {
+    for (std::size_t i = slot(m_cells[c]);; i = (i + 1) & m_table_mask) {
+      std::atomic_ref<uint32_t> entry(m_table[i]);
+      uint32_t expected = kEmpty;
+      if (entry.compare_exchange_strong(expected, c,
+                                        std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+  T m_radius = T{1};
+  T m_inv_cell = T{1};
+  std::vector<uint64_t> m_keys;      // cell key of each slot, ascending
+  std::vector<uint32_t> m_order;     // point index of each slot
+  std::vector<Point3<T>> m_points;   // point of each slot
+  std::vector<uint64_t> m_cells;     // key of each occupied cell
+  std::vector<uint32_t> m_cell_start;  // first slot of each cell, and n
+  std::vector<uint32_t> m_table;     // cell index by key hash, or kEmpty
+  std::size_t m_table_mask = 0;
+  int m_shift = 64;
+};
+
+using HashGridf = HashGrid<float>;
+using HashGridd = HashGrid<double>;
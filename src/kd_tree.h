@@ -0,0 +1,310 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "point3.h"
+#include "thread_pool.h"
+#include "types.h"
+
+//--------------------------------------------
+// k-d tree over a point set
+//--------------------------------------------
+//
+// The tree is implicit: the points are copied and reordered so that every
+// subtree is a contiguous range [begin, end) whose split point sits at the
+// median position begin + (end - begin) / 2, with the left subtree before
+// it and the right one after. Nodes need no child pointers or bounds, only
+// the split axis of each median (one byte). Ranges of at most kLeafSize
+// points are leaves and are scanned linearly.
+//
+// The build splits every range at the median of its widest axis
+// (std::nth_element), building the two halves of large ranges in parallel
+// on the pool. Results refer to points by their index in the span the tree
+// was built from.
+
+template <numeric T>
+struct Neighbor {
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  uint32_t index = kNone;
+  T distance2 = std::numeric_limits<T>::max();  // squared distance
+
+  bool operator==(const Neighbor&) const = default;
+};
+
+template <numeric T>
+class KdTree {
+ public:
+  static constexpr std::size_t kLeafSize = 16;
+
+  KdTree() = default;
+
+  KdTree(std::span<const Point3<T>> points, ThreadPool& pool) {
+    build(points, pool);
+  }
+
+  explicit KdTree(std::span<const Point3<T>> points)
+      : KdTree(points, default_thread_pool()) {}
+
+  std::size_t size() const { return m_points.size(); }
+  bool empty() const { return m_points.empty(); }
+
+  //--------------------------------------------
+  // Single queries
+  //--------------------------------------------
+
+  // The min(k, size()) points closest to q, nearest first, in out[0, n);
+  // returns n.
+  std::size_t knn(const Point3<T>& q, std::size_t k,
+                  std::span<Neighbor<T>> out) const {
+    if (out.size() < k) throw std::out_of_range("Output span is too small");
+    return closest(q, std::min(k, size()), std::numeric_limits<T>::max(),
+                   out.data());
+  }
+
+  std::vector<Neighbor<T>> knn(const Point3<T>& q, std::size_t k) const {
+    std::vector<Neighbor<T>> out(k);
+    out.resize(knn(q, k, std::span(out)));
+    return out;
+  }
+
+  // Appends every point within distance r of q to out, in no particular
+  // order; returns how many were appended. Reusing out across calls avoids
+  // allocating once it has grown.
+  std::size_t radius(const Point3<T>& q, T r,
+                     std::vector<Neighbor<T>>& out) const {
+    std::size_t before = out.size();
+    if (empty()) return 0;
+    T r2 = r * r;
+    Range stack[kMaxDepth];
+    int top = 0;
+    stack[top++] = {0, static_cast<uint32_t>(size()), T{0}};
+    while (top > 0) {
+      Range range = stack[--top];
+      if (range.distance2 > r2) continue;
+      if (range.end - range.begin <= kLeafSize) {
+        for (uint32_t i = range.begin; i < range.end; ++i) {
+          T d2 = distance2(q, m_points[i]);
+          if (d2 <= r2) out.push_back({m_indices[i], d2});
+        }
+        continue;
+      }
+      uint32_t mid = range.begin + (range.end - range.begin) / 2;
+      T d2 = distance2(q, m_points[mid]);
+      if (d2 <= r2) out.push_back({m_indices[mid], d2});
+      T diff = coord(q, m_axis[mid]) - coord(m_points[mid], m_axis[mid]);
+      T far = diff * diff;
+      stack[top++] = {range.begin, mid, diff < T{0} ? T{0} : far};
+      stack[top++] = {mid + 1, range.end, diff < T{0} ? far : T{0}};
+    }
+    return out.size() - before;
+  }
+
+  //--------------------------------------------
+  // Batched queries
+  //--------------------------------------------
+  // Queries are spread over the pool; results go into caller-owned buffers
+  // with a fixed stride, so nothing is allocated per query.
+
+  // Row i of out (out[i * k, (i + 1) * k)) receives the k nearest points of
+  // queries[i], nearest first. Rows are padded with Neighbor{} when the
+  // tree holds fewer than k points.
+  void knn(std::span<const Point3<T>> queries, std::size_t k,
+           std::span<Neighbor<T>> out, ThreadPool& pool) const {
+    if (out.size() < queries.size() * k) {
+      throw std::out_of_range("Output span is too small");
+    }
+    std::size_t found = std::min(k, size());
+    parallel_for(pool, 0, queries.size(), kQueryGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     Neighbor<T>* row = out.data() + i * k;
+                     closest(queries[i], found,
+                             std::numeric_limits<T>::max(), row);
+                     std::fill(row + found, row + k, Neighbor<T>{});
+                   }
+                 });
+  }
+
+  void knn(std::span<const Point3<T>> queries, std::size_t k,
+           std::span<Neighbor<T>> out) const {
+    knn(queries, k, out, default_thread_pool());
+  }
+
+  // The closest points within distance r of every query, at most
+  // max_count each: row i of out (stride max_count) receives counts[i] of
+  // them, nearest first.
+  void radius(std::span<const Point3<T>> queries, T r, std::size_t max_count,
+              std::span<Neighbor<T>> out, std::span<uint32_t> counts,
+              ThreadPool& pool) const {
+    if (out.size() < queries.size() * max_count ||
+        counts.size() < queries.size()) {
+      throw std::out_of_range("Output span is too small");
+    }
+    std::size_t k = std::min(max_count, size());
+    parallel_for(pool, 0, queries.size(), kQueryGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     counts[i] = static_cast<uint32_t>(closest(
+                         queries[i], k, r * r, out.data() + i * max_count));
+                   }
+                 });
+  }
+
+  void radius(std::span<const Point3<T>> queries, T r, std::size_t max_count,
+              std::span<Neighbor<T>> out, std::span<uint32_t> counts) const {
+    radius(queries, r, max_count, out, counts, default_thread_pool());
+  }
+
+ private:
+  // Traversal keeps one pending range per level at most, and ranges halve
+  // per level.
+  static constexpr int kMaxDepth = 64;
+  static constexpr std::size_t kParallelBuild = std::size_t{1} << 15;
+  static constexpr std::size_t kQueryGrain = 64;
+
+  struct Range {
+    uint32_t begin;
+    uint32_t end;
+    T distance2;  // lower bound from q to anything in the range
+  };
+
+  struct Item {
+    Point3<T> point;
+    uint32_t index;
+  };
+
+  // Point3::operator[] range-checks; the axis here is always valid.
+  static T coord(const Point3<T>& p, int axis) {
+    return axis == 0 ? p.x() : axis == 1 ? p.y() : p.z();
+  }
+
+  static T distance2(const Point3<T>& a, const Point3<T>& b) {
+    T dx = a.x() - b.x(), dy = a.y() - b.y(), dz = a.z() - b.z();
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  void build(std::span<const Point3<T>> points, ThreadPool& pool) {
+    if (points.size() >= UINT32_MAX) {
+      throw std::length_error("Too many points for a k-d tree");
+    }
+    std::vector<Item> items(points.size());
+    parallel_for(pool, 0, items.size(), std::size_t{1} << 16,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     items[i] = {points[i], static_cast<uint32_t>(i)};
+                   }
+                 });
+    m_axis.assign(items.size(), 0);
+    split(items, 0, items.size(), pool);
+
+    m_points.resize(items.size());
+    m_indices.resize(items.size());
+    parallel_for(pool, 0, items.size(), std::size_t{1} << 16,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     m_points[i] = items[i].point;
+                     m_indices[i] = items[i].index;
+                   }
+                 });
+  }
+
+  void split(std::vector<Item>& items, std::size_t begin, std::size_t end,
+             ThreadPool& pool) {
+    if (end - begin <= kLeafSize) return;
+    T lo[3], hi[3];
+    for (int a = 0; a < 3; ++a) lo[a] = hi[a] = coord(items[begin].point, a);
+    for (std::size_t i = begin + 1; i < end; ++i) {
+      for (int a = 0; a < 3; ++a) {
+        lo[a] = std::min(lo[a], coord(items[i].point, a));
+        hi[a] = std::max(hi[a], coord(items[i].point, a));
+      }
+    }
+    int axis = 0;
+    for (int a = 1; a < 3; ++a) {
+      if (hi[a] - lo[a] > hi[axis] - lo[axis]) axis = a;
+    }
+    std::size_t mid = begin + (end - begin) / 2;
+    std::nth_element(items.begin() + begin, items.begin() + mid,
+                     items.begin() + end, [axis](const Item& a, const Item& b) {
+                       return coord(a.point, axis) < coord(b.point, axis);
+                     });
+    m_axis[mid] = static_cast<uint8_t>(axis);
+    if (end - begin < kParallelBuild) {
+      split(items, begin, mid, pool);
+      split(items, mid + 1, end, pool);
+      return;
+    }
+    parallel_for(pool, 0, 2, 1, [&](std::size_t half, std::size_t) {
+      if (half == 0) {
+        split(items, begin, mid, pool);
+      } else {
+        split(items, mid + 1, end, pool);
+      }
+    });
+  }
+
+  // The k nearest points to q closer than max_d2, sorted, into out; returns
+  // how many there are.
+  std::size_t closest(const Point3<T>& q, std::size_t k, T max_d2,
+                      Neighbor<T>* out) const {
+    if (k == 0) return 0;
+    std::size_t count = 0;
+    // Squared distance a point must be within to get into the list.
+    T worst = max_d2;
+    auto offer = [&](uint32_t i) {
+      T d2 = distance2(q, m_points[i]);
+      if (d2 > worst || (count == k && d2 == worst)) return;
+      // Insertion into the sorted list; k is small.
+      std::size_t at = count < k ? count++ : k - 1;
+      while (at > 0 && out[at - 1].distance2 > d2) {
+        out[at] = out[at - 1];
+        --at;
+      }
+      out[at] = {m_indices[i], d2};
+      if (count == k) worst = out[k - 1].distance2;
+    };
+
+    Range stack[kMaxDepth];
+    int top = 0;
+    stack[top++] = {0, static_cast<uint32_t>(size()), T{0}};
+    while (top > 0) {
+      Range range = stack[--top];
+      if (range.distance2 > worst) continue;
+      if (range.end - range.begin <= kLeafSize) {
+        for (uint32_t i = range.begin; i < range.end; ++i) offer(i);
+        continue;
+      }
+      uint32_t mid = range.begin + (range.end - range.begin) / 2;
+      offer(mid);
+      int axis = m_axis[mid];
+      T diff = coord(q, axis) - coord(m_points[mid], axis);
+      Range left{range.begin, mid, T{0}};
+      Range right{mid + 1, range.end, T{0}};
+      // Far side first on the stack, so the near side is searched first.
+      if (diff < T{0}) {
+        right.distance2 = diff * diff;
+        stack[top++] = right;
+        stack[top++] = left;
+      } else {
+        left.distance2 = diff * diff;
+        stack[top++] = left;
+        stack[top++] = right;
+      }
+    }
+    return count;
+  }
+
+  std::vector<Point3<T>> m_points;  // in tree order
+  std::vector<uint32_t> m_indices;  // of m_points in the input
+  std::vector<uint8_t> m_axis;      // split axis of the median at each slot
+};
+
+using KdTreef = KdTree<float>;
+using KdTreed = KdTree<double>;
@@ -34,7 +34,7 @@ class Mat2 {
     return m_vec[1];
   }
 
-  double determinant() const {
+  T determinant() const {
     return m_vec[0].x() * m_vec[1].y() - m_vec[0].y() * m_vec[1].x();
   }
 
@@ -85,3 +85,21 @@ std::ostream& operator<<(std::ostream& out, const Mat2<T>& m) {
   out << "{" << m[0] << "," << m[1] << "}";
   return out;
 }
+
+//--------------------------------------------
+// Explicit instantiation of the common aliases
+//--------------------------------------------
+// Expanded with `extern` here when MATH_EXTERN_TEMPLATES is defined (linking
+// math_instantiated does that) and without it in math_instantiated.cpp.
+
+#define MATH_INSTANTIATE_MAT2(EXTERN, T)                             \
+  EXTERN template class Mat2<T>;                                     \
+  EXTERN template Mat2<T> operator+(const Mat2<T>&, const Mat2<T>&); \
+  EXTERN template Mat2<T> operator-(const Mat2<T>&, const Mat2<T>&); \
+  EXTERN template Mat2<T> operator*(const Mat2<T>&, T);              \
+  EXTERN template Mat2<T> operator*(const Mat2<T>&, const Mat2<T>&)
+
+#ifdef MATH_EXTERN_TEMPLATES
+MATH_INSTANTIATE_MAT2(extern, float);
+MATH_INSTANTIATE_MAT2(extern, double);
+#endif
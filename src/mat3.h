@@ -81,11 +81,11 @@ T Mat3<T>::trace() const {
 
 template <numeric T>
 T Mat3<T>::determinant() const {
-  double r1 =
+  wide_t<T> r1 =
       m_vec[0][0] * (m_vec[1][1] * m_vec[2][2] - m_vec[1][2] * m_vec[2][1]);
-  double r2 =
+  wide_t<T> r2 =
       m_vec[0][1] * (m_vec[1][0] * m_vec[2][2] - m_vec[1][2] * m_vec[2][0]);
-  double r3 =
+  wide_t<T> r3 =
       m_vec[0][2] * (m_vec[1][0] * m_vec[2][1] - m_vec[1][1] * m_vec[2][0]);
 
   return r1 - r2 + r3;
@@ -192,3 +192,21 @@ std::ostream& operator<<(std::ostream& out, const Mat3<T>& m) {
   out << "{" << m[0] << "," << m[1] << "," << m[2] << "}";
   return out;
 }
+
+//--------------------------------------------
+// Explicit instantiation of the common aliases
+//--------------------------------------------
+// Expanded with `extern` here when MATH_EXTERN_TEMPLATES is defined (linking
+// math_instantiated does that) and without it in math_instantiated.cpp.
+
+#define MATH_INSTANTIATE_MAT3(EXTERN, T)                             \
+  EXTERN template class Mat3<T>;                                     \
+  EXTERN template Mat3<T> operator+(const Mat3<T>&, const Mat3<T>&); \
+  EXTERN template Mat3<T> operator-(const Mat3<T>&, const Mat3<T>&); \
+  EXTERN template Mat3<T> operator*(const Mat3<T>&, const Mat3<T>&); \
+  EXTERN template Mat3<T> operator*(const Mat3<T>&, T)
+
+#ifdef MATH_EXTERN_TEMPLATES
+MATH_INSTANTIATE_MAT3(extern, float);
+MATH_INSTANTIATE_MAT3(extern, double);
+#endif
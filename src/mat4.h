@@ -6,6 +6,7 @@
 
 #include "constants.h"
 #include "mat3.h"
+#include "matn.h"
 #include "types.h"
 #include "vec4.h"
 
@@ -105,14 +106,11 @@ T Mat4<T>::trace() const {
   return m_vec[0][0] + m_vec[1][1] + m_vec[2][2] + m_vec[3][3];
 }
 
+// Closed forms from matn.h, by complementary 2x2 minors rather than 3x3
+// cofactors.
 template <numeric T>
 T Mat4<T>::determinant() const {
-  T det = 0;
-  for (int j = 0; j < 4; ++j) {
-    Mat3<T> mi = minor(0, j);
-    det += m_vec[0][j] * coFactor(0, j);
-  }
-  return det;
+  return detail::determinant4<T>(m_vec);
 }
 
 template <numeric T>
@@ -134,15 +132,9 @@ Mat3<T> Mat4<T>::minor(int i, int j) const {
 
 template <numeric T>
 Mat4<T> Mat4<T>::inverse() const {
-  T det = determinant();
-  assert(det != 0);  // Matrix is not invertible!
   Mat4<T> inv;
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      T c = coFactor(i, j);
-      inv.m_vec[j][i] = coFactor(i, j) / det;
-    }
-  }
+  [[maybe_unused]] T det = detail::inverse4<T>(m_vec, inv.m_vec);
+  assert(all(det != T{0}));  // Matrix is not invertible!
   return inv;
 }
 
@@ -175,7 +167,7 @@ Mat4<T> Mat4<T>::transpose() const {
 template <numeric T>
 void Mat4<T>::Orient(const Vec3<T>& pos, const Vec3<T>& fwd,
                      const Vec3<T>& up) {
-  Vec3<T> left = up.cross(fwd);
+  Vec3<T> left = cross(up, fwd);
   m_vec[0] = Vec4<T>(fwd.x(), left.x(), up.x(), pos.x());
   m_vec[1] = Vec4<T>(fwd.y(), left.y(), up.y(), pos.y());
   m_vec[2] = Vec4<T>(fwd.z(), left.z(), up.z(), pos.z());
@@ -188,14 +180,15 @@ void Mat4<T>::LookAt(const Vec3<T>& pos, const Vec3<T>& lookAt,
   Vec3<T> fwd = pos - lookAt;
   fwd.normalize();
 
-  Vec3<T> right = up.cross(fwd);
+  Vec3<T> right = cross(up, fwd);
   right.normalize();
 
-  up = fwd.cross(right);
-  up.normalize();
+  Vec3<T> up_ortho = cross(fwd, right);
+  up_ortho.normalize();
 
   m_vec[0] = Vec4<T>(right.x(), right.y(), right.z(), -dot(pos, right));
-  m_vec[1] = Vec4<T>(up.x(), up.y(), up.z(), -dot(pos, up));
+  m_vec[1] = Vec4<T>(up_ortho.x(), up_ortho.y(), up_ortho.z(),
+                     -dot(pos, up_ortho));
   m_vec[2] = Vec4<T>(fwd.x(), fwd.y(), fwd.z(), -dot(pos, fwd));
   m_vec[3] = Vec4<T>(T{0}, T{0}, T{0}, T{1});
 }
@@ -304,38 +297,46 @@ Mat4<T> scale(const Vec3<T>& v) {
   return ret;
 }
 
-// TODO: floating point errors ~ E-8
+// The rotations are within 2 ulp of the exact matrix (test/accuracy). Zeros
+// at multiples of PI/2 come out as ~1E-8 because the float angle is not
+// exactly a multiple of PI/2.
 
 template <numeric T>
 Mat4<T> rotationOverX(T rad) {
+  auto c = static_cast<T>(cos(rad));
+  auto s = static_cast<T>(sin(rad));
   Mat4<T> ret;
   ret.identity();
-  ret[1][1] = static_cast<T>(cos(rad));
-  ret[1][2] = -static_cast<T>(sin(rad));
-  ret[2][1] = static_cast<T>(sin(rad));
-  ret[2][2] = static_cast<T>(cos(rad));
+  ret[1][1] = c;
+  ret[1][2] = -s;
+  ret[2][1] = s;
+  ret[2][2] = c;
   return ret;
 }
 
 template <numeric T>
 Mat4<T> rotationOverY(T rad) {
+  auto c = static_cast<T>(cos(rad));
+  auto s = static_cast<T>(sin(rad));
   Mat4<T> ret;
   ret.identity();
-  ret[0][0] = static_cast<T>(cos(rad));
-  ret[0][2] = static_cast<T>(sin(rad));
-  ret[2][0] = -static_cast<T>(sin(rad));
-  ret[2][2] = static_cast<T>(cos(rad));
+  ret[0][0] = c;
+  ret[0][2] = s;
+  ret[2][0] = -s;
+  ret[2][2] = c;
   return ret;
 }
 
 template <numeric T>
 Mat4<T> rotationOverZ(T rad) {
+  auto c = static_cast<T>(cos(rad));
+  auto s = static_cast<T>(sin(rad));
   Mat4<T> ret;
   ret.identity();
-  ret[0][0] = static_cast<T>(cos(rad));
-  ret[0][1] = -static_cast<T>(sin(rad));
-  ret[1][0] = static_cast<T>(sin(rad));
-  ret[1][1] = static_cast<T>(cos(rad));
+  ret[0][0] = c;
+  ret[0][1] = -s;
+  ret[1][0] = s;
+  ret[1][1] = c;
   return ret;
 }
 
@@ -348,10 +349,10 @@ Mat4<T> view_transform(const Point3<T>& from, const Point3<T>& to,
   Vec3<T> up_res = cross(left, forward);
 
   Mat4<T> orientation =
-      Mat4D(Vec4<T>(left.x(), left.y(), left.z(), 0.0f),
-            Vec4<T>(up_res.x(), up_res.y(), up_res.z(), 0.0f),
-            Vec4<T>(-forward.x(), -forward.y(), -forward.z(), 0.0f),
-            Vec4<T>(0.0f, 0.0f, 0.0f, 1.0f));
+      Mat4<T>(Vec4<T>(left.x(), left.y(), left.z(), T{0}),
+              Vec4<T>(up_res.x(), up_res.y(), up_res.z(), T{0}),
+              Vec4<T>(-forward.x(), -forward.y(), -forward.z(), T{0}),
+              Vec4<T>(T{0}, T{0}, T{0}, T{1}));
 
   return orientation * translation(-from.x(), -from.y(), -from.z());
 }
@@ -413,4 +414,32 @@ Mat4<T> LookAt(const Vec3<T>& pos, const Vec3<T>& target, const Vec3<T>& up) {
   auto v3 = Vec4f(right.z(), up_norm.z(), fwd.z(), 0.f);
   auto v4 = Vec4f(t.x(), t.y(), t.z(), 1.f);
   return Mat4<T>(v1, v2, v3, v4);
-}
\ No newline at end of file
+}
+
+//--------------------------------------------
+// Explicit instantiation of the common aliases
+//--------------------------------------------
+// Expanded with `extern` here when MATH_EXTERN_TEMPLATES is defined (linking
+// math_instantiated does that) and without it in math_instantiated.cpp.
+
+#define MATH_INSTANTIATE_MAT4(EXTERN, T)                                     \
+  EXTERN template class Mat4<T>;                                             \
+  EXTERN template Mat4<T> operator+(const Mat4<T>&, const Mat4<T>&);         \
+  EXTERN template Mat4<T> operator-(const Mat4<T>&, const Mat4<T>&);         \
+  EXTERN template Mat4<T> operator*(const Mat4<T>&, const Mat4<T>&);         \
+  EXTERN template Vec4<T> operator*(const Mat4<T>&, const Vec4<T>&);         \
+  EXTERN template Mat4<T> operator*(const Mat4<T>&, T);                      \
+  EXTERN template Mat4<T> translation(T, T, T);                              \
+  EXTERN template Mat4<T> translation(const Vec3<T>&);                       \
+  EXTERN template Mat4<T> scale(T, T, T);                                    \
+  EXTERN template Mat4<T> scale(const Vec3<T>&);                             \
+  EXTERN template Mat4<T> rotationOverX(T);                                  \
+  EXTERN template Mat4<T> rotationOverY(T);                                  \
+  EXTERN template Mat4<T> rotationOverZ(T);                                  \
+  EXTERN template Mat4<T> view_transform(const Point3<T>&, const Point3<T>&, \
+                                         const Vec3<T>&)
+
+#ifdef MATH_EXTERN_TEMPLATES
+MATH_INSTANTIATE_MAT4(extern, float);
+MATH_INSTANTIATE_MAT4(extern, double);
+#endif
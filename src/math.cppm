@@ -0,0 +1,116 @@
+// C++20 module interface for the core types:
+//
+//   import math;
+//
+// The headers are included in the global module fragment and their names
+// re-exported, so the module and #include can be mixed in one program. Built
+// when MATH_BUILD_MODULE is on (needs CMake 3.28 and GCC 14, Clang 16 or
+// MSVC 19.34 or newer); test/module/import_math.cpp checks the exports.
+
+module;
+
+#include "constants.h"
+#include "mat2.h"
+#include "mat3.h"
+#include "mat4.h"
+#include "normal3.h"
+#include "orthonormal.h"
+#include "point3.h"
+#include "quat.h"
+#include "ray.h"
+#include "types.h"
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+
+export module math;
+
+//--------------------------------------------
+// Constants and concepts
+//--------------------------------------------
+
+export using ::PI;
+export using ::InvPI;
+export using ::EPS;
+export using ::EPS1;
+export using ::RAD;
+export using ::DEG2RAD;
+export using ::RAD2DEG;
+
+export using ::numeric;
+
+//--------------------------------------------
+// Types
+//--------------------------------------------
+
+export using ::Vec2;
+export using ::Vec2i;
+export using ::Vec2f;
+export using ::Vec2d;
+
+export using ::Vec3;
+export using ::Vec3i;
+export using ::Vec3f;
+export using ::Vec3d;
+
+export using ::Vec4;
+export using ::Vec4i;
+export using ::Vec4f;
+export using ::Vec4d;
+
+export using ::Point3;
+export using ::Point3i;
+export using ::Point3f;
+export using ::Point3d;
+
+export using ::Normal3;
+export using ::Normal3i;
+export using ::Normal3f;
+export using ::Normal3d;
+
+export using ::Mat2;
+export using ::Mat2D;
+export using ::Mat3;
+export using ::Mat3D;
+export using ::Mat4;
+export using ::Mat4i;
+export using ::Mat4f;
+export using ::Mat4d;
+
+export using ::Quat;
+export using ::Ray;
+export using ::OrthoNormalBasis;
+
+//--------------------------------------------
+// Operators and functions
+//--------------------------------------------
+
+export using ::operator+;
+export using ::operator-;
+export using ::operator*;
+export using ::operator/;
+export using ::operator==;
+export using ::operator!=;
+export using ::operator<<;
+export using ::operator>>;
+
+export using ::dot;
+export using ::cross;
+export using ::normalize;
+export using ::normalized;
+export using ::reflect;
+
+export using ::translation;
+export using ::scale;
+export using ::rotationOverX;
+export using ::rotationOverY;
+export using ::rotationOverZ;
+export using ::view_transform;
+export using ::perspective;
+export using ::orthographic;
+export using ::frustrum;
+
+export using ::angle_axis;
+export using ::from;
+export using ::same_orientation;
+export using ::quat_to_mat4;
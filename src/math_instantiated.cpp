@@ -0,0 +1,44 @@
+// Explicit instantiations of the common aliases for the math_instantiated
+// library. Translation units linking it see the matching extern template
+// declarations and skip instantiating these themselves.
+
+#include "mat2.h"
+#include "mat3.h"
+#include "mat4.h"
+#include "normal3.h"
+#include "point3.h"
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+
+#ifdef MATH_EXTERN_TEMPLATES
+#error "math_instantiated.cpp must be built without MATH_EXTERN_TEMPLATES"
+#endif
+
+MATH_INSTANTIATE_VEC2(, int);
+MATH_INSTANTIATE_VEC2(, float);
+MATH_INSTANTIATE_VEC2(, double);
+
+MATH_INSTANTIATE_VEC3(, int);
+MATH_INSTANTIATE_VEC3(, float);
+MATH_INSTANTIATE_VEC3(, double);
+
+MATH_INSTANTIATE_VEC4(, int);
+MATH_INSTANTIATE_VEC4(, float);
+MATH_INSTANTIATE_VEC4(, double);
+
+MATH_INSTANTIATE_NORMAL3(, float);
+MATH_INSTANTIATE_NORMAL3(, double);
+
+MATH_INSTANTIATE_POINT3(, int);
+MATH_INSTANTIATE_POINT3(, float);
+MATH_INSTANTIATE_POINT3(, double);
+
+MATH_INSTANTIATE_MAT2(, float);
+MATH_INSTANTIATE_MAT2(, double);
+
+MATH_INSTANTIATE_MAT3(, float);
+MATH_INSTANTIATE_MAT3(, double);
+
+MATH_INSTANTIATE_MAT4(, float);
+MATH_INSTANTIATE_MAT4(, double);
@@ -0,0 +1,434 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "types.h"
+#include "vecn.h"
+
+template <numeric T>
+class Mat2;
+
+template <numeric T>
+class Mat3;
+
+template <numeric T>
+class Mat4;
+
+//--------------------------------------------
+// Fixed-size matrices of any shape
+//--------------------------------------------
+//
+// Matrix<T, R, C> is R rows of Vector<T, C>, for the shapes Mat2/Mat3/Mat4
+// do not cover: the 6x6 covariances and transitions of inertial filters,
+// 3x4 affine transforms, the 2x6 or 3x6 Jacobians between them. Products
+// and sums are folds over the rows and columns, expanded at compile time as
+// Vector's are.
+//
+// determinant() and inverse() are closed forms up to 4x4: cofactors for
+// 2x2 and 3x3. For 4x4 the determinant is the Laplace expansion by
+// complementary 2x2 minors, 12 of them instead of the 16 Mat3 minors Mat4
+// used to build, and the inverse is the adjugate with its 3x3 minors
+// written out in place; Mat4 now shares both (detail::determinant4 and
+// detail::inverse4). Larger matrices use LU and Gauss-Jordan elimination
+// with partial pivoting, for scalar T only.
+//
+// The matrix product, determinant() and inverse() are [[gnu::flatten]]:
+// at -O2 GCC stops inlining the nested lambdas of a 6x6 product partway,
+// leaving a call per entry, which doubled its cost.
+//
+// Unlike Mat3 and Mat4, a default-constructed Matrix is zero; identity()
+// gives the identity. Mat2/Mat3/Mat4 convert to and from the square sizes.
+
+namespace detail {
+
+// Closed forms over anything indexed m[row][column], so that Mat4 can use
+// them on its own rows.
+
+template <typename T, typename M>
+T determinant2(const M& m) {
+  return m[0][0] * m[1][1] - m[0][1] * m[1][0];
+}
+
+template <typename T, typename M>
+T determinant3(const M& m) {
+  return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+         m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+         m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+// The 2x2 minors of rows 0-1 (s) and rows 2-3 (c) over each pair of
+// columns, from which the 4x4 determinant and adjugate follow.
+template <typename T>
+struct Minors4 {
+  T s[6];
+  T c[6];
+
+  T determinant() const {
+    return s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] -
+           s[4] * c[1] + s[5] * c[0];
+  }
+};
+
+template <typename T, typename M>
+Minors4<T> minors4(const M& m) {
+  Minors4<T> k;
+  k.s[0] = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+  k.s[1] = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+  k.s[2] = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+  k.s[3] = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+  k.s[4] = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+  k.s[5] = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+  k.c[5] = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+  k.c[4] = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+  k.c[3] = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+  k.c[2] = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+  k.c[1] = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+  k.c[0] = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+  return k;
+}
+
+template <typename T, typename M>
+T determinant4(const M& m) {
+  return minors4<T>(m).determinant();
+}
+
+// The three of 0..3 other than `skip`.
+template <int Skip>
+constexpr std::array<int, 3> others4 = {Skip == 0 ? 1 : 0, Skip <= 1 ? 2 : 1,
+                                        Skip <= 2 ? 3 : 2};
+
+// The (I, J) cofactor of a 4x4 matrix, with the partial products of the
+// 3x3 minor's expansion kept in wide_t<T> as Mat3::determinant() keeps them.
+template <typename T, int I, int J, typename M>
+T cofactor4(const M& m) {
+  constexpr std::array<int, 3> r = others4<I>;
+  constexpr std::array<int, 3> c = others4<J>;
+  wide_t<T> p1 = m[r[0]][c[0]] * (m[r[1]][c[1]] * m[r[2]][c[2]] -
+                                  m[r[1]][c[2]] * m[r[2]][c[1]]);
+  wide_t<T> p2 = m[r[0]][c[1]] * (m[r[1]][c[0]] * m[r[2]][c[2]] -
+                                  m[r[1]][c[2]] * m[r[2]][c[0]]);
+  wide_t<T> p3 = m[r[0]][c[2]] * (m[r[1]][c[0]] * m[r[2]][c[1]] -
+                                  m[r[1]][c[1]] * m[r[2]][c[0]]);
+  T minor = static_cast<T>(p1 - p2 + p3);
+  if constexpr ((I + J) % 2) {
+    return -minor;
+  } else {
+    return minor;
+  }
+}
+
+// Writes the inverse of m to out, indexed the same way, and returns the
+// determinant; with a zero determinant out is not finite. The adjugate is
+// built from the 16 cofactors with the minors written out in place, which
+// rounds exactly as the Mat3-based cofactors Mat4 used to build.
+template <typename T, typename M, typename Out>
+T inverse4(const M& m, Out& out) {
+  T cof[4][4];
+  [&]<int... K>(std::integer_sequence<int, K...>) {
+    ((cof[K / 4][K % 4] = cofactor4<T, K / 4, K % 4>(m)), ...);
+  }(std::make_integer_sequence<int, 16>());
+  T det = 0;
+  for_indices<4>([&](int j) { det += m[0][j] * cof[0][j]; });
+  for_indices<4>([&](int i) {
+    for_indices<4>([&](int j) { out[j][i] = cof[i][j] / det; });
+  });
+  return det;
+}
+
+}  // namespace detail
+
+template <numeric T, int R, int C>
+  requires(R > 0 && C > 0)
+class Matrix {
+ public:
+  using value_type = T;
+  using row_type = Vector<T, C>;
+  using column_type = Vector<T, R>;
+
+  // All zero.
+  Matrix() = default;
+
+  template <typename... Rows>
+    requires(sizeof...(Rows) == R && (std::same_as<Rows, row_type> && ...))
+  Matrix(const Rows&... rows) : m_rows{rows...} {}
+
+  explicit Matrix(const Mat2<T>& m)
+    requires(R == 2 && C == 2)
+      : Matrix(generate([&](int r, int c) { return m[r][c]; })) {}
+  explicit Matrix(const Mat3<T>& m)
+    requires(R == 3 && C == 3)
+      : Matrix(generate([&](int r, int c) { return m[r][c]; })) {}
+  explicit Matrix(const Mat4<T>& m)
+    requires(R == 4 && C == 4)
+      : Matrix(generate([&](int r, int c) { return m[r][c]; })) {}
+
+  explicit operator Mat2<T>() const
+    requires(R == 2 && C == 2)
+  {
+    return Mat2<T>(Vec2<T>(m_rows[0]), Vec2<T>(m_rows[1]));
+  }
+  explicit operator Mat3<T>() const
+    requires(R == 3 && C == 3)
+  {
+    return Mat3<T>(Vec3<T>(m_rows[0]), Vec3<T>(m_rows[1]),
+                   Vec3<T>(m_rows[2]));
+  }
+  explicit operator Mat4<T>() const
+    requires(R == 4 && C == 4)
+  {
+    return Mat4<T>(Vec4<T>(m_rows[0]), Vec4<T>(m_rows[1]),
+                   Vec4<T>(m_rows[2]), Vec4<T>(m_rows[3]));
+  }
+
+  static Matrix identity()
+    requires(R == C)
+  {
+    return generate([](int r, int c) { return r == c ? T{1} : T{0}; });
+  }
+
+  // All entries `value`.
+  static Matrix filled(T value) {
+    return generate([&](int, int) { return value; });
+  }
+
+  // Entry (r, c) is f(r, c).
+  template <typename F>
+  static Matrix generate(F&& f) {
+    Matrix m;
+    detail::for_indices<R>([&](int r) {
+      m.m_rows[r] = row_type::generate([&](int c) { return f(r, c); });
+    });
+    return m;
+  }
+
+  static constexpr int rows() { return R; }
+  static constexpr int cols() { return C; }
+
+  const row_type& operator[](int r) const {
+    assert(r >= 0 && r < R);
+    return m_rows[r];
+  }
+
+  row_type& operator[](int r) {
+    assert(r >= 0 && r < R);
+    return m_rows[r];
+  }
+
+  column_type column(int c) const {
+    return column_type::generate([&](int r) { return m_rows[r][c]; });
+  }
+
+  auto operator<=>(const Matrix&) const = default;
+
+  Matrix operator+() const { return *this; }
+  Matrix operator-() const {
+    return generate([&](int r, int c) { return -m_rows[r][c]; });
+  }
+
+  Matrix& operator+=(const Matrix& m) { return *this = *this + m; }
+  Matrix& operator-=(const Matrix& m) { return *this = *this - m; }
+  Matrix& operator*=(T num) { return *this = *this * num; }
+
+  Matrix<T, C, R> transpose() const {
+    return Matrix<T, C, R>::generate(
+        [&](int r, int c) { return m_rows[c][r]; });
+  }
+
+  T trace() const
+    requires(R == C)
+  {
+    return detail::sum_indices<R>([&](int i) { return m_rows[i][i]; });
+  }
+
+  [[gnu::flatten]] T determinant() const
+    requires(R == C);
+
+  // Throws std::runtime_error if the matrix is singular (in any lane).
+  [[gnu::flatten]] Matrix inverse() const
+    requires(R == C);
+
+ private:
+  std::array<row_type, R> m_rows{};
+};
+
+using Mat6f = Matrix<float, 6, 6>;
+using Mat6d = Matrix<double, 6, 6>;
+using Mat3x4f = Matrix<float, 3, 4>;
+using Mat3x4d = Matrix<double, 3, 4>;
+
+namespace detail {
+
+// LU decomposition with partial pivoting, in place: returns the sign of the
+// row permutation, 0 if a pivot is zero.
+template <typename T, int N>
+int lu_decompose(Matrix<T, N, N>& a) {
+  static_assert(!is_simd_lane<T>, "pivoting needs scalar comparisons");
+  int sign = 1;
+  for (int k = 0; k < N; ++k) {
+    int pivot = k;
+    for (int r = k + 1; r < N; ++r) {
+      if (std::abs(a[r][k]) > std::abs(a[pivot][k])) pivot = r;
+    }
+    if (a[pivot][k] == T{0}) return 0;
+    if (pivot != k) {
+      std::swap(a[pivot], a[k]);
+      sign = -sign;
+    }
+    for (int r = k + 1; r < N; ++r) {
+      T f = a[r][k] / a[k][k];
+      a[r][k] = f;
+      for (int c = k + 1; c < N; ++c) a[r][c] -= f * a[k][c];
+    }
+  }
+  return sign;
+}
+
+}  // namespace detail
+
+template <numeric T, int R, int C>
+  requires(R > 0 && C > 0)
+T Matrix<T, R, C>::determinant() const
+  requires(R == C)
+{
+  if constexpr (R == 1) {
+    return m_rows[0][0];
+  } else if constexpr (R == 2) {
+    return detail::determinant2<T>(*this);
+  } else if constexpr (R == 3) {
+    return detail::determinant3<T>(*this);
+  } else if constexpr (R == 4) {
+    return detail::determinant4<T>(*this);
+  } else {
+    Matrix lu = *this;
+    int sign = detail::lu_decompose(lu);
+    T det = static_cast<T>(sign);
+    for (int i = 0; i < R; ++i) det *= lu[i][i];
+    return det;
+  }
+}
+
+template <numeric T, int R, int C>
+  requires(R > 0 && C > 0)
+Matrix<T, R, C> Matrix<T, R, C>::inverse() const
+  requires(R == C)
+{
+  auto singular = [] {
+    throw std::runtime_error("Cannot invert a singular matrix");
+  };
+  Matrix inv;
+  const Matrix& m = *this;
+  if constexpr (R == 1) {
+    if (any(m[0][0] == T{0})) singular();
+    inv[0][0] = T{1} / m[0][0];
+  } else if constexpr (R == 2) {
+    T det = detail::determinant2<T>(m);
+    if (any(det == T{0})) singular();
+    inv[0] = row_type(m[1][1] / det, -m[0][1] / det);
+    inv[1] = row_type(-m[1][0] / det, m[0][0] / det);
+  } else if constexpr (R == 3) {
+    T det = detail::determinant3<T>(m);
+    if (any(det == T{0})) singular();
+    inv = generate([&](int r, int c) {
+      // Cofactor (c, r) from the cyclic rows and columns after c and r.
+      int r1 = (c + 1) % 3, r2 = (c + 2) % 3;
+      int c1 = (r + 1) % 3, c2 = (r + 2) % 3;
+      return (m[r1][c1] * m[r2][c2] - m[r1][c2] * m[r2][c1]) / det;
+    });
+  } else if constexpr (R == 4) {
+    if (any(detail::inverse4<T>(m, inv) == T{0})) singular();
+  } else {
+    // Gauss-Jordan on [m | I] with partial pivoting.
+    static_assert(!is_simd_lane<T>, "pivoting needs scalar comparisons");
+    Matrix a = m;
+    inv = identity();
+    for (int k = 0; k < R; ++k) {
+      int pivot = k;
+      for (int r = k + 1; r < R; ++r) {
+        if (std::abs(a[r][k]) > std::abs(a[pivot][k])) pivot = r;
+      }
+      if (a[pivot][k] == T{0}) singular();
+      std::swap(a[pivot], a[k]);
+      std::swap(inv[pivot], inv[k]);
+      T scale = T{1} / a[k][k];
+      a[k] *= scale;
+      inv[k] *= scale;
+      for (int r = 0; r < R; ++r) {
+        if (r == k) continue;
+        T f = a[r][k];
+        a[r] -= a[k] * f;
+        inv[r] -= inv[k] * f;
+      }
+    }
+  }
+  return inv;
+}
+
+//--------------------------------------------
+// Overloaded I/O operators (input, output)
+//--------------------------------------------
+
+template <numeric T, int R, int C>
+std::ostream& operator<<(std::ostream& out, const Matrix<T, R, C>& m) {
+  out << "{";
+  for (int r = 0; r < R; ++r) out << (r ? "," : "") << m[r];
+  return out << "}";
+}
+
+//----------------------------------------------
+// Overloaded math operators as normal functions
+//----------------------------------------------
+
+template <numeric T, int R, int C>
+Matrix<T, R, C> operator+(const Matrix<T, R, C>& m1,
+                          const Matrix<T, R, C>& m2) {
+  return Matrix<T, R, C>::generate(
+      [&](int r, int c) { return m1[r][c] + m2[r][c]; });
+}
+
+template <numeric T, int R, int C>
+Matrix<T, R, C> operator-(const Matrix<T, R, C>& m1,
+                          const Matrix<T, R, C>& m2) {
+  return Matrix<T, R, C>::generate(
+      [&](int r, int c) { return m1[r][c] - m2[r][c]; });
+}
+
+template <numeric T, int R, int C>
+Matrix<T, R, C> operator*(const Matrix<T, R, C>& m, T num) {
+  return Matrix<T, R, C>::generate(
+      [&](int r, int c) { return m[r][c] * num; });
+}
+
+template <numeric T, int R, int C>
+Matrix<T, R, C> operator*(T num, const Matrix<T, R, C>& m) {
+  return m * num;
+}
+
+// Row r of the product is the rows of m2 weighted by row r of m1, which
+// sums each entry in the order Mat4's product does.
+template <numeric T, int R, int K, int C>
+[[gnu::flatten]] Matrix<T, R, C> operator*(const Matrix<T, R, K>& m1,
+                                           const Matrix<T, K, C>& m2) {
+  Matrix<T, R, C> out;
+  detail::for_indices<R>([&](int r) {
+    out[r] = detail::sum_indices<K>([&](int k) { return m2[k] * m1[r][k]; });
+  });
+  return out;
+}
+
+template <numeric T, int R, int C>
+Vector<T, R> operator*(const Matrix<T, R, C>& m, const Vector<T, C>& v) {
+  return Vector<T, R>::generate([&](int r) { return dot(m[r], v); });
+}
+
+// The R x C matrix u v^T.
+template <numeric T, int R, int C>
+Matrix<T, R, C> outer(const Vector<T, R>& u, const Vector<T, C>& v) {
+  return Matrix<T, R, C>::generate([&](int r, int c) { return u[r] * v[c]; });
+}
@@ -0,0 +1,817 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <istream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "binary_io.h"
+#include "normal3.h"
+#include "point3.h"
+#include "text_io.h"
+#include "thread_pool.h"
+
+//--------------------------------------------
+// Streaming OBJ/PLY mesh loading
+//--------------------------------------------
+//
+// load_obj() and load_ply() read a mesh in windows of a fixed size, either
+// out of a mapped file or from a stream through a bounded buffer, and hand
+// positions, normals and triangle indices to a sink as they are decoded.
+// Each window is split into one piece per thread and the pieces are parsed
+// on a ThreadPool; the sink always sees the data in file order. Memory use is
+// bounded by the window, so a sink that writes its batches out (e.g. with
+// write_binary) can convert files larger than RAM.
+//
+// PLY vertices have a fixed size, and so do their windows' pieces, but
+// faces and other elements with lists do not: they are parsed on the
+// calling thread, one record after another. OBJ faces are split with the
+// rest of their window.
+//
+// Supported input:
+//   OBJ  v, vn and f records; faces are fan-triangulated, negative
+//        (relative) indices are resolved, only the position index of each
+//        v/vt/vn corner is kept
+//   PLY  ascii, binary_little_endian and binary_big_endian; vertex x y z and
+//        optionally nx ny nz of any scalar type, face vertex_indices lists;
+//        other elements and properties are skipped
+
+// Receives decoded batches. The spans are only valid during the call.
+template <typename S>
+concept mesh_sink = requires(S& sink, std::span<const Point3f> positions,
+                             std::span<const Normal3f> normals,
+                             std::span<const uint32_t> triangles) {
+  sink.add_positions(positions);
+  sink.add_normals(normals);
+  sink.add_triangles(triangles);
+};
+
+// Interleaved buffers of the library's types.
+struct MeshBuffers {
+  std::vector<Point3f> positions;
+  std::vector<Normal3f> normals;
+  std::vector<uint32_t> indices;
+
+  void add_positions(std::span<const Point3f> p) {
+    positions.insert(positions.end(), p.begin(), p.end());
+  }
+  void add_normals(std::span<const Normal3f> n) {
+    normals.insert(normals.end(), n.begin(), n.end());
+  }
+  void add_triangles(std::span<const uint32_t> t) {
+    indices.insert(indices.end(), t.begin(), t.end());
+  }
+};
+
+// One array per component, for code that processes x, y and z separately.
+struct MeshBuffersSoA {
+  std::vector<float> x, y, z;
+  std::vector<float> nx, ny, nz;
+  std::vector<uint32_t> indices;
+
+  void add_positions(std::span<const Point3f> p) {
+    for (const auto& v : p) {
+      x.push_back(v.x());
+      y.push_back(v.y());
+      z.push_back(v.z());
+    }
+  }
+  void add_normals(std::span<const Normal3f> n) {
+    for (const auto& v : n) {
+      nx.push_back(v.x());
+      ny.push_back(v.y());
+      nz.push_back(v.z());
+    }
+  }
+  void add_triangles(std::span<const uint32_t> t) {
+    indices.insert(indices.end(), t.begin(), t.end());
+  }
+};
+
+struct MeshLoadOptions {
+  // Bytes decoded per window, split into `threads` pieces.
+  std::size_t window_size = std::size_t{32} << 20;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  // Runs the pieces; default_thread_pool() when null.
+  ThreadPool* pool = nullptr;
+};
+
+namespace detail {
+
+//--------------------------------------------
+// Input
+//--------------------------------------------
+
+// Bytes of a mesh file: a mapped range, or a stream read through a buffer
+// that only grows to the largest window asked for. A mapped file is asked
+// to prefetch each window as it is peeked, not the whole file, so that
+// files larger than RAM stream through.
+class ByteSource {
+ public:
+  explicit ByteSource(std::string_view mapped) : m_mapped{mapped} {}
+  explicit ByteSource(std::istream& in) : m_in{&in} {}
+#ifdef MATH_HAS_MMAP
+  explicit ByteSource(const MappedFile& file)
+      : m_mapped{file.view()}, m_file{&file} {}
+#endif
+
+  // At least n bytes, or all that is left; valid until the next call.
+  std::string_view peek(std::size_t n) {
+    if (!m_in) {
+      prefetch(n);
+      return m_mapped.substr(0, n);
+    }
+    if (m_buffer.size() - m_pos < n) {
+      m_buffer.erase(0, m_pos);
+      m_pos = 0;
+      std::size_t have = m_buffer.size();
+      m_buffer.resize(std::max(n, have + kMinRead));
+      m_in->read(m_buffer.data() + have,
+                 static_cast<std::streamsize>(m_buffer.size() - have));
+      m_buffer.resize(have + static_cast<std::size_t>(m_in->gcount()));
+    }
+    return std::string_view(m_buffer).substr(m_pos, n);
+  }
+
+  void consume(std::size_t n) {
+    if (m_in) {
+      m_pos += n;
+    } else {
+      m_mapped.remove_prefix(n);
+    }
+  }
+
+  bool at_end() { return peek(1).empty(); }
+
+  // Next window of whole lines, about `size` bytes (more if one line is
+  // longer). Empty at the end of the input.
+  std::string_view lines(std::size_t size) {
+    for (;;) {
+      auto view = peek(size);
+      if (view.size() < size) return view;
+      auto nl = view.rfind('\n');
+      if (nl != std::string_view::npos) return view.substr(0, nl + 1);
+      size *= 2;
+    }
+  }
+
+  std::string_view line() {
+    auto text = lines(256);
+    auto nl = text.find('\n');
+    auto line = text.substr(0, nl == std::string_view::npos ? nl : nl + 1);
+    consume(line.size());
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+      line.remove_suffix(1);
+    }
+    return line;
+  }
+
+ private:
+  static constexpr std::size_t kMinRead = std::size_t{64} << 10;
+  // Small peeks of list elements prefetch this much at once.
+  static constexpr std::size_t kMinPrefetch = std::size_t{1} << 20;
+
+  void prefetch([[maybe_unused]] std::size_t n) {
+#ifdef MATH_HAS_MMAP
+    if (!m_file) return;
+    auto offset = static_cast<std::size_t>(m_mapped.data() - m_file->data());
+    if (offset + n <= m_prefetched) return;
+    std::size_t length = std::max(n, kMinPrefetch);
+    m_file->will_need(offset, length);
+    m_prefetched = offset + length;
+#endif
+  }
+
+  std::string_view m_mapped;
+#ifdef MATH_HAS_MMAP
+  const MappedFile* m_file = nullptr;
+  std::size_t m_prefetched = 0;
+#endif
+  std::istream* m_in = nullptr;
+  std::string m_buffer;
+  std::size_t m_pos = 0;
+};
+
+// Runs fn(i) for every piece on the pool and rethrows the error of the
+// first failing piece; all pieces run, so the error reported is the same
+// whatever order they ran in.
+template <typename F>
+void run_pieces(const MeshLoadOptions& options, std::size_t pieces, F&& fn) {
+  if (pieces == 1) {
+    fn(0);
+    return;
+  }
+  ThreadPool& pool = options.pool ? *options.pool : default_thread_pool();
+  std::vector<std::exception_ptr> errors(pieces);
+  parallel_for(pool, 0, pieces, 1, [&](std::size_t i, std::size_t) {
+    try {
+      fn(i);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  });
+  for (auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+}
+
+inline std::string_view next_word(std::string_view& line) {
+  std::size_t b = line.find_first_not_of(" \t\r");
+  if (b == std::string_view::npos) {
+    line = {};
+    return {};
+  }
+  std::size_t e = line.find_first_of(" \t\r", b);
+  if (e == std::string_view::npos) e = line.size();
+  auto word = line.substr(b, e - b);
+  line.remove_prefix(e);
+  return word;
+}
+
+//--------------------------------------------
+// OBJ
+//--------------------------------------------
+
+// What one piece of an OBJ file decodes to. Relative face indices can point
+// into earlier pieces, so they are stored against this piece's first vertex
+// and rebased once the vertex count before it is known.
+struct ObjBatch {
+  std::vector<Point3f> positions;
+  std::vector<Normal3f> normals;
+  std::vector<uint32_t> triangles;
+  std::vector<std::pair<std::size_t, int64_t>> relative;
+};
+
+// Parses one corner of an f record ("7", "7/2", "7//3", "-1/2/3").
+inline const char* parse_corner(const char* p, const char* end, int64_t& idx) {
+  auto [next, ec] = std::from_chars(p, end, idx);
+  if (ec != std::errc{} || idx == 0) return nullptr;
+  while (next != end && !is_blank(*next) && *next != '\n') ++next;
+  return next;
+}
+
+inline void parse_obj_piece(std::string_view text, const char* origin,
+                            ObjBatch& out) {
+  const char* p = text.data();
+  const char* end = p + text.size();
+  std::vector<int64_t> face;
+  while (p != end) {
+    const char* q = skip_blanks(p, end);
+    if (q + 1 < end && q[0] == 'v' && is_blank(q[1])) {
+      float x, y, z;
+      if (!(q = parse_scalar(q + 1, end, x)) ||
+          !(q = parse_scalar(q, end, y)) || !(q = parse_scalar(q, end, z))) {
+        throw_parse_error(origin, p);
+      }
+      out.positions.emplace_back(x, y, z);
+    } else if (q + 2 < end && q[0] == 'v' && q[1] == 'n' && is_blank(q[2])) {
+      float x, y, z;
+      if (!(q = parse_scalar(q + 2, end, x)) ||
+          !(q = parse_scalar(q, end, y)) || !(q = parse_scalar(q, end, z))) {
+        throw_parse_error(origin, p);
+      }
+      out.normals.emplace_back(x, y, z);
+    } else if (q + 1 < end && q[0] == 'f' && is_blank(q[1])) {
+      face.clear();
+      ++q;
+      for (;;) {
+        q = skip_blanks(q, end);
+        if (q == end || *q == '\n') break;
+        int64_t idx;
+        if (!(q = parse_corner(q, end, idx))) throw_parse_error(origin, p);
+        face.push_back(idx);
+      }
+      if (face.size() < 3) throw_parse_error(origin, p);
+      auto local = static_cast<int64_t>(out.positions.size());
+      for (std::size_t i = 1; i + 1 < face.size(); ++i) {
+        for (int64_t idx : {face[0], face[i], face[i + 1]}) {
+          if (idx > 0) {
+            if (idx > int64_t{UINT32_MAX}) throw_parse_error(origin, p);
+            out.triangles.push_back(static_cast<uint32_t>(idx - 1));
+          } else {
+            out.relative.emplace_back(out.triangles.size(), local + idx);
+            out.triangles.push_back(0);
+          }
+        }
+      }
+    }
+    if (q != end && *q != '\n') q = line_end(q, end);
+    p = q == end ? end : q + 1;
+  }
+}
+
+template <mesh_sink Sink>
+void load_obj(ByteSource& src, Sink& sink, const MeshLoadOptions& options) {
+  uint64_t vertices = 0;
+  uint64_t referenced = 0;  // highest index used + 1
+  std::vector<ObjBatch> batches;
+  for (;;) {
+    auto window = src.lines(options.window_size);
+    if (window.empty()) break;
+    auto pieces = split_lines(window, options.threads);
+    batches.assign(pieces.size(), ObjBatch{});
+    run_pieces(options, pieces.size(), [&](std::size_t i) {
+      parse_obj_piece(pieces[i], window.data(), batches[i]);
+    });
+    for (auto& b : batches) {
+      for (auto [at, local] : b.relative) {
+        auto idx = static_cast<int64_t>(vertices) + local;
+        if (idx < 0) throw std::runtime_error("OBJ face index out of range");
+        b.triangles[at] = static_cast<uint32_t>(idx);
+      }
+      for (uint64_t idx : b.triangles) {
+        referenced = std::max(referenced, idx + 1);
+      }
+      vertices += b.positions.size();
+      sink.add_positions(b.positions);
+      sink.add_normals(b.normals);
+      sink.add_triangles(b.triangles);
+    }
+    src.consume(window.size());
+  }
+  if (referenced > vertices) {
+    throw std::runtime_error("OBJ face index out of range");
+  }
+}
+
+//--------------------------------------------
+// PLY
+//--------------------------------------------
+
+enum class PlyType : uint8_t { none, i8, u8, i16, u16, i32, u32, f32, f64 };
+
+inline PlyType ply_type(std::string_view name) {
+  if (name == "char" || name == "int8") return PlyType::i8;
+  if (name == "uchar" || name == "uint8") return PlyType::u8;
+  if (name == "short" || name == "int16") return PlyType::i16;
+  if (name == "ushort" || name == "uint16") return PlyType::u16;
+  if (name == "int" || name == "int32") return PlyType::i32;
+  if (name == "uint" || name == "uint32") return PlyType::u32;
+  if (name == "float" || name == "float32") return PlyType::f32;
+  if (name == "double" || name == "float64") return PlyType::f64;
+  throw std::runtime_error("Unknown PLY property type " + std::string(name));
+}
+
+inline std::size_t ply_size(PlyType t) {
+  static constexpr std::size_t sizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+  return sizes[static_cast<int>(t)];
+}
+
+template <typename U>
+U load_scalar(const char* p, bool swap) {
+  U v;
+  std::memcpy(&v, p, sizeof(U));
+  return swap ? byteswap(v) : v;
+}
+
+inline double read_ply_value(const char* p, PlyType t, bool swap) {
+  switch (t) {
+    case PlyType::i8:
+      return static_cast<int8_t>(*p);
+    case PlyType::u8:
+      return static_cast<uint8_t>(*p);
+    case PlyType::i16:
+      return load_scalar<int16_t>(p, swap);
+    case PlyType::u16:
+      return load_scalar<uint16_t>(p, swap);
+    case PlyType::i32:
+      return load_scalar<int32_t>(p, swap);
+    case PlyType::u32:
+      return load_scalar<uint32_t>(p, swap);
+    case PlyType::f32:
+      return load_scalar<float>(p, swap);
+    case PlyType::f64:
+      return load_scalar<double>(p, swap);
+    default:
+      throw std::runtime_error("Invalid PLY property type");
+  }
+}
+
+struct PlyProperty {
+  std::string name;
+  PlyType type = PlyType::none;
+  PlyType count_type = PlyType::none;  // set for list properties
+};
+
+struct PlyElement {
+  std::string name;
+  uint64_t count = 0;
+  std::vector<PlyProperty> properties;
+
+  bool fixed_size() const {
+    return std::all_of(properties.begin(), properties.end(), [](const auto& p) {
+      return p.count_type == PlyType::none;
+    });
+  }
+  std::size_t stride() const {
+    std::size_t s = 0;
+    for (const auto& p : properties) s += ply_size(p.type);
+    return s;
+  }
+  int find(std::string_view property) const {
+    for (std::size_t i = 0; i < properties.size(); ++i) {
+      if (properties[i].name == property) return static_cast<int>(i);
+    }
+    return -1;
+  }
+};
+
+enum class PlyFormat { ascii, binary_little_endian, binary_big_endian };
+
+struct PlyHeader {
+  PlyFormat format = PlyFormat::ascii;
+  std::vector<PlyElement> elements;
+};
+
+inline PlyHeader read_ply_header(ByteSource& src) {
+  if (src.line() != "ply") throw std::runtime_error("Not a PLY file");
+  PlyHeader h;
+  bool has_format = false;
+  for (;;) {
+    if (src.at_end()) throw std::runtime_error("PLY header is truncated");
+    auto line = src.line();
+    auto keyword = next_word(line);
+    if (keyword == "end_header") break;
+    if (keyword == "format") {
+      auto format = next_word(line);
+      if (format == "ascii") {
+        h.format = PlyFormat::ascii;
+      } else if (format == "binary_little_endian") {
+        h.format = PlyFormat::binary_little_endian;
+      } else if (format == "binary_big_endian") {
+        h.format = PlyFormat::binary_big_endian;
+      } else {
+        throw std::runtime_error("Unknown PLY format " + std::string(format));
+      }
+      has_format = true;
+    } else if (keyword == "element") {
+      PlyElement e;
+      e.name = next_word(line);
+      auto count = next_word(line);
+      auto [p, ec] =
+          std::from_chars(count.data(), count.data() + count.size(), e.count);
+      if (ec != std::errc{}) throw std::runtime_error("Invalid PLY element");
+      h.elements.push_back(std::move(e));
+    } else if (keyword == "property") {
+      if (h.elements.empty()) throw std::runtime_error("PLY property first");
+      PlyProperty prop;
+      auto type = next_word(line);
+      if (type == "list") {
+        prop.count_type = ply_type(next_word(line));
+        type = next_word(line);
+      }
+      prop.type = ply_type(type);
+      prop.name = next_word(line);
+      h.elements.back().properties.push_back(std::move(prop));
+    }
+  }
+  if (!has_format) throw std::runtime_error("PLY header has no format");
+  return h;
+}
+
+// Column of each vertex property the loader keeps, -1 when absent.
+struct PlyVertexLayout {
+  int x, y, z, nx, ny, nz;
+
+  explicit PlyVertexLayout(const PlyElement& e)
+      : x{e.find("x")},
+        y{e.find("y")},
+        z{e.find("z")},
+        nx{e.find("nx")},
+        ny{e.find("ny")},
+        nz{e.find("nz")} {
+    if (x < 0 || y < 0 || z < 0) {
+      throw std::runtime_error("PLY vertices have no x, y and z");
+    }
+    if (!e.fixed_size()) throw std::runtime_error("PLY vertex has a list");
+  }
+
+  bool has_normals() const { return nx >= 0 && ny >= 0 && nz >= 0; }
+};
+
+struct VertexBatch {
+  std::vector<Point3f> positions;
+  std::vector<Normal3f> normals;
+};
+
+template <mesh_sink Sink>
+void deliver(Sink& sink, std::vector<VertexBatch>& batches) {
+  for (const auto& b : batches) {
+    sink.add_positions(b.positions);
+    sink.add_normals(b.normals);
+  }
+}
+
+// A list entry as a vertex index. Checked while still a double: casting
+// NaN, infinities or values out of the integer range is undefined.
+inline uint32_t ply_index(double value, uint64_t vertices) {
+  if (!(value >= 0) || value >= static_cast<double>(vertices) ||
+      value != std::floor(value)) {
+    throw std::runtime_error("PLY face index out of range");
+  }
+  return static_cast<uint32_t>(value);
+}
+
+inline void triangulate(std::span<const uint32_t> face,
+                        std::vector<uint32_t>& out) {
+  if (face.size() < 3) throw std::runtime_error("PLY face has < 3 vertices");
+  for (std::size_t i = 1; i + 1 < face.size(); ++i) {
+    out.push_back(face[0]);
+    out.push_back(face[i]);
+    out.push_back(face[i + 1]);
+  }
+}
+
+// Binary vertices have a fixed stride, so a window is split by count.
+template <mesh_sink Sink>
+void load_binary_vertices(ByteSource& src, const PlyElement& e, bool swap,
+                          Sink& sink, const MeshLoadOptions& options) {
+  PlyVertexLayout layout(e);
+  std::vector<std::size_t> offset;
+  std::size_t stride = 0;
+  for (const auto& p : e.properties) {
+    offset.push_back(stride);
+    stride += ply_size(p.type);
+  }
+  auto value = [&](const char* v, int column) {
+    return static_cast<float>(
+        read_ply_value(v + offset[column], e.properties[column].type, swap));
+  };
+
+  std::size_t per_window =
+      std::max<std::size_t>(options.window_size / stride, 1);
+  std::vector<VertexBatch> batches;
+  for (uint64_t done = 0; done < e.count;) {
+    auto n = static_cast<std::size_t>(
+        std::min<uint64_t>(per_window, e.count - done));
+    auto bytes = src.peek(n * stride);
+    if (bytes.size() < n * stride) {
+      throw std::runtime_error("PLY vertex data is truncated");
+    }
+    std::size_t pieces = std::min<std::size_t>(options.threads, n);
+    batches.assign(pieces, VertexBatch{});
+    run_pieces(options, pieces, [&](std::size_t i) {
+      std::size_t begin = n * i / pieces, end = n * (i + 1) / pieces;
+      auto& b = batches[i];
+      b.positions.reserve(end - begin);
+      if (layout.has_normals()) b.normals.reserve(end - begin);
+      for (std::size_t k = begin; k < end; ++k) {
+        const char* v = bytes.data() + k * stride;
+        b.positions.emplace_back(value(v, layout.x), value(v, layout.y),
+                                 value(v, layout.z));
+        if (layout.has_normals()) {
+          b.normals.emplace_back(value(v, layout.nx), value(v, layout.ny),
+                                 value(v, layout.nz));
+        }
+      }
+    });
+    deliver(sink, batches);
+    src.consume(n * stride);
+    done += n;
+  }
+}
+
+// The size of the longest list accepted when the window is smaller.
+inline constexpr std::size_t kMaxListBytes = std::size_t{1} << 20;
+
+// Faces and skipped elements are walked in order; lists make their size
+// variable.
+template <mesh_sink Sink>
+void load_binary_element(ByteSource& src, const PlyElement& e, bool swap,
+                         uint64_t vertices, Sink& sink,
+                         const MeshLoadOptions& options) {
+  int indices = e.name == "face" ? e.find("vertex_indices") : -1;
+  if (indices < 0 && e.name == "face") indices = e.find("vertex_index");
+  std::vector<uint32_t> triangles;
+  std::vector<uint32_t> face;
+  for (uint64_t i = 0; i < e.count; ++i) {
+    for (std::size_t k = 0; k < e.properties.size(); ++k) {
+      const auto& p = e.properties[k];
+      if (p.count_type == PlyType::none) {
+        auto size = ply_size(p.type);
+        if (src.peek(size).size() < size) {
+          throw std::runtime_error("PLY " + e.name + " data is truncated");
+        }
+        src.consume(size);
+        continue;
+      }
+      auto count_size = ply_size(p.count_type);
+      auto head = src.peek(count_size);
+      if (head.size() < count_size) {
+        throw std::runtime_error("PLY " + e.name + " data is truncated");
+      }
+      // Negative, NaN, or more than a window holds (which would also make
+      // the stream buffer grow to it) is a corrupt file.
+      double listed = read_ply_value(head.data(), p.count_type, swap);
+      auto size = ply_size(p.type);
+      std::size_t max_bytes = std::max(options.window_size, kMaxListBytes);
+      if (!(listed >= 0) ||
+          listed > static_cast<double>((max_bytes - count_size) / size)) {
+        throw std::runtime_error("PLY " + e.name + " has a bad list size");
+      }
+      auto count = static_cast<std::size_t>(listed);
+      auto bytes = src.peek(count_size + count * size);
+      if (bytes.size() < count_size + count * size) {
+        throw std::runtime_error("PLY " + e.name + " data is truncated");
+      }
+      if (static_cast<int>(k) == indices) {
+        face.clear();
+        for (std::size_t c = 0; c < count; ++c) {
+          const char* at = bytes.data() + count_size + c * size;
+          face.push_back(ply_index(read_ply_value(at, p.type, swap), vertices));
+        }
+        triangulate(face, triangles);
+      }
+      src.consume(count_size + count * size);
+    }
+    if (triangles.size() >= options.window_size / sizeof(uint32_t)) {
+      sink.add_triangles(triangles);
+      triangles.clear();
+    }
+  }
+  if (!triangles.empty()) sink.add_triangles(triangles);
+}
+
+inline void parse_ascii_vertices(std::string_view text, const char* origin,
+                                 const PlyElement& e,
+                                 const PlyVertexLayout& layout,
+                                 VertexBatch& out) {
+  const char* p = text.data();
+  const char* end = p + text.size();
+  float v[6] = {};
+  while (p != end) {
+    const char* q = p;
+    std::size_t columns = e.properties.size();
+    for (std::size_t c = 0; c < columns; ++c) {
+      double value;
+      if (!(q = parse_scalar(q, end, value))) throw_parse_error(origin, p);
+      int col = static_cast<int>(c);
+      if (col == layout.x) v[0] = static_cast<float>(value);
+      if (col == layout.y) v[1] = static_cast<float>(value);
+      if (col == layout.z) v[2] = static_cast<float>(value);
+      if (col == layout.nx) v[3] = static_cast<float>(value);
+      if (col == layout.ny) v[4] = static_cast<float>(value);
+      if (col == layout.nz) v[5] = static_cast<float>(value);
+    }
+    out.positions.emplace_back(v[0], v[1], v[2]);
+    if (layout.has_normals()) out.normals.emplace_back(v[3], v[4], v[5]);
+    q = skip_blanks(q, end);
+    if (q != end && *q != '\n') throw_parse_error(origin, p);
+    p = q == end ? end : q + 1;
+  }
+}
+
+// ASCII vertices are one per line; a window is cut after the last vertex
+// line it holds and split between threads at line boundaries.
+template <mesh_sink Sink>
+void load_ascii_vertices(ByteSource& src, const PlyElement& e, Sink& sink,
+                         const MeshLoadOptions& options) {
+  PlyVertexLayout layout(e);
+  std::vector<VertexBatch> batches;
+  for (uint64_t done = 0; done < e.count;) {
+    auto window = src.lines(options.window_size);
+    if (window.empty()) {
+      throw std::runtime_error("PLY vertex data is truncated");
+    }
+    std::size_t cut = 0;
+    uint64_t lines = 0;
+    while (cut < window.size() && done + lines < e.count) {
+      auto nl = window.find('\n', cut);
+      cut = nl == std::string_view::npos ? window.size() : nl + 1;
+      ++lines;
+    }
+    window = window.substr(0, cut);
+    auto pieces = split_lines(window, options.threads);
+    batches.assign(pieces.size(), VertexBatch{});
+    run_pieces(options, pieces.size(), [&](std::size_t i) {
+      parse_ascii_vertices(pieces[i], window.data(), e, layout, batches[i]);
+    });
+    deliver(sink, batches);
+    src.consume(window.size());
+    done += lines;
+  }
+}
+
+template <mesh_sink Sink>
+void load_ascii_element(ByteSource& src, const PlyElement& e, uint64_t vertices,
+                        Sink& sink, const MeshLoadOptions& options) {
+  int indices = e.name == "face" ? e.find("vertex_indices") : -1;
+  if (indices < 0 && e.name == "face") indices = e.find("vertex_index");
+  std::vector<uint32_t> triangles;
+  std::vector<uint32_t> face;
+  for (uint64_t i = 0; i < e.count; ++i) {
+    if (src.at_end()) throw std::runtime_error("PLY data is truncated");
+    auto line = src.line();
+    const char* p = line.data();
+    const char* end = p + line.size();
+    for (std::size_t k = 0; k < e.properties.size(); ++k) {
+      const auto& prop = e.properties[k];
+      std::size_t count = 1;
+      if (prop.count_type != PlyType::none) {
+        if (!(p = parse_scalar(p, end, count))) {
+          throw std::runtime_error("Malformed PLY " + e.name);
+        }
+      }
+      if (static_cast<int>(k) == indices) face.clear();
+      for (std::size_t c = 0; c < count; ++c) {
+        double value;
+        if (!(p = parse_scalar(p, end, value))) {
+          throw std::runtime_error("Malformed PLY " + e.name);
+        }
+        if (static_cast<int>(k) == indices) {
+          face.push_back(ply_index(value, vertices));
+        }
+      }
+      if (static_cast<int>(k) == indices) {
+        triangulate(face, triangles);
+      }
+    }
+    if (triangles.size() >= options.window_size / sizeof(uint32_t)) {
+      sink.add_triangles(triangles);
+      triangles.clear();
+    }
+  }
+  if (!triangles.empty()) sink.add_triangles(triangles);
+}
+
+template <mesh_sink Sink>
+void load_ply(ByteSource& src, Sink& sink, const MeshLoadOptions& options) {
+  auto header = read_ply_header(src);
+  bool ascii = header.format == PlyFormat::ascii;
+  bool swap = (header.format == PlyFormat::binary_big_endian) !=
+              (std::endian::native == std::endian::big);
+  uint64_t vertices = 0;
+  for (const auto& e : header.elements) {
+    if (e.name == "vertex") {
+      if (ascii) {
+        load_ascii_vertices(src, e, sink, options);
+      } else {
+        load_binary_vertices(src, e, swap, sink, options);
+      }
+      vertices += e.count;
+    } else if (ascii) {
+      load_ascii_element(src, e, vertices, sink, options);
+    } else {
+      load_binary_element(src, e, swap, vertices, sink, options);
+    }
+  }
+}
+
+}  // namespace detail
+
+//--------------------------------------------
+// Loading
+//--------------------------------------------
+
+template <mesh_sink Sink>
+void load_obj(std::istream& in, Sink& sink,
+              const MeshLoadOptions& options = {}) {
+  detail::ByteSource src(in);
+  detail::load_obj(src, sink, options);
+}
+
+template <mesh_sink Sink>
+void load_ply(std::istream& in, Sink& sink,
+              const MeshLoadOptions& options = {}) {
+  detail::ByteSource src(in);
+  detail::load_ply(src, sink, options);
+}
+
+// Loads an .obj or .ply file, chosen by extension. The file is mapped when
+// the platform supports it and read through a bounded buffer otherwise.
+template <mesh_sink Sink>
+void load_mesh(const std::string& path, Sink& sink,
+               const MeshLoadOptions& options = {}) {
+  auto dot = path.rfind('.');
+  std::string ext = dot == std::string::npos ? "" : path.substr(dot + 1);
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (ext != "obj" && ext != "ply") {
+    throw std::runtime_error("Unknown mesh format " + path);
+  }
+#ifdef MATH_HAS_MMAP
+  MappedFile file(path);
+  detail::ByteSource src(file);
+#else
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw std::runtime_error("Cannot open " + path);
+  detail::ByteSource src(in);
+#endif
+  if (ext == "obj") {
+    detail::load_obj(src, sink, options);
+  } else {
+    detail::load_ply(src, sink, options);
+  }
+}
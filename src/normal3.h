@@ -70,9 +70,9 @@ class Normal3 {
   }
 
  private:
-  T m_x = T{1};
-  T m_y = T{1};
-  T m_z = T{1};
+  T m_x = T{0};
+  T m_y = T{0};
+  T m_z = T{0};
 };
 
 using Normal3i = Normal3<int>;
@@ -93,7 +93,7 @@ inline std::istream& operator>>(std::istream& in, Normal3<T>& n) {
 
 template <numeric T>
 inline std::ostream& operator<<(std::ostream& out, const Normal3<T>& n) {
-  out << "(" << n.x() << "," << n.y() << "," << n.z() << ")" << std::endl;
+  out << "(" << n.x() << "," << n.y() << "," << n.z() << ")";
   return out;
 }
 
@@ -108,7 +108,7 @@ Normal3<T> operator+(const Normal3<T>& n1, const Normal3<T>& n2) {
 
 template <numeric T>
 Normal3<T> operator+(const Normal3<T>& n, const Vec3<T>& v) {
-  return Vec3<T>(n.x() + v.x(), n.y() + v.y(), n.z() + v.z());
+  return Normal3<T>(n.x() + v.x(), n.y() + v.y(), n.z() + v.z());
 }
 
 template <numeric T>
@@ -180,14 +180,12 @@ Normal3<T> operator/(const Normal3<T>& n, T num) {
 
 template <numeric T>
 T dot(const Normal3<T>& n1, const Normal3<T>& n2) {
-  Normal3<T> n = n1 * n2;
-  return n.x() + n.y() + n.z();
+  return n1.x() * n2.x() + n1.y() * n2.y() + n1.z() * n2.z();
 }
 
 template <numeric T>
 T dot(const Normal3<T>& n, const Vec3<T>& v) {
-  Normal3<T> u = n * v;
-  return u.x() + u.y() + u.z();
+  return n.x() * v.x() + n.y() * v.y() + n.z() * v.z();
 }
 
 template <numeric T>
@@ -198,8 +196,30 @@ T dot(const Vec3<T>& v, const Normal3<T>& n) {
 template <numeric T>
 Normal3<T> normalized(const Normal3<T>& v) {
   auto l = v.length();
-  if (l < std::numeric_limits<double>::epsilon()) {
+  if (any(l < std::numeric_limits<double>::epsilon())) {
     throw std::runtime_error("Cannot normalize zero-length 3D normal");
   }
   return v / static_cast<T>(l);
-}
\ No newline at end of file
+}
+
+//--------------------------------------------
+// Explicit instantiation of the common aliases
+//--------------------------------------------
+// Expanded with `extern` here when MATH_EXTERN_TEMPLATES is defined (linking
+// math_instantiated does that) and without it in math_instantiated.cpp.
+
+#define MATH_INSTANTIATE_NORMAL3(EXTERN, T)                                   \
+  EXTERN template class Normal3<T>;                                           \
+  EXTERN template Normal3<T> operator+(const Normal3<T>&, const Normal3<T>&); \
+  EXTERN template Normal3<T> operator-(const Normal3<T>&, const Normal3<T>&); \
+  EXTERN template Normal3<T> operator*(const Normal3<T>&, T);                 \
+  EXTERN template Normal3<T> operator*(T, const Normal3<T>&);                 \
+  EXTERN template T dot(const Normal3<T>&, const Normal3<T>&);                \
+  EXTERN template T dot(const Normal3<T>&, const Vec3<T>&);                   \
+  EXTERN template T dot(const Vec3<T>&, const Normal3<T>&);                   \
+  EXTERN template Normal3<T> normalized(const Normal3<T>&)
+
+#ifdef MATH_EXTERN_TEMPLATES
+MATH_INSTANTIATE_NORMAL3(extern, float);
+MATH_INSTANTIATE_NORMAL3(extern, double);
+#endif
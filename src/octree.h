@@ -0,0 +1,480 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "point3.h"
+#include "ray.h"
+#include "spatial_sort.h"
+#include "thread_pool.h"
+#include "types.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Sparse octree over a point set
+//--------------------------------------------
+//
+// The cube around the points is cut into 2^depth voxels per axis, and only
+// the voxels holding a point exist. The points are sorted by the Morton key
+// of their voxel, so a voxel, and any subtree, is a contiguous range of
+// that order.
+//
+// There are no pointers. Nodes are stored level by level, root first, and
+// the children of a node are consecutive on the next level in octant
+// order, so a node is an 8-bit child mask plus the index of its first
+// child (5 bytes); child i sits at first + popcount(mask & ((1 << i) - 1)).
+// The leaves are the voxels and keep the first slot of their points
+// instead.
+//
+// The build is bottom up: the sorted voxel keys are the leaves, and the
+// keys of a level shifted right by 3 are, once deduplicated, the level
+// above. Every step runs on the pool.
+//
+// Rays are traversed with the parametric algorithm of Revelles et al.
+// ("An Efficient Parametric Algorithm for Octree Traversal", 2000): the
+// slab parameters of a node are halved into those of its children, which
+// are visited in the order the ray crosses them, so the first leaf reached
+// is the nearest hit. Voxels are numbered 0 to voxel_count() - 1 in key
+// order.
+
+template <numeric T>
+struct OctreeHit {
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  uint32_t voxel = kNone;
+  T t = std::numeric_limits<T>::infinity();  // ray parameter at entry
+
+  bool hit() const { return voxel != kNone; }
+  bool operator==(const OctreeHit&) const = default;
+};
+
+template <numeric T>
+class Octree {
+ public:
+  static constexpr uint32_t kNone = UINT32_MAX;
+  static constexpr int kMaxDepth = kSpatialKeyBits;
+
+  Octree() = default;
+
+  Octree(std::span<const Point3<T>> points, int depth, ThreadPool& pool) {
+    build(points, depth, pool);
+  }
+
+  Octree(std::span<const Point3<T>> points, int depth)
+      : Octree(points, depth, default_thread_pool()) {}
+
+  int depth() const { return m_depth; }
+  std::size_t size() const { return m_order.size(); }
+  bool empty() const { return m_order.empty(); }
+  std::size_t node_count() const { return m_mask.size(); }
+  std::size_t voxel_count() const { return m_voxel_keys.size(); }
+
+  // The cube the voxels tile.
+  const AABB<T>& bounds() const { return m_bounds; }
+  T voxel_size() const { return m_voxel_size; }
+
+  //--------------------------------------------
+  // Voxels
+  //--------------------------------------------
+
+  // The voxel holding p, or kNone when it is empty or outside bounds().
+  uint32_t find_voxel(const Point3<T>& p) const {
+    if (empty() || !m_bounds.contains(p)) return kNone;
+    uint64_t key = voxel_key(p);
+    uint32_t node = 0;
+    for (int shift = 3 * (m_depth - 1); shift >= 0; shift -= 3) {
+      unsigned octant = key >> shift & 7;
+      if (!(m_mask[node] >> octant & 1)) return kNone;
+      node = child(node, octant);
+    }
+    return node - m_leaf_begin;
+  }
+
+  bool occupied(const Point3<T>& p) const { return find_voxel(p) != kNone; }
+
+  AABB<T> voxel_bounds(uint32_t voxel) const {
+    auto c = morton_decode(m_voxel_keys.at(voxel));
+    Point3<T> lo = m_bounds.min() + Vec3<T>(static_cast<T>(c[0]),
+                                            static_cast<T>(c[1]),
+                                            static_cast<T>(c[2])) *
+                                        m_voxel_size;
+    return AABB<T>(lo, lo + Vec3<T>(m_voxel_size, m_voxel_size, m_voxel_size));
+  }
+
+  // Indices of the points in a voxel.
+  std::span<const uint32_t> voxel_points(uint32_t voxel) const {
+    if (voxel >= voxel_count()) throw std::out_of_range("No such voxel");
+    uint32_t leaf = m_leaf_begin + voxel;
+    return std::span(m_order).subspan(m_first[leaf],
+                                      m_first[leaf + 1] - m_first[leaf]);
+  }
+
+  //--------------------------------------------
+  // Box queries
+  //--------------------------------------------
+
+  // Whether an occupied voxel overlaps box: occupancy at voxel resolution,
+  // as for collision tests.
+  bool intersects(const AABB<T>& box) const {
+    bool found = false;
+    visit(box, [&](uint32_t, int level, bool) {
+      if (level == m_depth) found = true;
+      return !found;
+    });
+    return found;
+  }
+
+  // Appends the indices of the points inside box to out, in no particular
+  // order; returns how many were appended. Subtrees entirely inside the
+  // box are appended without looking at their points.
+  std::size_t points_in_box(const AABB<T>& box,
+                            std::vector<uint32_t>& out) const {
+    std::size_t before = out.size();
+    visit(box, [&](uint32_t node, int level, bool inside) {
+      if (inside) {
+        auto [begin, end] = slots(node, level);
+        out.insert(out.end(), m_order.begin() + begin, m_order.begin() + end);
+        return false;
+      }
+      if (level < m_depth) return true;
+      for (uint32_t s = m_first[node]; s < m_first[node + 1]; ++s) {
+        if (box.contains(m_points[s])) out.push_back(m_order[s]);
+      }
+      return false;
+    });
+    return out.size() - before;
+  }
+
+  //--------------------------------------------
+  // Ray traversal
+  //--------------------------------------------
+
+  // The first occupied voxel along the ray within its parameter range.
+  OctreeHit<T> raycast(const Ray& ray) const {
+    if (empty()) return {};
+    T tmin = static_cast<T>(ray.getMinRange());
+    T tmax = static_cast<T>(ray.getMaxRange());
+    Point3f origin = ray.origin();
+    Vec3f direction = ray.direction();
+
+    // Mirror the negative axes about the centre of the cube, so that the
+    // direction is positive; `flip` maps mirrored octants back.
+    Span root{0, 0, {}, {}};
+    unsigned flip = 0;
+    for (int a = 0; a < 3; ++a) {
+      T lo = coord(m_bounds.min(), a), hi = coord(m_bounds.max(), a);
+      T o = static_cast<T>(a == 0   ? origin.x()
+                           : a == 1 ? origin.y()
+                                    : origin.z());
+      T d = static_cast<T>(a == 0   ? direction.x()
+                           : a == 1 ? direction.y()
+                                    : direction.z());
+      if (d < T{0}) {
+        o = lo + hi - o;
+        d = -d;
+        flip |= 1u << a;
+      }
+      // Keeps the parameters finite for rays parallel to an axis.
+      T inv = T{1} / std::max(d, kTinyDirection);
+      root.t0[a] = (lo - o) * inv;
+      root.t1[a] = (hi - o) * inv;
+    }
+
+    Span stack[4 * kMaxDepth + 1];
+    int top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+      Span s = stack[--top];
+      T enter = std::max({s.t0[0], s.t0[1], s.t0[2]});
+      T exit = std::min({s.t1[0], s.t1[1], s.t1[2]});
+      if (enter > exit || exit < tmin || enter > tmax) continue;
+      if (s.level == m_depth) {
+        return {s.node - m_leaf_begin, std::max(enter, tmin)};
+      }
+      T mid[3];
+      for (int a = 0; a < 3; ++a) mid[a] = (s.t0[a] + s.t1[a]) / T{2};
+
+      // The ray enters the child on the far side of every mid-plane it
+      // crossed before entering the node, then moves to the next child at
+      // each remaining mid-plane crossing inside the node.
+      unsigned child_octant = 0;
+      for (int a = 0; a < 3; ++a) {
+        if (mid[a] < enter) child_octant |= 1u << a;
+      }
+      int axes[3] = {0, 1, 2};
+      std::sort(axes, axes + 3, [&](int a, int b) { return mid[a] < mid[b]; });
+      unsigned sequence[4];
+      int count = 0;
+      sequence[count++] = child_octant;
+      for (int a : axes) {
+        if (mid[a] >= enter && mid[a] < exit) {
+          child_octant ^= 1u << a;
+          sequence[count++] = child_octant;
+        }
+      }
+      // Pushed last to first, so the nearest is searched first.
+      uint8_t mask = m_mask[s.node];
+      for (int k = count - 1; k >= 0; --k) {
+        unsigned octant = sequence[k] ^ flip;
+        if (!(mask >> octant & 1)) continue;
+        Span c{child(s.node, octant), s.level + 1, {}, {}};
+        for (int a = 0; a < 3; ++a) {
+          bool upper = sequence[k] >> a & 1;
+          c.t0[a] = upper ? mid[a] : s.t0[a];
+          c.t1[a] = upper ? s.t1[a] : mid[a];
+        }
+        stack[top++] = c;
+      }
+    }
+    return {};
+  }
+
+ private:
+  static constexpr std::size_t kGrain = std::size_t{1} << 14;
+  static constexpr T kTinyDirection = static_cast<T>(1e-20);
+
+  // A node and the ray's slab parameters over its cell.
+  struct Span {
+    uint32_t node;
+    int level;
+    T t0[3];
+    T t1[3];
+  };
+
+  // A node and its cell, in units of its level's cells.
+  struct Cell {
+    uint32_t node;
+    int level;
+    uint32_t x, y, z;
+  };
+
+  // Point3::operator[] range-checks; the axis here is always valid.
+  static T coord(const Point3<T>& p, int axis) {
+    return axis == 0 ? p.x() : axis == 1 ? p.y() : p.z();
+  }
+
+  uint32_t child(uint32_t node, unsigned octant) const {
+    unsigned before = m_mask[node] & ((1u << octant) - 1);
+    return m_first[node] + static_cast<uint32_t>(std::popcount(before));
+  }
+
+  // Voxel coordinate along an axis, clamped to the grid.
+  uint32_t quantize(T v, int axis) const {
+    T c = std::floor((v - coord(m_bounds.min(), axis)) * m_scale);
+    T last = static_cast<T>((1u << m_depth) - 1);
+    return static_cast<uint32_t>(std::clamp(c, T{0}, last));
+  }
+
+  uint64_t voxel_key(const Point3<T>& p) const {
+    return morton_key(quantize(p.x(), 0), quantize(p.y(), 1),
+                      quantize(p.z(), 2));
+  }
+
+  // Slots of the points below a node: from its leftmost leaf to the end of
+  // its rightmost one.
+  std::pair<uint32_t, uint32_t> slots(uint32_t node, int level) const {
+    uint32_t first = node, last = node;
+    for (; level < m_depth; ++level) {
+      first = m_first[first];
+      last = m_first[last] + std::popcount(m_mask[last]) - 1;
+    }
+    return {m_first[first], m_first[last + 1]};
+  }
+
+  // Calls fn(node, level, inside) for the nodes whose cell overlaps the
+  // voxels box touches, root first; fn returns whether to go on to the
+  // node's children. `inside` is set when every voxel of the cell is
+  // strictly inside that range, which means each of its points is inside
+  // box: quantization is monotonic.
+  template <typename F>
+  void visit(const AABB<T>& box, F&& fn) const {
+    if (empty() || box.empty()) return;
+    uint32_t lo[3], hi[3];
+    for (int a = 0; a < 3; ++a) {
+      if (coord(box.max(), a) < coord(m_bounds.min(), a) ||
+          coord(box.min(), a) > coord(m_bounds.max(), a)) {
+        return;
+      }
+      lo[a] = quantize(coord(box.min(), a), a);
+      hi[a] = quantize(coord(box.max(), a), a);
+    }
+    Cell stack[8 * kMaxDepth];
+    int top = 0;
+    stack[top++] = {0, 0, 0, 0, 0};
+    while (top > 0) {
+      Cell c = stack[--top];
+      int shift = m_depth - c.level;
+      uint32_t at[3] = {c.x, c.y, c.z};
+      bool overlaps = true, inside = true;
+      for (int a = 0; a < 3; ++a) {
+        uint32_t begin = at[a] << shift, last = ((at[a] + 1) << shift) - 1;
+        overlaps = overlaps && begin <= hi[a] && last >= lo[a];
+        inside = inside && begin > lo[a] && last < hi[a];
+      }
+      if (!overlaps || !fn(c.node, c.level, inside) || shift == 0) continue;
+      uint8_t mask = m_mask[c.node];
+      for (unsigned octant = 0; octant < 8; ++octant) {
+        if (!(mask >> octant & 1)) continue;
+        stack[top++] = {child(c.node, octant), c.level + 1,
+                        c.x << 1 | (octant & 1), c.y << 1 | (octant >> 1 & 1),
+                        c.z << 1 | (octant >> 2)};
+      }
+    }
+  }
+
+  // Start of every run of equal key(i) over [0, n), then n.
+  template <typename Key>
+  static std::vector<uint32_t> run_starts(std::size_t n, Key key,
+                                          ThreadPool& pool) {
+    std::size_t blocks = std::clamp<std::size_t>(
+        n / kGrain, 1, 8 * (std::size_t{pool.size()} + 1));
+    auto block_begin = [&](std::size_t b) { return n * b / blocks; };
+    auto starts_run = [&](std::size_t i) {
+      return i == 0 || key(i) != key(i - 1);
+    };
+    std::vector<std::size_t> runs_before(blocks + 1, 0);
+    parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+      std::size_t count = 0;
+      for (std::size_t i = block_begin(b); i < block_begin(b + 1); ++i) {
+        count += starts_run(i);
+      }
+      runs_before[b + 1] = count;
+    });
+    for (std::size_t b = 0; b < blocks; ++b) {
+      runs_before[b + 1] += runs_before[b];
+    }
+    std::vector<uint32_t> starts(runs_before[blocks] + 1);
+    starts.back() = static_cast<uint32_t>(n);
+    parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+      std::size_t r = runs_before[b];
+      for (std::size_t i = block_begin(b); i < block_begin(b + 1); ++i) {
+        if (starts_run(i)) starts[r++] = static_cast<uint32_t>(i);
+      }
+    });
+    return starts;
+  }
+
+  void build(std::span<const Point3<T>> points, int depth, ThreadPool& pool) {
+    if (depth < 1 || depth > kMaxDepth) {
+      throw std::invalid_argument("Octree depth must be in [1, 21]");
+    }
+    if (points.size() >= UINT32_MAX) {
+      throw std::length_error("Too many points for an octree");
+    }
+    m_depth = depth;
+    std::size_t n = points.size();
+    if (n == 0) return;
+
+    AABB<T> box = ::bounds(points, pool);
+    Vec3<T> extent = box.extent();
+    T side = std::max({extent.x(), extent.y(), extent.z()});
+    if (!(side > T{0})) side = T{1};
+    m_bounds = AABB<T>(box.min(), box.min() + Vec3<T>(side, side, side));
+    m_scale = static_cast<T>(1u << depth) / side;
+    m_voxel_size = side / static_cast<T>(1u << depth);
+
+    // Leaves: points sorted by voxel.
+    std::vector<uint64_t> keys(n);
+    m_order.resize(n);
+    parallel_for(pool, 0, n, kGrain, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        keys[i] = voxel_key(points[i]);
+        m_order[i] = static_cast<uint32_t>(i);
+      }
+    });
+    radix_sort(std::span(keys), std::span(m_order), pool);
+    m_points.resize(n);
+    gather(std::span<const uint32_t>(m_order), points, std::span(m_points),
+           pool);
+
+    // Levels from the leaves up: the keys, and the first child (or point
+    // slot) of every node, in level-local indices.
+    std::vector<std::vector<uint64_t>> level_keys(depth + 1);
+    std::vector<std::vector<uint32_t>> level_first(depth + 1);
+    std::vector<std::vector<uint8_t>> level_mask(depth + 1);
+    level_first[depth] = run_starts(
+        n, [&](std::size_t i) { return keys[i]; }, pool);
+    level_first[depth].pop_back();
+    level_keys[depth].resize(level_first[depth].size());
+    level_mask[depth].assign(level_first[depth].size(), 0);
+    parallel_for(pool, 0, level_keys[depth].size(), kGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t v = begin; v < end; ++v) {
+                     level_keys[depth][v] = keys[level_first[depth][v]];
+                   }
+                 });
+    for (int level = depth - 1; level >= 0; --level) {
+      const std::vector<uint64_t>& below = level_keys[level + 1];
+      std::vector<uint32_t> starts = run_starts(
+          below.size(), [&](std::size_t i) { return below[i] >> 3; }, pool);
+      std::size_t count = starts.size() - 1;
+      level_keys[level].resize(count);
+      level_mask[level].resize(count);
+      parallel_for(pool, 0, count, kGrain,
+                   [&](std::size_t begin, std::size_t end) {
+                     for (std::size_t j = begin; j < end; ++j) {
+                       uint8_t mask = 0;
+                       for (uint32_t c = starts[j]; c < starts[j + 1]; ++c) {
+                         mask |= static_cast<uint8_t>(1u << (below[c] & 7));
+                       }
+                       level_keys[level][j] = below[starts[j]] >> 3;
+                       level_mask[level][j] = mask;
+                     }
+                   });
+      starts.pop_back();
+      level_first[level] = std::move(starts);
+    }
+
+    // Concatenated root first, with child indices made global and the end
+    // of the last leaf's points after the last node.
+    std::vector<std::size_t> level_begin(depth + 2, 0);
+    for (int level = 0; level <= depth; ++level) {
+      level_begin[level + 1] = level_begin[level] + level_mask[level].size();
+    }
+    std::size_t nodes = level_begin[depth + 1];
+    if (nodes >= UINT32_MAX) {
+      throw std::length_error("Too many nodes for an octree");
+    }
+    m_first.resize(nodes + 1);
+    m_mask.resize(nodes);
+    m_first[nodes] = static_cast<uint32_t>(n);
+    for (int level = 0; level <= depth; ++level) {
+      uint32_t offset =
+          level < depth ? static_cast<uint32_t>(level_begin[level + 1]) : 0;
+      std::size_t base = level_begin[level];
+      parallel_for(pool, 0, level_mask[level].size(), kGrain,
+                   [&](std::size_t begin, std::size_t end) {
+                     for (std::size_t j = begin; j < end; ++j) {
+                       m_first[base + j] = offset + level_first[level][j];
+                       m_mask[base + j] = level_mask[level][j];
+                     }
+                   });
+    }
+    m_leaf_begin = static_cast<uint32_t>(level_begin[depth]);
+    m_voxel_keys = std::move(level_keys[depth]);
+  }
+
+  int m_depth = 1;
+  AABB<T> m_bounds;
+  T m_scale = T{1};       // voxels per unit length
+  T m_voxel_size = T{1};
+  std::vector<uint32_t> m_first;  // first child, or first point slot of a
+                                  // leaf; then the point count
+  std::vector<uint8_t> m_mask;    // children present, by octant
+  uint32_t m_leaf_begin = 0;      // index of the first leaf
+  std::vector<uint64_t> m_voxel_keys;  // Morton key of each leaf
+  std::vector<uint32_t> m_order;       // point index of each slot
+  std::vector<Point3<T>> m_points;     // point of each slot
+};
+
+using Octreef = Octree<float>;
+using Octreed = Octree<double>;
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATH_PACKED_NORMAL_SSE2 1
+#endif
+
+#include "normal3.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Octahedral normal encoding
+//--------------------------------------------
+//
+// A unit vector is projected onto the octahedron |x| + |y| + |z| = 1, the
+// lower half is folded over the upper one and the resulting square is stored
+// as two snorm integers (Cigolle et al., "A Survey of Efficient
+// Representations for Independent Unit Vectors", JCGT 2014):
+//
+//   PackedNormal16   8 + 8 bits,  2 bytes   max error 1.1 degrees
+//   PackedNormal32  16 + 16 bits, 4 bytes   max error 0.035 degrees
+//
+// against 12 bytes for a Normal3f. The error bounds are the largest angle
+// between a unit vector and its round trip, measured over the whole sphere
+// (see packed_normal_test.cpp). Unpacking always returns a unit vector, and
+// packing an unpacked value gives back the same bits, so repeated round
+// trips do not drift. The zero vector packs to +z.
+
+template <typename U>
+  requires std::is_same_v<U, uint16_t> || std::is_same_v<U, uint32_t>
+class PackedNormal {
+ public:
+  using storage_type = U;
+  static constexpr int kBits = sizeof(U) * 4;  // per component
+  static constexpr int kMax = (1 << (kBits - 1)) - 1;
+
+  PackedNormal() = default;
+  explicit PackedNormal(const Normal3f& n) : m_bits{encode(n)} {}
+  explicit PackedNormal(const Vec3f& v) : m_bits{encode(Normal3f(v))} {}
+
+  static PackedNormal from_bits(U bits) {
+    PackedNormal p;
+    p.m_bits = bits;
+    return p;
+  }
+
+  U bits() const { return m_bits; }
+
+  // Octahedral coordinates in [-1, 1].
+  float u() const { return component(m_bits); }
+  float v() const { return component(m_bits >> kBits); }
+
+  Normal3f unpack() const {
+    Vec3f d = direction();
+    float inv = 1.f / std::sqrt(dot(d, d));
+    return Normal3f(d.x() * inv, d.y() * inv, d.z() * inv);
+  }
+
+  explicit operator Normal3f() const { return unpack(); }
+
+  // The unnormalized point on the octahedron, |d| in [1/sqrt(3), 1].
+  Vec3f direction() const {
+    float x = u();
+    float y = v();
+    float z = 1.f - std::fabs(x) - std::fabs(y);
+    if (z < 0.f) fold(x, y);
+    return Vec3f(x, y, z);
+  }
+
+  bool operator==(const PackedNormal&) const = default;
+
+  static U encode(const Normal3f& n) {
+    float ax = std::fabs(n.x());
+    float ay = std::fabs(n.y());
+    float az = std::fabs(n.z());
+    float inv = 1.f / std::max(ax + ay + az, FLT_MIN);
+    float x = n.x() * inv;
+    float y = n.y() * inv;
+    if (n.z() < 0.f) fold(x, y);
+    return combine(quantize(x), quantize(y));
+  }
+
+ private:
+  // Mirrors the lower half of the octahedron over the upper one. It is its
+  // own inverse, so encoding and decoding share it and land exactly on the
+  // square's edges, and copysign carries the sign of a zero coordinate
+  // across, which keeps round trips stable.
+  static void fold(float& x, float& y) {
+    float fx = std::copysign(1.f - std::fabs(y), x);
+    float fy = std::copysign(1.f - std::fabs(x), y);
+    x = fx;
+    y = fy;
+  }
+
+  using Half = std::conditional_t<sizeof(U) == 2, uint8_t, uint16_t>;
+  using SignedHalf = std::conditional_t<sizeof(U) == 2, int8_t, int16_t>;
+
+  static int32_t quantize(float f) {
+    return static_cast<int32_t>(std::lrint(f * static_cast<float>(kMax)));
+  }
+
+  static U combine(int32_t x, int32_t y) {
+    return static_cast<U>(static_cast<Half>(x) |
+                          static_cast<U>(static_cast<Half>(y)) << kBits);
+  }
+
+  static float component(U bits) {
+    auto q = static_cast<SignedHalf>(static_cast<Half>(bits));
+    return std::max(static_cast<float>(q) * (1.f / kMax), -1.f);
+  }
+
+  U m_bits = 0;
+};
+
+using PackedNormal16 = PackedNormal<uint16_t>;
+using PackedNormal32 = PackedNormal<uint32_t>;
+
+static_assert(sizeof(PackedNormal16) == 2 && sizeof(PackedNormal32) == 4);
+
+//--------------------------------------------
+// Dot products without unpacking
+//--------------------------------------------
+// The octahedron points are dotted directly and the result rescaled by one
+// square root, instead of normalizing both vectors first.
+
+template <typename U>
+float dot(const PackedNormal<U>& a, const PackedNormal<U>& b) {
+  Vec3f da = a.direction();
+  Vec3f db = b.direction();
+  return dot(da, db) / std::sqrt(dot(da, da) * dot(db, db));
+}
+
+template <typename U>
+float dot(const PackedNormal<U>& a, const Vec3f& v) {
+  Vec3f d = a.direction();
+  return dot(d, v) / std::sqrt(dot(d, d));
+}
+
+template <typename U>
+float dot(const Vec3f& v, const PackedNormal<U>& a) {
+  return dot(a, v);
+}
+
+//--------------------------------------------
+// Batch conversion
+//--------------------------------------------
+// Same results as the scalar pack/unpack, four normals at a time with SSE2.
+
+namespace detail {
+
+#ifdef MATH_PACKED_NORMAL_SSE2
+
+// fold() for four lanes, applied where `lower` is set.
+inline void fold4(__m128& x, __m128& y, __m128 lower) {
+  const __m128 sign = _mm_set1_ps(-0.f);
+  const __m128 one = _mm_set1_ps(1.f);
+  __m128 fx = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(sign, y)),
+                        _mm_and_ps(x, sign));
+  __m128 fy = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(sign, x)),
+                        _mm_and_ps(y, sign));
+  x = _mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, x));
+  y = _mm_or_ps(_mm_and_ps(lower, fy), _mm_andnot_ps(lower, y));
+}
+
+// Octahedral coordinates of four unit vectors, scaled and rounded to ints.
+inline void oct_encode4(__m128 x, __m128 y, __m128 z, float scale,
+                        __m128i& qx, __m128i& qy) {
+  const __m128 sign = _mm_set1_ps(-0.f);
+  __m128 ax = _mm_andnot_ps(sign, x);
+  __m128 ay = _mm_andnot_ps(sign, y);
+  __m128 az = _mm_andnot_ps(sign, z);
+  __m128 sum = _mm_max_ps(_mm_add_ps(_mm_add_ps(ax, ay), az),
+                          _mm_set1_ps(FLT_MIN));
+  __m128 inv = _mm_div_ps(_mm_set1_ps(1.f), sum);
+  __m128 px = _mm_mul_ps(x, inv);
+  __m128 py = _mm_mul_ps(y, inv);
+  fold4(px, py, _mm_cmplt_ps(z, _mm_setzero_ps()));
+  qx = _mm_cvtps_epi32(_mm_mul_ps(px, _mm_set1_ps(scale)));
+  qy = _mm_cvtps_epi32(_mm_mul_ps(py, _mm_set1_ps(scale)));
+}
+
+// Unit vectors of four pairs of sign-extended octahedral coordinates.
+inline void oct_decode4(__m128i qx, __m128i qy, float scale, __m128& x,
+                        __m128& y, __m128& z) {
+  const __m128 sign = _mm_set1_ps(-0.f);
+  const __m128 minus_one = _mm_set1_ps(-1.f);
+  __m128 inv_scale = _mm_set1_ps(1.f / scale);
+  x = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(qx), inv_scale), minus_one);
+  y = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(qy), inv_scale), minus_one);
+  z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.f), _mm_andnot_ps(sign, x)),
+                 _mm_andnot_ps(sign, y));
+  fold4(x, y, _mm_cmplt_ps(z, _mm_setzero_ps()));
+  __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                           _mm_mul_ps(z, z));
+  __m128 inv = _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(len2));
+  x = _mm_mul_ps(x, inv);
+  y = _mm_mul_ps(y, inv);
+  z = _mm_mul_ps(z, inv);
+}
+
+inline void load4(const Normal3f* n, __m128& x, __m128& y, __m128& z) {
+  alignas(16) float fx[4], fy[4], fz[4];
+  for (int i = 0; i < 4; ++i) {
+    fx[i] = n[i].x();
+    fy[i] = n[i].y();
+    fz[i] = n[i].z();
+  }
+  x = _mm_load_ps(fx);
+  y = _mm_load_ps(fy);
+  z = _mm_load_ps(fz);
+}
+
+inline void store4(__m128 x, __m128 y, __m128 z, Normal3f* n) {
+  alignas(16) float fx[4], fy[4], fz[4];
+  _mm_store_ps(fx, x);
+  _mm_store_ps(fy, y);
+  _mm_store_ps(fz, z);
+  for (int i = 0; i < 4; ++i) n[i] = Normal3f(fx[i], fy[i], fz[i]);
+}
+
+#endif  // MATH_PACKED_NORMAL_SSE2
+
+}  // namespace detail
+
+template <typename U>
+void pack(std::span<const Normal3f> normals, std::span<PackedNormal<U>> out) {
+  if (out.size() < normals.size()) {
+    throw std::out_of_range("Output span is too small");
+  }
+  std::size_t i = 0;
+#ifdef MATH_PACKED_NORMAL_SSE2
+  constexpr float scale = PackedNormal<U>::kMax;
+  for (; i + 4 <= normals.size(); i += 4) {
+    __m128 x, y, z;
+    __m128i qx, qy;
+    detail::load4(&normals[i], x, y, z);
+    detail::oct_encode4(x, y, z, scale, qx, qy);
+    alignas(16) uint32_t bits[4];
+    if constexpr (sizeof(U) == 4) {
+      __m128i lo = _mm_and_si128(qx, _mm_set1_epi32(0xffff));
+      _mm_store_si128(reinterpret_cast<__m128i*>(bits),
+                      _mm_or_si128(lo, _mm_slli_epi32(qy, 16)));
+    } else {
+      __m128i lo = _mm_and_si128(qx, _mm_set1_epi32(0xff));
+      __m128i hi = _mm_slli_epi32(_mm_and_si128(qy, _mm_set1_epi32(0xff)), 8);
+      _mm_store_si128(reinterpret_cast<__m128i*>(bits), _mm_or_si128(lo, hi));
+    }
+    for (int k = 0; k < 4; ++k) {
+      out[i + k] = PackedNormal<U>::from_bits(static_cast<U>(bits[k]));
+    }
+  }
+#endif
+  for (; i < normals.size(); ++i) out[i] = PackedNormal<U>(normals[i]);
+}
+
+template <typename U>
+void unpack(std::span<const PackedNormal<U>> packed, std::span<Normal3f> out) {
+  if (out.size() < packed.size()) {
+    throw std::out_of_range("Output span is too small");
+  }
+  std::size_t i = 0;
+#ifdef MATH_PACKED_NORMAL_SSE2
+  constexpr float scale = PackedNormal<U>::kMax;
+  for (; i + 4 <= packed.size(); i += 4) {
+    alignas(16) uint32_t bits[4];
+    for (int k = 0; k < 4; ++k) bits[k] = packed[i + k].bits();
+    __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(bits));
+    __m128i qx, qy;
+    if constexpr (sizeof(U) == 4) {
+      qx = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+      qy = _mm_srai_epi32(b, 16);
+    } else {
+      qx = _mm_srai_epi32(_mm_slli_epi32(b, 24), 24);
+      qy = _mm_srai_epi32(_mm_slli_epi32(b, 16), 24);
+    }
+    __m128 x, y, z;
+    detail::oct_decode4(qx, qy, scale, x, y, z);
+    detail::store4(x, y, z, &out[i]);
+  }
+#endif
+  for (; i < packed.size(); ++i) out[i] = packed[i].unpack();
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATH_PACKED_QUAT_SSE2 1
+#endif
+
+#include "quat.h"
+
+//--------------------------------------------
+// Smallest-three quaternion encoding
+//--------------------------------------------
+//
+// A unit quaternion is stored as the index of its largest component (2 bits)
+// and the other three as snorm integers. The largest is made positive by
+// negating the whole quaternion, which is the same rotation, and recomputed
+// on decode as sqrt(1 - a^2 - b^2 - c^2). The other three lie in
+// [-1/sqrt(2), 1/sqrt(2)], which is the range the integers cover:
+//
+//   PackedQuat32   3 x 10 bits + 2, 4 bytes   max error 0.26 degrees
+//   PackedQuat48   3 x 15 bits + 2, 6 bytes   max error 0.0085 degrees
+//
+// against 16 bytes for a Quat. The error bounds are the largest rotation
+// angle between a unit quaternion and its round trip, measured on random
+// rotations (see packed_quat_test.cpp). Input is normalized before packing,
+// and unpacking returns a unit quaternion with w >= 0 when w is the largest
+// component.
+
+template <int N>
+  requires(N == 10 || N == 15)
+class PackedQuat {
+ public:
+  // Six bytes rather than a padded uint64_t for the 48-bit encoding.
+  using storage_type =
+      std::conditional_t<N == 10, uint32_t, std::array<uint16_t, 3>>;
+  static constexpr int kBits = N;  // per stored component
+  static constexpr int kMax = (1 << (N - 1)) - 1;
+  static constexpr float kScale = kMax * 1.41421356f;
+
+  PackedQuat() = default;
+  explicit PackedQuat(const Quat& q) { set_bits(encode(q)); }
+
+  static PackedQuat from_bits(uint64_t bits) {
+    PackedQuat p;
+    p.set_bits(bits);
+    return p;
+  }
+
+  // The 32 or 47 used bits: a | b << N | c << 2N | index << 3N.
+  uint64_t bits() const {
+    if constexpr (N == 10) {
+      return m_bits;
+    } else {
+      return m_bits[0] | uint64_t{m_bits[1]} << 16 |
+             uint64_t{m_bits[2]} << 32;
+    }
+  }
+
+  Quat unpack() const { return decode(bits()); }
+
+  explicit operator Quat() const { return unpack(); }
+
+  bool operator==(const PackedQuat&) const = default;
+
+  static uint64_t encode(const Quat& q) {
+    Quat n = normalized(q);
+    float c[4] = {n.x(), n.y(), n.z(), n.w()};
+    int largest = 0;
+    for (int i = 1; i < 4; ++i) {
+      if (std::fabs(c[i]) > std::fabs(c[largest])) largest = i;
+    }
+    float sign = c[largest] < 0.f ? -1.f : 1.f;
+    uint64_t bits = uint64_t(largest) << (3 * N);
+    for (int i = 0, k = 0; i < 4; ++i) {
+      if (i == largest) continue;
+      long code = std::lrint(c[i] * sign * kScale);
+      code = code < -kMax ? -kMax : code > kMax ? kMax : code;
+      bits |= uint64_t(code + kMax) << (k++ * N);
+    }
+    return bits;
+  }
+
+  static Quat decode(uint64_t bits) {
+    constexpr uint64_t kMask = (uint64_t{1} << N) - 1;
+    float c[3];
+    for (int k = 0; k < 3; ++k) {
+      auto q = static_cast<int>((bits >> (k * N)) & kMask) - kMax;
+      c[k] = static_cast<float>(q) * (1.f / kScale);
+    }
+    float d2 = 1.f - c[0] * c[0] - c[1] * c[1] - c[2] * c[2];
+    float d = std::sqrt(d2 > 0.f ? d2 : 0.f);  // as _mm_max_ps(d2, 0)
+    switch (bits >> (3 * N)) {
+      case 0:
+        return Quat(d, c[0], c[1], c[2]);
+      case 1:
+        return Quat(c[0], d, c[1], c[2]);
+      case 2:
+        return Quat(c[0], c[1], d, c[2]);
+      default:
+        return Quat(c[0], c[1], c[2], d);
+    }
+  }
+
+ private:
+  void set_bits(uint64_t bits) {
+    if constexpr (N == 10) {
+      m_bits = static_cast<uint32_t>(bits);
+    } else {
+      m_bits = {static_cast<uint16_t>(bits),
+                static_cast<uint16_t>(bits >> 16),
+                static_cast<uint16_t>(bits >> 32)};
+    }
+  }
+
+  storage_type m_bits{};
+};
+
+using PackedQuat32 = PackedQuat<10>;
+using PackedQuat48 = PackedQuat<15>;
+
+static_assert(sizeof(PackedQuat32) == 4 && sizeof(PackedQuat48) == 6);
+static_assert(sizeof(Quat) == 4 * sizeof(float));
+
+//--------------------------------------------
+// Batch conversion
+//--------------------------------------------
+// unpack() decodes four quaternions at a time with SSE2, with the same
+// results as the scalar decode; pack() is the scalar encode in a loop.
+
+template <int N>
+void pack(std::span<const Quat> quats, std::span<PackedQuat<N>> out) {
+  if (out.size() < quats.size()) {
+    throw std::out_of_range("Output span is too small");
+  }
+  for (std::size_t i = 0; i < quats.size(); ++i) {
+    out[i] = PackedQuat<N>(quats[i]);
+  }
+}
+
+namespace detail {
+
+#ifdef MATH_PACKED_QUAT_SSE2
+
+// Four packed values split into their three codes and the index, one lane
+// per quaternion.
+template <int N>
+void load4(const PackedQuat<N>* p, __m128i& a, __m128i& b, __m128i& c,
+           __m128i& index) {
+  const __m128i mask = _mm_set1_epi32((1 << N) - 1);
+  if constexpr (N == 10) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    a = _mm_and_si128(v, mask);
+    b = _mm_and_si128(_mm_srli_epi32(v, N), mask);
+    c = _mm_and_si128(_mm_srli_epi32(v, 2 * N), mask);
+    index = _mm_srli_epi32(v, 3 * N);
+  } else {
+    // 24 bytes: the low 32 bits of each value in one vector, the high 16 in
+    // another, then the fields that straddle the two are stitched together.
+    alignas(16) uint32_t lo[4], hi[4];
+    const auto* words = reinterpret_cast<const uint16_t*>(p);
+    for (int k = 0; k < 4; ++k) {
+      lo[k] = words[3 * k] | uint32_t{words[3 * k + 1]} << 16;
+      hi[k] = words[3 * k + 2];
+    }
+    __m128i vl = _mm_load_si128(reinterpret_cast<const __m128i*>(lo));
+    __m128i vh = _mm_load_si128(reinterpret_cast<const __m128i*>(hi));
+    a = _mm_and_si128(vl, mask);
+    b = _mm_and_si128(_mm_srli_epi32(vl, N), mask);
+    __m128i straddle = _mm_or_si128(_mm_srli_epi32(vl, 2 * N),
+                                    _mm_slli_epi32(vh, 32 - 2 * N));
+    c = _mm_and_si128(straddle, mask);
+    index = _mm_srli_epi32(vh, 3 * N - 32);
+  }
+}
+
+inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+template <int N>
+void unpack4(const PackedQuat<N>* p, Quat* out) {
+  const __m128i bias = _mm_set1_epi32(PackedQuat<N>::kMax);
+  const __m128 scale = _mm_set1_ps(1.f / PackedQuat<N>::kScale);
+  __m128i qa, qb, qc, index;
+  load4(p, qa, qb, qc, index);
+  __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(qa, bias)), scale);
+  __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(qb, bias)), scale);
+  __m128 c = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(qc, bias)), scale);
+  __m128 d2 = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.f),
+                                               _mm_mul_ps(a, a)),
+                                    _mm_mul_ps(b, b)),
+                         _mm_mul_ps(c, c));
+  __m128 d = _mm_sqrt_ps(_mm_max_ps(d2, _mm_setzero_ps()));
+
+  // The stored three fill the slots around the largest one in order.
+  __m128 is0 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(0)));
+  __m128 is1 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(1)));
+  __m128 is2 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(2)));
+  __m128 is3 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(3)));
+  __m128 x = select(is0, d, a);
+  __m128 y = select(is0, a, select(is1, d, b));
+  __m128 z = select(is2, d, select(is3, c, b));
+  __m128 w = select(is3, d, c);
+
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+  auto dst = reinterpret_cast<float*>(out);
+  _mm_storeu_ps(dst, x);
+  _mm_storeu_ps(dst + 4, y);
+  _mm_storeu_ps(dst + 8, z);
+  _mm_storeu_ps(dst + 12, w);
+}
+
+#endif  // MATH_PACKED_QUAT_SSE2
+
+}  // namespace detail
+
+template <int N>
+void unpack(std::span<const PackedQuat<N>> packed, std::span<Quat> out) {
+  if (out.size() < packed.size()) {
+    throw std::out_of_range("Output span is too small");
+  }
+  std::size_t i = 0;
+#ifdef MATH_PACKED_QUAT_SSE2
+  for (; i + 4 <= packed.size(); i += 4) {
+    detail::unpack4(&packed[i], &out[i]);
+  }
+#endif
+  for (; i < packed.size(); ++i) out[i] = packed[i].unpack();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <sstream>
+#include <iostream>
+#include <stdexcept>
 
 #include "types.h"
 
@@ -70,7 +71,10 @@ class Point3 {
     return Vec3<T>(m_x - p.m_x, m_y - p.m_y, m_z - p.m_z);
   }
 
-  bool is_zero() const { return *this == Point3<T>(T{0}, T{0}, T{0}); }
+  // Per lane for SIMD lanes.
+  mask_t<T> is_zero() const {
+    return mask_t<T>((m_x == T{0}) & (m_y == T{0}) & (m_z == T{0}));
+  }
 
  private:
   T m_x = T{0};
@@ -86,12 +90,6 @@ using Point3d = Point3<double>;
 // Overloaded I/O operators (input, output)
 //--------------------------------------------
 
-template <numeric T>
-std::stringstream &operator<<(std::stringstream &out, const Point3<T> &p) {
-  out << "(" << p.x() << "," << p.y() << "," << p.z() << ")";
-  return out;
-}
-
 template <numeric T>
 std::ostream &operator<<(std::ostream &out, const Point3<T> &p) {
   out << "(" << p.x() << "," << p.y() << "," << p.z() << ")";
@@ -126,3 +124,23 @@ template <numeric T>
 Point3<T> operator*(T num, const Point3<T> &p) {
   return p * num;
 }
+
+//--------------------------------------------
+// Explicit instantiation of the common aliases
+//--------------------------------------------
+// Expanded with `extern` here when MATH_EXTERN_TEMPLATES is defined (linking
+// math_instantiated does that) and without it in math_instantiated.cpp.
+
+#define MATH_INSTANTIATE_POINT3(EXTERN, T)                               \
+  EXTERN template class Point3<T>;                                       \
+  EXTERN template Vec3<T> operator-(const Vec3<T> &, const Point3<T> &); \
+  EXTERN template Vec3<T> operator+(const Vec3<T> &, const Point3<T> &); \
+  EXTERN template Point3<T> operator+(const Point3<T> &, T);             \
+  EXTERN template Point3<T> operator*(const Point3<T> &, T);             \
+  EXTERN template Point3<T> operator*(T, const Point3<T> &)
+
+#ifdef MATH_EXTERN_TEMPLATES
+MATH_INSTANTIATE_POINT3(extern, int);
+MATH_INSTANTIATE_POINT3(extern, float);
+MATH_INSTANTIATE_POINT3(extern, double);
+#endif
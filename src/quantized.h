@@ -0,0 +1,354 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__F16C__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATH_QUANTIZED_SSE2 1
+#endif
+
+#include "types.h"
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+
+//--------------------------------------------
+// Half-precision and normalized integer scalars
+//--------------------------------------------
+//
+// Storage types for memory-bound vertex and particle data. Each converts
+// implicitly to and from float and opts in to `numeric`, so Vec2/3/4 of them
+// are the usual vector templates: every operation converts its operands to
+// float, computes in float and rounds the result back on construction.
+//
+//   half      IEEE binary16, 2 bytes, 11 significant bits, |x| <= 65504
+//   unorm8    [0, 1] in steps of 1/255          unorm16   steps of 1/65535
+//   snorm8    [-1, 1] in steps of 1/127         snorm16   steps of 1/32767
+//
+// Conversion to half rounds to nearest even and overflows to infinity.
+// Conversion to the normalized types clamps to their range (NaN becomes the
+// lower end) and rounds to nearest even, so 1.f encodes to the largest code
+// and that code decodes to exactly 1.f. Chains of operations on these
+// vectors round after every step and saturate at the type's range (so
+// does length(), which returns T); convert to Vec3f (see convert() below)
+// for anything longer than a blend or an accumulation.
+
+namespace detail {
+
+// Software conversions (Giesen, "half <-> float conversions", 2012), used
+// when the target has no F16C.
+inline uint16_t float_to_half_bits(float value) {
+#ifdef __F16C__
+  return static_cast<uint16_t>(_cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT));
+#else
+  constexpr uint32_t kInfinity = 255u << 23;
+  constexpr uint32_t kOverflow = (127u + 16u) << 23;  // 65536.f
+  constexpr uint32_t kMinNormal = 113u << 23;         // 2^-14
+  constexpr uint32_t kDenormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+  uint32_t f = std::bit_cast<uint32_t>(value);
+  uint32_t sign = f & 0x80000000u;
+  f ^= sign;
+  uint32_t h;
+  if (f >= kOverflow) {
+    // Infinity, or a quiet NaN keeping the top of the payload like F16C.
+    h = f > kInfinity ? 0x7e00u | ((f >> 13) & 0x3ffu) : 0x7c00u;
+  } else if (f < kMinNormal) {
+    // Adding the magic number shifts the subnormal result into the low
+    // mantissa bits, with the FPU doing the rounding.
+    float sum = std::bit_cast<float>(f) + std::bit_cast<float>(kDenormMagic);
+    h = std::bit_cast<uint32_t>(sum) - kDenormMagic;
+  } else {
+    uint32_t odd = (f >> 13) & 1u;
+    f += ((15u - 127u) << 23) + 0xfffu + odd;
+    h = f >> 13;
+  }
+  return static_cast<uint16_t>(h | sign >> 16);
+#endif
+}
+
+inline float half_bits_to_float(uint16_t bits) {
+#ifdef __F16C__
+  return _cvtsh_ss(bits);
+#else
+  constexpr uint32_t kExponent = 0x7c00u << 13;
+  constexpr float kMagic = std::bit_cast<float>(113u << 23);
+  uint32_t f = (bits & 0x7fffu) << 13;
+  uint32_t exponent = f & kExponent;
+  f += (127u - 15u) << 23;
+  if (exponent == kExponent) {
+    f += (128u - 16u) << 23;  // infinity or NaN
+  } else if (exponent == 0) {
+    f = std::bit_cast<uint32_t>(std::bit_cast<float>(f + (1u << 23)) - kMagic);
+  }
+  return std::bit_cast<float>(f | (bits & 0x8000u) << 16);
+#endif
+}
+
+}  // namespace detail
+
+class half {
+ public:
+  half() = default;
+  half(float value) : m_bits{detail::float_to_half_bits(value)} {}
+
+  static half from_bits(uint16_t bits) {
+    half h;
+    h.m_bits = bits;
+    return h;
+  }
+
+  uint16_t bits() const { return m_bits; }
+
+  operator float() const { return detail::half_bits_to_float(m_bits); }
+
+  half& operator+=(float f) { return *this = *this + f; }
+  half& operator-=(float f) { return *this = *this - f; }
+  half& operator*=(float f) { return *this = *this * f; }
+  half& operator/=(float f) { return *this = *this / f; }
+
+ private:
+  uint16_t m_bits = 0;
+};
+
+template <typename I>
+  requires std::is_same_v<I, uint8_t> || std::is_same_v<I, int8_t> ||
+           std::is_same_v<I, uint16_t> || std::is_same_v<I, int16_t>
+class Normalized {
+ public:
+  using storage_type = I;
+  static constexpr float kMax = std::numeric_limits<I>::max();
+  static constexpr float kMin = std::is_signed_v<I> ? -1.f : 0.f;
+
+  Normalized() = default;
+  Normalized(float value) : m_bits{encode(value)} {}
+
+  static Normalized from_bits(I bits) {
+    Normalized n;
+    n.m_bits = bits;
+    return n;
+  }
+
+  I bits() const { return m_bits; }
+
+  // The most negative snorm code is clamped to -1, as in D3D and Vulkan.
+  operator float() const {
+    float f = static_cast<float>(m_bits) / kMax;
+    return f > kMin ? f : kMin;
+  }
+
+  Normalized& operator+=(float f) { return *this = *this + f; }
+  Normalized& operator-=(float f) { return *this = *this - f; }
+  Normalized& operator*=(float f) { return *this = *this * f; }
+  Normalized& operator/=(float f) { return *this = *this / f; }
+
+  // Written as the selects _mm_max_ps/_mm_min_ps perform, so the batch
+  // conversion below gives the same codes, NaN included.
+  static I encode(float value) {
+    value = value > kMin ? value : kMin;
+    value = value < 1.f ? value : 1.f;
+    return static_cast<I>(std::lrint(value * kMax));
+  }
+
+ private:
+  I m_bits = 0;
+};
+
+using unorm8 = Normalized<uint8_t>;
+using snorm8 = Normalized<int8_t>;
+using unorm16 = Normalized<uint16_t>;
+using snorm16 = Normalized<int16_t>;
+
+template <>
+inline constexpr bool is_storage_scalar<half> = true;
+template <typename I>
+inline constexpr bool is_storage_scalar<Normalized<I>> = true;
+
+template <typename T>
+concept storage_scalar = is_storage_scalar<T>;
+
+static_assert(sizeof(half) == 2 && sizeof(unorm8) == 1 &&
+              sizeof(snorm16) == 2);
+
+using Vec2h = Vec2<half>;
+using Vec3h = Vec3<half>;
+using Vec4h = Vec4<half>;
+
+//--------------------------------------------
+// Batch conversion
+//--------------------------------------------
+// Same results as converting one value at a time. Halves go through F16C,
+// 8 per instruction, or AVX-512F, 16 per instruction, when the target has
+// them (-mf16c, -mavx512f or a matching -march); the normalized types use
+// SSE2, 8 values per iteration.
+
+namespace detail {
+
+inline void check_output(std::size_t in, std::size_t out) {
+  if (out < in) throw std::out_of_range("Output span is too small");
+}
+
+inline void to_float(const half* in, float* out, std::size_t n) {
+  std::size_t i = 0;
+  auto bits = reinterpret_cast<const uint16_t*>(in);
+#ifdef __AVX512F__
+  for (; i + 16 <= n; i += 16) {
+    __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits + i));
+    _mm512_storeu_ps(out + i, _mm512_cvtph_ps(h));
+  }
+#endif
+#ifdef __F16C__
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bits + i));
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+  }
+#endif
+  for (; i < n; ++i) out[i] = half_bits_to_float(bits[i]);
+}
+
+inline void from_float(const float* in, half* out, std::size_t n) {
+  std::size_t i = 0;
+  auto bits = reinterpret_cast<uint16_t*>(out);
+#ifdef __AVX512F__
+  for (; i + 16 <= n; i += 16) {
+    __m256i h = _mm512_cvtps_ph(_mm512_loadu_ps(in + i),
+                                _MM_FROUND_TO_NEAREST_INT);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(bits + i), h);
+  }
+#endif
+#ifdef __F16C__
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i),
+                                _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bits + i), h);
+  }
+#endif
+  for (; i < n; ++i) bits[i] = float_to_half_bits(in[i]);
+}
+
+#ifdef MATH_QUANTIZED_SSE2
+
+// Eight codes widened to two vectors of four 32-bit integers.
+template <typename I>
+void load8(const I* in, __m128i& lo, __m128i& hi) {
+  __m128i v;
+  if constexpr (sizeof(I) == 1) {
+    v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in));
+    // Bytes into the high half of each 16-bit lane, then shifted down.
+    v = std::is_signed_v<I> ? _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8)
+                            : _mm_unpacklo_epi8(v, _mm_setzero_si128());
+  } else {
+    v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+  }
+  if constexpr (std::is_signed_v<I>) {
+    lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+  } else {
+    lo = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+    hi = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+  }
+}
+
+// Eight in-range 32-bit integers narrowed to codes.
+template <typename I>
+void store8(__m128i lo, __m128i hi, I* out) {
+  auto dst = reinterpret_cast<__m128i*>(out);
+  if constexpr (std::is_same_v<I, uint16_t>) {
+    // No unsigned 32 -> 16 bit pack in SSE2: bias into the signed range.
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    __m128i v = _mm_packs_epi32(_mm_sub_epi32(lo, bias),
+                                _mm_sub_epi32(hi, bias));
+    _mm_storeu_si128(dst, _mm_xor_si128(v, _mm_set1_epi16(-0x8000)));
+  } else if constexpr (std::is_same_v<I, int16_t>) {
+    _mm_storeu_si128(dst, _mm_packs_epi32(lo, hi));
+  } else {
+    __m128i v = _mm_packs_epi32(lo, hi);
+    v = std::is_signed_v<I> ? _mm_packs_epi16(v, v) : _mm_packus_epi16(v, v);
+    _mm_storel_epi64(dst, v);
+  }
+}
+
+#endif  // MATH_QUANTIZED_SSE2
+
+template <typename I>
+void to_float(const Normalized<I>* in, float* out, std::size_t n) {
+  std::size_t i = 0;
+  auto codes = reinterpret_cast<const I*>(in);
+#ifdef MATH_QUANTIZED_SSE2
+  const __m128 max = _mm_set1_ps(Normalized<I>::kMax);
+  const __m128 min = _mm_set1_ps(Normalized<I>::kMin);
+  for (; i + 8 <= n; i += 8) {
+    __m128i lo, hi;
+    load8(codes + i, lo, hi);
+    _mm_storeu_ps(out + i, _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(lo), max),
+                                      min));
+    _mm_storeu_ps(out + i + 4,
+                  _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(hi), max), min));
+  }
+#endif
+  for (; i < n; ++i) out[i] = in[i];
+}
+
+template <typename I>
+void from_float(const float* in, Normalized<I>* out, std::size_t n) {
+  std::size_t i = 0;
+  auto codes = reinterpret_cast<I*>(out);
+#ifdef MATH_QUANTIZED_SSE2
+  const __m128 max = _mm_set1_ps(Normalized<I>::kMax);
+  const __m128 min = _mm_set1_ps(Normalized<I>::kMin);
+  const __m128 one = _mm_set1_ps(1.f);
+  auto quantize = [&](__m128 v) {
+    v = _mm_min_ps(_mm_max_ps(v, min), one);
+    return _mm_cvtps_epi32(_mm_mul_ps(v, max));
+  };
+  for (; i + 8 <= n; i += 8) {
+    store8(quantize(_mm_loadu_ps(in + i)), quantize(_mm_loadu_ps(in + i + 4)),
+           codes + i);
+  }
+#endif
+  for (; i < n; ++i) codes[i] = Normalized<I>::encode(in[i]);
+}
+
+}  // namespace detail
+
+// Scalars: out must hold at least in.size() values.
+template <storage_scalar S>
+void convert(std::span<const S> in, std::span<float> out) {
+  detail::check_output(in.size(), out.size());
+  detail::to_float(in.data(), out.data(), in.size());
+}
+
+template <storage_scalar S>
+void convert(std::span<const float> in, std::span<S> out) {
+  detail::check_output(in.size(), out.size());
+  detail::from_float(in.data(), out.data(), in.size());
+}
+
+// Whole vectors, e.g. Vec3h to Vec3f and back. The components of an array of
+// vectors are contiguous, so this is one scalar conversion of 2, 3 or 4
+// times the length.
+template <template <typename> class V, storage_scalar S>
+void convert(std::span<const V<S>> in, std::span<V<float>> out) {
+  constexpr std::size_t kSize = sizeof(V<float>) / sizeof(float);
+  static_assert(sizeof(V<S>) == kSize * sizeof(S));
+  detail::check_output(in.size(), out.size());
+  detail::to_float(reinterpret_cast<const S*>(in.data()),
+                   reinterpret_cast<float*>(out.data()), in.size() * kSize);
+}
+
+template <template <typename> class V, storage_scalar S>
+void convert(std::span<const V<float>> in, std::span<V<S>> out) {
+  constexpr std::size_t kSize = sizeof(V<float>) / sizeof(float);
+  static_assert(sizeof(V<S>) == kSize * sizeof(S));
+  detail::check_output(in.size(), out.size());
+  detail::from_float(reinterpret_cast<const float*>(in.data()),
+                     reinterpret_cast<S*>(out.data()), in.size() * kSize);
+}
@@ -116,6 +116,29 @@ inline Quat normalized(const Quat& q) {
   return Quat(q.x() * inv, q.y() * inv, q.z() * inv, q.w() * inv);
 }
 
+// Interpolation along the shorter arc; q and -q are the same rotation.
+// nlerp is a normalized lerp: cheap, exact at the ends, but its angular
+// speed is not constant across the arc.
+inline Quat nlerp(const Quat& q1, const Quat& q2, float t) {
+  Quat to = dot(q1, q2) < 0.f ? -q2 : q2;
+  return normalized(q1 + (to - q1) * t);
+}
+
+inline Quat slerp(const Quat& q1, const Quat& q2, float t) {
+  auto cos_theta = dot(q1, q2);
+  Quat to = q2;
+  if (cos_theta < 0.f) {
+    to = -q2;
+    cos_theta = -cos_theta;
+  }
+  // sin(theta) vanishes for nearly equal rotations; nlerp is exact enough.
+  if (cos_theta > 0.9995f) return nlerp(q1, to, t);
+  auto theta = acosf(cos_theta);
+  auto inv_sin = 1.f / sinf(theta);
+  return q1 * (sinf((1.f - t) * theta) * inv_sin) +
+         to * (sinf(t * theta) * inv_sin);
+}
+
 inline Quat angle_axis(float angle, const Vec3f& axis) {
   Vec3f norm = normalized(axis);
   auto s = sinf(angle * 0.5f);
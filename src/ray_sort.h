@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "point3.h"
+#include "ray.h"
+#include "spatial_sort.h"
+#include "thread_pool.h"
+#include "vec3.h"
+#include "wavefront.h"
+
+//--------------------------------------------
+// Ray reordering for coherent traversal
+//--------------------------------------------
+//
+// Secondary rays leave surfaces in every direction, so consecutive rays of
+// a batch touch unrelated parts of an acceleration structure. Sorting them
+// by a key that is close for rays with close origins and directions, as in
+// Garanzha and Loop, "Fast Ray Sorting and Breadth-First Packet Traversal
+// for GPU Ray Tracing" (2010), makes neighbouring rays walk mostly the same
+// nodes while those are in cache.
+//
+// The key, 39 bits from the top:
+//
+//   3 bits   direction octant (sign of x, y, z)
+//   24 bits  Morton code of the origin on a 256^3 grid over scene bounds
+//   12 bits  Morton code of the direction on a 64^2 grid within the octant
+//            (octahedral projection)
+//
+// and is sorted with radix_sort(), which skips the 3 unused top bytes.
+
+constexpr int kRayOriginBits = 8;     // per axis
+constexpr int kRayDirectionBits = 6;  // per axis of the octahedral map
+
+// Sort key of a ray; origins outside bounds are clamped to it.
+inline uint64_t ray_sort_key(const Point3f& origin, const Vec3f& direction,
+                             const AABBf& bounds) {
+  constexpr float kOriginCells = 1 << kRayOriginBits;
+  constexpr float kDirectionCells = 1 << kRayDirectionBits;
+  auto cell = [](float v, float cells) {
+    return static_cast<uint32_t>(std::clamp(v * cells, 0.f, cells - 1.f));
+  };
+  Vec3f extent = bounds.extent();
+  auto origin_cell = [&](float o, float lo, float size) {
+    return size > 0.f ? cell((o - lo) / size, kOriginCells) : 0u;
+  };
+  uint64_t at = morton_key(
+      origin_cell(origin.x(), bounds.min().x(), extent.x()),
+      origin_cell(origin.y(), bounds.min().y(), extent.y()),
+      origin_cell(origin.z(), bounds.min().z(), extent.z()));
+
+  float ax = std::abs(direction.x()), ay = std::abs(direction.y());
+  float l1 = ax + ay + std::abs(direction.z());
+  uint64_t toward = 0;
+  if (l1 > 0.f) {
+    uint32_t u = cell(ax / l1, kDirectionCells);
+    uint32_t v = cell(ay / l1, kDirectionCells);
+    for (int bit = 0; bit < kRayDirectionBits; ++bit) {
+      toward |= uint64_t{(u >> bit & 1u) | (v >> bit & 1u) << 1} << 2 * bit;
+    }
+  }
+  uint64_t octant = (direction.x() < 0.f ? 1u : 0u) |
+                    (direction.y() < 0.f ? 2u : 0u) |
+                    (direction.z() < 0.f ? 4u : 0u);
+  return octant << (3 * kRayOriginBits + 2 * kRayDirectionBits) |
+         at << (2 * kRayDirectionBits) | toward;
+}
+
+// Sorts batches of rays by ray_sort_key(). Keeps its buffers between
+// calls, so sorting the same amount of rays again allocates nothing but
+// radix_sort()'s scratch.
+class RaySorter {
+ public:
+  // Sorts the live paths of queue, payload and all; `bounds` is usually
+  // that of the scene.
+  void sort(RayQueue& queue, const AABBf& bounds, ThreadPool& pool) {
+    std::size_t n = queue.count;
+    compute_order(n, pool, [&](std::size_t i) {
+      return ray_sort_key(Point3f(queue.ox[i], queue.oy[i], queue.oz[i]),
+                          Vec3f(queue.dx[i], queue.dy[i], queue.dz[i]),
+                          bounds);
+    });
+    m_queue.resize(n);
+    parallel_for(pool, 0, n, kGrain, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        m_queue.copy(i, queue, m_order[i]);
+      }
+    });
+    std::swap(queue, m_queue);
+  }
+
+  void sort(RayQueue& queue, const AABBf& bounds) {
+    sort(queue, bounds, default_thread_pool());
+  }
+
+  // Sorts rays in place; order() then maps every position to the ray's
+  // former index, to put results back or reorder other arrays with
+  // gather().
+  void sort(std::span<Ray> rays, const AABBf& bounds, ThreadPool& pool) {
+    compute_order(rays.size(), pool, [&](std::size_t i) {
+      return ray_sort_key(rays[i].origin(), rays[i].direction(), bounds);
+    });
+    m_rays.resize(rays.size());
+    std::copy(rays.begin(), rays.end(), m_rays.begin());
+    gather(order(), std::span<const Ray>(m_rays), rays, pool);
+  }
+
+  void sort(std::span<Ray> rays, const AABBf& bounds) {
+    sort(rays, bounds, default_thread_pool());
+  }
+
+  // Former index of each entry after the last sort.
+  std::span<const uint32_t> order() const { return m_order; }
+
+ private:
+  static constexpr std::size_t kGrain = std::size_t{1} << 12;
+
+  template <typename Key>
+  void compute_order(std::size_t n, ThreadPool& pool, Key key) {
+    if (n >= UINT32_MAX) throw std::length_error("Too many rays to sort");
+    m_keys.resize(n);
+    m_order.resize(n);
+    parallel_for(pool, 0, n, kGrain, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        m_keys[i] = key(i);
+        m_order[i] = static_cast<uint32_t>(i);
+      }
+    });
+    radix_sort(std::span(m_keys), std::span(m_order), pool);
+  }
+
+  std::vector<uint64_t> m_keys;
+  std::vector<uint32_t> m_order;
+  RayQueue m_queue;
+  std::vector<Ray> m_rays;
+};
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+#if defined(__AVX__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATH_SIMD_SSE2 1
+#endif
+
+// GCC and Clang vector extensions, unless MATH_SIMD_PORTABLE asks for the
+// plain array fallback.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(MATH_SIMD_PORTABLE)
+#define MATH_SIMD_VECTOR_EXTENSIONS 1
+#endif
+
+#include "types.h"
+
+//--------------------------------------------
+// SIMD lanes
+//--------------------------------------------
+//
+// Simd<T, N> holds N floats or doubles and computes on all of them at once.
+// It opts in to `numeric`, so Vec3<Simd<float, 8>> is a packet of eight
+// vectors on which dot(), cross(), normalized(), reflect() and the Mat4
+// operations run the same source as for Vec3f, one vector per lane:
+//
+//   Vec3<Simd8f> n(Simd8f::load(nx), Simd8f::load(ny), Simd8f::load(nz));
+//   Vec3<Simd8f> r = reflect(d, normalized(n));
+//
+// Comparisons give a SimdMask<T, N>, one flag per lane. Where scalar code
+// branches, lane-generic code selects, select(mask, a, b), or reduces the
+// mask with any(), all() or none(); types.h has the bool overloads.
+//
+// With GCC and Clang the lanes are a vector extension type that the
+// compiler maps onto the target: one SSE, AVX or AVX-512 register for 16,
+// 32 or 64 bytes, several for wider types, scalar code without SIMD. sqrt()
+// and the mask reductions use intrinsics of the widest instruction set
+// enabled. Other compilers get an array and loops over it.
+//
+// kSimdBytes is the width of the target's registers; Simdf and Simdd fill
+// one.
+
+#if defined(__AVX512F__)
+inline constexpr int kSimdBytes = 64;
+#elif defined(__AVX__)
+inline constexpr int kSimdBytes = 32;
+#else
+inline constexpr int kSimdBytes = 16;
+#endif
+
+template <typename T, int N>
+concept simd_lanes = (std::same_as<T, float> || std::same_as<T, double>) &&
+                     N > 0 && N <= 64 && (N & (N - 1)) == 0;
+
+template <typename T, int N>
+  requires simd_lanes<T, N>
+class Simd;
+
+namespace detail {
+
+// Integer lanes of the same width as T, as comparisons produce them: all
+// ones for true, zero for false.
+template <typename T>
+using simd_int_t = std::conditional_t<sizeof(T) == 4, int32_t, int64_t>;
+
+#ifdef MATH_SIMD_VECTOR_EXTENSIONS
+
+template <typename T, int N>
+struct SimdRegister {
+  typedef T type __attribute__((vector_size(N * sizeof(T))));
+};
+
+// These write through `out` so that no vector is passed or returned by
+// value, which GCC warns about for vectors wider than the target's.
+
+template <typename R, typename T>
+void broadcast(R& out, T value) {
+  out = R{} + value;
+}
+
+template <typename M, typename R>
+void blend(R& out, const M& mask, const R& a, const R& b) {
+  out = mask ? a : b;
+}
+
+#else
+
+template <typename T, int N>
+struct LaneArray {
+  T lane[N];
+
+  T operator[](int i) const { return lane[i]; }
+  T& operator[](int i) { return lane[i]; }
+};
+
+template <typename T, int N>
+struct SimdRegister {
+  using type = LaneArray<T, N>;
+};
+
+template <typename T, int N, typename F>
+auto lanewise(const LaneArray<T, N>& a, const LaneArray<T, N>& b, F f) {
+  LaneArray<decltype(f(a[0], b[0])), N> out;
+  for (int i = 0; i < N; ++i) out[i] = f(a[i], b[i]);
+  return out;
+}
+
+template <typename T, int N>
+LaneArray<T, N> operator-(const LaneArray<T, N>& a) {
+  return lanewise(a, a, [](T x, T) { return static_cast<T>(-x); });
+}
+
+template <typename T, int N>
+LaneArray<T, N> operator~(const LaneArray<T, N>& a) {
+  return lanewise(a, a, [](T x, T) { return static_cast<T>(~x); });
+}
+
+#define MATH_SIMD_LANEWISE(OP, EXPR)                                     \
+  template <typename T, int N>                                           \
+  auto operator OP(const LaneArray<T, N>& a, const LaneArray<T, N>& b) { \
+    return lanewise(a, b, [](T x, T y) { return EXPR; });                \
+  }
+
+MATH_SIMD_LANEWISE(+, T(x + y))
+MATH_SIMD_LANEWISE(-, T(x - y))
+MATH_SIMD_LANEWISE(*, T(x * y))
+MATH_SIMD_LANEWISE(/, T(x / y))
+MATH_SIMD_LANEWISE(&, T(x & y))
+MATH_SIMD_LANEWISE(|, T(x | y))
+MATH_SIMD_LANEWISE(^, T(x ^ y))
+MATH_SIMD_LANEWISE(==, simd_int_t<T>(x == y ? -1 : 0))
+MATH_SIMD_LANEWISE(!=, simd_int_t<T>(x != y ? -1 : 0))
+MATH_SIMD_LANEWISE(<, simd_int_t<T>(x < y ? -1 : 0))
+MATH_SIMD_LANEWISE(<=, simd_int_t<T>(x <= y ? -1 : 0))
+MATH_SIMD_LANEWISE(>, simd_int_t<T>(x > y ? -1 : 0))
+MATH_SIMD_LANEWISE(>=, simd_int_t<T>(x >= y ? -1 : 0))
+
+#undef MATH_SIMD_LANEWISE
+
+template <typename R, typename T>
+void broadcast(R& out, T value) {
+  for (auto& lane : out.lane) lane = value;
+}
+
+template <typename I, typename T, int N>
+void blend(LaneArray<T, N>& out, const LaneArray<I, N>& mask,
+           const LaneArray<T, N>& a, const LaneArray<T, N>& b) {
+  for (int i = 0; i < N; ++i) out[i] = mask[i] ? a[i] : b[i];
+}
+
+#endif
+
+// In place, with the widest square roots the target has.
+inline void sqrt_lanes(float* p, int n) {
+  int i = 0;
+#ifdef __AVX512F__
+  for (; i + 16 <= n; i += 16) {
+    _mm512_storeu_ps(p + i, _mm512_sqrt_ps(_mm512_loadu_ps(p + i)));
+  }
+#endif
+#ifdef __AVX__
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(p + i, _mm256_sqrt_ps(_mm256_loadu_ps(p + i)));
+  }
+#endif
+#ifdef MATH_SIMD_SSE2
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(p + i, _mm_sqrt_ps(_mm_loadu_ps(p + i)));
+  }
+#endif
+  for (; i < n; ++i) p[i] = std::sqrt(p[i]);
+}
+
+inline void sqrt_lanes(double* p, int n) {
+  int i = 0;
+#ifdef __AVX512F__
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(p + i, _mm512_sqrt_pd(_mm512_loadu_pd(p + i)));
+  }
+#endif
+#ifdef __AVX__
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(p + i, _mm256_sqrt_pd(_mm256_loadu_pd(p + i)));
+  }
+#endif
+#ifdef MATH_SIMD_SSE2
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(p + i, _mm_sqrt_pd(_mm_loadu_pd(p + i)));
+  }
+#endif
+  for (; i < n; ++i) p[i] = std::sqrt(p[i]);
+}
+
+// Bit i set if mask lane i is; lanes are all ones or zero, so the sign bit
+// decides, as movemask reads it.
+template <typename I>
+uint64_t mask_bits(const I* p, int n) {
+  uint64_t bits = 0;
+  int i = 0;
+#ifdef MATH_SIMD_SSE2
+  constexpr int kStep = 16 / sizeof(I);
+  for (; i + kStep <= n; i += kStep) {
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    int step = sizeof(I) == 4 ? _mm_movemask_ps(_mm_castsi128_ps(m))
+                              : _mm_movemask_pd(_mm_castsi128_pd(m));
+    bits |= uint64_t(step) << i;
+  }
+#endif
+  for (; i < n; ++i) bits |= uint64_t{p[i] < 0} << i;
+  return bits;
+}
+
+}  // namespace detail
+
+//--------------------------------------------
+// Masks
+//--------------------------------------------
+
+template <typename T, int N>
+  requires simd_lanes<T, N>
+class SimdMask {
+ public:
+  using int_type = detail::simd_int_t<T>;
+
+  // No lane set.
+  SimdMask() = default;
+  explicit SimdMask(bool value) {
+    detail::broadcast(m_v, int_type{value ? -1 : 0});
+  }
+
+  static constexpr int size() { return N; }
+
+  bool operator[](int i) const { return m_v[i] != 0; }
+
+  // Bit i set if lane i is.
+  uint64_t bits() const {
+    int_type lanes[N];
+    std::memcpy(lanes, &m_v, sizeof(lanes));
+    return detail::mask_bits(lanes, N);
+  }
+
+  friend SimdMask operator&(const SimdMask& a, const SimdMask& b) {
+    return SimdMask(a.m_v & b.m_v);
+  }
+  friend SimdMask operator|(const SimdMask& a, const SimdMask& b) {
+    return SimdMask(a.m_v | b.m_v);
+  }
+  friend SimdMask operator^(const SimdMask& a, const SimdMask& b) {
+    return SimdMask(a.m_v ^ b.m_v);
+  }
+  friend SimdMask operator!(const SimdMask& a) { return SimdMask(~a.m_v); }
+
+  SimdMask& operator&=(const SimdMask& o) { return *this = *this & o; }
+  SimdMask& operator|=(const SimdMask& o) { return *this = *this | o; }
+
+  friend bool any(const SimdMask& m) { return m.bits() != 0; }
+  friend bool all(const SimdMask& m) { return m.bits() == kAll; }
+  friend bool none(const SimdMask& m) { return m.bits() == 0; }
+
+ private:
+  friend class Simd<T, N>;
+  using Register = typename detail::SimdRegister<int_type, N>::type;
+  static constexpr uint64_t kAll = ~uint64_t{0} >> (64 - N);
+
+  // Comparisons may produce another integer type of the same width (long
+  // and long long); the bits are the same.
+  template <typename R>
+  explicit SimdMask(const R& lanes) {
+#ifdef MATH_SIMD_VECTOR_EXTENSIONS
+    m_v = (Register)lanes;
+#else
+    for (int i = 0; i < N; ++i) m_v[i] = static_cast<int_type>(lanes[i]);
+#endif
+  }
+
+  Register m_v{};
+};
+
+//--------------------------------------------
+// Lanes
+//--------------------------------------------
+
+template <typename T, int N>
+  requires simd_lanes<T, N>
+class Simd {
+ public:
+  using value_type = T;
+  using mask_type = SimdMask<T, N>;
+
+  // All lanes zero.
+  Simd() = default;
+  // All lanes `value`; implicit, so scalars mix with lanes as with T.
+  Simd(T value) { detail::broadcast(m_v, value); }
+
+  static constexpr int size() { return N; }
+
+  // N values from p, which need not be aligned.
+  static Simd load(const T* p) {
+    Simd s;
+    std::memcpy(&s.m_v, p, sizeof(s.m_v));
+    return s;
+  }
+
+  void store(T* p) const { std::memcpy(p, &m_v, sizeof(m_v)); }
+
+  T operator[](int i) const { return m_v[i]; }
+  void set(int i, T value) { m_v[i] = value; }
+
+  Simd operator+() const { return *this; }
+  Simd operator-() const { return Simd(-m_v); }
+
+  Simd& operator+=(const Simd& o) { return *this = *this + o; }
+  Simd& operator-=(const Simd& o) { return *this = *this - o; }
+  Simd& operator*=(const Simd& o) { return *this = *this * o; }
+  Simd& operator/=(const Simd& o) { return *this = *this / o; }
+
+  friend Simd operator+(const Simd& a, const Simd& b) {
+    return Simd(a.m_v + b.m_v);
+  }
+  friend Simd operator-(const Simd& a, const Simd& b) {
+    return Simd(a.m_v - b.m_v);
+  }
+  friend Simd operator*(const Simd& a, const Simd& b) {
+    return Simd(a.m_v * b.m_v);
+  }
+  friend Simd operator/(const Simd& a, const Simd& b) {
+    return Simd(a.m_v / b.m_v);
+  }
+
+  friend mask_type operator==(const Simd& a, const Simd& b) {
+    return to_mask(a.m_v == b.m_v);
+  }
+  friend mask_type operator!=(const Simd& a, const Simd& b) {
+    return to_mask(a.m_v != b.m_v);
+  }
+  friend mask_type operator<(const Simd& a, const Simd& b) {
+    return to_mask(a.m_v < b.m_v);
+  }
+  friend mask_type operator<=(const Simd& a, const Simd& b) {
+    return to_mask(a.m_v <= b.m_v);
+  }
+  friend mask_type operator>(const Simd& a, const Simd& b) {
+    return to_mask(a.m_v > b.m_v);
+  }
+  friend mask_type operator>=(const Simd& a, const Simd& b) {
+    return to_mask(a.m_v >= b.m_v);
+  }
+
+  //--------------------------------------------
+  // Lane-wise functions, found by argument-dependent lookup
+  //--------------------------------------------
+
+  // a where mask is set, b elsewhere.
+  friend Simd select(const mask_type& mask, const Simd& a, const Simd& b) {
+    Simd out;
+    detail::blend(out.m_v, mask_lanes(mask), a.m_v, b.m_v);
+    return out;
+  }
+
+  // As _mm_min_ps and _mm_max_ps: b if either is NaN.
+  friend Simd min(const Simd& a, const Simd& b) { return select(a < b, a, b); }
+  friend Simd max(const Simd& a, const Simd& b) { return select(a > b, a, b); }
+
+  friend Simd abs(const Simd& a) { return select(a < T{0}, -a, a); }
+
+  friend Simd sqrt(const Simd& a) {
+    T lanes[N];
+    a.store(lanes);
+    detail::sqrt_lanes(lanes, N);
+    return load(lanes);
+  }
+
+  // One libm call per lane; see fast_math.h for vectorizable kernels.
+  friend Simd sin(const Simd& a) {
+    return a.map([](T x) { return std::sin(x); });
+  }
+  friend Simd cos(const Simd& a) {
+    return a.map([](T x) { return std::cos(x); });
+  }
+
+  friend std::ostream& operator<<(std::ostream& out, const Simd& s) {
+    out << "[";
+    for (int i = 0; i < N; ++i) out << (i ? "," : "") << s[i];
+    return out << "]";
+  }
+
+ private:
+  using Register = typename detail::SimdRegister<T, N>::type;
+
+  explicit Simd(const Register& v) : m_v{v} {}
+
+  // The mask's lanes are private to Simd's members, which the friends
+  // above are not.
+  template <typename R>
+  static mask_type to_mask(const R& lanes) {
+    return mask_type(lanes);
+  }
+
+  static const auto& mask_lanes(const mask_type& mask) { return mask.m_v; }
+
+  template <typename F>
+  Simd map(F f) const {
+    T lanes[N];
+    store(lanes);
+    for (T& lane : lanes) lane = f(lane);
+    return load(lanes);
+  }
+
+  Register m_v{};
+};
+
+template <typename T, int N>
+inline constexpr bool is_simd_lane<Simd<T, N>> = true;
+
+using Simd4f = Simd<float, 4>;
+using Simd8f = Simd<float, 8>;
+using Simd16f = Simd<float, 16>;
+using Simd2d = Simd<double, 2>;
+using Simd4d = Simd<double, 4>;
+using Simd8d = Simd<double, 8>;
+
+using Simdf = Simd<float, kSimdBytes / sizeof(float)>;
+using Simdd = Simd<double, kSimdBytes / sizeof(double)>;
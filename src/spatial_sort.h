@@ -0,0 +1,358 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "point3.h"
+#include "thread_pool.h"
+
+//--------------------------------------------
+// Spatial reordering of point sets
+//--------------------------------------------
+//
+// Points are quantized to a 2^21 grid over their bounds and given a 63-bit
+// key along a space-filling curve, Morton (Z-order, cheap) or Hilbert (no
+// jumps between distant cells, better locality). Sorting by key puts points
+// that are close in space close in memory, so later neighbour searches and
+// splats mostly hit cache.
+//
+// radix_sort() is a stable LSD radix sort of the keys carrying a uint32_t
+// payload, eight bits per pass. Each pass counts digits per block on the
+// pool, turns the counts into write offsets and scatters the blocks in
+// parallel; passes where every key has the same digit are skipped. The
+// resulting permutation (order[i] = old index of the i-th element) is then
+// applied to any number of attribute arrays with gather() (out of place) or
+// permute() (in place).
+
+enum class SpaceCurve { morton, hilbert };
+
+constexpr int kSpatialKeyBits = 21;  // per axis
+
+namespace detail {
+
+// Spreads the low 21 bits of x to every third bit of the result.
+constexpr uint64_t spread_bits3(uint64_t x) {
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8) & 0x100f00f00f00f00f;
+  x = (x | x << 4) & 0x10c30c30c30c30c3;
+  x = (x | x << 2) & 0x1249249249249249;
+  return x;
+}
+
+}  // namespace detail
+
+// Interleaves the low 21 bits of each coordinate, x in the lowest bit.
+constexpr uint64_t morton_key(uint32_t x, uint32_t y, uint32_t z) {
+  return detail::spread_bits3(x) | detail::spread_bits3(y) << 1 |
+         detail::spread_bits3(z) << 2;
+}
+
+namespace detail {
+
+// Inverse of spread_bits3: every third bit of x, packed into the low 21.
+constexpr uint32_t compact_bits3(uint64_t x) {
+  x &= 0x1249249249249249;
+  x = (x | x >> 2) & 0x10c30c30c30c30c3;
+  x = (x | x >> 4) & 0x100f00f00f00f00f;
+  x = (x | x >> 8) & 0x1f0000ff0000ff;
+  x = (x | x >> 16) & 0x1f00000000ffff;
+  x = (x | x >> 32) & 0x1fffff;
+  return static_cast<uint32_t>(x);
+}
+
+}  // namespace detail
+
+// The coordinates morton_key() interleaved into key.
+constexpr std::array<uint32_t, 3> morton_decode(uint64_t key) {
+  return {detail::compact_bits3(key), detail::compact_bits3(key >> 1),
+          detail::compact_bits3(key >> 2)};
+}
+
+namespace detail {
+
+// State machine of the Hilbert curve below, one step per level: entry
+// 8 * state + octant (x | y << 1 | z << 2 of the level's bits) holds the
+// curve's digit for that octant in the low 3 bits and the next state above
+// them. A state is the rotation of the sub-cube at that level together with
+// the level modulo 3, as the curve's sub-cubes cycle through three
+// orientations. Generated from Skilling's transform, which the test
+// compares it to.
+inline constexpr uint16_t kHilbertStates[72 * 8] = {
+      8,  23,  27,  36,  41,  54,  58,  61,  64,  75,  81,  90,
+    103, 108, 118,  93, 124, 135, 141,  86, 147, 152, 138, 113,
+    134,  87, 165, 172, 153, 112, 162, 179,  80,  65, 171, 186,
+    119, 102, 180, 189, 184, 195, 207,  92, 177, 106, 214, 109,
+    220, 167, 139, 224, 149, 182, 146, 209,  88, 143, 163, 188,
+    105, 150, 178, 181,   0, 233, 247, 254, 259, 266, 276, 269,
+    286, 293, 297, 290, 239, 308, 248, 315, 320, 335, 313, 342,
+    347, 268, 274, 277, 264, 291, 273, 314, 359, 324, 366, 317,
+    372, 357, 363, 354, 287, 238, 296, 249, 232, 307, 255, 316,
+      1, 322, 246, 325, 380, 355, 365, 362, 295, 384, 318, 337,
+    386, 281, 389, 302, 395, 400, 340, 415, 406,   7, 409, 240,
+    349, 260, 346, 275, 388, 351, 341, 278, 331, 376, 338, 361,
+    396, 407, 339, 408, 333,   6, 330, 241, 378, 371, 381, 364,
+    401, 280, 414, 303, 350, 279, 405, 284, 377, 360, 402,   3,
+    294, 385, 285, 282, 319, 336, 404, 235, 312, 343, 403, 236,
+    321, 334,   2,   5, 272, 265, 283, 234, 367, 358,   4, 237,
+    262, 309, 271, 292, 369, 306, 352, 323, 300, 253, 263, 270,
+    243, 250, 368, 353, 412, 251, 311, 392, 245, 242, 326, 329,
+    394, 257, 387, 344, 397, 374, 332, 383, 410, 299, 345, 256,
+    413, 244, 382, 375, 416, 425, 435,  34, 447, 454,  60,  37,
+    460, 467, 479, 480, 493, 490,  46,  49, 500, 469, 511, 430,
+    491, 466, 512, 449, 478, 481,  47,  48, 509, 506, 524, 427,
+     56,  33, 495, 470, 507, 426, 420, 429,  40,  55,   9,  22,
+    523, 428, 418, 421, 534, 537, 437, 434,  15,  16,  28,  35,
+    438, 533, 497, 530,  39, 476, 464,  11, 498, 501, 529, 542,
+    459, 468, 472, 487, 510, 477, 431, 532, 513, 474, 448,  43,
+    424, 531, 417,  10, 455,  44, 446,  13,  32, 475, 471,  12,
+     57,  42, 494,  45, 484,  31,  19, 456,  53,  62,  50, 489,
+    540, 527,  21, 422,  51, 544,  18, 441,  30,  63, 457, 488,
+    525, 508, 522, 419, 516, 453, 443, 450, 439,  38, 496, 465,
+    548, 451, 445, 442, 535, 536,  14,  17, 514, 517, 547, 452,
+    473, 486, 528, 543, 546, 515, 549, 444,  25, 432, 462, 503,
+    538, 433, 541, 502, 483,  24,  20, 463, 482, 505, 539, 520,
+    485, 518,  52, 551, 526, 423,  29, 436, 545, 440,  26,  59,
+    458, 499, 521, 504, 461, 492, 550, 519, 104, 151,  89, 142,
+    131,  68,  82,  85, 176, 185, 215, 206, 555,  66,  84,  69,
+     78, 121, 173, 170,  95, 136, 164, 187, 156,  99, 117, 114,
+     79, 120,  94, 137, 564, 101, 115,  98, 175, 190, 568, 201,
+    226, 571, 129, 552, 229, 212, 158, 567, 572, 205, 559,  70,
+    211, 202, 560,  97, 558, 197,  71,  76, 561, 194,  96, 107,
+    218, 553, 123, 128, 221, 566, 148, 159, 228, 203, 199, 216,
+    213, 210, 110, 145, 570, 573,  73, 126, 227, 204, 192, 223,
+    198, 217, 111, 144, 557, 554, 132,  67, 562, 565, 155, 100,
+    193, 222,  72, 127, 166, 183, 225, 208, 133, 556, 130,  83,
+    174,  77, 569,  74, 191, 196, 200,  91, 122, 169, 125, 574,
+    219, 160, 140, 231, 154, 563, 157, 116, 161, 168, 230, 575,
+    310, 393, 327, 328, 261, 258, 348, 267, 370, 373, 379, 356,
+    305, 398, 288, 391, 298, 301, 289, 390, 411, 252, 304, 399,
+};
+
+}  // namespace detail
+
+// Distance along the 21-bit Hilbert curve of Skilling ("Programming the
+// Hilbert curve", 2004), the order in which the curve visits the cell.
+constexpr uint64_t hilbert_key(uint32_t x, uint32_t y, uint32_t z) {
+  uint64_t octants = morton_key(x, y, z);
+  uint64_t key = 0;
+  unsigned state = 0;
+  for (int shift = 3 * (kSpatialKeyBits - 1); shift >= 0; shift -= 3) {
+    unsigned e = detail::kHilbertStates[8 * state + (octants >> shift & 7)];
+    key |= uint64_t{e & 7} << shift;
+    state = e >> 3;
+  }
+  return key;
+}
+
+// Curve keys of points quantized over `box`, which should contain them;
+// points outside are clamped to it.
+template <numeric T>
+void spatial_keys(std::span<const Point3<T>> points, const AABB<T>& box,
+                  SpaceCurve curve, std::span<uint64_t> keys,
+                  ThreadPool& pool) {
+  if (keys.size() < points.size()) {
+    throw std::out_of_range("Output span is too small");
+  }
+  constexpr double kMax = (1u << kSpatialKeyBits) - 1;
+  const Point3<T>& lo = box.min();
+  std::array<double, 3> scale;
+  for (int a = 0; a < 3; ++a) {
+    double extent = static_cast<double>(box.max()[a]) - lo[a];
+    scale[a] = extent > 0. ? kMax / extent : 0.;
+  }
+  auto cell = [&](T v, int a) {
+    double q = (static_cast<double>(v) - lo[a]) * scale[a];
+    return static_cast<uint32_t>(std::clamp(q, 0., kMax));
+  };
+  parallel_for(pool, 0, points.size(), std::size_t{1} << 14,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; ++i) {
+                   const Point3<T>& p = points[i];
+                   uint32_t x = cell(p.x(), 0);
+                   uint32_t y = cell(p.y(), 1);
+                   uint32_t z = cell(p.z(), 2);
+                   keys[i] = curve == SpaceCurve::morton
+                                 ? morton_key(x, y, z)
+                                 : hilbert_key(x, y, z);
+                 }
+               });
+}
+
+//--------------------------------------------
+// Radix sort
+//--------------------------------------------
+
+// Sorts keys ascending and moves values[i] along with keys[i]; equal keys
+// keep their order.
+inline void radix_sort(std::span<uint64_t> keys, std::span<uint32_t> values,
+                       ThreadPool& pool) {
+  if (values.size() != keys.size()) {
+    throw std::invalid_argument("radix_sort needs one value per key");
+  }
+  constexpr int kDigits = 256;
+  constexpr std::size_t kMinBlock = std::size_t{1} << 16;
+  std::size_t n = keys.size();
+  if (n < 2) return;
+  std::size_t blocks = std::clamp<std::size_t>(
+      n / kMinBlock, 1, 4 * (std::size_t{pool.size()} + 1));
+  auto block_begin = [&](std::size_t b) { return n * b / blocks; };
+
+  std::vector<uint64_t> key_buffer(n);
+  std::vector<uint32_t> value_buffer(n);
+  std::span<uint64_t> src_keys = keys, dst_keys = key_buffer;
+  std::span<uint32_t> src_values = values, dst_values = value_buffer;
+  std::vector<std::array<std::size_t, kDigits>> counts(blocks);
+
+  for (int shift = 0; shift < 64; shift += 8) {
+    parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+      auto& count = counts[b];
+      count.fill(0);
+      for (std::size_t i = block_begin(b); i < block_begin(b + 1); ++i) {
+        ++count[(src_keys[i] >> shift) & 0xff];
+      }
+    });
+    // Offsets: every block's share of digit d follows the blocks before it,
+    // after all of digit d - 1.
+    std::size_t offset = 0;
+    bool single = false;
+    for (int d = 0; d < kDigits; ++d) {
+      std::size_t total = 0;
+      for (auto& count : counts) {
+        std::size_t c = count[d];
+        count[d] = offset + total;
+        total += c;
+      }
+      single = single || total == n;
+      offset += total;
+    }
+    if (single) continue;
+
+    parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+      auto& next = counts[b];
+      for (std::size_t i = block_begin(b); i < block_begin(b + 1); ++i) {
+        std::size_t at = next[(src_keys[i] >> shift) & 0xff]++;
+        dst_keys[at] = src_keys[i];
+        dst_values[at] = src_values[i];
+      }
+    });
+    std::swap(src_keys, dst_keys);
+    std::swap(src_values, dst_values);
+  }
+  if (src_keys.data() != keys.data()) {
+    parallel_for(pool, 0, n, std::size_t{1} << 16,
+                 [&](std::size_t begin, std::size_t end) {
+                   std::copy(src_keys.begin() + begin,
+                             src_keys.begin() + end, keys.begin() + begin);
+                   std::copy(src_values.begin() + begin,
+                             src_values.begin() + end,
+                             values.begin() + begin);
+                 });
+  }
+}
+
+inline void radix_sort(std::span<uint64_t> keys, std::span<uint32_t> values) {
+  radix_sort(keys, values, default_thread_pool());
+}
+
+//--------------------------------------------
+// Orders and permutations
+//--------------------------------------------
+
+// Permutation sorting the points along the curve: order[i] is the index of
+// the point that goes i-th.
+template <numeric T>
+std::vector<uint32_t> spatial_order(std::span<const Point3<T>> points,
+                                    SpaceCurve curve, ThreadPool& pool) {
+  if (points.size() > UINT32_MAX) {
+    throw std::length_error("Too many points for a 32-bit order");
+  }
+  std::vector<uint64_t> keys(points.size());
+  spatial_keys(points, bounds(points, pool), curve, std::span(keys), pool);
+  std::vector<uint32_t> order(points.size());
+  parallel_for(pool, 0, order.size(), std::size_t{1} << 16,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; ++i) {
+                   order[i] = static_cast<uint32_t>(i);
+                 }
+               });
+  radix_sort(std::span(keys), std::span(order), pool);
+  return order;
+}
+
+template <numeric T>
+std::vector<uint32_t> spatial_order(std::span<const Point3<T>> points,
+                                    SpaceCurve curve = SpaceCurve::hilbert) {
+  return spatial_order(points, curve, default_thread_pool());
+}
+
+// out[i] = in[order[i]].
+template <typename A>
+void gather(std::span<const uint32_t> order, std::span<const A> in,
+            std::span<A> out, ThreadPool& pool) {
+  if (in.size() != order.size()) {
+    throw std::invalid_argument("Permutation and array sizes differ");
+  }
+  if (out.size() < order.size()) {
+    throw std::out_of_range("Output span is too small");
+  }
+  parallel_for(pool, 0, order.size(), std::size_t{1} << 14,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; ++i) {
+                   out[i] = in[order[i]];
+                 }
+               });
+}
+
+template <typename A>
+void gather(std::span<const uint32_t> order, std::span<const A> in,
+            std::span<A> out) {
+  gather(order, in, out, default_thread_pool());
+}
+
+// Applies the permutation to every array in place, as gather() would. Each
+// array goes through a scratch copy of itself, so the extra memory is that
+// of the largest array.
+template <typename... A>
+void permute(ThreadPool& pool, std::span<const uint32_t> order,
+             std::span<A>... arrays) {
+  if (((arrays.size() != order.size()) || ...)) {
+    throw std::invalid_argument("Permutation and array sizes differ");
+  }
+  auto one = [&]<typename E>(std::span<E> array) {
+    std::vector<E> scratch(array.begin(), array.end());
+    gather(order, std::span<const E>(scratch), array, pool);
+  };
+  (one(arrays), ...);
+}
+
+template <typename... A>
+void permute(std::span<const uint32_t> order, std::span<A>... arrays) {
+  permute(default_thread_pool(), order, arrays...);
+}
+
+// Sorts the points along the curve in place, reorders the attribute arrays
+// (one element per point) the same way and returns the permutation used.
+template <numeric T, typename... A>
+std::vector<uint32_t> spatial_sort(ThreadPool& pool, SpaceCurve curve,
+                                   std::span<Point3<T>> points,
+                                   std::span<A>... attributes) {
+  auto order = spatial_order(std::span<const Point3<T>>(points), curve, pool);
+  permute(pool, std::span<const uint32_t>(order), points, attributes...);
+  return order;
+}
+
+template <numeric T, typename... A>
+std::vector<uint32_t> spatial_sort(SpaceCurve curve,
+                                   std::span<Point3<T>> points,
+                                   std::span<A>... attributes) {
+  return spatial_sort(default_thread_pool(), curve, points, attributes...);
+}
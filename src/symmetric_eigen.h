@@ -0,0 +1,368 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "kd_tree.h"
+#include "mat3.h"
+#include "point3.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "types.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Symmetric 3x3 eigen-decomposition
+//--------------------------------------------
+//
+// For PCA on point neighbourhoods (normals, oriented boxes), where the
+// matrices are covariances and there are millions of them. The solver is
+// cyclic Jacobi: rotations over the pairs (0,1), (0,2), (1,2) until the
+// off-diagonal entries are negligible next to the diagonal, at most
+// kMaxSweeps sweeps: three for float, three or four for double on random
+// matrices. It stays accurate for repeated and nearly repeated
+// eigenvalues, where the closed trigonometric form loses the eigenvectors,
+// and it has no branch on the data but the sweep count, so T may be a Simd
+// and solve a register of matrices at once. The rotations are latency
+// bound (two square roots and two divisions each), which the lanes of a
+// register hide; wider Simd than the target's registers did not help.
+//
+// Covariance3 accumulates a covariance point by point, and the batch
+// functions go from KdTree neighbour rows to covariances to eigen-
+// decompositions over one array per distinct matrix entry
+// (SymmetricMat3SoA), a Simd register of matrices at a time.
+
+template <numeric T>
+struct SymmetricEigen3 {
+  // Ascending.
+  Vec3<T> values;
+  // Unit eigenvectors, vectors[i] for values[i]; a right-handed frame,
+  // vectors[2] = cross(vectors[0], vectors[1]). For a covariance,
+  // vectors[0] is the normal of the best fitting plane.
+  Vec3<T> vectors[3];
+};
+
+namespace detail {
+
+inline constexpr int kMaxSweeps = 8;
+
+// The scalar type of T's lanes.
+template <typename T>
+struct lane_scalar {
+  using type = T;
+};
+
+template <typename T, int N>
+struct lane_scalar<Simd<T, N>> {
+  using type = T;
+};
+
+template <numeric T>
+Vec3<T> select3(const mask_t<T>& mask, const Vec3<T>& a, const Vec3<T>& b) {
+  return Vec3<T>(select(mask, a.x(), b.x()), select(mask, a.y(), b.y()),
+                 select(mask, a.z(), b.z()));
+}
+
+// Zeroes apq by a rotation of rows and columns p and q, r being the third
+// index: app, aqq, arp and arq take their rotated values and the
+// eigenvector estimates vp and vq rotate with them.
+template <numeric T>
+void jacobi_rotate(T& app, T& aqq, T& apq, T& arp, T& arq, Vec3<T>& vp,
+                   Vec3<T>& vq) {
+  using std::abs;
+  using std::sqrt;
+  // tan of the rotation angle, the smaller root of t^2 + 2 theta t - 1.
+  mask_t<T> skip = apq == T{0};
+  T theta = (aqq - app) / select(skip, T{1}, apq + apq);
+  T t = T{1} / (abs(theta) + sqrt(theta * theta + T{1}));
+  t = select(skip, T{0}, select(theta < T{0}, -t, t));
+  T c = T{1} / sqrt(t * t + T{1});
+  T s = t * c;
+
+  T tapq = t * apq;
+  app -= tapq;
+  aqq += tapq;
+  apq = T{0};
+  T rp = arp;
+  arp = c * rp - s * arq;
+  arq = s * rp + c * arq;
+  Vec3<T> p = vp;
+  vp = p * c - vq * s;
+  vq = p * s + vq * c;
+}
+
+// Orders (a, va) before (b, vb) where b < a.
+template <numeric T>
+void sort_pair(T& a, T& b, Vec3<T>& va, Vec3<T>& vb) {
+  mask_t<T> swap = b < a;
+  T lo = select(swap, b, a);
+  b = select(swap, a, b);
+  a = lo;
+  Vec3<T> vlo = select3<T>(swap, vb, va);
+  vb = select3<T>(swap, va, vb);
+  va = vlo;
+}
+
+}  // namespace detail
+
+// The eigen-decomposition of the symmetric matrix with upper triangle
+// xx xy xz / yy yz / zz.
+template <numeric T>
+SymmetricEigen3<T> eigen_symmetric(const T& xx, const T& xy, const T& xz,
+                                   const T& yy, const T& yz, const T& zz) {
+  using scalar = typename detail::lane_scalar<T>::type;
+  constexpr scalar kEps = std::numeric_limits<scalar>::epsilon();
+  T a00 = xx, a01 = xy, a02 = xz, a11 = yy, a12 = yz, a22 = zz;
+  SymmetricEigen3<T> e;
+  Vec3<T>* v = e.vectors;
+  v[0] = Vec3<T>(T{1}, T{0}, T{0});
+  v[1] = Vec3<T>(T{0}, T{1}, T{0});
+  v[2] = Vec3<T>(T{0}, T{0}, T{1});
+  for (int sweep = 0; sweep < detail::kMaxSweeps; ++sweep) {
+    T off = a01 * a01 + a02 * a02 + a12 * a12;
+    T diag = a00 * a00 + a11 * a11 + a22 * a22;
+    if (all(off <= T{kEps * kEps} * diag)) break;
+    detail::jacobi_rotate(a00, a11, a01, a02, a12, v[0], v[1]);
+    detail::jacobi_rotate(a00, a22, a02, a01, a12, v[0], v[2]);
+    detail::jacobi_rotate(a11, a22, a12, a01, a02, v[1], v[2]);
+  }
+
+  detail::sort_pair(a00, a11, v[0], v[1]);
+  detail::sort_pair(a11, a22, v[1], v[2]);
+  detail::sort_pair(a00, a11, v[0], v[1]);
+  e.values = Vec3<T>(a00, a11, a22);
+  v[2] = cross(v[0], v[1]);
+  return e;
+}
+
+// Reads the upper triangle of m.
+template <numeric T>
+SymmetricEigen3<T> eigen_symmetric(const Mat3<T>& m) {
+  return eigen_symmetric(m[0][0], m[0][1], m[0][2], m[1][1], m[1][2],
+                         m[2][2]);
+}
+
+//--------------------------------------------
+// Covariance of a point set
+//--------------------------------------------
+
+// Adds points one at a time and gives their mean and covariance, the
+// second moments summed in wide_t<T> relative to the first point so that
+// clusters far from the origin keep their precision.
+template <numeric T>
+class Covariance3 {
+ public:
+  void add(const Point3<T>& p) {
+    if (m_count == 0) m_origin = p;
+    Vec3<T> d = p - m_origin;
+    wide_t<T> x = d.x(), y = d.y(), z = d.z();
+    m_sum[0] += x;
+    m_sum[1] += y;
+    m_sum[2] += z;
+    m_sum2[0] += x * x;
+    m_sum2[1] += x * y;
+    m_sum2[2] += x * z;
+    m_sum2[3] += y * y;
+    m_sum2[4] += y * z;
+    m_sum2[5] += z * z;
+    ++m_count;
+  }
+
+  std::size_t count() const { return m_count; }
+
+  // The origin when empty.
+  Point3<T> mean() const {
+    if (m_count == 0) return Point3<T>();
+    wide_t<T> n = static_cast<wide_t<T>>(m_count);
+    return m_origin + Vec3<T>(static_cast<T>(m_sum[0] / n),
+                              static_cast<T>(m_sum[1] / n),
+                              static_cast<T>(m_sum[2] / n));
+  }
+
+  // The population covariance, divided by count(); zero when empty.
+  Mat3<T> matrix() const {
+    T e[6];
+    entries(e);
+    return Mat3<T>(Vec3<T>(e[0], e[1], e[2]), Vec3<T>(e[1], e[3], e[4]),
+                   Vec3<T>(e[2], e[4], e[5]));
+  }
+
+  // The upper triangle of matrix(): xx, xy, xz, yy, yz, zz.
+  void entries(T (&out)[6]) const {
+    if (m_count == 0) {
+      for (T& x : out) x = T{0};
+      return;
+    }
+    wide_t<T> n = static_cast<wide_t<T>>(m_count);
+    const int row[6] = {0, 0, 0, 1, 1, 2};
+    const int col[6] = {0, 1, 2, 1, 2, 2};
+    for (int i = 0; i < 6; ++i) {
+      out[i] = static_cast<T>(
+          (m_sum2[i] - m_sum[row[i]] * m_sum[col[i]] / n) / n);
+    }
+  }
+
+ private:
+  Point3<T> m_origin;
+  wide_t<T> m_sum[3] = {};
+  wide_t<T> m_sum2[6] = {};
+  std::size_t m_count = 0;
+};
+
+//--------------------------------------------
+// Batches
+//--------------------------------------------
+
+// Symmetric 3x3 matrices as one array per entry of the upper triangle, so
+// that a Simd register of matrices loads with six loads.
+template <numeric T>
+struct SymmetricMat3SoA {
+  std::vector<T> xx, xy, xz, yy, yz, zz;
+
+  std::size_t size() const { return xx.size(); }
+
+  void resize(std::size_t n) {
+    for (auto* a : {&xx, &xy, &xz, &yy, &yz, &zz}) a->resize(n);
+  }
+
+  // Reads the upper triangle of m.
+  void set(std::size_t i, const Mat3<T>& m) {
+    set(i, {m[0][0], m[0][1], m[0][2], m[1][1], m[1][2], m[2][2]});
+  }
+
+  void set(std::size_t i, const T (&e)[6]) {
+    xx[i] = e[0];
+    xy[i] = e[1];
+    xz[i] = e[2];
+    yy[i] = e[3];
+    yz[i] = e[4];
+    zz[i] = e[5];
+  }
+
+  Mat3<T> get(std::size_t i) const {
+    return Mat3<T>(Vec3<T>(xx[i], xy[i], xz[i]), Vec3<T>(xy[i], yy[i], yz[i]),
+                   Vec3<T>(xz[i], yz[i], zz[i]));
+  }
+};
+
+namespace detail {
+
+inline constexpr std::size_t kEigenGrain = 1024;
+
+template <numeric T, typename Count>
+void neighborhood_covariances(std::span<const Point3<T>> points,
+                              std::span<const Neighbor<T>> neighbors,
+                              std::size_t stride, std::size_t rows,
+                              Count&& count, SymmetricMat3SoA<T>& out,
+                              ThreadPool& pool) {
+  out.resize(rows);
+  parallel_for(pool, 0, rows, kEigenGrain,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; ++i) {
+                   Covariance3<T> c;
+                   const Neighbor<T>* row = neighbors.data() + i * stride;
+                   for (std::size_t j = 0, n = count(i); j < n; ++j) {
+                     if (row[j].index == Neighbor<T>::kNone) break;
+                     c.add(points[row[j].index]);
+                   }
+                   T e[6];
+                   c.entries(e);
+                   out.set(i, e);
+                 }
+               });
+}
+
+}  // namespace detail
+
+// out[i] is the covariance of the points in row i of a batched
+// KdTree::knn() result (stride k), the query's own point included if the
+// tree holds it; padding entries are skipped.
+template <numeric T>
+void neighborhood_covariances(std::span<const Point3<T>> points,
+                              std::span<const Neighbor<T>> neighbors,
+                              std::size_t k, SymmetricMat3SoA<T>& out,
+                              ThreadPool& pool) {
+  std::size_t rows = k == 0 ? 0 : neighbors.size() / k;
+  detail::neighborhood_covariances(
+      points, neighbors, k, rows, [&](std::size_t) { return k; }, out, pool);
+}
+
+template <numeric T>
+void neighborhood_covariances(std::span<const Point3<T>> points,
+                              std::span<const Neighbor<T>> neighbors,
+                              std::size_t k, SymmetricMat3SoA<T>& out) {
+  neighborhood_covariances(points, neighbors, k, out, default_thread_pool());
+}
+
+// The same for a batched KdTree::radius() result: row i (stride
+// max_count) holds counts[i] neighbours.
+template <numeric T>
+void neighborhood_covariances(std::span<const Point3<T>> points,
+                              std::span<const Neighbor<T>> neighbors,
+                              std::size_t max_count,
+                              std::span<const uint32_t> counts,
+                              SymmetricMat3SoA<T>& out, ThreadPool& pool) {
+  if (neighbors.size() < counts.size() * max_count) {
+    throw std::out_of_range("Neighbor span is too small");
+  }
+  detail::neighborhood_covariances(
+      points, neighbors, max_count, counts.size(),
+      [&](std::size_t i) { return std::size_t{counts[i]}; }, out, pool);
+}
+
+template <numeric T>
+void neighborhood_covariances(std::span<const Point3<T>> points,
+                              std::span<const Neighbor<T>> neighbors,
+                              std::size_t max_count,
+                              std::span<const uint32_t> counts,
+                              SymmetricMat3SoA<T>& out) {
+  neighborhood_covariances(points, neighbors, max_count, counts, out,
+                           default_thread_pool());
+}
+
+// out[i] is the eigen-decomposition of m.get(i), solved a Simd register
+// of matrices at a time over the pool.
+template <numeric T>
+  requires simd_lanes<T, kSimdBytes / sizeof(T)>
+void eigen_symmetric(const SymmetricMat3SoA<T>& m,
+                     std::span<SymmetricEigen3<T>> out, ThreadPool& pool) {
+  if (out.size() < m.size()) {
+    throw std::out_of_range("Output span is too small");
+  }
+  using Lanes = Simd<T, kSimdBytes / sizeof(T)>;
+  constexpr std::size_t kLanes = Lanes::size();
+  parallel_for(
+      pool, 0, m.size(), detail::kEigenGrain,
+      [&](std::size_t begin, std::size_t end) {
+        std::size_t i = begin;
+        for (; i + kLanes <= end; i += kLanes) {
+          SymmetricEigen3<Lanes> e = eigen_symmetric(
+              Lanes::load(&m.xx[i]), Lanes::load(&m.xy[i]),
+              Lanes::load(&m.xz[i]), Lanes::load(&m.yy[i]),
+              Lanes::load(&m.yz[i]), Lanes::load(&m.zz[i]));
+          for (std::size_t l = 0; l < kLanes; ++l) {
+            auto lane = [&](const Vec3<Lanes>& v) {
+              return Vec3<T>(v.x()[l], v.y()[l], v.z()[l]);
+            };
+            SymmetricEigen3<T>& o = out[i + l];
+            o.values = lane(e.values);
+            for (int k = 0; k < 3; ++k) o.vectors[k] = lane(e.vectors[k]);
+          }
+        }
+        for (; i < end; ++i) {
+          out[i] = eigen_symmetric(m.xx[i], m.xy[i], m.xz[i], m.yy[i],
+                                   m.yz[i], m.zz[i]);
+        }
+      });
+}
+
+template <numeric T>
+  requires simd_lanes<T, kSimdBytes / sizeof(T)>
+void eigen_symmetric(const SymmetricMat3SoA<T>& m,
+                     std::span<SymmetricEigen3<T>> out) {
+  eigen_symmetric(m, out, default_thread_pool());
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "normal3.h"
+#include "point3.h"
+#include "thread_pool.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Bulk text parsing and formatting
+//--------------------------------------------
+//
+// Reads and writes whole arrays of three-component values as text, one per
+// line, with std::from_chars/std::to_chars: no locale, no stream state, no
+// allocation per element. Accepted lines are
+//
+//   x y z ...      plain xyz files; further columns (colours, w) are ignored
+//   v x y z ...    OBJ vertex positions (parse_points)
+//   vn x y z       OBJ vertex normals (parse_normals)
+//
+// Empty lines, '#' comments and records with any other keyword (vt, f, o,
+// ...) are skipped, so an OBJ file can be passed as is. Malformed lines throw
+// std::runtime_error naming the line.
+
+template <typename V>
+concept xyz_value = requires(const V& v) {
+  requires numeric<decltype(v.x())>;
+  V(v.x(), v.y(), v.z());
+};
+
+namespace detail {
+
+inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char* skip_blanks(const char* p, const char* end) {
+  while (p != end && is_blank(*p)) ++p;
+  return p;
+}
+
+inline const char* line_end(const char* p, const char* end) {
+  auto nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+  return nl ? nl : end;
+}
+
+[[noreturn]] inline void throw_parse_error(const char* origin,
+                                           const char* where) {
+  auto line = std::count(origin, where, '\n') + 1;
+  throw std::runtime_error("Malformed value on line " + std::to_string(line));
+}
+
+// Fast path for the plain decimals that make up nearly all of these files:
+// at most 19 significant digits and a small power of ten. When the digits
+// fit in a double's mantissa and the power is exact (|e| <= 22), one double
+// multiply or divide is correctly rounded (Clinger). A float is then rounded
+// from that double, which is only ambiguous when the double sits exactly on
+// a float midpoint. Anything else, or that case, returns nullptr and the
+// caller falls back to std::from_chars.
+template <typename T>
+const char* parse_decimal(const char* p, const char* end, T& value) {
+  static constexpr double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                      1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                      1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                      1e18, 1e19, 1e20, 1e21, 1e22};
+  bool negative = p != end && *p == '-';
+  if (negative) ++p;
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  for (; p != end && unsigned(*p - '0') < 10; ++p, ++digits) {
+    mantissa = mantissa * 10 + unsigned(*p - '0');
+  }
+  if (p != end && *p == '.') {
+    const char* frac = ++p;
+    for (; p != end && unsigned(*p - '0') < 10; ++p, ++digits) {
+      mantissa = mantissa * 10 + unsigned(*p - '0');
+    }
+    exponent = -static_cast<int>(p - frac);
+  }
+  if (digits == 0 || digits > 19) return nullptr;
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exp = p != end && *p == '-';
+    if (p != end && (*p == '-' || *p == '+')) ++p;
+    int e = 0;
+    const char* exp_start = p;
+    for (; p != end && unsigned(*p - '0') < 10 && e < 1000; ++p) {
+      e = e * 10 + (*p - '0');
+    }
+    if (p == exp_start) return nullptr;
+    exponent += negative_exp ? -e : e;
+  }
+  if (mantissa > (uint64_t{1} << 53) || exponent < -22 || exponent > 22) {
+    return nullptr;
+  }
+  double d = static_cast<double>(mantissa);
+  d = exponent < 0 ? d / kPow10[-exponent] : d * kPow10[exponent];
+  if constexpr (std::is_same_v<T, float>) {
+    // Bits below a float's mantissa equal to exactly one half: a tie.
+    if ((std::bit_cast<uint64_t>(d) & 0x1fffffff) == 0x10000000) return nullptr;
+  }
+  value = static_cast<T>(negative ? -d : d);
+  return p;
+}
+
+inline bool ends_token(const char* p, const char* end) {
+  return p == end || is_blank(*p) || *p == '\n';
+}
+
+// Parses one number starting at p, after optional blanks. Returns nullptr
+// when there is none.
+template <numeric T>
+const char* parse_scalar(const char* p, const char* end, T& value) {
+  p = skip_blanks(p, end);
+  if (p != end && *p == '+') ++p;
+  if constexpr (std::is_floating_point_v<T>) {
+    const char* next = parse_decimal(p, end, value);
+    if (next && ends_token(next, end)) return next;
+  }
+  auto [next, ec] = std::from_chars(p, end, value);
+  if (ec != std::errc{} || !ends_token(next, end)) return nullptr;
+  return next;
+}
+
+// Appends every value in [text) to out. `keyword` selects which OBJ records
+// are taken besides plain numeric lines. `origin` is the start of the whole
+// input, for the line number in error messages.
+template <xyz_value V>
+void parse_xyz(std::string_view text, std::string_view keyword,
+               const char* origin, std::vector<V>& out) {
+  using T = decltype(std::declval<V>().x());
+  const char* p = text.data();
+  const char* end = p + text.size();
+  while (p != end) {
+    const char* q = skip_blanks(p, end);
+    bool take = q != end && *q != '\n' && *q != '#';
+    if (take && ((*q >= 'a' && *q <= 'z') || (*q >= 'A' && *q <= 'Z'))) {
+      const char* word = q;
+      while (!ends_token(q, end)) ++q;
+      take = std::string_view(word, q - word) == keyword;
+    }
+    if (take) {
+      T x, y, z;
+      if (!(q = parse_scalar(q, end, x)) || !(q = parse_scalar(q, end, y)) ||
+          !(q = parse_scalar(q, end, z))) {
+        throw_parse_error(origin, p);
+      }
+      out.emplace_back(x, y, z);
+    }
+    if (q != end && *q != '\n') q = line_end(q, end);
+    p = q == end ? end : q + 1;
+  }
+}
+
+template <xyz_value V>
+std::vector<V> parse_xyz(std::string_view text, std::string_view keyword) {
+  std::vector<V> out;
+  out.reserve(std::count(text.begin(), text.end(), '\n') + 1);
+  parse_xyz(text, keyword, text.data(), out);
+  return out;
+}
+
+}  // namespace detail
+
+// Splits text into at most `parts` pieces of similar size, each ending just
+// after a newline (or at the end), so they can be parsed independently.
+inline std::vector<std::string_view> split_lines(std::string_view text,
+                                                 std::size_t parts) {
+  std::vector<std::string_view> pieces;
+  parts = std::max<std::size_t>(parts, 1);
+  std::size_t begin = 0;
+  for (std::size_t i = 1; i <= parts && begin < text.size(); ++i) {
+    std::size_t cut = text.size() * i / parts;
+    if (i < parts) {
+      cut = std::max(cut, begin);
+      auto nl = text.find('\n', cut);
+      cut = nl == std::string_view::npos ? text.size() : nl + 1;
+    }
+    if (cut > begin) pieces.push_back(text.substr(begin, cut - begin));
+    begin = cut;
+  }
+  return pieces;
+}
+
+namespace detail {
+
+// Pieces to split bulk text into: enough that an uneven piece does not
+// leave the other threads idle.
+inline std::size_t pieces_for(const ThreadPool& pool) {
+  return 4 * (std::size_t{pool.size()} + 1);
+}
+
+template <xyz_value V>
+std::vector<V> parse_xyz(std::string_view text, std::string_view keyword,
+                         ThreadPool& pool, std::size_t parts) {
+  auto pieces = split_lines(text, parts);
+  if (pieces.size() < 2) return parse_xyz<V>(text, keyword);
+
+  // Every piece is parsed even after an error, so the error reported is the
+  // one on the first bad line whatever order the pieces ran in.
+  std::vector<std::vector<V>> parts_out(pieces.size());
+  std::vector<std::exception_ptr> errors(pieces.size());
+  parallel_for(pool, 0, pieces.size(), 1, [&](std::size_t i, std::size_t) {
+    try {
+      parts_out[i].reserve(
+          std::count(pieces[i].begin(), pieces[i].end(), '\n'));
+      parse_xyz(pieces[i], keyword, text.data(), parts_out[i]);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  });
+  for (auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+
+  std::size_t total = 0;
+  for (const auto& part : parts_out) total += part.size();
+  std::vector<V> out;
+  out.reserve(total);
+  for (const auto& part : parts_out) {
+    out.insert(out.end(), part.begin(), part.end());
+  }
+  return out;
+}
+
+}  // namespace detail
+
+//--------------------------------------------
+// Parsing
+//--------------------------------------------
+
+template <numeric T = float>
+std::vector<Point3<T>> parse_points(std::string_view text) {
+  return detail::parse_xyz<Point3<T>>(text, "v");
+}
+
+template <numeric T = float>
+std::vector<Normal3<T>> parse_normals(std::string_view text) {
+  return detail::parse_xyz<Normal3<T>>(text, "vn");
+}
+
+// Same as above with the text split at line boundaries into pieces parsed
+// on `pool`, a few per thread; the result keeps the input order.
+template <numeric T = float>
+std::vector<Point3<T>> parse_points(std::string_view text, ThreadPool& pool) {
+  return detail::parse_xyz<Point3<T>>(text, "v", pool,
+                                      detail::pieces_for(pool));
+}
+
+template <numeric T = float>
+std::vector<Normal3<T>> parse_normals(std::string_view text,
+                                      ThreadPool& pool) {
+  return detail::parse_xyz<Normal3<T>>(text, "vn", pool,
+                                       detail::pieces_for(pool));
+}
+
+// Split into `threads` pieces, run on default_thread_pool().
+template <numeric T = float>
+std::vector<Point3<T>> parse_points(std::string_view text, unsigned threads) {
+  return detail::parse_xyz<Point3<T>>(text, "v", default_thread_pool(),
+                                      threads);
+}
+
+template <numeric T = float>
+std::vector<Normal3<T>> parse_normals(std::string_view text,
+                                      unsigned threads) {
+  return detail::parse_xyz<Normal3<T>>(text, "vn", default_thread_pool(),
+                                       threads);
+}
+
+//--------------------------------------------
+// Formatting
+//--------------------------------------------
+
+// Upper bound of the characters format_points() writes for one value with
+// the given prefix: three shortest round-trip numbers, two spaces and '\n'.
+template <xyz_value V>
+constexpr std::size_t max_formatted_size(std::size_t prefix_size = 0) {
+  using T = decltype(std::declval<V>().x());
+  constexpr std::size_t number = std::is_same_v<T, float>    ? 16
+                                 : std::is_same_v<T, double> ? 25
+                                                             : 12;
+  return prefix_size + 3 * number + 3;
+}
+
+struct FormatResult {
+  std::size_t count;  // values written
+  std::size_t size;   // characters written
+};
+
+// Writes one "x y z" line per value into buffer, each number in the shortest
+// form that reads back to the same value. Only whole lines are written; when
+// the buffer fills up the result says how far it got, so the caller can
+// flush it and continue with the remaining values. `prefix` starts every
+// line, e.g. "v " for OBJ output.
+template <xyz_value V>
+FormatResult format_points(std::span<const V> values, std::span<char> buffer,
+                           std::string_view prefix = {}) {
+  char* p = buffer.data();
+  char* end = p + buffer.size();
+  std::size_t count = 0;
+  for (const auto& v : values) {
+    char* q = p;
+    if (static_cast<std::size_t>(end - q) < prefix.size()) break;
+    q = std::copy(prefix.begin(), prefix.end(), q);
+    bool fits = true;
+    for (auto c : {v.x(), v.y(), v.z()}) {
+      auto r = std::to_chars(q, end, c);
+      if (r.ec != std::errc{} || r.ptr == end) {
+        fits = false;
+        break;
+      }
+      q = r.ptr;
+      *q++ = ' ';
+    }
+    if (!fits) break;
+    q[-1] = '\n';
+    p = q;
+    ++count;
+  }
+  return {count, static_cast<std::size_t>(p - buffer.data())};
+}
+
+template <xyz_value V>
+FormatResult format_points(const std::vector<V>& values,
+                           std::span<char> buffer,
+                           std::string_view prefix = {}) {
+  return format_points(std::span<const V>(values), buffer, prefix);
+}
+
+// Convenience for small arrays: formats everything into one string.
+template <xyz_value V>
+std::string format_points(std::span<const V> values,
+                          std::string_view prefix = {}) {
+  std::string out(values.size() * max_formatted_size<V>(prefix.size()), '\0');
+  auto r = format_points(values, std::span<char>(out), prefix);
+  out.resize(r.size);
+  return out;
+}
@@ -0,0 +1,412 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//--------------------------------------------
+// Work-stealing thread pool
+//--------------------------------------------
+//
+// Every worker owns a Chase-Lev deque (Chase and Lev, "Dynamic Circular
+// Work-Stealing Deque", SPAA 2005; memory orders after Le et al., PPoPP
+// 2013). parallel_for() splits its range in halves down to the grain size:
+// the owner pushes and pops the back of its deque, so it works depth first
+// on data it just touched, while idle workers steal the largest remaining
+// halves from the front. Calls from outside the pool go through a shared
+// queue, and the calling thread runs tasks too while it waits, so a pool of
+// N workers keeps N + 1 threads busy and nested calls cannot deadlock.
+//
+// The bulk functions of the library take an optional ThreadPool& and
+// otherwise use default_thread_pool(), one worker per hardware thread
+// besides the caller. Pass your own pool to share threads with the rest of
+// an application instead of oversubscribing the machine.
+
+namespace detail {
+
+struct PoolTask {
+  void (*run)(PoolTask*);
+};
+
+// Single-owner deque of task pointers. push() and pop() are only called by
+// the owning worker, steal() by anyone. Arrays are grown by doubling and
+// the old ones are kept until destruction, as a thief may still read them.
+class ChaseLevDeque {
+ public:
+  explicit ChaseLevDeque(int64_t capacity = 256) {
+    m_arrays.push_back(std::make_unique<Array>(capacity));
+    m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+  }
+
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+  void push(PoolTask* task) {
+    int64_t b = m_bottom.load(std::memory_order_relaxed);
+    int64_t t = m_top.load(std::memory_order_acquire);
+    Array* a = m_array.load(std::memory_order_relaxed);
+    if (b - t > a->mask) a = grow(a, t, b);
+    a->put(b, task);
+    m_bottom.store(b + 1, std::memory_order_release);
+  }
+
+  PoolTask* pop() {
+    int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    Array* a = m_array.load(std::memory_order_relaxed);
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = m_top.load(std::memory_order_relaxed);
+    if (t > b) {
+      m_bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    PoolTask* task = a->get(b);
+    if (t == b) {
+      // The last task: race the thieves for it.
+      if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  PoolTask* steal() {
+    int64_t t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = m_bottom.load(std::memory_order_acquire);
+    if (t >= b) return nullptr;
+    Array* a = m_array.load(std::memory_order_acquire);
+    PoolTask* task = a->get(t);
+    if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+  bool empty() const {
+    return m_bottom.load(std::memory_order_relaxed) <=
+           m_top.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Array {
+    explicit Array(int64_t capacity)
+        : mask{capacity - 1},
+          items{std::make_unique<std::atomic<PoolTask*>[]>(capacity)} {}
+
+    PoolTask* get(int64_t i) const {
+      return items[i & mask].load(std::memory_order_relaxed);
+    }
+    void put(int64_t i, PoolTask* task) {
+      items[i & mask].store(task, std::memory_order_relaxed);
+    }
+
+    int64_t mask;
+    std::unique_ptr<std::atomic<PoolTask*>[]> items;
+  };
+
+  Array* grow(Array* a, int64_t t, int64_t b) {
+    auto bigger = std::make_unique<Array>(2 * (a->mask + 1));
+    for (int64_t i = t; i < b; ++i) bigger->put(i, a->get(i));
+    m_arrays.push_back(std::move(bigger));
+    Array* next = m_arrays.back().get();
+    m_array.store(next, std::memory_order_release);
+    return next;
+  }
+
+  alignas(64) std::atomic<int64_t> m_top{0};
+  alignas(64) std::atomic<int64_t> m_bottom{0};
+  std::atomic<Array*> m_array;
+  std::vector<std::unique_ptr<Array>> m_arrays;
+};
+
+}  // namespace detail
+
+class ThreadPool {
+ public:
+  // `threads` workers besides the callers; 0 runs everything on the
+  // calling thread.
+  explicit ThreadPool(unsigned threads) {
+    m_workers.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+      m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+      m_workers[i]->thread = std::thread([this, i] { work(i); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& w : m_workers) w->thread.join();
+  }
+
+  unsigned size() const { return static_cast<unsigned>(m_workers.size()); }
+
+  // Queues a task: on the calling worker's own deque, or on the shared
+  // queue from any other thread.
+  void submit(detail::PoolTask* task) {
+    if (Worker* w = current_worker()) {
+      w->deque.push(task);
+    } else {
+      std::lock_guard lock(m_mutex);
+      m_injected.push_back(task);
+      m_injected_size.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_seq_cst) > 0) {
+      std::lock_guard lock(m_mutex);
+      m_wake.notify_one();
+    }
+  }
+
+  // Runs queued tasks until `done` returns true.
+  template <typename Done>
+  void help_until(Done&& done) {
+    Worker* self = current_worker();
+    for (int idle = 0; !done();) {
+      if (detail::PoolTask* task = find_task(self)) {
+        task->run(task);
+        idle = 0;
+      } else if (++idle > 64) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+ private:
+  struct Worker {
+    detail::ChaseLevDeque deque;
+    std::thread thread;
+  };
+
+  struct Current {
+    const ThreadPool* pool = nullptr;
+    Worker* worker = nullptr;
+  };
+
+  static Current& current() {
+    static thread_local Current c;
+    return c;
+  }
+
+  Worker* current_worker() const {
+    const Current& c = current();
+    return c.pool == this ? c.worker : nullptr;
+  }
+
+  detail::PoolTask* find_task(Worker* self) {
+    if (self) {
+      if (auto* task = self->deque.pop()) return task;
+    }
+    if (m_injected_size.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard lock(m_mutex);
+      if (!m_injected.empty()) {
+        auto* task = m_injected.front();
+        m_injected.pop_front();
+        m_injected_size.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+      }
+    }
+    // Victims in turn, starting after ourselves so thieves spread out.
+    std::size_t n = m_workers.size();
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      if (m_workers[i].get() == self) start = i + 1;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      Worker* victim = m_workers[(start + i) % n].get();
+      if (victim == self) continue;
+      if (auto* task = victim->deque.steal()) return task;
+    }
+    return nullptr;
+  }
+
+  void work(unsigned index) {
+    Worker* self = m_workers[index].get();
+    current() = {this, self};
+    for (;;) {
+      uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+      if (detail::PoolTask* task = find_task(self)) {
+        task->run(task);
+        continue;
+      }
+      // Nothing found since `epoch`: sleep until something is submitted.
+      // submit() bumps the epoch before it checks for sleepers, so either
+      // it sees this worker asleep or this worker sees the new epoch.
+      m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+      bool stop;
+      {
+        std::unique_lock lock(m_mutex);
+        m_wake.wait(lock, [&] {
+          return m_stop || m_epoch.load(std::memory_order_seq_cst) != epoch;
+        });
+        stop = m_stop;
+      }
+      m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+      if (stop && !find_pending()) return;
+    }
+  }
+
+  bool find_pending() const {
+    if (m_injected_size.load(std::memory_order_relaxed) > 0) return true;
+    return std::any_of(m_workers.begin(), m_workers.end(),
+                       [](const auto& w) { return !w->deque.empty(); });
+  }
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::deque<detail::PoolTask*> m_injected;
+  std::atomic<std::size_t> m_injected_size{0};
+  std::atomic<uint64_t> m_epoch{0};
+  std::atomic<unsigned> m_sleeping{0};
+  bool m_stop = false;
+};
+
+// Shared by the bulk functions when no pool is passed. Created on first
+// use with a worker per hardware thread, less the one calling.
+inline ThreadPool& default_thread_pool() {
+  static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) -
+                         1);
+  return pool;
+}
+
+//--------------------------------------------
+// Parallel loops
+//--------------------------------------------
+
+namespace detail {
+
+template <typename F>
+struct ParallelFor {
+  ParallelFor(ThreadPool& pool, F& fn, std::size_t grain)
+      : pool{pool}, fn{fn}, grain{grain} {}
+
+  ThreadPool& pool;
+  F& fn;
+  std::size_t grain;
+  std::atomic<std::size_t> pending{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  struct Task : PoolTask {
+    ParallelFor* job;
+    std::size_t begin;
+    std::size_t end;
+  };
+
+  void spawn(std::size_t begin, std::size_t end) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    pool.submit(new Task{{&ParallelFor::run}, this, begin, end});
+  }
+
+  // Keeps the left half and hands the right one out until a grain is left.
+  static void run(PoolTask* base) {
+    auto* task = static_cast<Task*>(base);
+    ParallelFor& job = *task->job;
+    std::size_t begin = task->begin;
+    std::size_t end = task->end;
+    delete task;
+    while (end - begin > job.grain) {
+      std::size_t mid = begin + (end - begin) / 2;
+      job.spawn(mid, end);
+      end = mid;
+    }
+    if (!job.failed.load(std::memory_order_relaxed)) {
+      try {
+        job.fn(begin, end);
+      } catch (...) {
+        std::lock_guard lock(job.error_mutex);
+        if (!job.error) job.error = std::current_exception();
+        job.failed.store(true, std::memory_order_relaxed);
+      }
+    }
+    job.pending.fetch_sub(1, std::memory_order_acq_rel);
+  }
+};
+
+inline std::size_t default_grain(const ThreadPool& pool, std::size_t n) {
+  return std::max<std::size_t>(n / (8 * (pool.size() + 1)), 1);
+}
+
+}  // namespace detail
+
+// Calls fn(begin, end) on disjoint subranges covering [begin, end), each
+// at most `grain` long (0 picks about eight per thread). Returns when all
+// have run; the first exception thrown by fn is rethrown here, and ranges
+// not yet started are skipped after it.
+template <typename F>
+void parallel_for(ThreadPool& pool, std::size_t begin, std::size_t end,
+                  std::size_t grain, F&& fn) {
+  if (begin >= end) return;
+  if (grain == 0) grain = detail::default_grain(pool, end - begin);
+  if (end - begin <= grain || pool.size() == 0) {
+    for (std::size_t b = begin; b < end; b += grain) {
+      fn(b, std::min(b + grain, end));
+    }
+    return;
+  }
+  detail::ParallelFor<F> job{pool, fn, grain};
+  job.spawn(begin, end);
+  pool.help_until(
+      [&] { return job.pending.load(std::memory_order_acquire) == 0; });
+  if (job.error) std::rethrow_exception(job.error);
+}
+
+template <typename F>
+void parallel_for(std::size_t begin, std::size_t end, std::size_t grain,
+                  F&& fn) {
+  parallel_for(default_thread_pool(), begin, end, grain, std::forward<F>(fn));
+}
+
+// Reduces [begin, end) in chunks of `grain`: map(b, e) gives each chunk's
+// value, and the values are folded with combine() from left to right
+// starting at `identity`. The chunks only depend on the range and the
+// grain, so floating-point results do not change with the thread count.
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(ThreadPool& pool, std::size_t begin, std::size_t end,
+                  std::size_t grain, T identity, Map&& map,
+                  Combine&& combine) {
+  if (begin >= end) return identity;
+  if (grain == 0) grain = detail::default_grain(pool, end - begin);
+  std::size_t chunks = (end - begin + grain - 1) / grain;
+  std::vector<T> partial(chunks, identity);
+  parallel_for(pool, 0, chunks, 1, [&](std::size_t first, std::size_t last) {
+    for (std::size_t c = first; c < last; ++c) {
+      std::size_t b = begin + c * grain;
+      partial[c] = map(b, std::min(b + grain, end));
+    }
+  });
+  T result = std::move(identity);
+  for (auto& p : partial) result = combine(std::move(result), std::move(p));
+  return result;
+}
+
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(std::size_t begin, std::size_t end, std::size_t grain,
+                  T identity, Map&& map, Combine&& combine) {
+  return parallel_reduce(default_thread_pool(), begin, end, grain,
+                         std::move(identity), std::forward<Map>(map),
+                         std::forward<Combine>(combine));
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "bvh.h"
+#include "mat4.h"
+#include "point3.h"
+#include "ray.h"
+#include "thread_pool.h"
+#include "transform.h"
+#include "types.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Two-level acceleration structure
+//--------------------------------------------
+//
+// A scene of many placed copies of few meshes. Each mesh has one Bvh, the
+// bottom level, shared by all its instances; the top level is a tree of
+// the same kind over the instances' world-space boxes. A ray that reaches
+// an instance is moved into the mesh's space by the instance's
+// world-to-object matrix, inverted once at build time and kept as 3x4
+// rows, and traced through the mesh's Bvh there. Directions are not
+// renormalized, so ray parameters mean the same in both spaces and the
+// nearest hit so far bounds every later instance.
+//
+// Memory grows with the number of meshes' triangles plus about 80 bytes
+// per instance, instead of with every placed triangle.
+
+// A mesh placed in the world.
+template <numeric T>
+struct Instance {
+  uint32_t mesh = 0;        // index into the Tlas's meshes
+  Mat4<T> object_to_world;  // affine
+};
+
+using Instancef = Instance<float>;
+using Instanced = Instance<double>;
+
+template <numeric T>
+struct InstanceHit {
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  uint32_t instance = kNone;
+  uint32_t triangle = kNone;  // in the instance's mesh
+  T t = std::numeric_limits<T>::infinity();
+  T u = T{0};
+  T v = T{0};
+
+  bool hit() const { return instance != kNone; }
+  bool operator==(const InstanceHit&) const = default;
+};
+
+template <numeric T>
+class Tlas {
+ public:
+  Tlas() = default;
+
+  // Does not copy meshes, which must outlive the Tlas. Throws
+  // std::invalid_argument if an instance names a mesh that is not there.
+  Tlas(std::span<const Bvh<T>> meshes, std::span<const Instance<T>> instances,
+       ThreadPool& pool)
+      : m_meshes(meshes) {
+    build(instances, pool);
+  }
+
+  Tlas(std::span<const Bvh<T>> meshes, std::span<const Instance<T>> instances)
+      : Tlas(meshes, instances, default_thread_pool()) {}
+
+  std::size_t size() const { return m_placed.size(); }
+  bool empty() const { return m_placed.empty(); }
+  std::size_t node_count() const { return m_nodes.size(); }
+  std::span<const Bvh<T>> meshes() const { return m_meshes; }
+
+  AABB<T> bounds() const { return empty() ? AABB<T>() : m_nodes[0].box; }
+
+  //--------------------------------------------
+  // Nearest hit
+  //--------------------------------------------
+
+  InstanceHit<T> intersect(const Point3<T>& origin, const Vec3<T>& direction,
+                           T tmin, T tmax) const {
+    InstanceHit<T> hit;
+    hit.t = tmax;
+    traverse(origin, direction, tmin, hit.t, [&](const Placed& p) {
+      TriangleHit<T> found = m_meshes[p.mesh].intersect(
+          detail::apply(p.to_object, origin, T{1}),
+          detail::apply(p.to_object, direction, T{0}), tmin, hit.t);
+      if (!found.hit()) return false;
+      hit = {p.instance, found.triangle, found.t, found.u, found.v};
+      return false;
+    });
+    return hit.hit() ? hit : InstanceHit<T>{};
+  }
+
+  InstanceHit<T> intersect(const Ray& ray) const {
+    return intersect(detail::point_from<T>(ray.origin()),
+                     detail::vector_from<T>(ray.direction()),
+                     static_cast<T>(ray.getMinRange()),
+                     static_cast<T>(ray.getMaxRange()));
+  }
+
+  // hits[i] is the nearest hit of rays[i].
+  void intersect(std::span<const Ray> rays, std::span<InstanceHit<T>> hits,
+                 ThreadPool& pool) const {
+    if (hits.size() < rays.size()) {
+      throw std::out_of_range("Output span is too small");
+    }
+    parallel_for(pool, 0, rays.size(), kQueryGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     hits[i] = intersect(rays[i]);
+                   }
+                 });
+  }
+
+  void intersect(std::span<const Ray> rays,
+                 std::span<InstanceHit<T>> hits) const {
+    intersect(rays, hits, default_thread_pool());
+  }
+
+  //--------------------------------------------
+  // Any hit
+  //--------------------------------------------
+
+  bool occluded(const Point3<T>& origin, const Vec3<T>& direction, T tmin,
+                T tmax) const {
+    bool blocked = false;
+    traverse(origin, direction, tmin, tmax, [&](const Placed& p) {
+      blocked = m_meshes[p.mesh].occluded(
+          detail::apply(p.to_object, origin, T{1}),
+          detail::apply(p.to_object, direction, T{0}), tmin, tmax);
+      return blocked;
+    });
+    return blocked;
+  }
+
+  bool occluded(const Ray& ray) const {
+    return occluded(detail::point_from<T>(ray.origin()),
+                    detail::vector_from<T>(ray.direction()),
+                    static_cast<T>(ray.getMinRange()),
+                    static_cast<T>(ray.getMaxRange()));
+  }
+
+  // occluded[i] is 1 if rays[i] is occluded and 0 if not.
+  void occluded(std::span<const Ray> rays, std::span<uint8_t> occluded,
+                ThreadPool& pool) const {
+    if (occluded.size() < rays.size()) {
+      throw std::out_of_range("Output span is too small");
+    }
+    parallel_for(pool, 0, rays.size(), kQueryGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     occluded[i] = this->occluded(rays[i]);
+                   }
+                 });
+  }
+
+  void occluded(std::span<const Ray> rays, std::span<uint8_t> occluded) const {
+    this->occluded(rays, occluded, default_thread_pool());
+  }
+
+ private:
+  static constexpr int kStackSize = detail::kBvhStackSize;
+  static constexpr std::size_t kQueryGrain = 64;
+
+  // An instance as the traversal needs it, in leaf order.
+  struct Placed {
+    detail::Affine<T> to_object;
+    uint32_t mesh;
+    uint32_t instance;  // index in the input
+  };
+
+  void build(std::span<const Instance<T>> instances, ThreadPool& pool) {
+    std::vector<AABB<T>> boxes(instances.size());
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+      if (instances[i].mesh >= m_meshes.size()) {
+        throw std::invalid_argument("Instance of a mesh that is not there");
+      }
+    }
+    parallel_for(pool, 0, instances.size(), kQueryGrain,
+                 [&](std::size_t begin, std::size_t end) {
+                   for (std::size_t i = begin; i < end; ++i) {
+                     boxes[i] = world_bounds(instances[i]);
+                   }
+                 });
+    std::vector<uint32_t> order;
+    detail::BvhBuilder<T>::build(boxes, m_nodes, order, pool);
+    m_placed.clear();
+    m_placed.reserve(instances.size());
+    for (uint32_t i : order) {
+      m_placed.push_back({detail::Affine<T>(
+                              instances[i].object_to_world.inverse()),
+                          instances[i].mesh, i});
+    }
+  }
+
+  // Box around the corners of the mesh's box placed by the instance.
+  AABB<T> world_bounds(const Instance<T>& instance) const {
+    AABB<T> box = m_meshes[instance.mesh].bounds();
+    AABB<T> out;
+    if (box.empty()) return out;
+    detail::Affine<T> to_world(instance.object_to_world);
+    for (int corner = 0; corner < 8; ++corner) {
+      Point3<T> p(corner & 1 ? box.max().x() : box.min().x(),
+                  corner & 2 ? box.max().y() : box.min().y(),
+                  corner & 4 ? box.max().z() : box.min().z());
+      out.expand(detail::apply(to_world, p, T{1}));
+    }
+    return out;
+  }
+
+  // Calls visit(placed) for every instance whose box the ray enters before
+  // tmax, which visit may lower, until visit returns true.
+  template <typename Visit>
+  void traverse(const Point3<T>& origin, const Vec3<T>& direction, T tmin,
+                const T& tmax, Visit&& visit) const {
+    if (empty()) return;
+    detail::SlabRay<T> slab(origin, direction);
+    constexpr T kMiss = std::numeric_limits<T>::infinity();
+    if (slab.enter(m_nodes[0].box, tmin, tmax) == kMiss) return;
+
+    // Pending far children and where the ray enters them.
+    std::pair<uint32_t, T> stack[kStackSize];
+    int top = 0;
+    uint32_t node = 0;
+    while (true) {
+      const BvhNode<T>& n = m_nodes[node];
+      if (n.leaf()) {
+        for (uint32_t s = n.first; s < n.first + n.count; ++s) {
+          if (visit(m_placed[s])) return;
+        }
+      } else {
+        T near = slab.enter(m_nodes[n.first].box, tmin, tmax);
+        T far = slab.enter(m_nodes[n.first + 1].box, tmin, tmax);
+        uint32_t near_node = n.first, far_node = n.first + 1;
+        if (far < near) {
+          std::swap(near, far);
+          std::swap(near_node, far_node);
+        }
+        if (near != kMiss) {
+          if (far != kMiss) stack[top++] = {far_node, far};
+          node = near_node;
+          continue;
+        }
+      }
+      while (top > 0 && stack[top - 1].second >= tmax) --top;
+      if (top == 0) return;
+      node = stack[--top].first;
+    }
+  }
+
+  std::span<const Bvh<T>> m_meshes;
+  std::vector<BvhNode<T>> m_nodes;  // root first
+  std::vector<Placed> m_placed;     // in leaf order
+};
+
+using Tlasf = Tlas<float>;
+using Tlasd = Tlas<double>;
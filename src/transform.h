@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+
+#include "mat4.h"
+#include "normal3.h"
+#include "point3.h"
+#include "ray.h"
+#include "thread_pool.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Batch transforms
+//--------------------------------------------
+//
+// Apply one affine Mat4 to whole arrays. Points get the translation,
+// vectors do not, and normals are multiplied by the inverse transpose of
+// the upper 3x3, computed once per call. Rays get both in one pass, their
+// direction not renormalized, so that ray parameters and ranges mean the
+// same points after the transform. The bottom row is assumed to be
+// 0 0 0 1; no divide by w. in and out may be the same span.
+
+namespace detail {
+
+// Row-major 3x4 copy of the matrix so the loops do not go through Vec4.
+template <numeric T>
+struct Affine {
+  explicit Affine(const Mat4<T>& m) {
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 4; ++c) e[r][c] = m[r][c];
+    }
+  }
+
+  T e[3][4];
+};
+
+template <numeric T, typename V>
+V apply(const Affine<T>& a, const V& v, T w) {
+  return V(a.e[0][0] * v.x() + a.e[0][1] * v.y() + a.e[0][2] * v.z() +
+               a.e[0][3] * w,
+           a.e[1][0] * v.x() + a.e[1][1] * v.y() + a.e[1][2] * v.z() +
+               a.e[1][3] * w,
+           a.e[2][0] * v.x() + a.e[2][1] * v.y() + a.e[2][2] * v.z() +
+               a.e[2][3] * w);
+}
+
+inline Ray apply(const Affine<float>& a, const Ray& ray) {
+  Ray out(apply(a, ray.origin(), 1.f), apply(a, ray.direction(), 0.f));
+  out.setMinRange(ray.getMinRange());
+  out.setMaxRange(ray.getMaxRange());
+  return out;
+}
+
+template <numeric T, typename V>
+void transform_span(const Affine<T>& a, T w, std::span<const V> in,
+                    std::span<V> out, ThreadPool& pool) {
+  if (out.size() < in.size()) {
+    throw std::out_of_range("Output span is too small");
+  }
+  constexpr std::size_t kGrain = std::size_t{1} << 13;
+  parallel_for(pool, 0, in.size(), kGrain,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; ++i) {
+                   out[i] = apply(a, in[i], w);
+                 }
+               });
+}
+
+}  // namespace detail
+
+template <numeric T>
+void transform_points(const Mat4<T>& m, std::span<const Point3<T>> in,
+                      std::span<Point3<T>> out, ThreadPool& pool) {
+  detail::transform_span(detail::Affine<T>(m), T{1}, in, out, pool);
+}
+
+template <numeric T>
+void transform_vectors(const Mat4<T>& m, std::span<const Vec3<T>> in,
+                       std::span<Vec3<T>> out, ThreadPool& pool) {
+  detail::transform_span(detail::Affine<T>(m), T{0}, in, out, pool);
+}
+
+// Not renormalized: scale it back if the matrix is not a rotation.
+template <numeric T>
+void transform_normals(const Mat4<T>& m, std::span<const Normal3<T>> in,
+                       std::span<Normal3<T>> out, ThreadPool& pool) {
+  detail::transform_span(detail::Affine<T>(m.inverse().transpose()), T{0},
+                         in, out, pool);
+}
+
+inline void transform_rays(const Mat4f& m, std::span<const Ray> in,
+                           std::span<Ray> out, ThreadPool& pool) {
+  detail::Affine<float> a(m);
+  if (out.size() < in.size()) {
+    throw std::out_of_range("Output span is too small");
+  }
+  constexpr std::size_t kGrain = std::size_t{1} << 12;
+  parallel_for(pool, 0, in.size(), kGrain,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; ++i) {
+                   out[i] = detail::apply(a, in[i]);
+                 }
+               });
+}
+
+template <numeric T>
+void transform_points(const Mat4<T>& m, std::span<const Point3<T>> in,
+                      std::span<Point3<T>> out) {
+  transform_points(m, in, out, default_thread_pool());
+}
+
+template <numeric T>
+void transform_vectors(const Mat4<T>& m, std::span<const Vec3<T>> in,
+                       std::span<Vec3<T>> out) {
+  transform_vectors(m, in, out, default_thread_pool());
+}
+
+template <numeric T>
+void transform_normals(const Mat4<T>& m, std::span<const Normal3<T>> in,
+                       std::span<Normal3<T>> out) {
+  transform_normals(m, in, out, default_thread_pool());
+}
+
+inline void transform_rays(const Mat4f& m, std::span<const Ray> in,
+                           std::span<Ray> out) {
+  transform_rays(m, in, out, default_thread_pool());
+}
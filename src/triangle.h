@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "aabb.h"
+#include "point3.h"
+#include "types.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Triangle
+//--------------------------------------------
+
+template <numeric T>
+struct Triangle {
+  Point3<T> a, b, c;
+
+  AABB<T> bounds() const {
+    AABB<T> box(a);
+    box.expand(b);
+    box.expand(c);
+    return box;
+  }
+
+  Point3<T> centroid() const {
+    return Point3<T>((a.x() + b.x() + c.x()) / T{3},
+                     (a.y() + b.y() + c.y()) / T{3},
+                     (a.z() + b.z() + c.z()) / T{3});
+  }
+
+  // Not normalized; its length is twice the area. Counter-clockwise
+  // vertices face it.
+  Vec3<T> normal() const { return cross(b - a, c - a); }
+
+  bool operator==(const Triangle&) const = default;
+};
+
+using Trianglef = Triangle<float>;
+using Triangled = Triangle<double>;
+
+// Nearest hit found so far along a ray. The point hit is
+// (1 - u - v) * a + u * b + v * c.
+template <numeric T>
+struct TriangleHit {
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  uint32_t triangle = kNone;
+  T t = std::numeric_limits<T>::infinity();
+  T u = T{0};
+  T v = T{0};
+
+  bool hit() const { return triangle != kNone; }
+  bool operator==(const TriangleHit&) const = default;
+};
+
+//--------------------------------------------
+// Ray-triangle intersection
+//--------------------------------------------
+// Möller and Trumbore, "Fast, Minimum Storage Ray/Triangle Intersection"
+// (1997). Both faces are hit.
+
+// Whether the ray origin + t * direction hits the triangle for t in
+// [tmin, hit.t); if so stores t, u and v in hit and leaves hit.triangle to
+// the caller.
+template <numeric T>
+bool intersect(const Triangle<T>& tri, const Point3<T>& origin,
+               const Vec3<T>& direction, T tmin, TriangleHit<T>& hit) {
+  Vec3<T> e1 = tri.b - tri.a;
+  Vec3<T> e2 = tri.c - tri.a;
+  Vec3<T> p = cross(direction, e2);
+  T det = dot(e1, p);
+  // Parallel to the plane, or degenerate.
+  if (std::abs(det) < std::numeric_limits<T>::min()) return false;
+  T inv = T{1} / det;
+  Vec3<T> s = origin - tri.a;
+  T u = dot(s, p) * inv;
+  if (u < T{0} || u > T{1}) return false;
+  Vec3<T> q = cross(s, e1);
+  T v = dot(direction, q) * inv;
+  if (v < T{0} || u + v > T{1}) return false;
+  T t = dot(e2, q) * inv;
+  if (t < tmin || !(t < hit.t)) return false;
+  hit.t = t;
+  hit.u = u;
+  hit.v = v;
+  return true;
+}
+
+// Whether the triangle lies on origin + t * direction for any t in
+// [tmin, tmax), for shadow rays. The same test as intersect() with the
+// division deferred: the comparisons are scaled by the determinant
+// instead, and u, v and t are never formed.
+template <numeric T>
+bool occludes(const Triangle<T>& tri, const Point3<T>& origin,
+              const Vec3<T>& direction, T tmin, T tmax) {
+  Vec3<T> e1 = tri.b - tri.a;
+  Vec3<T> e2 = tri.c - tri.a;
+  Vec3<T> p = cross(direction, e2);
+  T det = dot(e1, p);
+  if (std::abs(det) < std::numeric_limits<T>::min()) return false;
+  T sign = det < T{0} ? T{-1} : T{1};
+  T scale = std::abs(det);
+  Vec3<T> s = origin - tri.a;
+  T u = dot(s, p) * sign;
+  if (u < T{0} || u > scale) return false;
+  Vec3<T> q = cross(s, e1);
+  T v = dot(direction, q) * sign;
+  if (v < T{0} || u + v > scale) return false;
+  T t = dot(e2, q) * sign;
+  return t >= tmin * scale && t < tmax * scale;
+}
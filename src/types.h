@@ -2,8 +2,47 @@
 
 #include <concepts>
 #include <type_traits>
+#include <utility>
 
+// Compact storage scalars that compute in float (half, unorm8, ... in
+// quantized.h) opt in to `numeric` by specializing this.
 template <typename T>
-concept numeric = std::is_arithmetic_v<T> && !std::same_as<T, bool> &&
-                  !std::same_as<T, char> && !std::same_as<T, char16_t> &&
-                  !std::same_as<T, char32_t> && !std::same_as<T, wchar_t>;
\ No newline at end of file
+inline constexpr bool is_storage_scalar = false;
+
+// SIMD lanes (Simd<T, N> in simd.h) opt in the same way. Comparing two of
+// them gives a mask of lanes instead of a bool.
+template <typename T>
+inline constexpr bool is_simd_lane = false;
+
+template <typename T>
+concept numeric = (std::is_arithmetic_v<T> && !std::same_as<T, bool> &&
+                   !std::same_as<T, char> && !std::same_as<T, char16_t> &&
+                   !std::same_as<T, char32_t> &&
+                   !std::same_as<T, wchar_t>) ||
+                  is_storage_scalar<T> || is_simd_lane<T>;
+
+//--------------------------------------------
+// Lane-generic conditions
+//--------------------------------------------
+// Code written against these runs on scalars, where a comparison gives a
+// bool, and on SIMD lanes, where it gives a mask: select() instead of a
+// branch on the comparison, any() or all() where an `if` needs one bool.
+// Simd has the mask overloads.
+
+// What comparing two T gives.
+template <typename T>
+using mask_t = decltype(std::declval<T>() < std::declval<T>());
+
+// What to accumulate T in where extra precision is cheap: double for
+// scalars, T itself for SIMD lanes.
+template <typename T>
+using wide_t = std::conditional_t<is_simd_lane<T>, T, double>;
+
+inline bool any(bool condition) { return condition; }
+inline bool all(bool condition) { return condition; }
+inline bool none(bool condition) { return !condition; }
+
+template <numeric T>
+T select(bool condition, const T& a, const T& b) {
+  return condition ? a : b;
+}
@@ -44,15 +44,17 @@ class Vec2 {
 
   void normalize() {
     auto l = length();
-    if (l < std::numeric_limits<double>::epsilon()) {
-      l += static_cast<T>(1E-6);
-    }
+    l += select(l < std::numeric_limits<double>::epsilon(),
+                static_cast<T>(1E-6), T{0});
     m_x = static_cast<T>(m_x / l);
     m_y = static_cast<T>(m_y / l);
   }
 
   auto length() const { return static_cast<T>(sqrt(m_x * m_x + m_y * m_y)); }
-  bool is_zero() const { return *this == Vec2<T>(T{0}, T{0}); }
+  // Per lane for SIMD lanes.
+  mask_t<T> is_zero() const {
+    return mask_t<T>((m_x == T{0}) & (m_y == T{0}));
+  }
 
  private:
   T m_x = T{0};
@@ -132,7 +134,7 @@ Vec2<T> operator*(T num, const Vec2<T>& v) {
 
 template <numeric T>
 Vec2<T> operator/(const Vec2<T>& v1, const Vec2<T>& v2) {
-  if (v2.is_zero()) {
+  if (any(v2.is_zero())) {
     throw std::runtime_error("Cannot divide by zero 2D vector");
   }
   return Vec2<T>(v1.x() / v2.x(), v1.y() / v2.y());
@@ -140,7 +142,7 @@ Vec2<T> operator/(const Vec2<T>& v1, const Vec2<T>& v2) {
 
 template <numeric T>
 Vec2<T> operator/(const Vec2<T>& v, T num) {
-  if (num == T{0}) {
+  if (any(num == T{0})) {
     throw std::runtime_error("Cannot divide by zero number");
   }
   return Vec2<T>(v.x() / num, v.y() / num);
@@ -159,8 +161,33 @@ T dot(const Vec2<T>& v1, const Vec2<T>& v2) {
 template <numeric T>
 Vec2<T> normalized(const Vec2<T>& v) {
   auto l = v.length();
-  if (l < std::numeric_limits<double>::epsilon()) {
-    l += static_cast<T>(1E-6);
-  }
+  l += select(l < std::numeric_limits<double>::epsilon(),
+              static_cast<T>(1E-6), T{0});
   return Vec2<T>{static_cast<T>(v.x() / l), static_cast<T>(v.y() / l)};
 }
+
+//--------------------------------------------
+// Explicit instantiation of the common aliases
+//--------------------------------------------
+// Expanded with `extern` here when MATH_EXTERN_TEMPLATES is defined (linking
+// math_instantiated does that) and without it in math_instantiated.cpp.
+
+#define MATH_INSTANTIATE_VEC2(EXTERN, T)                             \
+  EXTERN template class Vec2<T>;                                     \
+  EXTERN template Vec2<T> operator+(const Vec2<T>&, const Vec2<T>&); \
+  EXTERN template Vec2<T> operator+(const Vec2<T>&, T);              \
+  EXTERN template Vec2<T> operator-(const Vec2<T>&, const Vec2<T>&); \
+  EXTERN template Vec2<T> operator-(const Vec2<T>&, T);              \
+  EXTERN template Vec2<T> operator*(const Vec2<T>&, const Vec2<T>&); \
+  EXTERN template Vec2<T> operator*(const Vec2<T>&, T);              \
+  EXTERN template Vec2<T> operator*(T, const Vec2<T>&);              \
+  EXTERN template Vec2<T> operator/(const Vec2<T>&, const Vec2<T>&); \
+  EXTERN template Vec2<T> operator/(const Vec2<T>&, T);              \
+  EXTERN template T dot(const Vec2<T>&, const Vec2<T>&);             \
+  EXTERN template Vec2<T> normalized(const Vec2<T>&)
+
+#ifdef MATH_EXTERN_TEMPLATES
+MATH_INSTANTIATE_VEC2(extern, int);
+MATH_INSTANTIATE_VEC2(extern, float);
+MATH_INSTANTIATE_VEC2(extern, double);
+#endif
@@ -68,9 +68,8 @@ class Vec3 {
 
   void normalize() {
     auto l = length();
-    if (l < std::numeric_limits<double>::epsilon()) {
-      l += static_cast<T>(1E-6);
-    }
+    l += select(l < std::numeric_limits<double>::epsilon(),
+                static_cast<T>(1E-6), T{0});
     m_x = static_cast<T>(m_x / l);
     m_y = static_cast<T>(m_y / l);
     m_z = static_cast<T>(m_z / l);
@@ -80,7 +79,10 @@ class Vec3 {
     return static_cast<T>(sqrt(x() * x() + y() * y() + z() * z()));
   }
 
-  bool is_zero() const { return *this == Vec3<T>(T{0}, T{0}, T{0}); }
+  // Per lane for SIMD lanes.
+  mask_t<T> is_zero() const {
+    return mask_t<T>((m_x == T{0}) & (m_y == T{0}) & (m_z == T{0}));
+  }
 
   void zero() {
     m_x = T{0};
@@ -112,7 +114,7 @@ inline std::istream& operator>>(std::istream& in, Vec3<T>& v) {
 
 template <numeric T>
 inline std::ostream& operator<<(std::ostream& out, const Vec3<T>& v) {
-  out << "(" << v.x() << "," << v.y() << "," << v.z() << ")" << std::endl;
+  out << "(" << v.x() << "," << v.y() << "," << v.z() << ")";
   return out;
 }
 
@@ -167,7 +169,7 @@ Vec3<T> operator*(T num, const Vec3<T>& v) {
 
 template <numeric T>
 Vec3<T> operator/(const Vec3<T>& v1, const Vec3<T>& v2) {
-  if (v2.is_zero()) {
+  if (any(v2.is_zero())) {
     throw std::runtime_error("Cannot divide by zero 3D vector");
   }
   return Vec3<T>(v1.x() / v2.x(), v1.y() / v2.y(), v1.z() / v2.z());
@@ -175,7 +177,7 @@ Vec3<T> operator/(const Vec3<T>& v1, const Vec3<T>& v2) {
 
 template <numeric T>
 Vec3<T> operator/(const Vec3<T>& v, T num) {
-  if (num == T{0}) {
+  if (any(num == T{0})) {
     throw std::runtime_error("Cannot divide by zero number");
   }
   return Vec3<T>(v.x() / num, v.y() / num, v.z() / num);
@@ -186,9 +188,8 @@ Vec3<T> operator/(const Vec3<T>& v, T num) {
 //--------------------------------------------
 
 template <numeric T>
-auto dot(const Vec3<T>& v1, const Vec3<T>& v2) {
-  Vec3<T> v = v1 * v2;
-  return v.x() + v.y() + v.z();
+T dot(const Vec3<T>& v1, const Vec3<T>& v2) {
+  return v1.x() * v2.x() + v1.y() * v2.y() + v1.z() * v2.z();
 }
 
 template <numeric T>
@@ -202,9 +203,8 @@ Vec3<T> cross(const Vec3<T>& v1, const Vec3<T>& v2) {
 template <numeric T>
 Vec3<T> normalized(const Vec3<T>& v) {
   auto l = v.length();
-  if (l < std::numeric_limits<double>::epsilon()) {
-    l += static_cast<T>(1E-6);
-  }
+  l += select(l < std::numeric_limits<double>::epsilon(),
+              static_cast<T>(1E-6), T{0});
   return v / static_cast<T>(l);
 }
 
@@ -212,3 +212,31 @@ template <numeric T>
 Vec3<T> reflect(const Vec3<T>& in, const Vec3<T>& normal) {
   return in - normal * T{2} * dot(in, normal);
 }
+
+//--------------------------------------------
+// Explicit instantiation of the common aliases
+//--------------------------------------------
+// Expanded with `extern` here when MATH_EXTERN_TEMPLATES is defined (linking
+// math_instantiated does that) and without it in math_instantiated.cpp.
+
+#define MATH_INSTANTIATE_VEC3(EXTERN, T)                             \
+  EXTERN template class Vec3<T>;                                     \
+  EXTERN template Vec3<T> operator+(const Vec3<T>&, const Vec3<T>&); \
+  EXTERN template Vec3<T> operator+(const Vec3<T>&, T);              \
+  EXTERN template Vec3<T> operator-(const Vec3<T>&, const Vec3<T>&); \
+  EXTERN template Vec3<T> operator-(const Vec3<T>&, T);              \
+  EXTERN template Vec3<T> operator*(const Vec3<T>&, const Vec3<T>&); \
+  EXTERN template Vec3<T> operator*(const Vec3<T>&, T);              \
+  EXTERN template Vec3<T> operator*(T, const Vec3<T>&);              \
+  EXTERN template Vec3<T> operator/(const Vec3<T>&, const Vec3<T>&); \
+  EXTERN template Vec3<T> operator/(const Vec3<T>&, T);              \
+  EXTERN template T dot(const Vec3<T>&, const Vec3<T>&);             \
+  EXTERN template Vec3<T> cross(const Vec3<T>&, const Vec3<T>&);     \
+  EXTERN template Vec3<T> normalized(const Vec3<T>&);                \
+  EXTERN template Vec3<T> reflect(const Vec3<T>&, const Vec3<T>&)
+
+#ifdef MATH_EXTERN_TEMPLATES
+MATH_INSTANTIATE_VEC3(extern, int);
+MATH_INSTANTIATE_VEC3(extern, float);
+MATH_INSTANTIATE_VEC3(extern, double);
+#endif
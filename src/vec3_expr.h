@@ -0,0 +1,321 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+#include <type_traits>
+
+#include "quat.h"
+#include "types.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Lazy Vec3 expressions
+//--------------------------------------------
+//
+// Opt-in expression templates for Vec3 arithmetic. Wrapping an operand with
+// expr::lazy() makes the operators build a small expression tree instead of
+// a Vec3 per operator; the tree is evaluated component by component when it
+// is converted to a Vec3, so a whole chain costs one pass and no temporaries
+// even when the optimizer does not run (-O0/-O1):
+//
+//   Vec3f r = expr::lazy(a) + b * s - c * t;
+//
+// Products feeding a sum are contracted into std::fma when the target has a
+// fast fused multiply-add (FP_FAST_FMAF / FP_FAST_FMA).
+//
+// Leaves hold references to their Vec3, so an expression must be evaluated
+// within the full expression that created it; do not keep one in an auto.
+
+namespace expr {
+
+template <typename T>
+inline T madd(T a, T b, T c) {
+  if constexpr (std::is_same_v<T, float>) {
+#ifdef FP_FAST_FMAF
+    return std::fma(a, b, c);
+#endif
+  } else if constexpr (std::is_same_v<T, double>) {
+#ifdef FP_FAST_FMA
+    return std::fma(a, b, c);
+#endif
+  }
+  return a * b + c;
+}
+
+// CRTP base of every node. value_type is the scalar of the result.
+template <typename E, numeric T>
+class Vec3Expr {
+ public:
+  using value_type = T;
+
+  const E& self() const { return static_cast<const E&>(*this); }
+
+  Vec3<T> eval() const { return Vec3<T>(self().x(), self().y(), self().z()); }
+  operator Vec3<T>() const { return eval(); }
+};
+
+template <typename E>
+concept expression = requires { typename E::value_type; } &&
+                     std::derived_from<E, Vec3Expr<E, typename E::value_type>>;
+
+//--------------------------------------------
+// Nodes
+//--------------------------------------------
+
+template <numeric T>
+class Leaf : public Vec3Expr<Leaf<T>, T> {
+ public:
+  explicit Leaf(const Vec3<T>& v) : m_v{v} {}
+
+  T x() const { return m_v.x(); }
+  T y() const { return m_v.y(); }
+  T z() const { return m_v.z(); }
+
+ private:
+  const Vec3<T>& m_v;
+};
+
+template <expression L, expression R>
+class Sum : public Vec3Expr<Sum<L, R>, typename L::value_type> {
+ public:
+  Sum(const L& l, const R& r) : m_l{l}, m_r{r} {}
+
+  auto x() const { return m_l.x() + m_r.x(); }
+  auto y() const { return m_l.y() + m_r.y(); }
+  auto z() const { return m_l.z() + m_r.z(); }
+
+ private:
+  L m_l;
+  R m_r;
+};
+
+template <expression L, expression R>
+class Difference : public Vec3Expr<Difference<L, R>, typename L::value_type> {
+ public:
+  Difference(const L& l, const R& r) : m_l{l}, m_r{r} {}
+
+  auto x() const { return m_l.x() - m_r.x(); }
+  auto y() const { return m_l.y() - m_r.y(); }
+  auto z() const { return m_l.z() - m_r.z(); }
+
+ private:
+  L m_l;
+  R m_r;
+};
+
+template <expression L, expression R>
+class Product : public Vec3Expr<Product<L, R>, typename L::value_type> {
+ public:
+  Product(const L& l, const R& r) : m_l{l}, m_r{r} {}
+
+  auto x() const { return m_l.x() * m_r.x(); }
+  auto y() const { return m_l.y() * m_r.y(); }
+  auto z() const { return m_l.z() * m_r.z(); }
+
+ private:
+  L m_l;
+  R m_r;
+};
+
+template <expression E>
+class Scaled : public Vec3Expr<Scaled<E>, typename E::value_type> {
+ public:
+  using T = typename E::value_type;
+
+  Scaled(const E& e, T s) : m_e{e}, m_s{s} {}
+
+  T x() const { return m_e.x() * m_s; }
+  T y() const { return m_e.y() * m_s; }
+  T z() const { return m_e.z() * m_s; }
+
+  const E& operand() const { return m_e; }
+  T factor() const { return m_s; }
+
+ private:
+  E m_e;
+  T m_s;
+};
+
+// e * s + r, contracted into one multiply-add per component.
+template <expression E, expression R>
+class ScaledSum : public Vec3Expr<ScaledSum<E, R>, typename E::value_type> {
+ public:
+  using T = typename E::value_type;
+
+  ScaledSum(const Scaled<E>& l, const R& r)
+      : m_e{l.operand()}, m_s{l.factor()}, m_r{r} {}
+
+  T x() const { return madd(m_e.x(), m_s, m_r.x()); }
+  T y() const { return madd(m_e.y(), m_s, m_r.y()); }
+  T z() const { return madd(m_e.z(), m_s, m_r.z()); }
+
+ private:
+  E m_e;
+  T m_s;
+  R m_r;
+};
+
+template <expression E>
+class Negated : public Vec3Expr<Negated<E>, typename E::value_type> {
+ public:
+  explicit Negated(const E& e) : m_e{e} {}
+
+  auto x() const { return -m_e.x(); }
+  auto y() const { return -m_e.y(); }
+  auto z() const { return -m_e.z(); }
+
+ private:
+  E m_e;
+};
+
+template <expression L, expression R>
+class Cross : public Vec3Expr<Cross<L, R>, typename L::value_type> {
+ public:
+  using T = typename L::value_type;
+
+  // Operands are evaluated once: every component needs two of each.
+  Cross(const L& l, const R& r)
+      : m_lx{l.x()},
+        m_ly{l.y()},
+        m_lz{l.z()},
+        m_rx{r.x()},
+        m_ry{r.y()},
+        m_rz{r.z()} {}
+
+  T x() const { return madd(m_ly, m_rz, -m_lz * m_ry); }
+  T y() const { return madd(m_lz, m_rx, -m_lx * m_rz); }
+  T z() const { return madd(m_lx, m_ry, -m_ly * m_rx); }
+
+ private:
+  T m_lx, m_ly, m_lz;
+  T m_rx, m_ry, m_rz;
+};
+
+//--------------------------------------------
+// Building expressions
+//--------------------------------------------
+
+template <numeric T>
+Leaf<T> lazy(const Vec3<T>& v) {
+  return Leaf<T>(v);
+}
+
+// Plain Vec3 operands mix freely with expressions.
+template <expression E>
+const E& as_expr(const E& e) {
+  return e;
+}
+
+template <numeric T>
+Leaf<T> as_expr(const Vec3<T>& v) {
+  return Leaf<T>(v);
+}
+
+template <typename L, typename R>
+concept operands = (expression<L> || expression<R>) && requires(L l, R r) {
+  as_expr(l);
+  as_expr(r);
+};
+
+template <typename L, typename R>
+  requires operands<L, R>
+auto operator+(const L& l, const R& r) {
+  auto a = as_expr(l);
+  auto b = as_expr(r);
+  using A = decltype(a);
+  using B = decltype(b);
+  if constexpr (requires { a.factor(); }) {
+    return ScaledSum<std::decay_t<decltype(a.operand())>, B>(a, b);
+  } else if constexpr (requires { b.factor(); }) {
+    return ScaledSum<std::decay_t<decltype(b.operand())>, A>(b, a);
+  } else {
+    return Sum<A, B>(a, b);
+  }
+}
+
+template <typename L, typename R>
+  requires operands<L, R>
+auto operator-(const L& l, const R& r) {
+  auto a = as_expr(l);
+  auto b = as_expr(r);
+  using A = decltype(a);
+  using B = decltype(b);
+  if constexpr (requires { b.factor(); }) {
+    // a - e * s == e * (-s) + a
+    using E = std::decay_t<decltype(b.operand())>;
+    return ScaledSum<E, A>(Scaled<E>(b.operand(), -b.factor()), a);
+  } else {
+    return Difference<A, B>(a, b);
+  }
+}
+
+template <typename L, typename R>
+  requires operands<L, R>
+auto operator*(const L& l, const R& r) {
+  auto a = as_expr(l);
+  auto b = as_expr(r);
+  return Product<decltype(a), decltype(b)>(a, b);
+}
+
+template <expression E>
+Scaled<E> operator*(const E& e, typename E::value_type s) {
+  return Scaled<E>(e, s);
+}
+
+template <expression E>
+Scaled<E> operator*(typename E::value_type s, const E& e) {
+  return Scaled<E>(e, s);
+}
+
+template <expression E>
+Scaled<E> operator/(const E& e, typename E::value_type s) {
+  return Scaled<E>(e, typename E::value_type{1} / s);
+}
+
+template <expression E>
+Negated<E> operator-(const E& e) {
+  return Negated<E>(e);
+}
+
+template <typename L, typename R>
+  requires operands<L, R>
+auto cross(const L& l, const R& r) {
+  auto a = as_expr(l);
+  auto b = as_expr(r);
+  return Cross<decltype(a), decltype(b)>(a, b);
+}
+
+template <typename L, typename R>
+  requires operands<L, R>
+auto dot(const L& l, const R& r) {
+  auto a = as_expr(l);
+  auto b = as_expr(r);
+  return madd(a.x(), b.x(), madd(a.y(), b.y(), a.z() * b.z()));
+}
+
+template <expression E>
+Vec3<typename E::value_type> eval(const E& e) {
+  return e.eval();
+}
+
+//--------------------------------------------
+// Fused versions of the common compound operations
+//--------------------------------------------
+
+template <numeric T>
+Vec3<T> reflect(const Vec3<T>& in, const Vec3<T>& normal) {
+  T d = dot(lazy(in), normal);
+  return lazy(in) - lazy(normal) * (T{2} * d);
+}
+
+// Same as Quat * Vec3f: 2 (u.v) u + (s^2 - u.u) v + 2 s (u x v).
+inline Vec3f rotate(const Quat& q, const Vec3f& v) {
+  Vec3f u = q.vector();
+  float s = q.scalar();
+  float uv = dot(lazy(u), v);
+  float uu = dot(lazy(u), u);
+  return lazy(u) * (2.f * uv) + lazy(v) * (s * s - uu) +
+         cross(lazy(u), v) * (2.f * s);
+}
+
+}  // namespace expr
@@ -84,9 +84,8 @@ class Vec4 {
 
   void normalize() {
     auto l = length();
-    if (l < std::numeric_limits<double>::epsilon()) {
-      l += static_cast<T>(1E-6);
-    }
+    l += select(l < std::numeric_limits<double>::epsilon(),
+                static_cast<T>(1E-6), T{0});
     m_x = static_cast<T>(m_x / l);
     m_y = static_cast<T>(m_y / l);
     m_z = static_cast<T>(m_z / l);
@@ -97,7 +96,11 @@ class Vec4 {
     return static_cast<T>(sqrt(x() * x() + y() * y() + z() * z() + w() * w()));
   }
 
-  bool is_zero() const { return *this == Vec4<T>(T{0}, T{0}, T{0}, T{0}); }
+  // Per lane for SIMD lanes.
+  mask_t<T> is_zero() const {
+    return mask_t<T>((m_x == T{0}) & (m_y == T{0}) & (m_z == T{0}) &
+                     (m_w == T{0}));
+  }
 
   void zero() {
     m_x = T{0};
@@ -185,7 +188,7 @@ Vec4<T> operator*(T num, const Vec4<T>& v) {
 
 template <numeric T>
 Vec4<T> operator/(const Vec4<T>& v1, const Vec4<T>& v2) {
-  if (v2.is_zero()) {
+  if (any(v2.is_zero())) {
     throw std::runtime_error("Cannot divide by zero 4D vector");
   }
   return Vec4<T>(v1.x() / v2.x(), v1.y() / v2.y(), v1.z() / v2.z(),
@@ -194,23 +197,47 @@ Vec4<T> operator/(const Vec4<T>& v1, const Vec4<T>& v2) {
 
 template <numeric T>
 Vec4<T> operator/(const Vec4<T>& v, T num) {
-  if (num == T{0}) {
+  if (any(num == T{0})) {
     throw std::runtime_error("Cannot divide by zero number");
   }
   return Vec4<T>(v.x() / num, v.y() / num, v.z() / num, v.w() / num);
 }
 
 template <numeric T>
-auto dot(const Vec4<T>& v1, const Vec4<T>& v2) {
-  Vec4<T> v = v1 * v2;
-  return v.x() + v.y() + v.z() + v.w();
+T dot(const Vec4<T>& v1, const Vec4<T>& v2) {
+  return v1.x() * v2.x() + v1.y() * v2.y() + v1.z() * v2.z() + v1.w() * v2.w();
 }
 
 template <numeric T>
 Vec4<T> normalized(const Vec4<T>& v) {
   auto l = v.length();
-  if (l < std::numeric_limits<double>::epsilon()) {
-    l += static_cast<T>(1E-6);
-  }
+  l += select(l < std::numeric_limits<double>::epsilon(),
+              static_cast<T>(1E-6), T{0});
   return v / static_cast<T>(l);
 }
+
+//--------------------------------------------
+// Explicit instantiation of the common aliases
+//--------------------------------------------
+// Expanded with `extern` here when MATH_EXTERN_TEMPLATES is defined (linking
+// math_instantiated does that) and without it in math_instantiated.cpp.
+
+#define MATH_INSTANTIATE_VEC4(EXTERN, T)                             \
+  EXTERN template class Vec4<T>;                                     \
+  EXTERN template Vec4<T> operator+(const Vec4<T>&, const Vec4<T>&); \
+  EXTERN template Vec4<T> operator+(const Vec4<T>&, T);              \
+  EXTERN template Vec4<T> operator-(const Vec4<T>&, const Vec4<T>&); \
+  EXTERN template Vec4<T> operator-(const Vec4<T>&, T);              \
+  EXTERN template Vec4<T> operator*(const Vec4<T>&, const Vec4<T>&); \
+  EXTERN template Vec4<T> operator*(const Vec4<T>&, T);              \
+  EXTERN template Vec4<T> operator*(T, const Vec4<T>&);              \
+  EXTERN template Vec4<T> operator/(const Vec4<T>&, const Vec4<T>&); \
+  EXTERN template Vec4<T> operator/(const Vec4<T>&, T);              \
+  EXTERN template T dot(const Vec4<T>&, const Vec4<T>&);             \
+  EXTERN template Vec4<T> normalized(const Vec4<T>&)
+
+#ifdef MATH_EXTERN_TEMPLATES
+MATH_INSTANTIATE_VEC4(extern, int);
+MATH_INSTANTIATE_VEC4(extern, float);
+MATH_INSTANTIATE_VEC4(extern, double);
+#endif
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "types.h"
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+
+//--------------------------------------------
+// Fixed-size vectors of any dimension
+//--------------------------------------------
+//
+// Vector<T, N> is the N-dimensional counterpart of Vec2/Vec3/Vec4 for the
+// sizes those do not cover, such as the 6-vectors of inertial filtering
+// (position and velocity, or angular and linear rate). Every operation is
+// expanded at compile time into one expression per component with a fold
+// over std::make_integer_sequence, so there are no loops for the optimizer
+// to unroll and T may be a Simd (simd.h) as for the named vectors.
+// Vec2/Vec3/Vec4 convert to and from the matching size.
+
+namespace detail {
+
+// f(0) ... f(N - 1) as the arguments of `combine`, in order.
+template <int N, typename Combine, typename F>
+constexpr decltype(auto) fold_indices(Combine&& combine, F&& f) {
+  return [&]<int... I>(std::integer_sequence<int, I...>) -> decltype(auto) {
+    return combine(f(I)...);
+  }(std::make_integer_sequence<int, N>());
+}
+
+// f(0); ...; f(N - 1).
+template <int N, typename F>
+constexpr void for_indices(F&& f) {
+  [&]<int... I>(std::integer_sequence<int, I...>) {
+    (f(I), ...);
+  }(std::make_integer_sequence<int, N>());
+}
+
+// (f(0) + f(1)) + ... + f(N - 1), left to right as the named vectors add.
+template <int N, typename F>
+constexpr auto sum_indices(F&& f) {
+  return [&]<int... I>(std::integer_sequence<int, I...>) {
+    return (... + f(I));
+  }(std::make_integer_sequence<int, N>());
+}
+
+}  // namespace detail
+
+template <numeric T, int N>
+  requires(N > 0)
+class Vector {
+ public:
+  using value_type = T;
+
+  Vector() = default;
+
+  template <typename... U>
+    requires(sizeof...(U) == N && N > 1 && (std::convertible_to<U, T> && ...))
+  Vector(U... values) : m_v{static_cast<T>(values)...} {}
+
+  explicit Vector(const Vec2<T>& v)
+    requires(N == 2)
+      : m_v{v.x(), v.y()} {}
+  explicit Vector(const Vec3<T>& v)
+    requires(N == 3)
+      : m_v{v.x(), v.y(), v.z()} {}
+  explicit Vector(const Vec4<T>& v)
+    requires(N == 4)
+      : m_v{v.x(), v.y(), v.z(), v.w()} {}
+
+  explicit operator Vec2<T>() const
+    requires(N == 2)
+  {
+    return Vec2<T>(m_v[0], m_v[1]);
+  }
+  explicit operator Vec3<T>() const
+    requires(N == 3)
+  {
+    return Vec3<T>(m_v[0], m_v[1], m_v[2]);
+  }
+  explicit operator Vec4<T>() const
+    requires(N == 4)
+  {
+    return Vec4<T>(m_v[0], m_v[1], m_v[2], m_v[3]);
+  }
+
+  // All components `value`.
+  static Vector filled(T value) {
+    return generate([&](int) { return value; });
+  }
+
+  // The i-th unit vector.
+  static Vector unit(int i) {
+    Vector v;
+    v[i] = T{1};
+    return v;
+  }
+
+  // f(0), ..., f(N - 1).
+  template <typename F>
+  static Vector generate(F&& f) {
+    return detail::fold_indices<N>(
+        [](auto... v) { return Vector(std::in_place, v...); }, f);
+  }
+
+  static constexpr int size() { return N; }
+
+  T operator[](int i) const {
+    assert(i >= 0 && i < N);
+    return m_v[i];
+  }
+
+  T& operator[](int i) {
+    assert(i >= 0 && i < N);
+    return m_v[i];
+  }
+
+  const T* data() const { return m_v.data(); }
+  T* data() { return m_v.data(); }
+
+  auto operator<=>(const Vector&) const = default;
+
+  Vector operator+() const { return *this; }
+  Vector operator-() const {
+    return generate([&](int i) { return -m_v[i]; });
+  }
+
+  Vector& operator+=(const Vector& v) { return *this = *this + v; }
+  Vector& operator-=(const Vector& v) { return *this = *this - v; }
+  Vector& operator*=(T num) { return *this = *this * num; }
+  Vector& operator/=(T num) { return *this = *this / num; }
+
+  T length_squared() const {
+    return detail::sum_indices<N>([&](int i) { return m_v[i] * m_v[i]; });
+  }
+
+  T length() const { return static_cast<T>(sqrt(length_squared())); }
+
+  // Per lane for SIMD lanes.
+  mask_t<T> is_zero() const {
+    return detail::fold_indices<N>(
+        [](auto... zero) { return mask_t<T>((zero & ...)); },
+        [&](int i) { return m_v[i] == T{0}; });
+  }
+
+ private:
+  // Components from generate(), without the conversions of the variadic
+  // constructor.
+  template <typename... U>
+  explicit Vector(std::in_place_t, U... values) : m_v{values...} {}
+
+  std::array<T, N> m_v{};
+};
+
+template <int N>
+using Vecf = Vector<float, N>;
+template <int N>
+using Vecd = Vector<double, N>;
+
+using Vec6f = Vector<float, 6>;
+using Vec6d = Vector<double, 6>;
+
+//--------------------------------------------
+// Overloaded I/O operators (input, output)
+//--------------------------------------------
+
+template <numeric T, int N>
+std::ostream& operator<<(std::ostream& out, const Vector<T, N>& v) {
+  out << "(";
+  for (int i = 0; i < N; ++i) out << (i ? "," : "") << v[i];
+  return out << ")";
+}
+
+//----------------------------------------------
+// Overloaded math operators as normal functions
+//----------------------------------------------
+
+template <numeric T, int N>
+Vector<T, N> operator+(const Vector<T, N>& v1, const Vector<T, N>& v2) {
+  return Vector<T, N>::generate([&](int i) { return v1[i] + v2[i]; });
+}
+
+template <numeric T, int N>
+Vector<T, N> operator-(const Vector<T, N>& v1, const Vector<T, N>& v2) {
+  return Vector<T, N>::generate([&](int i) { return v1[i] - v2[i]; });
+}
+
+// Component-wise.
+template <numeric T, int N>
+Vector<T, N> operator*(const Vector<T, N>& v1, const Vector<T, N>& v2) {
+  return Vector<T, N>::generate([&](int i) { return v1[i] * v2[i]; });
+}
+
+template <numeric T, int N>
+Vector<T, N> operator*(const Vector<T, N>& v, T num) {
+  return Vector<T, N>::generate([&](int i) { return v[i] * num; });
+}
+
+template <numeric T, int N>
+Vector<T, N> operator*(T num, const Vector<T, N>& v) {
+  return v * num;
+}
+
+template <numeric T, int N>
+Vector<T, N> operator/(const Vector<T, N>& v, T num) {
+  if (any(num == T{0})) {
+    throw std::runtime_error("Cannot divide by zero number");
+  }
+  return Vector<T, N>::generate([&](int i) { return v[i] / num; });
+}
+
+//--------------------------------------------
+// Other vector operations
+//--------------------------------------------
+
+template <numeric T, int N>
+T dot(const Vector<T, N>& v1, const Vector<T, N>& v2) {
+  return detail::sum_indices<N>([&](int i) { return v1[i] * v2[i]; });
+}
+
+template <numeric T, int N>
+Vector<T, N> normalized(const Vector<T, N>& v) {
+  auto l = v.length();
+  l += select(l < std::numeric_limits<double>::epsilon(),
+              static_cast<T>(1E-6), T{0});
+  return v / l;
+}
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "mat4.h"
+#include "point3.h"
+#include "ray.h"
+#include "thread_pool.h"
+#include "triangle.h"
+#include "vec3.h"
+#include "vec4.h"
+
+//--------------------------------------------
+// Wavefront path tracing stages
+//--------------------------------------------
+//
+// Instead of following one path through all its bounces (a megakernel),
+// every path is advanced by one stage at a time, as in Laine et al.,
+// "Megakernels Considered Harmful: Wavefront Path Tracing on GPUs" (2013).
+// Each stage runs one small loop over a queue of paths, so its code and
+// data stay in cache:
+//
+//   generate_camera_rays()  fills a queue with primary rays,
+//   extend()                finds the nearest hit of every ray,
+//   shade()                 turns hits into the next rays, or ends paths,
+//   compact()               moves the live paths to the next queue,
+//
+// and occluded() traces a queue of shadow rays, whose range ends at the
+// light, with the scene's cheaper any-hit query.
+//
+// Queues are structures of arrays and keep their capacity, so after the
+// first frame no path data is allocated. The thread pool still allocates
+// a small task per split of each stage's loop, and shade() a vector of
+// per-chunk counts. A frame ping-pongs between two queues:
+//
+//   generate_camera_rays(view, projection, w, h, a);
+//   while (a.count > 0) {
+//     extend(bvh, a, hits);
+//     shade(a, hits, shader);
+//     compact(a, b);
+//     std::swap(a, b);
+//   }
+
+// A batch of paths. Only the first `count` entries are live; the arrays
+// are capacity() long.
+struct RayQueue {
+  std::vector<float> ox, oy, oz;    // ray origin
+  std::vector<float> dx, dy, dz;    // ray direction
+  std::vector<float> tmin, tmax;    // ray range
+  std::vector<float> r, g, b;       // path throughput
+  std::vector<uint32_t> pixel;      // image entry the path adds to
+  std::vector<uint8_t> alive;       // set by shade(), read by compact()
+  std::size_t count = 0;
+
+  RayQueue() = default;
+  explicit RayQueue(std::size_t capacity) { reserve(capacity); }
+
+  std::size_t capacity() const { return pixel.size(); }
+
+  // Grows every array to n entries; never shrinks them.
+  void reserve(std::size_t n) {
+    if (n <= capacity()) return;
+    for (auto* a : {&ox, &oy, &oz, &dx, &dy, &dz, &tmin, &tmax, &r, &g, &b}) {
+      a->resize(n);
+    }
+    pixel.resize(n);
+    alive.resize(n);
+  }
+
+  void resize(std::size_t n) {
+    reserve(n);
+    count = n;
+  }
+
+  void clear() { count = 0; }
+
+  Ray ray(std::size_t i) const {
+    Ray out(Point3f(ox[i], oy[i], oz[i]), Vec3f(dx[i], dy[i], dz[i]));
+    out.setMinRange(tmin[i]);
+    out.setMaxRange(tmax[i]);
+    return out;
+  }
+
+  void set_ray(std::size_t i, const Ray& ray) {
+    Point3f o = ray.origin();
+    Vec3f d = ray.direction();
+    ox[i] = o.x();
+    oy[i] = o.y();
+    oz[i] = o.z();
+    dx[i] = d.x();
+    dy[i] = d.y();
+    dz[i] = d.z();
+    tmin[i] = ray.getMinRange();
+    tmax[i] = ray.getMaxRange();
+  }
+
+  Vec3f throughput(std::size_t i) const { return Vec3f(r[i], g[i], b[i]); }
+
+  void set_throughput(std::size_t i, const Vec3f& t) {
+    r[i] = t.x();
+    g[i] = t.y();
+    b[i] = t.z();
+  }
+
+  // Entry i of this queue becomes entry j of `from`.
+  void copy(std::size_t i, const RayQueue& from, std::size_t j) {
+    ox[i] = from.ox[j];
+    oy[i] = from.oy[j];
+    oz[i] = from.oz[j];
+    dx[i] = from.dx[j];
+    dy[i] = from.dy[j];
+    dz[i] = from.dz[j];
+    tmin[i] = from.tmin[j];
+    tmax[i] = from.tmax[j];
+    r[i] = from.r[j];
+    g[i] = from.g[j];
+    b[i] = from.b[j];
+    pixel[i] = from.pixel[j];
+    alive[i] = from.alive[j];
+  }
+};
+
+// One path as shade() hands it to the shader, which updates it in place.
+struct Path {
+  Ray ray;
+  Vec3f throughput;
+  uint32_t pixel;
+};
+
+namespace detail {
+
+constexpr std::size_t kWavefrontGrain = 256;
+
+}  // namespace detail
+
+//--------------------------------------------
+// Generate
+//--------------------------------------------
+
+// One ray per pixel through its centre, row by row from the top left, with
+// unit throughput. `view` maps world to camera space as view_transform()
+// does; `projection` is laid out as perspective() and orthographic()
+// return it, with the OpenGL matrix's columns as its rows, so it is
+// transposed here. The rays start on the near plane.
+inline void generate_camera_rays(const Mat4f& view, const Mat4f& projection,
+                                 uint32_t width, uint32_t height,
+                                 RayQueue& queue, ThreadPool& pool) {
+  Mat4f to_world = (projection.transpose() * view).inverse();
+  auto unproject = [&](float x, float y, float z) {
+    Vec4f p = to_world * Vec4f(x, y, z, 1.f);
+    return Point3f(p.x() / p.w(), p.y() / p.w(), p.z() / p.w());
+  };
+  std::size_t n = std::size_t{width} * height;
+  queue.resize(n);
+  float sx = 2.f / static_cast<float>(width);
+  float sy = 2.f / static_cast<float>(height);
+  parallel_for(pool, 0, n, detail::kWavefrontGrain,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; ++i) {
+                   float x = (static_cast<float>(i % width) + 0.5f) * sx - 1.f;
+                   float y = 1.f - (static_cast<float>(i / width) + 0.5f) * sy;
+                   Point3f near = unproject(x, y, -1.f);
+                   Vec3f d = normalized(unproject(x, y, 1.f) - near);
+                   queue.ox[i] = near.x();
+                   queue.oy[i] = near.y();
+                   queue.oz[i] = near.z();
+                   queue.dx[i] = d.x();
+                   queue.dy[i] = d.y();
+                   queue.dz[i] = d.z();
+                   queue.tmin[i] = 0.f;
+                   queue.tmax[i] = std::numeric_limits<float>::infinity();
+                   queue.r[i] = queue.g[i] = queue.b[i] = 1.f;
+                   queue.pixel[i] = static_cast<uint32_t>(i);
+                   queue.alive[i] = 1;
+                 }
+               });
+}
+
+inline void generate_camera_rays(const Mat4f& view, const Mat4f& projection,
+                                 uint32_t width, uint32_t height,
+                                 RayQueue& queue) {
+  generate_camera_rays(view, projection, width, height, queue,
+                       default_thread_pool());
+}
+
+//--------------------------------------------
+// Extend
+//--------------------------------------------
+
+// hits[i] is the nearest hit of the queue's ray i in scene, anything with
+// TriangleHit<float> intersect(const Ray&) const, such as Bvh<float>.
+template <typename Scene>
+void extend(const Scene& scene, const RayQueue& queue,
+            std::span<TriangleHit<float>> hits, ThreadPool& pool) {
+  if (hits.size() < queue.count) {
+    throw std::out_of_range("Output span is too small");
+  }
+  parallel_for(pool, 0, queue.count, detail::kWavefrontGrain,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; ++i) {
+                   hits[i] = scene.intersect(queue.ray(i));
+                 }
+               });
+}
+
+template <typename Scene>
+void extend(const Scene& scene, const RayQueue& queue,
+            std::span<TriangleHit<float>> hits) {
+  extend(scene, queue, hits, default_thread_pool());
+}
+
+//--------------------------------------------
+// Shadow rays
+//--------------------------------------------
+
+// occluded[i] is 1 if the queue's ray i hits anything in scene and 0 if
+// not. Scene is anything with bool occluded(const Ray&) const, such as
+// Bvh<float>.
+template <typename Scene>
+void occluded(const Scene& scene, const RayQueue& queue,
+              std::span<uint8_t> occluded, ThreadPool& pool) {
+  if (occluded.size() < queue.count) {
+    throw std::out_of_range("Output span is too small");
+  }
+  parallel_for(pool, 0, queue.count, detail::kWavefrontGrain,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; ++i) {
+                   occluded[i] = scene.occluded(queue.ray(i));
+                 }
+               });
+}
+
+template <typename Scene>
+void occluded(const Scene& scene, const RayQueue& queue,
+              std::span<uint8_t> occluded) {
+  ::occluded(scene, queue, occluded, default_thread_pool());
+}
+
+//--------------------------------------------
+// Shade
+//--------------------------------------------
+
+// Calls shader(path, hit) for every live path and its hit. The shader
+// updates the path to its next ray and throughput and returns whether it
+// goes on; it must be safe to call from many threads. Returns the number
+// of paths that go on.
+template <typename Shader>
+std::size_t shade(RayQueue& queue, std::span<const TriangleHit<float>> hits,
+                  Shader&& shader, ThreadPool& pool) {
+  if (hits.size() < queue.count) {
+    throw std::invalid_argument("shade needs one hit per path");
+  }
+  return parallel_reduce(
+      pool, 0, queue.count, detail::kWavefrontGrain, std::size_t{0},
+      [&](std::size_t begin, std::size_t end) {
+        std::size_t live = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+          Path path{queue.ray(i), queue.throughput(i), queue.pixel[i]};
+          bool on = shader(path, hits[i]);
+          queue.set_ray(i, path.ray);
+          queue.set_throughput(i, path.throughput);
+          queue.alive[i] = on;
+          live += on;
+        }
+        return live;
+      },
+      [](std::size_t a, std::size_t b) { return a + b; });
+}
+
+template <typename Shader>
+std::size_t shade(RayQueue& queue, std::span<const TriangleHit<float>> hits,
+                  Shader&& shader) {
+  return shade(queue, hits, shader, default_thread_pool());
+}
+
+//--------------------------------------------
+// Compact
+//--------------------------------------------
+
+// Copies the live paths of `in` to `out`, in order; returns how many.
+inline std::size_t compact(const RayQueue& in, RayQueue& out,
+                           ThreadPool& pool) {
+  constexpr std::size_t kMaxBlocks = 64;
+  std::size_t n = in.count;
+  std::size_t blocks = std::clamp<std::size_t>(
+      n / (4 * detail::kWavefrontGrain), 1,
+      std::min<std::size_t>(kMaxBlocks, 4 * (std::size_t{pool.size()} + 1)));
+  auto block_begin = [&](std::size_t b) { return n * b / blocks; };
+  std::array<std::size_t, kMaxBlocks + 1> live_before{};
+  parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+    std::size_t live = 0;
+    for (std::size_t i = block_begin(b); i < block_begin(b + 1); ++i) {
+      live += in.alive[i] != 0;
+    }
+    live_before[b + 1] = live;
+  });
+  for (std::size_t b = 0; b < blocks; ++b) {
+    live_before[b + 1] += live_before[b];
+  }
+  out.resize(live_before[blocks]);
+  parallel_for(pool, 0, blocks, 1, [&](std::size_t b, std::size_t) {
+    std::size_t j = live_before[b];
+    for (std::size_t i = block_begin(b); i < block_begin(b + 1); ++i) {
+      if (in.alive[i]) out.copy(j++, in, i);
+    }
+  });
+  return out.count;
+}
+
+inline std::size_t compact(const RayQueue& in, RayQueue& out) {
+  return compact(in, out, default_thread_pool());
+}
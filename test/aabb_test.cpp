@@ -0,0 +1,45 @@
+#include "aabb.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using testing::Eq;
+using testing::FloatEq;
+
+class AABBTest : public testing::Test {
+ public:
+  AABBf box{Point3f(-1.f, 0.f, 2.f), Point3f(1.f, 4.f, 3.f)};
+};
+
+TEST_F(AABBTest, DefaultIsEmpty) {
+  AABBf empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_THAT(empty.surface_area(), Eq(0.f));
+  EXPECT_THAT(merge(empty, box), Eq(box));
+  ASSERT_THAT(merge(box, empty), Eq(box));
+}
+
+TEST_F(AABBTest, Measures) {
+  EXPECT_THAT(box.centroid(), Eq(Point3f(0.f, 2.f, 2.5f)));
+  EXPECT_THAT(box.surface_area(), FloatEq(2.f * (8.f + 4.f + 2.f)));
+  EXPECT_THAT(box.longest_axis(), Eq(1));
+  EXPECT_TRUE(box.contains(Point3f(0.f, 4.f, 2.f)));
+  ASSERT_FALSE(box.contains(Point3f(0.f, 4.1f, 2.f)));
+}
+
+TEST_F(AABBTest, BoundsMatchSerialPass) {
+  std::mt19937 gen(3);
+  std::normal_distribution<float> dist(0.f, 10.f);
+  std::vector<Point3f> points(100000);
+  for (auto& p : points) p = Point3f(dist(gen), dist(gen), dist(gen));
+  AABBf expected;
+  for (const auto& p : points) expected.expand(p);
+
+  ThreadPool pool(3);
+  EXPECT_THAT(bounds(std::span<const Point3f>(points), pool), Eq(expected));
+  EXPECT_THAT(bounds(std::span<const Point3f>(points)), Eq(expected));
+  ASSERT_TRUE(bounds(std::span<const Point3f>()).empty());
+}
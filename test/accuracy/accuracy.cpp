@@ -0,0 +1,543 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "fast_math.h"
+#include "mat4.h"
+#include "quat.h"
+#include "vec3.h"
+#include "vec4.h"
+
+// Accuracy regression harness.
+//
+// Every routine is swept over a randomized set of well-conditioned inputs
+// and over an adversarial set (extreme magnitudes, mixed scales, nearly
+// singular matrices, nearly parallel vectors). Results are compared against
+// a long double reference computed with an independent algorithm, and the
+// max/mean error is reported in ulps next to the cost per call.
+//
+// Vector and matrix results use the normwise error: the absolute error of
+// each component in ulps of the largest reference component. Scalar results
+// use the ulp of the reference itself.
+//
+// The run fails when a max error exceeds the budget in its row. Budgets are
+// the measured errors with headroom; tighten them when a routine improves
+// and never loosen them to land a faster kernel without looking at why.
+//
+// Usage: math-accuracy [samples per sweep]
+
+namespace {
+
+using Real = long double;
+using RefMat4 = std::array<std::array<Real, 4>, 4>;
+
+std::size_t g_samples = 100000;
+std::mt19937 g_gen(20240521);
+
+struct Row {
+  std::string routine;
+  std::string inputs;
+  ErrorStats err;
+  double ns = 0.;
+  double budget = 0.;
+};
+
+std::vector<Row> g_rows;
+
+template <typename Input, typename Run, typename Measure>
+void sweep(const char* routine, const char* inputs, double budget,
+           const std::vector<Input>& in, Run run, Measure measure) {
+  Row row;
+  row.routine = routine;
+  row.inputs = inputs;
+  row.budget = budget;
+  for (const auto& x : in) row.err.add(measure(x, run(x)));
+  row.ns = best_ns_per_item(
+      in.size(), [&] {
+        for (const auto& x : in) do_not_optimize(run(x));
+      },
+      3);
+  g_rows.push_back(row);
+}
+
+//--------------------------------------------
+// Input generators
+//--------------------------------------------
+
+float uniform(float lo, float hi) {
+  return std::uniform_real_distribution<float>(lo, hi)(g_gen);
+}
+
+float log_uniform(float lo_exp, float hi_exp) {
+  float s = uniform(0.f, 1.f) < 0.5f ? -1.f : 1.f;
+  return s * std::pow(10.f, uniform(lo_exp, hi_exp));
+}
+
+Vec3f random_vec3(float lo, float hi) {
+  return Vec3f(uniform(lo, hi), uniform(lo, hi), uniform(lo, hi));
+}
+
+template <typename T>
+Mat4<T> random_mat4(float lo, float hi) {
+  Mat4<T> m;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) m[i][j] = static_cast<T>(uniform(lo, hi));
+  }
+  return m;
+}
+
+// Rotation * scale * translation, the typical model matrix.
+Mat4f random_affine() {
+  auto axis = random_vec3(-1.f, 1.f);
+  auto r = quat_to_mat4(angle_axis(uniform(-3.f, 3.f), axis));
+  auto s =
+      scale(uniform(0.1f, 10.f), uniform(0.1f, 10.f), uniform(0.1f, 10.f));
+  auto t = translation(uniform(-100.f, 100.f), uniform(-100.f, 100.f),
+                       uniform(-100.f, 100.f));
+  return t * r * s;
+}
+
+// Rows scaled over eight orders of magnitude.
+template <typename T>
+Mat4<T> badly_scaled_mat4() {
+  auto m = random_mat4<T>(-1.f, 1.f);
+  for (int i = 0; i < 4; ++i) {
+    m[i] = m[i] * static_cast<T>(log_uniform(-4, 4));
+  }
+  return m;
+}
+
+// A rank-3 matrix nudged by a small perturbation.
+template <typename T>
+Mat4<T> nearly_singular_mat4() {
+  auto m = random_mat4<T>(-1.f, 1.f);
+  auto a = uniform(-1.f, 1.f);
+  auto b = uniform(-1.f, 1.f);
+  for (int j = 0; j < 4; ++j) {
+    auto nudge = uniform(-1e-3f, 1e-3f);
+    m[3][j] = static_cast<T>(a * m[0][j] + b * m[1][j] + nudge);
+  }
+  return m;
+}
+
+template <typename Gen>
+auto generate(Gen gen) {
+  std::vector<decltype(gen())> out;
+  out.reserve(g_samples);
+  for (std::size_t i = 0; i < g_samples; ++i) out.push_back(gen());
+  return out;
+}
+
+//--------------------------------------------
+// Long double references
+//--------------------------------------------
+
+template <typename T>
+RefMat4 to_ref(const Mat4<T>& m) {
+  RefMat4 r;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) r[i][j] = m[i][j];
+  }
+  return r;
+}
+
+// Determinant by Gaussian elimination with partial pivoting.
+Real ref_determinant(RefMat4 a) {
+  Real det = 1;
+  for (int c = 0; c < 4; ++c) {
+    int p = c;
+    for (int r = c + 1; r < 4; ++r) {
+      if (std::fabs(a[r][c]) > std::fabs(a[p][c])) p = r;
+    }
+    if (a[p][c] == 0) return 0;
+    if (p != c) {
+      std::swap(a[p], a[c]);
+      det = -det;
+    }
+    det *= a[c][c];
+    for (int r = c + 1; r < 4; ++r) {
+      Real f = a[r][c] / a[c][c];
+      for (int k = c; k < 4; ++k) a[r][k] -= f * a[c][k];
+    }
+  }
+  return det;
+}
+
+// Inverse by Gauss-Jordan elimination with partial pivoting.
+RefMat4 ref_inverse(RefMat4 a) {
+  RefMat4 inv{};
+  for (int i = 0; i < 4; ++i) inv[i][i] = 1;
+  for (int c = 0; c < 4; ++c) {
+    int p = c;
+    for (int r = c + 1; r < 4; ++r) {
+      if (std::fabs(a[r][c]) > std::fabs(a[p][c])) p = r;
+    }
+    std::swap(a[p], a[c]);
+    std::swap(inv[p], inv[c]);
+    Real d = a[c][c];
+    for (int k = 0; k < 4; ++k) {
+      a[c][k] /= d;
+      inv[c][k] /= d;
+    }
+    for (int r = 0; r < 4; ++r) {
+      if (r == c) continue;
+      Real f = a[r][c];
+      for (int k = 0; k < 4; ++k) {
+        a[r][k] -= f * a[c][k];
+        inv[r][k] -= f * inv[c][k];
+      }
+    }
+  }
+  return inv;
+}
+
+Real norm_inf(const RefMat4& a) {
+  Real n = 0;
+  for (const auto& row : a) {
+    n = std::max(n, std::fabs(row[0]) + std::fabs(row[1]) + std::fabs(row[2]) +
+                        std::fabs(row[3]));
+  }
+  return n;
+}
+
+// Forward error of determinant and inverse grows with the condition number,
+// so each sweep draws matrices from a fixed condition range. This also
+// keeps Mat4::inverse away from the zero determinant it asserts on.
+template <typename Gen>
+auto with_condition(Gen gen, Real lo, Real hi) {
+  return [gen, lo, hi] {
+    for (;;) {
+      auto m = gen();
+      if (m.determinant() == 0) continue;
+      auto a = to_ref(m);
+      auto cond = norm_inf(a) * norm_inf(ref_inverse(a));
+      if (cond >= lo && cond <= hi) return m;
+    }
+  };
+}
+
+template <typename T>
+double mat4_error(const Mat4<T>& m, const RefMat4& ref) {
+  Real scale = 0;
+  for (const auto& row : ref) {
+    for (Real x : row) scale = std::max(scale, std::fabs(x));
+  }
+  double err = 0.;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      err = std::max(err, ulp_error<T>(m[i][j], ref[i][j], scale));
+    }
+  }
+  return err;
+}
+
+template <std::size_t N>
+double vec_error(const std::array<float, N>& v,
+                 const std::array<Real, N>& ref) {
+  Real scale = 0;
+  for (Real x : ref) scale = std::max(scale, std::fabs(x));
+  double err = 0.;
+  for (std::size_t i = 0; i < N; ++i) {
+    err = std::max(err, ulp_error<float>(v[i], ref[i], scale));
+  }
+  return err;
+}
+
+std::array<float, 3> arr(const Vec3f& v) { return {v.x(), v.y(), v.z()}; }
+
+std::array<Real, 3> ref_normalized(const Vec3f& v) {
+  Real x = v.x(), y = v.y(), z = v.z();
+  Real l = std::sqrt(x * x + y * y + z * z);
+  return {x / l, y / l, z / l};
+}
+
+// v' = v + 2w (u x v) + 2 u x (u x v) for a unit quaternion (u, w).
+std::array<Real, 3> ref_rotate(const Quat& q, const Vec3f& v) {
+  Real ux = q.x(), uy = q.y(), uz = q.z(), w = q.w();
+  Real vx = v.x(), vy = v.y(), vz = v.z();
+  Real tx = 2 * (uy * vz - uz * vy);
+  Real ty = 2 * (uz * vx - ux * vz);
+  Real tz = 2 * (ux * vy - uy * vx);
+  return {vx + w * tx + (uy * tz - uz * ty), vy + w * ty + (uz * tx - ux * tz),
+          vz + w * tz + (ux * ty - uy * tx)};
+}
+
+// The projection matrices as the library lays them out, built in long
+// double from the same parameters.
+RefMat4 ref_frustrum(Real l, Real r, Real b, Real t, Real n, Real f) {
+  RefMat4 m{};
+  m[0] = {2 * n / (r - l), 0, 0, 0};
+  m[1] = {0, 2 * n / (t - b), 0, 0};
+  m[2] = {(r + l) / (r - l), (t + b) / (t - b), -(f + n) / (f - n), -1};
+  m[3] = {0, 0, -2 * f * n / (f - n), 0};
+  return m;
+}
+
+RefMat4 ref_perspective(Real fov, Real aspect, Real n, Real f) {
+  Real ymax = n * std::tan(fov * std::acos(Real{-1}) / 360);
+  Real xmax = ymax * aspect;
+  return ref_frustrum(-xmax, xmax, -ymax, ymax, n, f);
+}
+
+RefMat4 ref_orthographic(Real l, Real r, Real b, Real t, Real n, Real f) {
+  RefMat4 m{};
+  m[0] = {2 / (r - l), 0, 0, 0};
+  m[1] = {0, 2 / (t - b), 0, 0};
+  m[2] = {0, 0, -2 / (f - n), 0};
+  m[3] = {-(r + l) / (r - l), -(t + b) / (t - b), -(f + n) / (f - n), 1};
+  return m;
+}
+
+// frustrum() and orthographic() store the matrix transposed with respect to
+// operator*(Mat4, Vec4), so clip coordinates are transpose(P) * p.
+std::array<Real, 4> ref_project(const RefMat4& m, const Vec4f& v) {
+  std::array<Real, 4> out{};
+  for (int i = 0; i < 4; ++i) {
+    out[i] = m[0][i] * v.x() + m[1][i] * v.y() + m[2][i] * v.z() +
+             m[3][i] * v.w();
+  }
+  return out;
+}
+
+std::array<float, 4> arr(const Vec4f& v) {
+  return {v.x(), v.y(), v.z(), v.w()};
+}
+
+struct Projection {
+  float fov, aspect, near, far;
+  Vec4f point;
+};
+
+struct Ortho {
+  float left, right, bottom, top, near, far;
+  Vec4f point;
+};
+
+//--------------------------------------------
+// Sweeps
+//--------------------------------------------
+
+void matrix_sweeps() {
+  auto random_f = generate(with_condition(
+      [] { return random_mat4<float>(-10.f, 10.f); }, 1, 1e2));
+  auto affine = generate(with_condition(random_affine, 1, 1e3));
+  auto scaled_f =
+      generate(with_condition(badly_scaled_mat4<float>, 1e4, 1e8));
+  auto singular_f =
+      generate(with_condition(nearly_singular_mat4<float>, 1e3, 1e4));
+  auto random_d = generate(with_condition(
+      [] { return random_mat4<double>(-10.f, 10.f); }, 1, 1e2));
+  auto singular_d =
+      generate(with_condition(nearly_singular_mat4<double>, 1e3, 1e4));
+
+  auto det = [](const auto& m) { return m.determinant(); };
+  auto det_err = [](const auto& m, auto d) {
+    using T = decltype(d);
+    Real ref = ref_determinant(to_ref(m));
+    return ulp_error<T>(d, ref, ref);
+  };
+  sweep("Mat4f::determinant", "cond <= 1e2", 256, random_f, det, det_err);
+  sweep("Mat4f::determinant", "affine", 8, affine, det, det_err);
+  sweep("Mat4f::determinant", "cond 1e4..1e8", 32768, scaled_f, det, det_err);
+  sweep("Mat4f::determinant", "cond 1e3..1e4", 131072, singular_f, det,
+        det_err);
+  sweep("Mat4d::determinant", "cond <= 1e2", 128, random_d, det, det_err);
+  sweep("Mat4d::determinant", "cond 1e3..1e4", 262144, singular_d, det,
+        det_err);
+
+  auto inv = [](const auto& m) { return m.inverse(); };
+  auto inv_err = [](const auto& m, const auto& i) {
+    return mat4_error(i, ref_inverse(to_ref(m)));
+  };
+  sweep("Mat4f::inverse", "cond <= 1e2", 256, random_f, inv, inv_err);
+  sweep("Mat4f::inverse", "affine", 64, affine, inv, inv_err);
+  sweep("Mat4f::inverse", "cond 1e4..1e8", 32768, scaled_f, inv, inv_err);
+  sweep("Mat4f::inverse", "cond 1e3..1e4", 131072, singular_f, inv, inv_err);
+  sweep("Mat4d::inverse", "cond <= 1e2", 128, random_d, inv, inv_err);
+  sweep("Mat4d::inverse", "cond 1e3..1e4", 262144, singular_d, inv, inv_err);
+}
+
+void vector_sweeps() {
+  auto random = generate([] { return random_vec3(-100.f, 100.f); });
+  // Magnitudes from 1e-12 to 1e18 per component, so mixed scales appear
+  // within one vector while the squared length still fits in a float.
+  auto extreme = generate([] {
+    return Vec3f(log_uniform(-12, 18), log_uniform(-12, 18),
+                 log_uniform(-12, 18));
+  });
+  auto err = [](const Vec3f& v, const Vec3f& n) {
+    return vec_error(arr(n), ref_normalized(v));
+  };
+  sweep("normalized", "random", 4, random,
+        [](const Vec3f& v) { return normalized(v); }, err);
+  sweep("normalized", "extreme", 4, extreme,
+        [](const Vec3f& v) { return normalized(v); }, err);
+  sweep("fast::normalized", "random", 4, random,
+        [](const Vec3f& v) { return fast::normalized(v); }, err);
+  sweep("fast::normalized", "extreme", 4, extreme,
+        [](const Vec3f& v) { return fast::normalized(v); }, err);
+
+  struct Rotation {
+    Quat q;
+    Vec3f v;
+  };
+  auto rotations = generate([] {
+    auto q = angle_axis(uniform(-3.14f, 3.14f), random_vec3(-1.f, 1.f));
+    return Rotation{normalized(q), random_vec3(-100.f, 100.f)};
+  });
+  // Angles next to 0 and PI, and vectors nearly parallel to the axis.
+  auto degenerate = generate([] {
+    auto axis = random_vec3(-1.f, 1.f);
+    auto near_pi = uniform(0.f, 1.f) < 0.5f;
+    auto angle = near_pi ? 3.14159265f - log_uniform(-7, -2)
+                         : log_uniform(-7, -2);
+    auto v = axis * uniform(-100.f, 100.f) + random_vec3(-1e-4f, 1e-4f);
+    return Rotation{normalized(angle_axis(angle, axis)), v};
+  });
+  auto rotate = [](const Rotation& r) { return r.q * r.v; };
+  auto rotate_err = [](const Rotation& r, const Vec3f& out) {
+    return vec_error(arr(out), ref_rotate(r.q, r.v));
+  };
+  sweep("Quat * Vec3f", "random", 16, rotations, rotate, rotate_err);
+  sweep("Quat * Vec3f", "degenerate", 16, degenerate, rotate, rotate_err);
+}
+
+void projection_sweeps() {
+  auto persp = generate([] {
+    auto near = std::pow(10.f, uniform(-3.f, 0.f));
+    auto far = near * std::pow(10.f, uniform(1.f, 5.f));
+    auto p = Vec4f(uniform(-50.f, 50.f), uniform(-50.f, 50.f),
+                   -uniform(near, far), 1.f);
+    return Projection{uniform(20.f, 120.f), uniform(0.5f, 2.5f), near, far, p};
+  });
+  sweep(
+      "perspective", "random", 16, persp,
+      [](const Projection& p) {
+        return perspective(p.fov, p.aspect, p.near, p.far).transpose() *
+               p.point;
+      },
+      [](const Projection& p, const Vec4f& out) {
+        auto ref = ref_project(ref_perspective(p.fov, p.aspect, p.near, p.far),
+                           p.point);
+        return vec_error(arr(out), ref);
+      });
+
+  auto ortho = generate([] {
+    auto w = std::pow(10.f, uniform(-2.f, 4.f));
+    auto h = w * uniform(0.5f, 2.f);
+    auto cx = uniform(-w, w);
+    auto cy = uniform(-h, h);
+    auto near = uniform(-10.f, 10.f);
+    auto far = near + std::pow(10.f, uniform(-1.f, 4.f));
+    auto p = Vec4f(uniform(cx - w, cx + w), uniform(cy - h, cy + h),
+                   -uniform(near, far), 1.f);
+    return Ortho{cx - w, cx + w, cy - h, cy + h, near, far, p};
+  });
+  sweep(
+      "orthographic", "random", 512, ortho,
+      [](const Ortho& o) {
+        auto m = orthographic(o.left, o.right, o.bottom, o.top, o.near, o.far);
+        return m.transpose() * o.point;
+      },
+      [](const Ortho& o, const Vec4f& out) {
+        auto ref = ref_project(
+            ref_orthographic(o.left, o.right, o.bottom, o.top, o.near, o.far),
+            o.point);
+        return vec_error(arr(out), ref);
+      });
+}
+
+void rotation_sweeps() {
+  auto angles = generate([] { return uniform(-100.f, 100.f); });
+  auto quarter_turns = generate([] {
+    auto k = static_cast<float>(static_cast<int>(uniform(-64.f, 64.f)));
+    return k * 1.57079632679f + uniform(-1e-6f, 1e-6f);
+  });
+  // Entries (1,1) (1,2) (2,1) (2,2) of a rotation about X.
+  auto err = [](float a, const Mat4f& m) {
+    Real c = std::cos(static_cast<Real>(a));
+    Real s = std::sin(static_cast<Real>(a));
+    return vec_error(std::array<float, 4>{m[1][1], m[1][2], m[2][1], m[2][2]},
+                     std::array<Real, 4>{c, -s, s, c});
+  };
+  auto exact = [](float a) { return rotationOverX(a); };
+  auto fast = [](float a) { return fast::rotationOverX(a); };
+  sweep("rotationOverX", "[-100, 100]", 2, angles, exact, err);
+  sweep("rotationOverX", "k * PI/2", 2, quarter_turns, exact, err);
+  sweep("fast::rotationOverX", "[-100, 100]", 2, angles, fast, err);
+  sweep("fast::rotationOverX", "k * PI/2", 2, quarter_turns, fast, err);
+}
+
+void scalar_sweeps() {
+  auto angles = generate([] { return uniform(-100.f, 100.f); });
+  auto large = generate([] { return uniform(-8192.f, 8192.f); });
+  auto unit = generate([] { return uniform(-1.f, 1.f); });
+  auto positive = generate([] { return log_uniform(-37, 38); });
+  for (auto& x : positive) x = std::fabs(x);
+
+  // Near the zeros of sin/cos the absolute error is what matters, so the
+  // ulp is taken at magnitude 1 there.
+  auto trig_err = [](Real ref) {
+    return [ref](float out) {
+      return ulp_error<float>(out, ref, std::max(std::fabs(ref), Real{1e-3}));
+    };
+  };
+  auto sin_err = [&](float x, float out) {
+    return trig_err(std::sin(static_cast<Real>(x)))(out);
+  };
+  auto cos_err = [&](float x, float out) {
+    return trig_err(std::cos(static_cast<Real>(x)))(out);
+  };
+  sweep("fast::sin", "[-100, 100]", 2, angles,
+        [](float x) { return fast::sin(x); }, sin_err);
+  sweep("fast::sin", "[-8192, 8192]", 2, large,
+        [](float x) { return fast::sin(x); }, sin_err);
+  sweep("fast::cos", "[-100, 100]", 2, angles,
+        [](float x) { return fast::cos(x); }, cos_err);
+  sweep("fast::cos", "[-8192, 8192]", 2, large,
+        [](float x) { return fast::cos(x); }, cos_err);
+
+  auto scalar_err = [](Real (*ref_fn)(Real)) {
+    return [ref_fn](float x, float out) {
+      Real ref = ref_fn(x);
+      return ulp_error<float>(out, ref, ref);
+    };
+  };
+  sweep("fast::acos", "[-1, 1]", 2, unit,
+        [](float x) { return fast::acos(x); },
+        scalar_err([](Real x) { return std::acos(x); }));
+  sweep("fast::rsqrt", "[1e-37, 1e38]", 3, positive,
+        [](float x) { return fast::rsqrt(x); },
+        scalar_err([](Real x) { return 1 / std::sqrt(x); }));
+  sweep("fast::atan2", "(x, 1.7)", 3, angles,
+        [](float y) { return fast::atan2(y, 1.7f); },
+        scalar_err([](Real y) { return std::atan2(y, Real{1.7f}); }));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1) g_samples = std::strtoul(argv[1], nullptr, 10);
+
+  matrix_sweeps();
+  vector_sweeps();
+  projection_sweeps();
+  rotation_sweeps();
+  scalar_sweeps();
+
+  std::printf("%-20s %-16s %12s %10s %10s %10s\n", "routine", "inputs",
+              "max ulp", "mean ulp", "ns/call", "budget");
+  int failures = 0;
+  for (const auto& row : g_rows) {
+    bool ok = row.err.max() <= row.budget;
+    failures += ok ? 0 : 1;
+    std::printf("%-20s %-16s %12.1f %10.2f %10.1f %10.0f%s\n",
+                row.routine.c_str(), row.inputs.c_str(), row.err.max(),
+                row.err.mean(), row.ns, row.budget, ok ? "" : "  FAILED");
+  }
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,153 @@
+#include "animation.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using testing::Eq;
+using testing::FloatNear;
+
+class AnimationTest : public testing::Test {
+ public:
+  static void expect_near(const Vec3f& a, const Vec3f& b, float eps = 1e-5f) {
+    EXPECT_THAT(a.x(), FloatNear(b.x(), eps));
+    EXPECT_THAT(a.y(), FloatNear(b.y(), eps));
+    EXPECT_THAT(a.z(), FloatNear(b.z(), eps));
+  }
+
+  static void expect_same(const Quat& a, const Quat& b) {
+    EXPECT_THAT(a.x(), Eq(b.x()));
+    EXPECT_THAT(a.y(), Eq(b.y()));
+    EXPECT_THAT(a.z(), Eq(b.z()));
+    EXPECT_THAT(a.w(), Eq(b.w()));
+  }
+
+  Vec3Track ramp{{0.f, 1.f, 3.f},
+                 {Vec3f(0.f, 0.f, 0.f), Vec3f(1.f, 2.f, 3.f),
+                  Vec3f(3.f, 6.f, 9.f)}};
+  Quat quarter_turn = angle_axis(PI / 2.f, Vec3f(0.f, 0.f, 1.f));
+};
+
+TEST_F(AnimationTest, SlerpKeepsConstantSpeedOnShorterArc) {
+  Quat half_way = slerp(Quat(), quarter_turn, 0.5f);
+  EXPECT_TRUE(same_orientation(half_way,
+                               angle_axis(PI / 4.f, Vec3f(0.f, 0.f, 1.f))));
+  EXPECT_TRUE(same_orientation(slerp(Quat(), -quarter_turn, 0.5f), half_way));
+  EXPECT_TRUE(same_orientation(nlerp(Quat(), quarter_turn, 1.f),
+                               quarter_turn));
+  ASSERT_TRUE(same_orientation(nlerp(Quat(), quarter_turn, 0.5f), half_way));
+}
+
+TEST_F(AnimationTest, LinearTrackInterpolatesAndClamps) {
+  expect_near(ramp.sample(0.5f), Vec3f(0.5f, 1.f, 1.5f));
+  expect_near(ramp.sample(2.f), Vec3f(2.f, 4.f, 6.f));
+  expect_near(ramp.sample(-1.f), Vec3f(0.f, 0.f, 0.f));
+  expect_near(ramp.sample(10.f), Vec3f(3.f, 6.f, 9.f));
+}
+
+TEST_F(AnimationTest, StepTrackHoldsKeys) {
+  Vec3Track step({0.f, 1.f}, {Vec3f(1.f, 1.f, 1.f), Vec3f(2.f, 2.f, 2.f)},
+                 Interpolation::step);
+  expect_near(step.sample(0.99f), Vec3f(1.f, 1.f, 1.f));
+  expect_near(step.sample(1.f), Vec3f(2.f, 2.f, 2.f));
+}
+
+TEST_F(AnimationTest, CatmullRomReproducesLinearMotion) {
+  // Uneven key spacing on a straight line at constant speed.
+  std::vector<float> times = {0.f, 0.5f, 2.f, 2.25f, 4.f};
+  std::vector<Vec3f> values;
+  for (float t : times) values.push_back(Vec3f(t, -2.f * t, 1.f));
+  Vec3Track track(times, values, Interpolation::catmull_rom);
+  for (float t = 0.f; t <= 4.f; t += 0.125f) {
+    expect_near(track.sample(t), Vec3f(t, -2.f * t, 1.f));
+  }
+}
+
+TEST_F(AnimationTest, HermiteReproducesCubic) {
+  std::vector<float> times = {0.f, 1.f, 1.5f, 3.f};
+  std::vector<Vec3f> values;
+  std::vector<Vec3f> tangents;
+  for (float t : times) {
+    values.push_back(Vec3f(t * t * t, t, 0.f));
+    Vec3f derivative(3.f * t * t, 1.f, 0.f);
+    tangents.push_back(derivative);  // in
+    tangents.push_back(derivative);  // out
+  }
+  Vec3Track track(times, values, tangents);
+  for (float t = 0.f; t <= 3.f; t += 0.1f) {
+    expect_near(track.sample(t), Vec3f(t * t * t, t, 0.f), 1e-4f);
+  }
+}
+
+TEST_F(AnimationTest, QuatTrackSlerpsBetweenKeys) {
+  QuatTrack track({0.f, 2.f}, {Quat(), quarter_turn}, Interpolation::slerp);
+  EXPECT_TRUE(same_orientation(track.sample(1.f),
+                               angle_axis(PI / 4.f, Vec3f(0.f, 0.f, 1.f))));
+  ASSERT_TRUE(same_orientation(track.sample(5.f), quarter_turn));
+}
+
+TEST_F(AnimationTest, CursorMatchesBinarySearch) {
+  std::mt19937 gen(12);
+  std::uniform_real_distribution<float> step(0.01f, 0.5f);
+  std::vector<float> times(200);
+  std::vector<Vec3f> values(times.size());
+  float t = 0.f;
+  for (std::size_t i = 0; i < times.size(); ++i) {
+    times[i] = t += step(gen);
+    values[i] = Vec3f(t, std::sin(t), std::cos(t));
+  }
+  Vec3Track track(times, values);
+
+  // Small steps forward, small steps back and long jumps both ways.
+  std::uniform_real_distribution<float> jump(-5.f, times.back() + 5.f);
+  std::uniform_real_distribution<float> frame(-0.05f, 0.1f);
+  TrackCursor cursor;
+  t = 0.f;
+  for (int i = 0; i < 5000; ++i) {
+    t = i % 100 == 0 ? jump(gen) : t + frame(gen);
+    Vec3f a = track.sample(t, cursor);
+    Vec3f b = track.sample(t);
+    ASSERT_TRUE(a == b) << "t " << t;
+  }
+}
+
+TEST_F(AnimationTest, RejectsInvalidTracks) {
+  Vec3f v;
+  EXPECT_THROW(Vec3Track({}, {}), std::invalid_argument);
+  EXPECT_THROW(Vec3Track({0.f, 1.f}, {v}), std::invalid_argument);
+  EXPECT_THROW(Vec3Track({1.f, 1.f}, {v, v}), std::invalid_argument);
+  EXPECT_THROW(Vec3Track({0.f}, {v}, Interpolation::slerp),
+               std::invalid_argument);
+  EXPECT_THROW(Vec3Track({0.f}, {v}, Interpolation::hermite),
+               std::invalid_argument);
+  ASSERT_THROW(QuatTrack({0.f}, {Quat()}, Interpolation::catmull_rom),
+               std::invalid_argument);
+}
+
+TEST_F(AnimationTest, ClipSamplesEveryJoint) {
+  AnimationClip clip;
+  QuatTrack spin({0.f, 1.f, 2.f},
+                 {Quat(), quarter_turn, angle_axis(PI, Vec3f(0.f, 0.f, 1.f))},
+                 Interpolation::slerp);
+  clip.add_joint(ramp, spin, Vec3Track::constant(Vec3f(2.f, 2.f, 2.f)));
+  clip.add_joint(Vec3Track::constant(Vec3f(0.f, 1.f, 0.f)),
+                 QuatTrack::constant(quarter_turn), ramp);
+  ASSERT_THAT(clip.joint_count(), Eq(2u));
+  ASSERT_THAT(clip.duration(), Eq(3.f));
+
+  auto cursor = clip.make_cursor();
+  std::vector<JointPose> poses(2);
+  for (float t = -0.5f; t < 3.5f; t += 1.f / 60.f) {
+    clip.sample(t, cursor, poses);
+    expect_near(poses[0].translation, ramp.sample(t));
+    expect_same(poses[0].rotation, spin.sample(t));
+    expect_near(poses[0].scale, Vec3f(2.f, 2.f, 2.f));
+    expect_near(poses[1].translation, Vec3f(0.f, 1.f, 0.f));
+    expect_same(poses[1].rotation, quarter_turn);
+    expect_near(poses[1].scale, ramp.sample(t));
+  }
+  std::vector<JointPose> small(1);
+  ASSERT_THROW(clip.sample(0.f, cursor, small), std::out_of_range);
+}
@@ -0,0 +1,115 @@
+#include "binary_io.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <sstream>
+
+using testing::ElementsAreArray;
+using testing::Eq;
+
+class BinaryIOTest : public testing::Test {
+ public:
+  void TearDown() override { std::filesystem::remove(path); }
+
+  std::string path = (std::filesystem::temp_directory_path() /
+                      ("math_binary_io_" + std::to_string(::getpid())))
+                         .string();
+  std::vector<Point3f> points = {Point3f(1.f, 2.f, 3.f),
+                                 Point3f(-4.5f, 0.f, 1e-7f),
+                                 Point3f(1e30f, -2.f, 0.25f)};
+};
+
+TEST_F(BinaryIOTest, RoundTripsThroughStream) {
+  std::stringstream ss;
+  write_binary(ss, std::span<const Point3f>(points));
+  ASSERT_THAT(read_binary<Point3f>(ss), ElementsAreArray(points));
+}
+
+TEST_F(BinaryIOTest, WritesVersionedHeader) {
+  write_binary(path, points);
+  MappedArray<Point3f> mapped(path);
+  const auto& h = mapped.header();
+  EXPECT_THAT(h.version, Eq(BinaryHeader::kVersion));
+  EXPECT_THAT(h.count, Eq(3u));
+  EXPECT_THAT(h.element_size, Eq(sizeof(Point3f)));
+  ASSERT_THAT(std::filesystem::file_size(path),
+              Eq(BinaryHeader::kDataOffset + 3 * sizeof(Point3f)));
+}
+
+TEST_F(BinaryIOTest, MapsFileInPlace) {
+  write_binary(path, points);
+  MappedArray<Point3f> mapped(path);
+  std::span<const Point3f> view = mapped;
+  EXPECT_THAT(view.size(), Eq(3u));
+  EXPECT_THAT(reinterpret_cast<uintptr_t>(view.data()) % alignof(Point3f),
+              Eq(0u));
+  EXPECT_THAT(view, ElementsAreArray(points));
+  ASSERT_THROW(mapped[3], std::out_of_range);
+}
+
+TEST_F(BinaryIOTest, MapsMatrices) {
+  std::vector<Mat4f> transforms = {Mat4f(), translation(1.f, 2.f, 3.f),
+                                   rotationOverY(0.5f) * scale(2.f, 2.f, 2.f)};
+  write_binary(path, transforms);
+  MappedArray<Mat4f> mapped(path);
+  ASSERT_THAT(mapped.span(), ElementsAreArray(transforms));
+
+  MappedArray<Mat4f> moved = std::move(mapped);
+  EXPECT_TRUE(mapped.empty());
+  EXPECT_THAT(moved.header().count, Eq(3u));
+  ASSERT_THAT(moved[1], Eq(transforms[1]));
+
+  // Nothing is mapped after a move or default construction.
+  MappedArray<Mat4f> unmapped;
+  for (const auto* none : {&mapped, &unmapped}) {
+    EXPECT_THROW(none->header(), std::runtime_error);
+    EXPECT_THAT(none->span().size(), Eq(0u));
+    EXPECT_THROW((*none)[0], std::out_of_range);
+    none->will_need();
+  }
+}
+
+TEST_F(BinaryIOTest, RejectsOtherElementType) {
+  write_binary(path, points);
+  EXPECT_THROW(MappedArray<Vec3f>{path}, std::runtime_error);
+  EXPECT_THROW(MappedArray<Point3d>{path}, std::runtime_error);
+  ASSERT_THROW(read_binary<Normal3f>(path), std::runtime_error);
+}
+
+TEST_F(BinaryIOTest, RejectsTruncatedFile) {
+  write_binary(path, points);
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  EXPECT_THROW(MappedArray<Point3f>{path}, std::runtime_error);
+  ASSERT_THROW(read_binary<Point3f>(path), std::runtime_error);
+}
+
+TEST_F(BinaryIOTest, RejectsForeignFile) {
+  std::ofstream(path) << "v 1 2 3\nv 4 5 6\nv 7 8 9\nv 1 2 3\nv 4 5 6\n"
+                         "v 1 2 3\nv 4 5 6\nv 7 8 9\nv 1 2 3\nv 4 5 6\n";
+  ASSERT_THROW(MappedArray<Point3f>{path}, std::runtime_error);
+}
+
+TEST_F(BinaryIOTest, ReadsOtherByteOrder) {
+  std::stringstream native;
+  write_binary(native, std::span<const Point3f>(points));
+  std::string bytes = native.str();
+
+  // Rewrite the file as a machine with the other byte order would have.
+  BinaryHeader h;
+  std::memcpy(&h, bytes.data(), sizeof(h));
+  h.endian = h.endian == BinaryEndian::little ? BinaryEndian::big
+                                              : BinaryEndian::little;
+  detail::swap_header(h);
+  std::memcpy(bytes.data(), &h, sizeof(h));
+  detail::swap_scalars(
+      reinterpret_cast<unsigned char*>(bytes.data()) + sizeof(h),
+      bytes.size() - sizeof(h), sizeof(float));
+
+  std::stringstream foreign(bytes);
+  EXPECT_THAT(read_binary<Point3f>(foreign), ElementsAreArray(points));
+
+  std::ofstream(path, std::ios::binary) << bytes;
+  ASSERT_THROW(MappedArray<Point3f>{path}, std::runtime_error);
+}
@@ -0,0 +1,230 @@
+#include "bvh.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "random_scene.h"
+
+using testing::Eq;
+using testing::FloatNear;
+
+class BvhTest : public testing::Test {
+ public:
+  BvhTest() {
+    for (auto& t : triangles) t = random_triangle(gen);
+  }
+
+  TriangleHit<float> brute_force(const Ray& ray) const {
+    return ::brute_force(triangles, ray);
+  }
+
+  Ray random_ray() { return ::random_ray(gen, 15.f); }
+
+  std::mt19937 gen{42};
+  std::vector<Trianglef> triangles = std::vector<Trianglef>(5000);
+  ThreadPool pool{3};
+};
+
+TEST_F(BvhTest, NodesBoundTheirTriangles) {
+  Bvhf bvh(std::span<const Trianglef>(triangles), pool);
+  ASSERT_THAT(bvh.size(), Eq(triangles.size()));
+  auto nodes = bvh.nodes();
+  std::vector<int> seen(triangles.size(), 0);
+  for (const auto& node : nodes) {
+    if (!node.leaf()) {
+      ASSERT_TRUE(node.first + 1 < nodes.size());
+      AABBf children = merge(nodes[node.first].box, nodes[node.first + 1].box);
+      ASSERT_THAT(children, Eq(node.box));
+      continue;
+    }
+    ASSERT_TRUE(node.count <= Bvhf::kMaxLeafSize);
+    for (uint32_t s = node.first; s < node.first + node.count; ++s) {
+      ++seen[bvh.indices()[s]];
+      ASSERT_THAT(bvh.triangles()[s], Eq(triangles[bvh.indices()[s]]));
+      AABBf box = bvh.triangles()[s].bounds();
+      ASSERT_THAT(merge(node.box, box), Eq(node.box));
+    }
+  }
+  for (int s : seen) ASSERT_THAT(s, Eq(1));
+  EXPECT_THAT(nodes.size(), Eq(2 * (nodes.size() / 2) + 1));
+}
+
+TEST_F(BvhTest, NearestHitMatchesBruteForce) {
+  Bvhf bvh(std::span<const Trianglef>(triangles), pool);
+  int hits = 0;
+  for (int i = 0; i < 2000; ++i) {
+    Ray ray = random_ray();
+    if (i % 3 == 0) ray.setMaxRange(8.f);
+    if (i % 10 == 0) ray.setDirection(Vec3f(0.f, ray.direction().y(), 0.f));
+    TriangleHit<float> expected = brute_force(ray);
+    TriangleHit<float> found = bvh.intersect(ray);
+    ASSERT_THAT(found.triangle, Eq(expected.triangle)) << i;
+    if (!expected.hit()) continue;
+    ++hits;
+    ASSERT_THAT(found.t, FloatNear(expected.t, 1e-5f));
+  }
+  EXPECT_TRUE(hits > 200);
+}
+
+TEST_F(BvhTest, BatchMatchesSingle) {
+  Bvhf bvh{std::span<const Trianglef>(triangles)};
+  std::vector<Ray> rays(500);
+  for (auto& r : rays) r = random_ray();
+  std::vector<TriangleHit<float>> hits(rays.size());
+  bvh.intersect(std::span<const Ray>(rays), std::span(hits), pool);
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    ASSERT_THAT(hits[i], Eq(bvh.intersect(rays[i])));
+  }
+  std::vector<TriangleHit<float>> small(1);
+  ASSERT_THROW(bvh.intersect(std::span<const Ray>(rays), std::span(small)),
+               std::out_of_range);
+}
+
+TEST_F(BvhTest, OcclusionMatchesNearestHit) {
+  Bvhf bvh(std::span<const Trianglef>(triangles), pool);
+  std::vector<Ray> rays(2000);
+  int blocked = 0;
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    rays[i] = random_ray();
+    if (i % 2 == 0) rays[i].setMaxRange(5.f);
+    if (i % 10 == 0) {
+      rays[i].setDirection(Vec3f(0.f, rays[i].direction().y(), 0.f));
+    }
+    bool expected = brute_force(rays[i]).hit();
+    ASSERT_THAT(bvh.occluded(rays[i]), Eq(expected)) << i;
+    blocked += expected;
+  }
+  EXPECT_TRUE(blocked > 200);
+
+  std::vector<uint8_t> batch(rays.size());
+  bvh.occluded(std::span<const Ray>(rays), std::span(batch), pool);
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    ASSERT_THAT(batch[i], Eq(bvh.occluded(rays[i])));
+  }
+  std::vector<uint8_t> small(1);
+  ASSERT_THROW(bvh.occluded(std::span<const Ray>(rays), std::span(small)),
+               std::out_of_range);
+}
+
+TEST_F(BvhTest, RefitAndRotateFollowMovedTriangles) {
+  Bvhf bvh(std::span<const Trianglef>(triangles), pool);
+  // Spin every triangle about the y axis by an angle growing with its
+  // distance from it, which scrambles which ones are close.
+  for (auto& t : triangles) {
+    auto spin = [](const Point3f& p) {
+      float angle = 0.3f * std::sqrt(p.x() * p.x() + p.z() * p.z());
+      float c = std::cos(angle), s = std::sin(angle);
+      return Point3f(c * p.x() + s * p.z(), p.y(), c * p.z() - s * p.x());
+    };
+    t = {spin(t.a), spin(t.b), spin(t.c)};
+  }
+  bvh.refit(std::span<const Trianglef>(triangles), pool);
+  float refit_cost = bvh.sah_cost();
+  std::size_t swaps = 0;
+  for (int pass = 0; pass < 4; ++pass) swaps += bvh.rotate(pool);
+  EXPECT_TRUE(swaps > 0);
+  EXPECT_TRUE(bvh.sah_cost() < refit_cost);
+
+  auto nodes = bvh.nodes();
+  for (const auto& node : nodes) {
+    if (!node.leaf()) {
+      AABBf children = merge(nodes[node.first].box, nodes[node.first + 1].box);
+      ASSERT_THAT(children, Eq(node.box));
+      continue;
+    }
+    for (uint32_t s = node.first; s < node.first + node.count; ++s) {
+      ASSERT_THAT(bvh.triangles()[s], Eq(triangles[bvh.indices()[s]]));
+      ASSERT_THAT(merge(node.box, bvh.triangles()[s].bounds()), Eq(node.box));
+    }
+  }
+  for (int i = 0; i < 500; ++i) {
+    Ray ray = random_ray();
+    ASSERT_THAT(bvh.intersect(ray).triangle, Eq(brute_force(ray).triangle));
+  }
+  std::vector<Trianglef> fewer(10);
+  ASSERT_THROW(bvh.refit(std::span<const Trianglef>(fewer)),
+               std::invalid_argument);
+}
+
+TEST_F(BvhTest, RotationsKeepTheDepthBound) {
+  // Hills of 80 x 80 quads swirling about their centre, faster further
+  // out. Refit and rotated every frame, the tree reached depth 73 in 300
+  // frames before rotations were bounded.
+  constexpr int kQuads = 80;
+  auto vertex = [](int i, int j) {
+    float x = -50.f + 100.f * static_cast<float>(i) / kQuads;
+    float z = -50.f + 100.f * static_cast<float>(j) / kQuads;
+    float y = 4.f * std::sin(x * 0.15f) * std::cos(z * 0.11f) +
+              std::sin(x * 0.9f + z * 0.7f);
+    return Point3f(x, y, z);
+  };
+  std::vector<Trianglef> rest;
+  for (int i = 0; i < kQuads; ++i) {
+    for (int j = 0; j < kQuads; ++j) {
+      rest.push_back({vertex(i, j), vertex(i, j + 1), vertex(i + 1, j)});
+      rest.push_back(
+          {vertex(i + 1, j), vertex(i, j + 1), vertex(i + 1, j + 1)});
+    }
+  }
+  triangles = rest;
+  Bvhf bvh(std::span<const Trianglef>(triangles), pool);
+  auto depth = [&] {
+    auto nodes = bvh.nodes();
+    std::vector<std::pair<uint32_t, int>> stack = {{0, 0}};
+    int deepest = 0;
+    while (!stack.empty()) {
+      auto [node, at] = stack.back();
+      stack.pop_back();
+      deepest = std::max(deepest, at);
+      if (nodes[node].leaf()) continue;
+      stack.push_back({nodes[node].first, at + 1});
+      stack.push_back({nodes[node].first + 1, at + 1});
+    }
+    return deepest;
+  };
+  int bound = std::max(depth(), detail::kBvhSahDepth);
+
+  for (int frame = 1; frame <= 300; ++frame) {
+    auto swirl = [&](const Point3f& p) {
+      float r = std::sqrt(p.x() * p.x() + p.z() * p.z());
+      float angle = 0.008f * static_cast<float>(frame) * r;
+      float c = std::cos(angle), s = std::sin(angle);
+      return Point3f(c * p.x() + s * p.z(), p.y(), c * p.z() - s * p.x());
+    };
+    for (std::size_t i = 0; i < rest.size(); ++i) {
+      triangles[i] = {swirl(rest[i].a), swirl(rest[i].b), swirl(rest[i].c)};
+    }
+    bvh.refit(std::span<const Trianglef>(triangles), pool);
+    bvh.rotate(pool);
+    ASSERT_TRUE(depth() <= bound) << frame;
+  }
+  for (int i = 0; i < 300; ++i) {
+    Ray ray = random_ray();
+    ASSERT_THAT(bvh.intersect(ray).triangle, Eq(brute_force(ray).triangle));
+    ASSERT_THAT(bvh.occluded(ray), Eq(brute_force(ray).hit()));
+  }
+}
+
+TEST_F(BvhTest, EmptyAndDegenerateSets) {
+  Bvhf empty{std::span<const Trianglef>()};
+  EXPECT_FALSE(empty.intersect(random_ray()).hit());
+  EXPECT_FALSE(empty.occluded(random_ray()));
+  EXPECT_TRUE(empty.bounds().empty());
+
+  // Identical triangles: no split separates them.
+  std::vector<Trianglef> same(
+      100, Trianglef{Point3f(0.f, 0.f, 0.f), Point3f(1.f, 0.f, 0.f),
+                     Point3f(0.f, 1.f, 0.f)});
+  Bvhf stacked(std::span<const Trianglef>(same), pool);
+  TriangleHit<float> hit = stacked.intersect(
+      Ray(Point3f(0.2f, 0.2f, 1.f), Vec3f(0.f, 0.f, -1.f)));
+  ASSERT_TRUE(hit.hit());
+  EXPECT_THAT(hit.t, FloatNear(1.f, 1e-6f));
+  EXPECT_TRUE(stacked.occluded(
+      Ray(Point3f(0.2f, 0.2f, 1.f), Vec3f(0.f, 0.f, -1.f))));
+}
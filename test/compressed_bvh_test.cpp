@@ -0,0 +1,116 @@
+#include "compressed_bvh.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "random_scene.h"
+
+using testing::Eq;
+
+class CompressedBvhTest : public testing::Test {
+ public:
+  CompressedBvhTest() {
+    for (auto& t : triangles) t = random_triangle(gen);
+  }
+
+  Ray random_ray() { return ::random_ray(gen, 15.f); }
+
+  // Box of everything below child c of node, from the triangles.
+  AABBf exact_bounds(const CompressedBvh& tree, const CompressedBvhNode& node,
+                     int c) {
+    AABBf box;
+    if (node.leaf >> c & 1u) {
+      uint32_t first = node.triangle_base + (node.meta[c] >> 3u);
+      for (uint32_t s = first; s <= first + (node.meta[c] & 7u); ++s) {
+        box.expand(tree.triangles()[s].bounds());
+      }
+      return box;
+    }
+    uint32_t index = node.child_base;
+    for (int i = 0; i < c; ++i) index += node.inner >> i & 1u;
+    const CompressedBvhNode& child = tree.nodes()[index];
+    for (int i = 0; i < CompressedBvh::kWidth; ++i) {
+      if ((child.inner | child.leaf) >> i & 1u) {
+        box.expand(exact_bounds(tree, child, i));
+      }
+    }
+    return box;
+  }
+
+  std::mt19937 gen{47};
+  std::vector<Trianglef> triangles = std::vector<Trianglef>(5000);
+  ThreadPool pool{3};
+};
+
+TEST_F(CompressedBvhTest, DecodedBoxesContainTheirTriangles) {
+  Bvhf bvh(std::span<const Trianglef>(triangles), pool);
+  CompressedBvh tree(bvh);
+  ASSERT_THAT(tree.size(), Eq(triangles.size()));
+  EXPECT_THAT(sizeof(CompressedBvhNode), Eq(64u));
+  std::vector<int> seen(triangles.size(), 0);
+  for (std::size_t s = 0; s < tree.size(); ++s) {
+    ++seen[tree.indices()[s]];
+    ASSERT_THAT(tree.triangles()[s], Eq(triangles[tree.indices()[s]]));
+  }
+  for (int s : seen) ASSERT_THAT(s, Eq(1));
+
+  float slack = 0.f;
+  for (const CompressedBvhNode& node : tree.nodes()) {
+    ASSERT_TRUE(node.inner | node.leaf);
+    ASSERT_FALSE(node.inner & node.leaf);
+    for (int c = 0; c < CompressedBvh::kWidth; ++c) {
+      if (!((node.inner | node.leaf) >> c & 1u)) continue;
+      AABBf decoded = CompressedBvh::child_bounds(node, c);
+      AABBf exact = exact_bounds(tree, node, c);
+      ASSERT_THAT(merge(decoded, exact), Eq(decoded));
+      slack = std::max(slack, decoded.surface_area() / exact.surface_area());
+    }
+  }
+  // A quarter as many nodes as the binary tree, each looser by little.
+  EXPECT_TRUE(tree.node_count() * 3 < bvh.node_count());
+  EXPECT_TRUE(slack < 1.5f);
+}
+
+TEST_F(CompressedBvhTest, HitsMatchBvh) {
+  Bvhf bvh(std::span<const Trianglef>(triangles), pool);
+  CompressedBvh tree(bvh);
+  std::vector<Ray> rays(2000);
+  int hits = 0;
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    rays[i] = random_ray();
+    if (i % 3 == 0) rays[i].setMaxRange(8.f);
+    if (i % 10 == 0) {
+      rays[i].setDirection(Vec3f(0.f, rays[i].direction().y(), 0.f));
+    }
+    TriangleHit<float> expected = bvh.intersect(rays[i]);
+    ASSERT_THAT(tree.intersect(rays[i]), Eq(expected)) << i;
+    ASSERT_THAT(tree.occluded(rays[i]), Eq(expected.hit())) << i;
+    hits += expected.hit();
+  }
+  EXPECT_TRUE(hits > 200);
+  std::vector<TriangleHit<float>> batch(rays.size());
+  tree.intersect(std::span<const Ray>(rays), std::span(batch), pool);
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    ASSERT_THAT(batch[i], Eq(tree.intersect(rays[i])));
+  }
+}
+
+TEST_F(CompressedBvhTest, EmptyAndSingleLeafTrees) {
+  CompressedBvh empty{Bvhf{std::span<const Trianglef>()}};
+  EXPECT_FALSE(empty.intersect(random_ray()).hit());
+  EXPECT_THAT(empty.node_count(), Eq(0u));
+
+  std::vector<Trianglef> one = {{Point3f(0.f, 0.f, 0.f),
+                                 Point3f(1.f, 0.f, 0.f),
+                                 Point3f(0.f, 1.f, 0.f)}};
+  CompressedBvh single{Bvhf{std::span<const Trianglef>(one)}};
+  EXPECT_THAT(single.node_count(), Eq(1u));
+  Ray down(Point3f(0.2f, 0.2f, 1.f), Vec3f(0.f, 0.f, -1.f));
+  TriangleHit<float> hit = single.intersect(down);
+  EXPECT_THAT(hit.triangle, Eq(0u));
+  EXPECT_THAT(hit.t, Eq(1.f));
+  EXPECT_TRUE(single.occluded(down));
+}
@@ -0,0 +1,105 @@
+#include "dynamic_bvh.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "random_scene.h"
+
+using testing::Eq;
+using testing::FloatNear;
+
+class DynamicBvhTest : public testing::Test {
+ public:
+  Trianglef random_triangle() { return ::random_triangle(gen); }
+
+  Ray random_ray() { return ::random_ray(gen, 15.f); }
+
+  // Checks tree against a Bvh over the live triangles, hit by hit.
+  void expect_same_hits(const DynamicBvhf& tree) {
+    std::vector<Trianglef> live;
+    std::vector<uint32_t> ids;
+    for (uint32_t id = 0; id < triangles.size(); ++id) {
+      if (!tree.contains(id)) continue;
+      ASSERT_THAT(tree.triangle(id), Eq(triangles[id]));
+      live.push_back(triangles[id]);
+      ids.push_back(id);
+    }
+    ASSERT_THAT(tree.size(), Eq(live.size()));
+    Bvhf bvh(std::span<const Trianglef>(live), pool);
+    int hits = 0;
+    for (int i = 0; i < 1000; ++i) {
+      Ray ray = random_ray();
+      if (i % 3 == 0) ray.setMaxRange(8.f);
+      TriangleHit<float> expected = bvh.intersect(ray);
+      TriangleHit<float> found = tree.intersect(ray);
+      ASSERT_THAT(found.hit(), Eq(expected.hit())) << i;
+      ASSERT_THAT(tree.occluded(ray), Eq(expected.hit())) << i;
+      if (!expected.hit()) continue;
+      ++hits;
+      ASSERT_THAT(found.triangle, Eq(ids[expected.triangle])) << i;
+      ASSERT_THAT(found.t, FloatNear(expected.t, 1e-5f)) << i;
+    }
+    EXPECT_TRUE(hits > 50);
+  }
+
+  std::mt19937 gen{17};
+  std::vector<Trianglef> triangles;
+  ThreadPool pool{3};
+};
+
+TEST_F(DynamicBvhTest, InsertedTrianglesAreFound) {
+  DynamicBvhf tree;
+  for (int i = 0; i < 3000; ++i) {
+    triangles.push_back(random_triangle());
+    ASSERT_THAT(tree.insert(triangles.back()), Eq(static_cast<uint32_t>(i)));
+  }
+  EXPECT_THAT(tree.node_count(), Eq(2 * 3000u - 1));
+  expect_same_hits(tree);
+  // Within reach of a tree built over all of them at once.
+  Bvhf built(std::span<const Trianglef>(triangles), pool);
+  EXPECT_TRUE(tree.sah_cost() < 2.f * built.sah_cost());
+}
+
+TEST_F(DynamicBvhTest, RemoveUpdateAndReuseIds) {
+  DynamicBvhf tree;
+  for (int i = 0; i < 2000; ++i) {
+    triangles.push_back(random_triangle());
+    tree.insert(triangles.back());
+  }
+  for (uint32_t id = 0; id < 2000; id += 2) tree.remove(id);
+  for (uint32_t id = 1; id < 2000; id += 4) {
+    triangles[id] = random_triangle();
+    tree.update(id, triangles[id]);
+  }
+  expect_same_hits(tree);
+
+  // Removed ids come back, the last removed first.
+  triangles[1998] = random_triangle();
+  EXPECT_THAT(tree.insert(triangles[1998]), Eq(1998u));
+  EXPECT_TRUE(tree.contains(1998));
+  EXPECT_FALSE(tree.contains(1996));
+  expect_same_hits(tree);
+  ASSERT_THROW(tree.remove(1996), std::out_of_range);
+  ASSERT_THROW(tree.update(5000, triangles[0]), std::out_of_range);
+}
+
+TEST_F(DynamicBvhTest, EmptiesAndRefills) {
+  DynamicBvhf tree;
+  EXPECT_FALSE(tree.intersect(random_ray()).hit());
+  EXPECT_TRUE(tree.bounds().empty());
+  uint32_t a = tree.insert({Point3f(0.f, 0.f, 0.f), Point3f(1.f, 0.f, 0.f),
+                            Point3f(0.f, 1.f, 0.f)});
+  Ray down(Point3f(0.2f, 0.2f, 1.f), Vec3f(0.f, 0.f, -1.f));
+  TriangleHit<float> hit = tree.intersect(down);
+  EXPECT_THAT(hit.triangle, Eq(a));
+  EXPECT_THAT(hit.t, FloatNear(1.f, 1e-6f));
+  tree.remove(a);
+  EXPECT_TRUE(tree.empty());
+  EXPECT_FALSE(tree.occluded(down));
+  EXPECT_THAT(tree.insert(random_triangle()), Eq(a));
+  tree.clear();
+  EXPECT_THAT(tree.size(), Eq(0u));
+}
@@ -0,0 +1,100 @@
+#include "fast_math.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using testing::FloatEq;
+using testing::FloatNear;
+
+class FastMathTest : public testing::Test {
+ public:
+  // Relative tolerances equivalent to the documented ulp bounds.
+  float rsqrt_eps = 16.f * EPS;
+  float trig_eps = 4.f * EPS;
+};
+
+TEST_F(FastMathTest, ComputesReciprocalSquareRoot) {
+  for (float x : {1e-30f, 0.25f, 1.f, 2.f, 3.f, 1e5f, 3.4e38f}) {
+    float exact = 1.f / std::sqrt(x);
+    EXPECT_THAT(fast::rsqrt(x), FloatNear(exact, exact * rsqrt_eps));
+  }
+}
+
+TEST_F(FastMathTest, ComputesSineAndCosine) {
+  for (float x = -100.f; x < 100.f; x += 0.37f) {
+    float s, c;
+    fast::sincos(x, s, c);
+    EXPECT_THAT(s, FloatNear(std::sin(x), trig_eps));
+    EXPECT_THAT(c, FloatNear(std::cos(x), trig_eps));
+    EXPECT_THAT(fast::sin(x), FloatEq(s));
+    EXPECT_THAT(fast::cos(x), FloatEq(c));
+  }
+}
+
+TEST_F(FastMathTest, ComputesInverseTrigonometricFunctions) {
+  for (float x = -1.f; x <= 1.f; x += 0.01f) {
+    EXPECT_THAT(fast::acos(x), FloatNear(std::acos(x), trig_eps));
+  }
+  EXPECT_THAT(fast::acos(1.f), FloatEq(0.f));
+  EXPECT_THAT(fast::acos(-1.f), FloatEq(std::acos(-1.f)));
+
+  for (float y = -10.f; y < 10.f; y += 0.7f) {
+    for (float x = -10.f; x < 10.f; x += 0.9f) {
+      EXPECT_THAT(fast::atan2(y, x), FloatNear(std::atan2(y, x), trig_eps));
+    }
+  }
+  EXPECT_THAT(fast::atan2(1.f, 0.f), FloatEq(std::atan2(1.f, 0.f)));
+  EXPECT_THAT(fast::atan2(-1.f, 0.f), FloatEq(std::atan2(-1.f, 0.f)));
+}
+
+TEST_F(FastMathTest, NormalizesVector) {
+  auto v = Vec3f(4.53f, 93.5f, -56.3f);
+  auto n = fast::normalized(v);
+  auto exact = normalized(v);
+  EXPECT_THAT(n.x(), FloatNear(exact.x(), rsqrt_eps));
+  EXPECT_THAT(n.y(), FloatNear(exact.y(), rsqrt_eps));
+  EXPECT_THAT(n.z(), FloatNear(exact.z(), rsqrt_eps));
+  EXPECT_THAT(fast::length(n), FloatNear(1.f, rsqrt_eps));
+
+  fast::normalize(v);
+  ASSERT_THAT(v.length(), FloatNear(1.f, rsqrt_eps));
+}
+
+TEST_F(FastMathTest, NormalizesQuaternion) {
+  auto q = Quat(1.f, 2.f, 3.f, 4.f);
+  EXPECT_THAT(fast::length(q), FloatNear(q.length(), q.length() * rsqrt_eps));
+
+  fast::normalize(q);
+  EXPECT_THAT(q.length(), FloatNear(1.f, rsqrt_eps));
+  ASSERT_TRUE(same_orientation(fast::normalized(Quat(0.f, 0.f, 0.f, 2.f)),
+                               Quat()));
+}
+
+TEST_F(FastMathTest, BuildsQuaternionFromAngleAxis) {
+  auto axis = Vec3f(0.3f, -1.f, 2.f);
+  auto q = fast::angle_axis(1.2f, axis);
+  auto exact = angle_axis(1.2f, axis);
+  EXPECT_THAT(q.x(), FloatNear(exact.x(), rsqrt_eps));
+  EXPECT_THAT(q.y(), FloatNear(exact.y(), rsqrt_eps));
+  EXPECT_THAT(q.z(), FloatNear(exact.z(), rsqrt_eps));
+  EXPECT_THAT(q.w(), FloatNear(exact.w(), rsqrt_eps));
+  ASSERT_THAT(fast::get_angle(q), FloatNear(1.2f, 1E-5f));
+}
+
+TEST_F(FastMathTest, BuildsRotationMatrices) {
+  for (float a : {-2.5f, 0.f, 0.7f, 3.1f}) {
+    auto fx = fast::rotationOverX(a);
+    auto fy = fast::rotationOverY(a);
+    auto fz = fast::rotationOverZ(a);
+    auto ex = rotationOverX(a);
+    auto ey = rotationOverY(a);
+    auto ez = rotationOverZ(a);
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        EXPECT_THAT(fx[i][j], FloatNear(ex[i][j], trig_eps));
+        EXPECT_THAT(fy[i][j], FloatNear(ey[i][j], trig_eps));
+        EXPECT_THAT(fz[i][j], FloatNear(ez[i][j], trig_eps));
+      }
+    }
+  }
+}
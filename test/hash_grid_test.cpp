@@ -0,0 +1,103 @@
+#include "hash_grid.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "random_scene.h"
+
+using testing::Eq;
+
+class HashGridTest : public testing::Test {
+ public:
+  std::vector<uint32_t> neighbors(const HashGridf& grid, const Point3f& q) {
+    std::vector<uint32_t> found;
+    grid.for_each_neighbor(q, [&](uint32_t i, float d2) {
+      EXPECT_TRUE(d2 <= grid.radius() * grid.radius());
+      found.push_back(i);
+    });
+    std::sort(found.begin(), found.end());
+    return found;
+  }
+
+  std::vector<uint32_t> brute_force(const Point3f& q, float r) {
+    std::vector<uint32_t> found;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      if (distance2(points[i], q) <= r * r) {
+        found.push_back(static_cast<uint32_t>(i));
+      }
+    }
+    return found;
+  }
+
+  void jitter(float amount) {
+    std::uniform_real_distribution<float> step(-amount, amount);
+    for (auto& p : points) {
+      p = Point3f(p.x() + step(gen), p.y() + step(gen), p.z() + step(gen));
+    }
+  }
+
+  std::mt19937 gen{12};
+  std::vector<Point3f> points = random_points(gen, 30000, 20.f);
+  ThreadPool pool{3};
+};
+
+TEST_F(HashGridTest, NeighborsMatchBruteForce) {
+  HashGridf grid(std::span<const Point3f>(points), 1.25f, pool);
+  ASSERT_THAT(grid.size(), Eq(points.size()));
+  for (std::size_t i = 0; i < points.size(); i += 97) {
+    ASSERT_THAT(neighbors(grid, points[i]), Eq(brute_force(points[i], 1.25f)));
+  }
+  Point3f outside(100.f, -100.f, 3.f);
+  ASSERT_TRUE(neighbors(grid, outside).empty());
+}
+
+TEST_F(HashGridTest, OrderIsAPermutation) {
+  HashGridf grid(std::span<const Point3f>(points), 0.5f, pool);
+  std::vector<uint32_t> order(grid.order().begin(), grid.order().end());
+  std::sort(order.begin(), order.end());
+  for (std::size_t i = 0; i < order.size(); ++i) ASSERT_THAT(order[i], Eq(i));
+}
+
+TEST_F(HashGridTest, UpdateMatchesRebuild) {
+  HashGridf grid(std::span<const Point3f>(points), 1.f, pool);
+  EXPECT_THAT(grid.update(std::span<const Point3f>(points), pool), Eq(0u));
+  for (float amount : {0.01f, 0.05f, 2.f}) {
+    jitter(amount);
+    std::size_t moved = grid.update(std::span<const Point3f>(points), pool);
+    EXPECT_TRUE(moved > 0);
+    HashGridf fresh(std::span<const Point3f>(points), 1.f, pool);
+    ASSERT_TRUE(std::ranges::equal(grid.order(), fresh.order()));
+    for (std::size_t i = 0; i < points.size(); i += 211) {
+      ASSERT_THAT(neighbors(grid, points[i]), Eq(brute_force(points[i], 1.f)));
+    }
+  }
+}
+
+TEST_F(HashGridTest, HandlesEmptyAndResizedSets) {
+  HashGridf grid(std::span<const Point3f>(), 1.f);
+  EXPECT_TRUE(neighbors(grid, Point3f()).empty());
+  points.resize(100);
+  grid.update(std::span<const Point3f>(points));
+  ASSERT_THAT(neighbors(grid, points[0]), Eq(brute_force(points[0], 1.f)));
+  ASSERT_THROW(grid.rebuild(std::span<const Point3f>(points), 0.f),
+               std::invalid_argument);
+}
+
+TEST_F(HashGridTest, FarPointsShareBorderCells) {
+  // Beyond 2^20 cells from the origin all points land in the border cells.
+  std::vector<Point3f> far = {
+      Point3f(3e6f, 0.f, 0.f), Point3f(3e6f + 0.5f, 0.f, 0.f),
+      Point3f(5e6f, 0.f, 0.f), Point3f(-4e6f, 0.f, 0.f)};
+  HashGridf grid{std::span<const Point3f>(far), 1.f};
+  std::vector<uint32_t> found;
+  grid.for_each_neighbor(far[0], [&](uint32_t i, float) {
+    found.push_back(i);
+  });
+  std::sort(found.begin(), found.end());
+  ASSERT_THAT(found, Eq(std::vector<uint32_t>{0, 1}));
+  EXPECT_THAT(grid.cell_count(), Eq(2u));
+}
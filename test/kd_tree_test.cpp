@@ -0,0 +1,115 @@
+#include "kd_tree.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "random_scene.h"
+#include "vec3.h"
+
+using testing::Eq;
+
+class KdTreeTest : public testing::Test {
+ public:
+  // Every point by distance, ties by index.
+  std::vector<Neighbor<float>> brute_force(const Point3f& q) const {
+    std::vector<Neighbor<float>> all(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      all[i] = {static_cast<uint32_t>(i), distance2(points[i], q)};
+    }
+    std::sort(all.begin(), all.end(), [](const auto& a, const auto& b) {
+      return a.distance2 < b.distance2 ||
+             (a.distance2 == b.distance2 && a.index < b.index);
+    });
+    return all;
+  }
+
+  std::mt19937 gen{10};
+  std::vector<Point3f> points = random_points(gen, 20000, 10.f);
+  std::vector<Point3f> queries = random_points(gen, 200, 10.f);
+  ThreadPool pool{3};
+};
+
+TEST_F(KdTreeTest, KnnMatchesBruteForce) {
+  KdTreef tree(std::span<const Point3f>(points), pool);
+  ASSERT_THAT(tree.size(), Eq(points.size()));
+  for (const auto& q : queries) {
+    auto expected = brute_force(q);
+    auto found = tree.knn(q, 10);
+    ASSERT_THAT(found.size(), Eq(10u));
+    for (std::size_t i = 0; i < found.size(); ++i) {
+      ASSERT_THAT(found[i].distance2, Eq(expected[i].distance2));
+    }
+  }
+}
+
+TEST_F(KdTreeTest, RadiusMatchesBruteForce) {
+  KdTreef tree{std::span<const Point3f>(points)};
+  std::vector<Neighbor<float>> found;
+  for (const auto& q : queries) {
+    found.clear();
+    std::size_t n = tree.radius(q, 1.5f, found);
+    std::vector<uint32_t> indices;
+    for (const auto& f : found) indices.push_back(f.index);
+    std::sort(indices.begin(), indices.end());
+
+    std::vector<uint32_t> expected;
+    for (const auto& e : brute_force(q)) {
+      if (e.distance2 <= 1.5f * 1.5f) expected.push_back(e.index);
+    }
+    std::sort(expected.begin(), expected.end());
+    ASSERT_THAT(n, Eq(expected.size()));
+    ASSERT_THAT(indices, Eq(expected));
+  }
+}
+
+TEST_F(KdTreeTest, BatchedQueriesMatchSingle) {
+  KdTreef tree(std::span<const Point3f>(points), pool);
+  constexpr std::size_t k = 6;
+  std::vector<Neighbor<float>> knn(queries.size() * k);
+  tree.knn(std::span<const Point3f>(queries), k, std::span(knn), pool);
+  std::vector<Neighbor<float>> near(queries.size() * k);
+  std::vector<uint32_t> counts(queries.size());
+  tree.radius(std::span<const Point3f>(queries), 0.8f, k, std::span(near),
+              std::span(counts), pool);
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    auto single = tree.knn(queries[i], k);
+    std::size_t within = 0;
+    for (std::size_t j = 0; j < k; ++j) {
+      ASSERT_THAT(knn[i * k + j], Eq(single[j]));
+      if (single[j].distance2 <= 0.8f * 0.8f) ++within;
+    }
+    ASSERT_THAT(counts[i], Eq(within));
+    for (std::size_t j = 0; j < within; ++j) {
+      ASSERT_THAT(near[i * k + j].distance2, Eq(single[j].distance2));
+    }
+  }
+}
+
+TEST_F(KdTreeTest, SmallAndDegenerateSets) {
+  KdTreef empty{std::span<const Point3f>()};
+  EXPECT_TRUE(empty.knn(Point3f(), 3).empty());
+
+  std::vector<Point3f> few = {Point3f(0.f, 0.f, 0.f), Point3f(1.f, 0.f, 0.f),
+                              Point3f(5.f, 0.f, 0.f)};
+  KdTreef small{std::span<const Point3f>(few)};
+  auto found = small.knn(Point3f(4.f, 0.f, 0.f), 5);
+  ASSERT_THAT(found.size(), Eq(3u));
+  EXPECT_THAT(found[0].index, Eq(2u));
+  EXPECT_THAT(found[2].index, Eq(0u));
+  std::vector<Neighbor<float>> padded(4);
+  small.knn(std::span<const Point3f>(few).first(1), 4, std::span(padded));
+  EXPECT_THAT(padded[3], Eq(Neighbor<float>{}));
+
+  // All points equal: every split is a tie.
+  std::vector<Point3f> same(1000, Point3f(2.f, 2.f, 2.f));
+  KdTreef flat(std::span<const Point3f>(same), pool);
+  std::vector<Neighbor<float>> within;
+  EXPECT_THAT(flat.radius(Point3f(2.f, 2.f, 2.5f), 0.5f, within), Eq(1000u));
+  std::vector<Neighbor<float>> small_out(2);
+  ASSERT_THROW(flat.knn(Point3f(), 3, std::span(small_out)),
+               std::out_of_range);
+}
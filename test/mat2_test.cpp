@@ -65,6 +65,7 @@ TEST_F(Matrix2Test, MultipliesWithNumber) {
 TEST_F(Matrix2Test, GetsTheDeterminant) {
   m = Mat2<double>(Vec2<double>(5.36, 2.28), Vec2<double>(-1.5, 85.));
   ASSERT_DOUBLE_EQ(m.determinant(), 459.02);
+  static_assert(std::is_same_v<decltype(Mat2<float>().determinant()), float>);
 }
 
 TEST_F(Matrix2Test, AddsTwoMatrices) {
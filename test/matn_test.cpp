@@ -0,0 +1,132 @@
+#include "matn.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "mat4.h"
+#include "simd.h"
+
+using testing::DoubleNear;
+using testing::Eq;
+
+class MatrixTest : public testing::Test {
+ public:
+  // Diagonally dominant, so well conditioned.
+  template <int N>
+  Matrix<double, N, N> random_matrix() {
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    return Matrix<double, N, N>::generate(
+        [&](int r, int c) { return dist(gen) + (r == c ? 2. * N : 0.); });
+  }
+
+  template <int N>
+  void expect_inverse() {
+    auto m = random_matrix<N>();
+    auto product = m * m.inverse();
+    for (int r = 0; r < N; ++r) {
+      for (int c = 0; c < N; ++c) {
+        EXPECT_THAT(product[r][c], DoubleNear(r == c ? 1. : 0., 1e-14))
+            << N << "x" << N << " (" << r << "," << c << ")";
+      }
+    }
+    // det(m m) = det(m)^2, through the same kernel.
+    double det = m.determinant();
+    EXPECT_THAT((m * m).determinant(),
+                DoubleNear(det * det, 1e-12 * det * det));
+  }
+
+  std::mt19937 gen{49};
+};
+
+TEST_F(MatrixTest, Constructs) {
+  EXPECT_THAT(Mat6d(), Eq(Mat6d::filled(0.)));
+  Mat6d id = Mat6d::identity();
+  EXPECT_THAT(id.trace(), Eq(6.));
+  EXPECT_THAT(id[3], Eq(Vec6d::unit(3)));
+  EXPECT_THAT(id.column(5), Eq(Vec6d::unit(5)));
+  Mat3x4d m = Mat3x4d::generate([](int r, int c) { return r * 10. + c; });
+  EXPECT_THAT(m.transpose()[3], Eq(Vector<double, 3>(3., 13., 23.)));
+  EXPECT_THAT(m.transpose().transpose(), Eq(m));
+  EXPECT_THAT(Mat3x4d::rows() * Mat3x4d::cols(), Eq(12));
+}
+
+TEST_F(MatrixTest, MultipliesAnyShapes) {
+  Matrix<double, 2, 3> a(Vector<double, 3>(1., 2., 3.),
+                         Vector<double, 3>(4., 5., 6.));
+  Matrix<double, 3, 2> b(Vector<double, 2>(7., 8.), Vector<double, 2>(9., 10.),
+                         Vector<double, 2>(11., 12.));
+  Matrix<double, 2, 2> ab = a * b;
+  EXPECT_THAT(ab[0], Eq(Vector<double, 2>(58., 64.)));
+  EXPECT_THAT(ab[1], Eq(Vector<double, 2>(139., 154.)));
+  EXPECT_THAT((a * Vector<double, 3>(1., 0., -1.)),
+              Eq(Vector<double, 2>(-2., -2.)));
+  EXPECT_THAT(outer(Vector<double, 2>(1., 2.), Vector<double, 3>(3., 4., 5.)),
+              Eq(Matrix<double, 2, 3>(Vector<double, 3>(3., 4., 5.),
+                                      Vector<double, 3>(6., 8., 10.))));
+  EXPECT_THAT(a + a, Eq(2. * a));
+  EXPECT_THAT(a - a, Eq(-a + a));
+}
+
+TEST_F(MatrixTest, InvertsEverySize) {
+  expect_inverse<1>();
+  expect_inverse<2>();
+  expect_inverse<3>();
+  expect_inverse<4>();
+  expect_inverse<5>();
+  expect_inverse<6>();
+}
+
+TEST_F(MatrixTest, DeterminantOfPermutedDiagonal) {
+  // The columns of diag(1, ..., 6) shifted by one, an odd permutation.
+  Mat6d m = Mat6d::generate(
+      [](int r, int c) { return c == (r + 1) % 6 ? c + 1. : 0.; });
+  EXPECT_THAT(m.determinant(), Eq(-720.));
+  EXPECT_THAT(Mat6d().determinant(), Eq(0.));
+  EXPECT_THROW(Mat6d().inverse(), std::runtime_error);
+  EXPECT_THROW((Matrix<double, 3, 3>().inverse()), std::runtime_error);
+  EXPECT_THROW((Matrix<double, 4, 4>().inverse()), std::runtime_error);
+}
+
+TEST_F(MatrixTest, MatchesTheNamedMatrices) {
+  Mat4d m(Vec4d(1.36, 1.28, 0.85, -7.), Vec4d(1.5, 0., -6.58, 1.),
+          Vec4d(4.5, 0., -3., 10.), Vec4d(0., 1., 6.68, -9.));
+  Matrix<double, 4, 4> g(m);
+  EXPECT_THAT(Mat4d(g), Eq(m));
+  EXPECT_THAT(g.determinant(), Eq(m.determinant()));
+  EXPECT_THAT(Mat4d(g.inverse()), Eq(m.inverse()));
+  EXPECT_THAT(Mat4d(g * g), Eq(m * m));
+
+  Mat3<double> m3(Vec3d(1.36, 1.28, 0.85), Vec3d(1.5, 0., -6.58),
+                  Vec3d(4.5, 0., -3.));
+  Matrix<double, 3, 3> g3(m3);
+  EXPECT_THAT(g3.determinant(), DoubleNear(m3.determinant(), 1e-12));
+  Mat3<double> inverse3(g3.inverse()), expected3 = m3.inverse();
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 3; ++c) {
+      EXPECT_THAT(inverse3[r][c], DoubleNear(expected3[r][c], 1e-15));
+    }
+  }
+  Mat2<double> m2(Vec2d(5.36, 2.28), Vec2d(-1.5, 85.));
+  Matrix<double, 2, 2> g2(m2);
+  EXPECT_THAT(g2.determinant(), Eq(m2.determinant()));
+}
+
+TEST_F(MatrixTest, InvertsSimdLanes) {
+  Mat4d m[2] = {Mat4d(random_matrix<4>()), Mat4d(random_matrix<4>())};
+  auto lanes = Matrix<Simd2d, 4, 4>::generate([&](int r, int c) {
+    Simd2d s(m[0][r][c]);
+    s.set(1, m[1][r][c]);
+    return s;
+  });
+  Matrix<Simd2d, 4, 4> inverse = lanes.inverse();
+  for (int i = 0; i < 2; ++i) {
+    Mat4d expected = m[i].inverse();
+    for (int r = 0; r < 4; ++r) {
+      for (int c = 0; c < 4; ++c) {
+        EXPECT_THAT(inverse[r][c][i], Eq(expected[r][c]));
+      }
+    }
+  }
+}
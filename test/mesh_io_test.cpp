@@ -0,0 +1,250 @@
+#include "mesh_io.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <limits>
+#include <sstream>
+
+using testing::ElementsAre;
+using testing::ElementsAreArray;
+using testing::Eq;
+
+namespace {
+
+// Appends v to a binary PLY body in the given byte order.
+template <typename U>
+void put(std::string& out, U v, bool big_endian) {
+  char bytes[sizeof(U)];
+  std::memcpy(bytes, &v, sizeof(U));
+  if (big_endian != (std::endian::native == std::endian::big)) {
+    std::reverse(bytes, bytes + sizeof(U));
+  }
+  out.append(bytes, sizeof(U));
+}
+
+std::string binary_ply(bool big_endian) {
+  std::string out =
+      std::string("ply\nformat ") +
+      (big_endian ? "binary_big_endian" : "binary_little_endian") +
+      " 1.0\n"
+      "comment made by hand\n"
+      "element vertex 4\n"
+      "property double x\nproperty double y\nproperty double z\n"
+      "property uchar red\n"
+      "property float nx\nproperty float ny\nproperty float nz\n"
+      "element face 2\n"
+      "property list uchar int vertex_indices\n"
+      "property uchar flags\n"
+      "element edge 1\n"
+      "property list ushort uint vertex\n"
+      "end_header\n";
+  for (int i = 0; i < 4; ++i) {
+    put(out, double(i), big_endian);
+    put(out, double(-i), big_endian);
+    put(out, 0.5 * i, big_endian);
+    put(out, uint8_t(255), big_endian);
+    put(out, 0.f, big_endian);
+    put(out, 0.f, big_endian);
+    put(out, 1.f, big_endian);
+  }
+  put(out, uint8_t(4), big_endian);
+  for (int32_t idx : {0, 1, 2, 3}) put(out, idx, big_endian);
+  put(out, uint8_t(7), big_endian);
+  put(out, uint8_t(3), big_endian);
+  for (int32_t idx : {3, 2, 1}) put(out, idx, big_endian);
+  put(out, uint8_t(0), big_endian);
+  put(out, uint16_t(2), big_endian);
+  for (uint32_t idx : {0u, 1u}) put(out, idx, big_endian);
+  return out;
+}
+
+// Records how the loader delivered the data.
+struct CountingSink : MeshBuffers {
+  int position_batches = 0;
+
+  void add_positions(std::span<const Point3f> p) {
+    if (!p.empty()) ++position_batches;
+    MeshBuffers::add_positions(p);
+  }
+};
+
+}  // namespace
+
+class MeshIOTest : public testing::Test {
+ public:
+  std::string obj =
+      "# quad and triangle\n"
+      "v 0 0 0\n"
+      "v 1 0 0\n"
+      "v 1 1 0\n"
+      "v 0 1 0\n"
+      "vn 0 0 1\n"
+      "vt 0 0\n"
+      "f 1//1 2//1 3//1 4//1\n"
+      "v 2 0 0\n"
+      "f -1/1/1 -4/1/1 -3/1/1\n"
+      "g rest\n";
+  std::vector<Point3f> obj_positions = {
+      Point3f(0.f, 0.f, 0.f), Point3f(1.f, 0.f, 0.f), Point3f(1.f, 1.f, 0.f),
+      Point3f(0.f, 1.f, 0.f), Point3f(2.f, 0.f, 0.f)};
+  std::vector<uint32_t> obj_indices = {0, 1, 2, 0, 2, 3, 4, 1, 2};
+};
+
+TEST_F(MeshIOTest, LoadsObj) {
+  std::istringstream in(obj);
+  MeshBuffers mesh;
+  load_obj(in, mesh);
+  EXPECT_THAT(mesh.positions, ElementsAreArray(obj_positions));
+  EXPECT_THAT(mesh.normals, ElementsAre(Normal3f(0.f, 0.f, 1.f)));
+  ASSERT_THAT(mesh.indices, ElementsAreArray(obj_indices));
+}
+
+TEST_F(MeshIOTest, LoadsObjInSmallWindows) {
+  // Windows of a couple of lines, split across threads, so relative indices
+  // point into earlier pieces.
+  for (std::size_t window : {8u, 20u, 64u}) {
+    std::istringstream in(obj);
+    CountingSink mesh;
+    load_obj(in, mesh, {.window_size = window, .threads = 3});
+    EXPECT_THAT(mesh.positions, ElementsAreArray(obj_positions));
+    EXPECT_THAT(mesh.indices, ElementsAreArray(obj_indices));
+    EXPECT_GT(mesh.position_batches, 1);
+  }
+}
+
+TEST_F(MeshIOTest, LoadsObjIntoSoA) {
+  std::istringstream in(obj);
+  MeshBuffersSoA mesh;
+  load_obj(in, mesh, {.window_size = 16, .threads = 2});
+  EXPECT_THAT(mesh.x, ElementsAre(0.f, 1.f, 1.f, 0.f, 2.f));
+  EXPECT_THAT(mesh.y, ElementsAre(0.f, 0.f, 1.f, 1.f, 0.f));
+  EXPECT_THAT(mesh.nz, ElementsAre(1.f));
+  ASSERT_THAT(mesh.indices, ElementsAreArray(obj_indices));
+}
+
+TEST_F(MeshIOTest, RejectsBadObjFaces) {
+  MeshBuffers mesh;
+  std::istringstream out_of_range("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n");
+  EXPECT_THROW(load_obj(out_of_range, mesh), std::runtime_error);
+  std::istringstream before_start("v 0 0 0\nf -1 -2 -3\n");
+  EXPECT_THROW(load_obj(before_start, mesh), std::runtime_error);
+  std::istringstream short_face("v 0 0 0\nf 1 1\n");
+  ASSERT_THROW(load_obj(short_face, mesh), std::runtime_error);
+}
+
+TEST_F(MeshIOTest, LoadsAsciiPly) {
+  std::istringstream in(
+      "ply\n"
+      "format ascii 1.0\n"
+      "element vertex 4\n"
+      "property float x\nproperty float y\nproperty float z\n"
+      "property uchar red\n"
+      "property float nx\nproperty float ny\nproperty float nz\n"
+      "element face 2\n"
+      "property list uchar int vertex_indices\n"
+      "end_header\n"
+      "0 0 0 255 0 0 1\n"
+      "1 0 0 255 0 0 1\n"
+      "1 1 0 255 0 0 1\n"
+      "0 1 0 255 0 0 1\n"
+      "4 0 1 2 3\n"
+      "3 3 2 1\n");
+  MeshBuffers mesh;
+  load_ply(in, mesh, {.window_size = 24, .threads = 2});
+  EXPECT_THAT(mesh.positions, ElementsAreArray(obj_positions.data(), 4));
+  EXPECT_THAT(mesh.normals.size(), Eq(4u));
+  EXPECT_THAT(mesh.normals[3], Eq(Normal3f(0.f, 0.f, 1.f)));
+  ASSERT_THAT(mesh.indices, ElementsAre(0, 1, 2, 0, 2, 3, 3, 2, 1));
+}
+
+TEST_F(MeshIOTest, LoadsBinaryPly) {
+  for (bool big_endian : {false, true}) {
+    std::istringstream in(binary_ply(big_endian));
+    MeshBuffers mesh;
+    load_ply(in, mesh, {.window_size = 40, .threads = 3});
+    EXPECT_THAT(mesh.positions,
+                ElementsAre(Point3f(0.f, 0.f, 0.f), Point3f(1.f, -1.f, 0.5f),
+                            Point3f(2.f, -2.f, 1.f), Point3f(3.f, -3.f, 1.5f)));
+    EXPECT_THAT(mesh.normals[2], Eq(Normal3f(0.f, 0.f, 1.f)));
+    EXPECT_THAT(mesh.indices, ElementsAre(0, 1, 2, 0, 2, 3, 3, 2, 1));
+  }
+}
+
+TEST_F(MeshIOTest, RejectsTruncatedPly) {
+  auto ply = binary_ply(false);
+  std::istringstream in(ply.substr(0, ply.size() - 20));
+  MeshBuffers mesh;
+  EXPECT_THROW(load_ply(in, mesh), std::runtime_error);
+  std::istringstream not_ply("solid cube\n");
+  ASSERT_THROW(load_ply(not_ply, mesh), std::runtime_error);
+}
+
+TEST_F(MeshIOTest, RejectsBadPlyListSizes) {
+  for (int32_t count : {-1, 1 << 30}) {
+    std::string ply =
+        "ply\nformat binary_little_endian 1.0\n"
+        "element vertex 0\n"
+        "property float x\nproperty float y\nproperty float z\n"
+        "element face 1\n"
+        "property list int int vertex_indices\n"
+        "end_header\n";
+    put(ply, count, false);
+    for (int32_t idx : {0, 1, 2}) put(ply, idx, false);
+    std::istringstream in(ply);
+    MeshBuffers mesh;
+    EXPECT_THROW(load_ply(in, mesh), std::runtime_error) << count;
+  }
+}
+
+TEST_F(MeshIOTest, RejectsBadPlyIndices) {
+  const std::string vertices =
+      "element vertex 3\n"
+      "property float x\nproperty float y\nproperty float z\n"
+      "element face 1\n";
+  for (const char* bad : {"1.5", "1e300", "nan", "-inf", "-1", "3"}) {
+    std::istringstream in("ply\nformat ascii 1.0\n" + vertices +
+                          "property list uchar int vertex_indices\n"
+                          "end_header\n"
+                          "0 0 0\n1 0 0\n0 1 0\n"
+                          "3 0 1 " +
+                          std::string(bad) + "\n");
+    MeshBuffers mesh;
+    EXPECT_THROW(load_ply(in, mesh), std::runtime_error) << bad;
+  }
+  for (float bad : {1.5f, 1e30f, std::numeric_limits<float>::quiet_NaN(),
+                    std::numeric_limits<float>::infinity(), -1.f, 3.f}) {
+    std::string ply = "ply\nformat binary_little_endian 1.0\n" + vertices +
+                      "property list uchar float vertex_indices\n"
+                      "end_header\n";
+    for (float v : {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f}) {
+      put(ply, v, false);
+    }
+    put(ply, uint8_t(3), false);
+    for (float idx : {0.f, 1.f, bad}) put(ply, idx, false);
+    std::istringstream in(ply);
+    MeshBuffers mesh;
+    EXPECT_THROW(load_ply(in, mesh), std::runtime_error) << bad;
+  }
+}
+
+TEST_F(MeshIOTest, LoadsFilesByExtension) {
+  auto dir = std::filesystem::temp_directory_path();
+  auto obj_path = (dir / ("math_mesh_io_" + std::to_string(::getpid()) +
+                          ".OBJ")).string();
+  auto ply_path = (dir / ("math_mesh_io_" + std::to_string(::getpid()) +
+                          ".ply")).string();
+  std::ofstream(obj_path, std::ios::binary) << obj;
+  std::ofstream(ply_path, std::ios::binary) << binary_ply(false);
+
+  MeshBuffers from_obj, from_ply;
+  load_mesh(obj_path, from_obj);
+  load_mesh(ply_path, from_ply);
+  std::filesystem::remove(obj_path);
+  std::filesystem::remove(ply_path);
+
+  EXPECT_THAT(from_obj.indices, ElementsAreArray(obj_indices));
+  EXPECT_THAT(from_ply.positions.size(), Eq(4u));
+  ASSERT_THROW(load_mesh(dir / "mesh.stl", from_obj), std::runtime_error);
+}
@@ -0,0 +1,19 @@
+// Checks that `import math;` gives the core types, their operators and the
+// free functions without including any header. Run by ctest when
+// MATH_BUILD_MODULE is on.
+
+import math;
+
+int main() {
+  Vec3f x(1.f, 0.f, 0.f), y(0.f, 1.f, 0.f);
+  if (cross(x, y) != Vec3f(0.f, 0.f, 1.f)) return 1;
+  if (dot(x + y, y) != 1.f) return 2;
+
+  Point3f p = Point3f(1.f, 2.f, 3.f) + Vec3f(1.f, 1.f, 1.f);
+  Vec4f moved = translation(1.f, 0.f, 0.f) * Vec4f(p.x(), p.y(), p.z(), 1.f);
+  if (moved != Vec4f(3.f, 3.f, 4.f, 1.f)) return 3;
+
+  Quat q = angle_axis(0.f, Vec3f(0.f, 0.f, 1.f));
+  if (normalized(Vec3d(0., 0., 2.)) != Vec3d(0., 0., 1.)) return 4;
+  return same_orientation(q, q) ? 0 : 5;
+}
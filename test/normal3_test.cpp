@@ -0,0 +1,25 @@
+#include "normal3.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "vec3.h"
+
+using testing::Eq;
+using testing::FloatEq;
+
+class Normal3Test : public testing::Test {
+ public:
+  Normal3f n;
+};
+
+TEST_F(Normal3Test, createsZeroNormal) {
+  ASSERT_THAT(n, Eq(Normal3f(0.f, 0.f, 0.f)));
+  ASSERT_THAT(Normal3d().length(), Eq(0.));
+}
+
+TEST_F(Normal3Test, convertsFromVector) {
+  n = Normal3f(Vec3f(0.f, 3.f, 4.f));
+  EXPECT_THAT(n, Eq(Normal3f(0.f, 3.f, 4.f)));
+  ASSERT_THAT(n.length(), FloatEq(5.f));
+}
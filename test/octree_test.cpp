@@ -0,0 +1,149 @@
+#include "octree.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "random_scene.h"
+
+using testing::Eq;
+
+class OctreeTest : public testing::Test {
+ public:
+  // Nearest entry parameter of the ray into any occupied voxel, by testing
+  // them all.
+  float brute_force_hit(const Octreef& tree, const Ray& ray) {
+    float best = std::numeric_limits<float>::infinity();
+    for (uint32_t v = 0; v < tree.voxel_count(); ++v) {
+      AABBf box = tree.voxel_bounds(v);
+      float enter = ray.getMinRange(), exit = ray.getMaxRange();
+      for (int a = 0; a < 3; ++a) {
+        float o = ray.origin()[a], d = ray.direction()[a];
+        if (d == 0.f) {
+          if (o < box.min()[a] || o > box.max()[a]) enter = exit + 1.f;
+          continue;
+        }
+        float t0 = (box.min()[a] - o) / d, t1 = (box.max()[a] - o) / d;
+        enter = std::max(enter, std::min(t0, t1));
+        exit = std::min(exit, std::max(t0, t1));
+      }
+      if (enter <= exit) best = std::min(best, enter);
+    }
+    return best;
+  }
+
+  std::mt19937 gen{21};
+  std::vector<Point3f> points = clustered_points(gen, 20000, 20.f, 1.5f);
+  ThreadPool pool{3};
+};
+
+TEST_F(OctreeTest, VoxelsHoldTheirPoints) {
+  Octreef tree(std::span<const Point3f>(points), 7, pool);
+  ASSERT_THAT(tree.size(), Eq(points.size()));
+  std::set<std::array<int, 3>> cells;
+  std::vector<int> seen(points.size(), 0);
+  for (uint32_t v = 0; v < tree.voxel_count(); ++v) {
+    AABBf box = tree.voxel_bounds(v);
+    // Up to rounding, at the faces.
+    AABBf loose(box.min() - Vec3f(1e-5f, 1e-5f, 1e-5f),
+                box.max() + Vec3f(1e-5f, 1e-5f, 1e-5f));
+    for (uint32_t i : tree.voxel_points(v)) {
+      ++seen[i];
+      ASSERT_TRUE(loose.contains(points[i]));
+      ASSERT_THAT(tree.find_voxel(points[i]), Eq(v));
+    }
+    Vec3f at = (box.min() - tree.bounds().min()) / tree.voxel_size();
+    cells.insert({static_cast<int>(std::lround(at.x())),
+                  static_cast<int>(std::lround(at.y())),
+                  static_cast<int>(std::lround(at.z()))});
+  }
+  ASSERT_THAT(cells.size(), Eq(tree.voxel_count()));
+  ASSERT_TRUE(std::ranges::all_of(seen, [](int s) { return s == 1; }));
+  // A small fraction of the 2^21 voxels of the full grid.
+  EXPECT_TRUE(tree.node_count() < (1u << 21) / 20);
+  EXPECT_FALSE(tree.occupied(Point3f(100.f, 0.f, 0.f)));
+}
+
+TEST_F(OctreeTest, BoxQueriesMatchBruteForce) {
+  Octreef tree(std::span<const Point3f>(points), 6);
+  std::uniform_real_distribution<float> at(-25.f, 25.f), size(0.f, 8.f);
+  std::vector<uint32_t> found;
+  for (int q = 0; q < 200; ++q) {
+    Point3f lo(at(gen), at(gen), at(gen));
+    AABBf box(lo, lo + Vec3f(size(gen), size(gen), size(gen)));
+    found.clear();
+    std::size_t n = tree.points_in_box(box, found);
+    std::sort(found.begin(), found.end());
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < points.size(); ++i) {
+      if (box.contains(points[i])) expected.push_back(i);
+    }
+    ASSERT_THAT(n, Eq(expected.size()));
+    ASSERT_THAT(found, Eq(expected));
+
+    bool touches = false;
+    for (uint32_t v = 0; v < tree.voxel_count() && !touches; ++v) {
+      AABBf voxel = tree.voxel_bounds(v);
+      touches = voxel.min().x() <= box.max().x() &&
+                voxel.max().x() >= box.min().x() &&
+                voxel.min().y() <= box.max().y() &&
+                voxel.max().y() >= box.min().y() &&
+                voxel.min().z() <= box.max().z() &&
+                voxel.max().z() >= box.min().z();
+    }
+    if (!expected.empty()) {
+      ASSERT_TRUE(tree.intersects(box));
+    }
+    if (!touches) {
+      ASSERT_FALSE(tree.intersects(box));
+    }
+  }
+}
+
+TEST_F(OctreeTest, RaycastFindsNearestVoxel) {
+  Octreef tree(std::span<const Point3f>(points), 5, pool);
+  std::uniform_real_distribution<float> at(-40.f, 40.f), dir(-1.f, 1.f);
+  int hits = 0;
+  for (int q = 0; q < 500; ++q) {
+    Vec3f d(dir(gen), dir(gen), dir(gen));
+    if (q % 5 == 0) d = Vec3f(d.x(), 0.f, q % 2 ? 0.f : d.z());
+    Ray ray(Point3f(at(gen), at(gen), at(gen)), d);
+    if (q % 7 == 0) ray.setMaxRange(20.f);
+    OctreeHit<float> hit = tree.raycast(ray);
+    float expected = brute_force_hit(tree, ray);
+    if (std::isinf(expected)) {
+      ASSERT_FALSE(hit.hit()) << q;
+      continue;
+    }
+    ++hits;
+    ASSERT_TRUE(hit.hit()) << q;
+    ASSERT_NEAR(hit.t, expected, 1e-3f * (1.f + expected)) << q;
+  }
+  EXPECT_TRUE(hits > 50);
+}
+
+TEST_F(OctreeTest, EmptyAndDegenerateSets) {
+  Octreef empty{std::span<const Point3f>(), 4};
+  EXPECT_THAT(empty.node_count(), Eq(0u));
+  EXPECT_FALSE(empty.occupied(Point3f()));
+  EXPECT_FALSE(empty.raycast(Ray(Point3f(), Vec3f(1.f, 0.f, 0.f))).hit());
+
+  std::vector<Point3f> same(50, Point3f(1.f, 2.f, 3.f));
+  Octreef single{std::span<const Point3f>(same), 21};
+  EXPECT_THAT(single.voxel_count(), Eq(1u));
+  EXPECT_THAT(single.node_count(), Eq(22u));
+  EXPECT_THAT(single.voxel_points(0).size(), Eq(50u));
+  OctreeHit<float> hit =
+      single.raycast(Ray(Point3f(1.f, 2.f, -5.f), Vec3f(0.f, 0.f, 1.f)));
+  EXPECT_THAT(hit.voxel, Eq(0u));
+  EXPECT_NEAR(hit.t, 8.f, 1e-4f);
+
+  ASSERT_THROW(Octreef(std::span<const Point3f>(same), 22),
+               std::invalid_argument);
+  ASSERT_THROW(single.voxel_points(1), std::out_of_range);
+}
@@ -0,0 +1,117 @@
+#include "packed_normal.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <numbers>
+#include <random>
+#include <vector>
+
+using testing::Eq;
+using testing::FloatNear;
+using testing::Le;
+
+class PackedNormalTest : public testing::Test {
+ public:
+  void SetUp() override {
+    std::mt19937 gen(3);
+    std::normal_distribution<float> dist;
+    normals.resize(1 << 16);
+    for (auto& n : normals) {
+      n = normalized(Normal3f(dist(gen), dist(gen), dist(gen)));
+    }
+    normals.insert(normals.end(),
+                   {Normal3f(1.f, 0.f, 0.f), Normal3f(-1.f, 0.f, 0.f),
+                    Normal3f(0.f, 1.f, 0.f), Normal3f(0.f, -1.f, 0.f),
+                    Normal3f(0.f, 0.f, 1.f), Normal3f(0.f, 0.f, -1.f)});
+  }
+
+  template <typename U>
+  float max_error_degrees() const {
+    // atan2 of |n x m| and n.m in double; acos of a float dot product
+    // cannot resolve angles this small.
+    double worst = 0.0;
+    for (const auto& n : normals) {
+      Normal3f m = PackedNormal<U>(n).unpack();
+      Vec3d a(n.x(), n.y(), n.z());
+      Vec3d b(m.x(), m.y(), m.z());
+      worst = std::max(worst, std::atan2(cross(a, b).length(), dot(a, b)));
+    }
+    return static_cast<float>(worst * 180.0 / std::numbers::pi);
+  }
+
+  std::vector<Normal3f> normals;
+};
+
+TEST_F(PackedNormalTest, Sizes) {
+  EXPECT_THAT(sizeof(PackedNormal16), Eq(2u));
+  ASSERT_THAT(sizeof(PackedNormal32), Eq(4u));
+}
+
+TEST_F(PackedNormalTest, ErrorWithinDocumentedBounds) {
+  EXPECT_THAT(max_error_degrees<uint16_t>(), Le(1.1f));
+  ASSERT_THAT(max_error_degrees<uint32_t>(), Le(0.035f));
+}
+
+TEST_F(PackedNormalTest, AxesAreExact) {
+  for (std::size_t i = normals.size() - 6; i < normals.size(); ++i) {
+    Normal3f m = PackedNormal32(normals[i]).unpack();
+    EXPECT_THAT(m.x(), Eq(normals[i].x()));
+    EXPECT_THAT(m.y(), Eq(normals[i].y()));
+    EXPECT_THAT(m.z(), Eq(normals[i].z()));
+  }
+}
+
+TEST_F(PackedNormalTest, UnpackIsUnitLength) {
+  for (const auto& n : normals) {
+    Normal3f m = PackedNormal16(n).unpack();
+    ASSERT_THAT(dot(m, m), FloatNear(1.f, 1e-6f));
+  }
+}
+
+TEST_F(PackedNormalTest, RoundTripsDoNotDrift) {
+  for (uint32_t bits = 0; bits <= 0xffff; ++bits) {
+    auto p = PackedNormal16::from_bits(static_cast<uint16_t>(bits));
+    // -128 is clamped to -1 and aliases -127; pack() never produces it.
+    if ((bits & 0xff) == 0x80 || (bits >> 8) == 0x80) continue;
+    ASSERT_THAT(PackedNormal16(p.unpack()), Eq(p)) << "bits " << bits;
+  }
+  for (const auto& n : normals) {
+    PackedNormal32 p(n);
+    ASSERT_THAT(PackedNormal32(p.unpack()), Eq(p));
+  }
+}
+
+TEST_F(PackedNormalTest, ZeroPacksToPositiveZ) {
+  Normal3f m = PackedNormal16(Vec3f(0.f, 0.f, 0.f)).unpack();
+  EXPECT_THAT(m.z(), Eq(1.f));
+  ASSERT_THAT(PackedNormal32().unpack().z(), Eq(1.f));
+}
+
+TEST_F(PackedNormalTest, BatchMatchesScalar) {
+  std::vector<PackedNormal32> packed(normals.size());
+  std::vector<Normal3f> unpacked(normals.size());
+  pack(std::span<const Normal3f>(normals), std::span(packed));
+  unpack(std::span<const PackedNormal32>(packed), std::span(unpacked));
+  for (std::size_t i = 0; i < normals.size(); ++i) {
+    ASSERT_THAT(packed[i], Eq(PackedNormal32(normals[i])));
+    ASSERT_TRUE(unpacked[i] == packed[i].unpack());
+  }
+
+  std::vector<PackedNormal16> small(3);
+  ASSERT_THROW(pack(std::span<const Normal3f>(normals), std::span(small)),
+               std::out_of_range);
+}
+
+TEST_F(PackedNormalTest, DotWithoutUnpacking) {
+  Vec3f light = normalized(Vec3f(1.f, 2.f, -3.f));
+  for (std::size_t i = 0; i + 1 < normals.size(); i += 97) {
+    PackedNormal16 a(normals[i]);
+    PackedNormal16 b(normals[i + 1]);
+    Normal3f na = a.unpack();
+    Normal3f nb = b.unpack();
+    EXPECT_THAT(dot(a, b), FloatNear(dot(na, nb), 1e-6f));
+    EXPECT_THAT(dot(a, light),
+                FloatNear(dot(Vec3f(na.x(), na.y(), na.z()), light), 1e-6f));
+  }
+}
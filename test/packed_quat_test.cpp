@@ -0,0 +1,116 @@
+#include "packed_quat.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <numbers>
+#include <random>
+#include <vector>
+
+using testing::Eq;
+using testing::FloatNear;
+using testing::Le;
+
+class PackedQuatTest : public testing::Test {
+ public:
+  void SetUp() override {
+    std::mt19937 gen(8);
+    std::normal_distribution<float> dist;
+    quats.resize((1 << 16) + 3);  // with a scalar tail in the batch decode
+    for (auto& q : quats) {
+      q = normalized(Quat(dist(gen), dist(gen), dist(gen), dist(gen)));
+    }
+    quats[0] = Quat();
+    quats[1] = Quat(0.f, -1.f, 0.f, 0.f);
+    quats[2] = Quat(0.5f, 0.5f, -0.5f, 0.5f);
+  }
+
+  // The rotation angle between q and p, 4 atan2(|q - p|, |q + p|) with p on
+  // the same side as q; acos of a float dot product is too coarse here.
+  static double angle_degrees(const Quat& q, const Quat& p) {
+    double s = dot(q, p) < 0.f ? -1.0 : 1.0;
+    double c1[4] = {q.x(), q.y(), q.z(), q.w()};
+    double c2[4] = {p.x() * s, p.y() * s, p.z() * s, p.w() * s};
+    double minus = 0.0, plus = 0.0;
+    for (int i = 0; i < 4; ++i) {
+      minus += (c1[i] - c2[i]) * (c1[i] - c2[i]);
+      plus += (c1[i] + c2[i]) * (c1[i] + c2[i]);
+    }
+    return 4.0 * std::atan2(std::sqrt(minus), std::sqrt(plus)) * 180.0 /
+           std::numbers::pi;
+  }
+
+  template <int N>
+  double max_error_degrees() const {
+    double worst = 0.0;
+    for (const auto& q : quats) {
+      worst = std::max(worst, angle_degrees(q, PackedQuat<N>(q).unpack()));
+    }
+    return worst;
+  }
+
+  template <int N>
+  void expect_batch_matches_scalar() {
+    std::vector<PackedQuat<N>> packed(quats.size());
+    std::vector<Quat> unpacked(quats.size());
+    pack(std::span<const Quat>(quats), std::span(packed));
+    unpack(std::span<const PackedQuat<N>>(packed), std::span(unpacked));
+    for (std::size_t i = 0; i < quats.size(); ++i) {
+      Quat q = packed[i].unpack();
+      ASSERT_THAT(unpacked[i].x(), Eq(q.x()));
+      ASSERT_THAT(unpacked[i].y(), Eq(q.y()));
+      ASSERT_THAT(unpacked[i].z(), Eq(q.z()));
+      ASSERT_THAT(unpacked[i].w(), Eq(q.w()));
+    }
+  }
+
+  std::vector<Quat> quats;
+};
+
+TEST_F(PackedQuatTest, Sizes) {
+  EXPECT_THAT(sizeof(PackedQuat32), Eq(4u));
+  ASSERT_THAT(sizeof(PackedQuat48), Eq(6u));
+}
+
+TEST_F(PackedQuatTest, ErrorWithinDocumentedBounds) {
+  EXPECT_THAT(max_error_degrees<10>(), Le(0.26));
+  ASSERT_THAT(max_error_degrees<15>(), Le(0.0085));
+}
+
+TEST_F(PackedQuatTest, UnpackIsUnitLength) {
+  for (const auto& q : quats) {
+    ASSERT_THAT(PackedQuat32(q).unpack().squared_length(),
+                FloatNear(1.f, 1e-6f));
+  }
+}
+
+TEST_F(PackedQuatTest, KeepsTheRotationNotTheSign) {
+  Quat q = normalized(Quat(0.1f, -0.2f, 0.3f, -0.9f));
+  Quat p = PackedQuat48(q).unpack();
+  EXPECT_THAT(p.w(), FloatNear(-q.w(), 1e-4f));
+  Vec3f v(1.f, 2.f, 3.f);
+  Vec3f a = q * v;
+  Vec3f b = p * v;
+  EXPECT_THAT(b.x(), FloatNear(a.x(), 1e-3f));
+  EXPECT_THAT(b.y(), FloatNear(a.y(), 1e-3f));
+  ASSERT_THAT(b.z(), FloatNear(a.z(), 1e-3f));
+}
+
+// Not bit for bit: when two components are nearly equal the recomputed one
+// can come out smaller and the other is stored instead.
+TEST_F(PackedQuatTest, RepackingDoesNotDrift) {
+  for (const auto& q : quats) {
+    Quat once = PackedQuat32(q).unpack();
+    Quat twice = PackedQuat32(once).unpack();
+    ASSERT_THAT(angle_degrees(once, twice), Le(0.26));
+  }
+}
+
+TEST_F(PackedQuatTest, BatchMatchesScalar) {
+  expect_batch_matches_scalar<10>();
+  expect_batch_matches_scalar<15>();
+
+  std::vector<PackedQuat48> small(2);
+  ASSERT_THROW(pack(std::span<const Quat>(quats), std::span(small)),
+               std::out_of_range);
+}
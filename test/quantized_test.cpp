@@ -0,0 +1,140 @@
+#include "quantized.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using testing::Eq;
+using testing::FloatNear;
+
+class QuantizedTest : public testing::Test {
+ public:
+  void SetUp() override {
+    std::mt19937 gen(9);
+    std::uniform_real_distribution<float> dist(-1.5f, 1.5f);
+    values.resize(1003);  // not a multiple of any batch width
+    for (auto& v : values) v = dist(gen);
+    values[0] = 1.f;
+    values[1] = -1.f;
+    values[2] = 0.f;
+    values[3] = std::numeric_limits<float>::quiet_NaN();
+  }
+
+  // convert() against one value at a time, both ways.
+  template <typename S>
+  void expect_batch_matches_scalar() {
+    std::vector<S> packed(values.size());
+    convert(std::span<const float>(values), std::span(packed));
+    std::vector<float> unpacked(values.size());
+    convert(std::span<const S>(packed), std::span(unpacked));
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      ASSERT_THAT(packed[i].bits(), Eq(S(values[i]).bits())) << values[i];
+      float expected = packed[i];
+      ASSERT_THAT(std::bit_cast<uint32_t>(unpacked[i]),
+                  Eq(std::bit_cast<uint32_t>(expected)));
+    }
+  }
+
+  std::vector<float> values;
+};
+
+TEST_F(QuantizedTest, Sizes) {
+  EXPECT_THAT(sizeof(Vec3h), Eq(6u));
+  EXPECT_THAT(sizeof(Vec4<unorm8>), Eq(4u));
+  ASSERT_THAT(sizeof(Vec3<snorm16>), Eq(6u));
+}
+
+TEST_F(QuantizedTest, HalfRoundTripsEveryBitPattern) {
+  for (uint32_t bits = 0; bits <= 0xffff; ++bits) {
+    auto h = half::from_bits(static_cast<uint16_t>(bits));
+    float f = h;
+    if (std::isnan(f)) continue;
+    ASSERT_THAT(half(f).bits(), Eq(h.bits())) << "bits " << bits;
+  }
+}
+
+TEST_F(QuantizedTest, HalfRoundsToNearestEven) {
+  EXPECT_THAT(half(1.f + 0x1p-11f).bits(), Eq(0x3c00));
+  EXPECT_THAT(half(1.f + 0x3p-11f).bits(), Eq(0x3c02));
+  EXPECT_THAT(static_cast<float>(half(65519.f)), Eq(65504.f));
+  EXPECT_TRUE(std::isinf(half(65520.f)));
+  EXPECT_THAT(half(0x1p-24f).bits(), Eq(0x0001));
+  EXPECT_THAT(half(0x1p-25f).bits(), Eq(0x0000));
+  EXPECT_THAT(half(0x3p-26f).bits(), Eq(0x0001));
+  ASSERT_THAT(half(-2.f).bits(), Eq(0xc000));
+#ifdef __FLT16_MAX__
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<uint32_t> bits(0x33000000u, 0x47800000u);
+  for (int i = 0; i < 100000; ++i) {
+    float f = std::bit_cast<float>(bits(gen));
+    auto expected = std::bit_cast<uint16_t>(static_cast<_Float16>(f));
+    ASSERT_THAT(half(f).bits(), Eq(expected)) << f;
+  }
+#endif
+}
+
+TEST_F(QuantizedTest, NormalizedEndpointsAreExact) {
+  EXPECT_THAT(unorm8(1.f).bits(), Eq(255));
+  EXPECT_THAT(unorm8(2.f).bits(), Eq(255));
+  EXPECT_THAT(unorm8(-0.5f).bits(), Eq(0));
+  EXPECT_THAT(unorm8(std::nanf("")).bits(), Eq(0));
+  EXPECT_THAT(snorm16(-1.f).bits(), Eq(-32767));
+  EXPECT_THAT(static_cast<float>(unorm16::from_bits(65535)), Eq(1.f));
+  EXPECT_THAT(static_cast<float>(snorm8::from_bits(127)), Eq(1.f));
+  ASSERT_THAT(static_cast<float>(snorm8::from_bits(-128)), Eq(-1.f));
+}
+
+TEST_F(QuantizedTest, NormalizedRoundTripsEveryCode) {
+  for (int q = 0; q <= 255; ++q) {
+    auto u = unorm8::from_bits(static_cast<uint8_t>(q));
+    ASSERT_THAT(unorm8(u).bits(), Eq(u.bits()));
+  }
+  for (int q = -32767; q <= 32767; ++q) {
+    auto s = snorm16::from_bits(static_cast<int16_t>(q));
+    ASSERT_THAT(snorm16(s).bits(), Eq(s.bits()));
+  }
+}
+
+TEST_F(QuantizedTest, ArithmeticPromotesToFloat) {
+  Vec3h a(1.f, 2.f, 3.f);
+  Vec3h b(0.5f, 0.25f, 0.125f);
+  EXPECT_TRUE(a + b == Vec3h(1.5f, 2.25f, 3.125f));
+  EXPECT_THAT(static_cast<float>(dot(a, b)), Eq(1.375f));
+  Vec3h n = normalized(Vec3h(3.f, 0.f, 4.f));
+  EXPECT_THAT(static_cast<float>(n.x()), FloatNear(0.6f, 1e-3f));
+  EXPECT_THAT(static_cast<float>(n.z()), FloatNear(0.8f, 1e-3f));
+
+  // Saturates instead of wrapping.
+  Vec4<unorm8> color(0.25f, 0.5f, 0.75f, 1.f);
+  Vec4<unorm8> sum = color + color;
+  EXPECT_THAT(sum.x().bits(), Eq(unorm8(0.5f).bits()));
+  ASSERT_THAT(sum.z().bits(), Eq(255));
+}
+
+TEST_F(QuantizedTest, BatchMatchesScalar) {
+  expect_batch_matches_scalar<half>();
+  expect_batch_matches_scalar<unorm8>();
+  expect_batch_matches_scalar<snorm8>();
+  expect_batch_matches_scalar<unorm16>();
+  expect_batch_matches_scalar<snorm16>();
+}
+
+TEST_F(QuantizedTest, ConvertsVectorSpans) {
+  std::vector<Vec3f> points;
+  for (std::size_t i = 4; i + 2 < values.size(); i += 3) {  // skips the NaN
+    points.emplace_back(values[i + 1], values[i + 2], values[i] * 100.f);
+  }
+  std::vector<Vec3h> halves(points.size());
+  std::vector<Vec3f> back(points.size());
+  convert(std::span<const Vec3f>(points), std::span(halves));
+  convert(std::span<const Vec3h>(halves), std::span(back));
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    ASSERT_TRUE(back[i] == Vec3f(halves[i].x(), halves[i].y(), halves[i].z()));
+  }
+
+  std::vector<Vec3h> small(1);
+  ASSERT_THROW(convert(std::span<const Vec3f>(points), std::span(small)),
+               std::out_of_range);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "point3.h"
+#include "ray.h"
+#include "triangle.h"
+#include "vec3.h"
+
+//--------------------------------------------
+// Random geometry shared by the spatial and ray tracing tests
+//--------------------------------------------
+
+// n points uniform in [-spread, spread]^3.
+inline std::vector<Point3f> random_points(std::mt19937& gen, std::size_t n,
+                                          float spread) {
+  std::uniform_real_distribution<float> at(-spread, spread);
+  std::vector<Point3f> points(n);
+  for (auto& p : points) p = Point3f(at(gen), at(gen), at(gen));
+  return points;
+}
+
+// n points in clusters of 100 around centres uniform in [-spread, spread]^3,
+// normally distributed with deviation sigma, so most of the space is empty.
+inline std::vector<Point3f> clustered_points(std::mt19937& gen, std::size_t n,
+                                             float spread, float sigma) {
+  std::normal_distribution<float> offset(0.f, sigma);
+  std::uniform_real_distribution<float> centre(-spread, spread);
+  std::vector<Point3f> points(n);
+  for (std::size_t i = 0; i < n; i += 100) {
+    Point3f c(centre(gen), centre(gen), centre(gen));
+    for (std::size_t j = i; j < std::min(i + 100, n); ++j) {
+      points[j] = c + Vec3f(offset(gen), offset(gen), offset(gen));
+    }
+  }
+  return points;
+}
+
+// Squared distance between a and b, written out for brute-force checks.
+inline float distance2(const Point3f& a, const Point3f& b) {
+  float dx = a.x() - b.x(), dy = a.y() - b.y(), dz = a.z() - b.z();
+  return dx * dx + dy * dy + dz * dz;
+}
+
+// A triangle with its first corner in [-spread, spread]^3 and the other
+// two within `edge` of it on every axis.
+inline Trianglef random_triangle(std::mt19937& gen, float spread = 10.f,
+                                 float edge = 1.f) {
+  std::uniform_real_distribution<float> at(-spread, spread), off(-edge, edge);
+  Point3f a(at(gen), at(gen), at(gen));
+  return {a, a + Vec3f(off(gen), off(gen), off(gen)),
+          a + Vec3f(off(gen), off(gen), off(gen))};
+}
+
+// A ray from [-spread, spread]^3 in a direction that is not normalized.
+inline Ray random_ray(std::mt19937& gen, float spread) {
+  std::uniform_real_distribution<float> at(-spread, spread), dir(-1.f, 1.f);
+  return Ray(Point3f(at(gen), at(gen), at(gen)),
+             Vec3f(dir(gen), dir(gen), dir(gen)));
+}
+
+// The nearest hit of ray among all the triangles, tested one by one.
+inline TriangleHit<float> brute_force(std::span<const Trianglef> triangles,
+                                      const Ray& ray) {
+  TriangleHit<float> hit;
+  hit.t = ray.getMaxRange();
+  for (uint32_t i = 0; i < triangles.size(); ++i) {
+    if (intersect(triangles[i], ray.origin(), ray.direction(),
+                  ray.getMinRange(), hit)) {
+      hit.triangle = i;
+    }
+  }
+  return hit.hit() ? hit : TriangleHit<float>{};
+}
@@ -0,0 +1,86 @@
+#include "ray_sort.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "random_scene.h"
+
+using testing::Eq;
+
+class RaySortTest : public testing::Test {
+ public:
+  Ray random_ray() { return ::random_ray(gen, 10.f); }
+
+  static void expect_same(const Ray& a, const Ray& b) {
+    ASSERT_THAT(a.origin(), Eq(b.origin()));
+    ASSERT_THAT(a.direction(), Eq(b.direction()));
+  }
+
+  std::mt19937 gen{5};
+  AABBf bounds{Point3f(-10.f, -10.f, -10.f), Point3f(10.f, 10.f, 10.f)};
+  ThreadPool pool{3};
+};
+
+TEST_F(RaySortTest, KeyOrdersOctantThenOriginThenDirection) {
+  Point3f o(1.f, 2.f, 3.f);
+  uint64_t key = ray_sort_key(o, Vec3f(1.f, 1.f, 1.f), bounds);
+  EXPECT_THAT(key >> 36, Eq(0u));
+  EXPECT_THAT(ray_sort_key(o, Vec3f(-1.f, 1.f, -1.f), bounds) >> 36, Eq(5u));
+  EXPECT_TRUE(key < (uint64_t{1} << 39));
+  // Directions in one octant only change the low 12 bits.
+  uint64_t turned = ray_sort_key(o, Vec3f(0.1f, 1.f, 0.3f), bounds);
+  EXPECT_THAT(turned >> 12, Eq(key >> 12));
+  EXPECT_TRUE(turned != key);
+  // Origins in the same grid cell share the key; the far corner is last.
+  EXPECT_THAT(ray_sort_key(Point3f(1.01f, 2.f, 3.f), Vec3f(1.f, 1.f, 1.f),
+                           bounds),
+              Eq(key));
+  EXPECT_THAT(ray_sort_key(Point3f(50.f, 50.f, 50.f), Vec3f(1.f, 1.f, 1.f),
+                           bounds) >> 12,
+              Eq((uint64_t{1} << 24) - 1));
+}
+
+TEST_F(RaySortTest, SortsRaysAndReportsOrder) {
+  std::vector<Ray> rays(20000);
+  for (auto& r : rays) r = random_ray();
+  std::vector<Ray> original = rays;
+  RaySorter sorter;
+  sorter.sort(std::span(rays), bounds, pool);
+  ASSERT_THAT(sorter.order().size(), Eq(rays.size()));
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    expect_same(rays[i], original[sorter.order()[i]]);
+    if (i == 0) continue;
+    ASSERT_TRUE(ray_sort_key(rays[i - 1].origin(), rays[i - 1].direction(),
+                             bounds) <=
+                ray_sort_key(rays[i].origin(), rays[i].direction(), bounds));
+  }
+}
+
+TEST_F(RaySortTest, SortsQueuePayloadAndAll) {
+  RayQueue queue(5000);
+  queue.resize(3000);
+  for (std::size_t i = 0; i < queue.count; ++i) {
+    queue.set_ray(i, random_ray());
+    queue.set_throughput(i, Vec3f(static_cast<float>(i), 0.f, 1.f));
+    queue.pixel[i] = static_cast<uint32_t>(i);
+    queue.alive[i] = 1;
+  }
+  RayQueue original = queue;
+  RaySorter sorter;
+  sorter.sort(queue, bounds, pool);
+  ASSERT_THAT(queue.count, Eq(3000u));
+  for (std::size_t i = 0; i < queue.count; ++i) {
+    uint32_t from = queue.pixel[i];
+    ASSERT_THAT(sorter.order()[i], Eq(from));
+    expect_same(queue.ray(i), original.ray(from));
+    ASSERT_THAT(queue.r[i], Eq(static_cast<float>(from)));
+  }
+  // The sort is stable, so sorting again changes nothing.
+  sorter.sort(queue, bounds);
+  for (std::size_t i = 0; i < queue.count; ++i) {
+    ASSERT_THAT(sorter.order()[i], Eq(i));
+  }
+}
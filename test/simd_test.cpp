@@ -0,0 +1,127 @@
+#include "simd.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "mat4.h"
+#include "point3.h"
+#include "vec3.h"
+#include "vec4.h"
+
+using testing::DoubleNear;
+using testing::Eq;
+using testing::FloatEq;
+
+static_assert(numeric<Simd8f> && numeric<Simd4d> && numeric<Simdf>);
+static_assert(!numeric<SimdMask<float, 8>>);
+static_assert(std::same_as<mask_t<float>, bool>);
+static_assert(std::same_as<mask_t<Simd8f>, SimdMask<float, 8>>);
+
+class SimdTest : public testing::Test {
+ public:
+  SimdTest() {
+    std::uniform_real_distribution<float> dist(-4.f, 4.f);
+    for (float& f : a) f = dist(gen);
+    for (float& f : b) f = dist(gen);
+    for (float& f : c) f = dist(gen);
+    b[3] = a[3];
+  }
+
+  std::mt19937 gen{48};
+  float a[8], b[8], c[8];
+};
+
+TEST_F(SimdTest, ComputesPerLane) {
+  Simd8f x = Simd8f::load(a), y = Simd8f::load(b);
+  Simd8f sum = x + y, quotient = x / y, scaled = 2.f * x - 1.f;
+  Simd8f root = sqrt(abs(x)), low = min(x, y), high = max(x, y);
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_THAT(sum[i], Eq(a[i] + b[i]));
+    EXPECT_THAT(quotient[i], Eq(a[i] / b[i]));
+    EXPECT_THAT(scaled[i], Eq(2.f * a[i] - 1.f));
+    EXPECT_THAT(root[i], Eq(std::sqrt(std::abs(a[i]))));
+    EXPECT_THAT(low[i], Eq(std::min(a[i], b[i])));
+    EXPECT_THAT(high[i], Eq(std::max(a[i], b[i])));
+  }
+  float out[8];
+  (-x).store(out);
+  for (int i = 0; i < 8; ++i) EXPECT_THAT(out[i], Eq(-a[i]));
+  x.set(5, 7.f);
+  EXPECT_THAT(x[5], Eq(7.f));
+  EXPECT_THAT(Simd8f()[2], Eq(0.f));
+  EXPECT_THAT(Simd4d(1.5)[3], Eq(1.5));
+}
+
+TEST_F(SimdTest, MasksSelectAndReduce) {
+  Simd8f x = Simd8f::load(a), y = Simd8f::load(b);
+  SimdMask<float, 8> less = x < y, equal = x == y;
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_THAT(less[i], Eq(a[i] < b[i]));
+    bits |= uint64_t{a[i] < b[i]} << i;
+  }
+  EXPECT_THAT(less.bits(), Eq(bits));
+  EXPECT_THAT(equal.bits(), Eq(uint64_t{1} << 3));
+  EXPECT_THAT((less | equal).bits(), Eq(bits | 8u));
+  EXPECT_THAT((!less).bits(), Eq(~bits & 0xffu));
+  EXPECT_THAT((x <= y).bits(), Eq(bits | 8u));
+
+  Simd8f picked = select(less, x, y);
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_THAT(picked[i], Eq(a[i] < b[i] ? a[i] : b[i]));
+  }
+  EXPECT_TRUE(any(equal) && !all(equal) && !none(equal));
+  EXPECT_TRUE(all(x == x) && none(x != x));
+  EXPECT_TRUE(all(SimdMask<double, 4>(true)) && none(SimdMask<double, 4>()));
+  EXPECT_TRUE(any(Simd16f(1.f) > Simd16f(0.f)));
+}
+
+TEST_F(SimdTest, VectorsRunTheScalarCodePerLane) {
+  a[6] = b[6] = c[6] = 0.f;  // normalized() of a zero vector
+  Vec3<Simd8f> u(Simd8f::load(a), Simd8f::load(b), Simd8f::load(c));
+  Vec3<Simd8f> v(Simd8f::load(c), Simd8f::load(a), Simd8f::load(b));
+  Simd8f d = dot(u, v);
+  Vec3<Simd8f> x = cross(u, v), n = normalized(u), r = reflect(v, n);
+  Point3<Simd8f> p = Point3<Simd8f>(u) + v * Simd8f(0.5f);
+  for (int i = 0; i < 8; ++i) {
+    Vec3f su(a[i], b[i], c[i]), sv(c[i], a[i], b[i]);
+    Vec3f sx = cross(su, sv), sn = normalized(su), sr = reflect(sv, sn);
+    Point3f sp = Point3f(su) + sv * 0.5f;
+    EXPECT_THAT(d[i], FloatEq(dot(su, sv)));
+    EXPECT_THAT(x.x()[i], FloatEq(sx.x()));
+    EXPECT_THAT(x.z()[i], FloatEq(sx.z()));
+    EXPECT_THAT(n.y()[i], FloatEq(sn.y()));
+    EXPECT_THAT(r.x()[i], FloatEq(sr.x()));
+    EXPECT_THAT(r.z()[i], FloatEq(sr.z()));
+    EXPECT_THAT(p.y()[i], FloatEq(sp.y()));
+  }
+  EXPECT_THAT(u.is_zero().bits(), Eq(uint64_t{1} << 6));
+  EXPECT_THROW(v / u, std::runtime_error);
+  EXPECT_THROW(v / u.x(), std::runtime_error);
+}
+
+TEST_F(SimdTest, MatricesRunTheScalarCodePerLane) {
+  double angles[4] = {0.1, 1.2, -2.3, 3.0};
+  Simd4d angle = Simd4d::load(angles);
+  Mat4<Simd4d> m =
+      translation(Simd4d(1.0), Simd4d(-2.0), angle) * rotationOverY(angle);
+  Mat4<Simd4d> inverse = m.inverse();
+  Vec4<Simd4d> p = m * Vec4<Simd4d>(angle, Simd4d(2.0), Simd4d(3.0), 1.0);
+  Simd4d det = m.transpose().determinant();
+  for (int i = 0; i < 4; ++i) {
+    Mat4d sm = translation(1.0, -2.0, angles[i]) * rotationOverY(angles[i]);
+    Mat4d sinverse = sm.inverse();
+    Vec4d sp = sm * Vec4d(angles[i], 2.0, 3.0, 1.0);
+    for (int row = 0; row < 4; ++row) {
+      for (int col = 0; col < 4; ++col) {
+        EXPECT_THAT(m[row][col][i], Eq(sm[row][col]));
+        EXPECT_THAT(inverse[row][col][i],
+                    DoubleNear(sinverse[row][col], 1e-12));
+      }
+      EXPECT_THAT(p[row][i], Eq(sp[row]));
+    }
+    EXPECT_THAT(det[i], DoubleNear(1.0, 1e-12));
+  }
+}
@@ -0,0 +1,173 @@
+#include "spatial_sort.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "random_scene.h"
+
+using testing::Eq;
+
+namespace {
+
+// Skilling's axes-to-transpose transform, then the transposed bits
+// interleaved with the first axis most significant.
+uint64_t skilling_hilbert(uint32_t x, uint32_t y, uint32_t z) {
+  uint32_t c[3] = {x, y, z};
+  for (uint32_t q = 1u << 20; q > 1; q >>= 1) {
+    uint32_t p = q - 1;
+    for (int i = 0; i < 3; ++i) {
+      if (c[i] & q) {
+        c[0] ^= p;
+      } else {
+        uint32_t t = (c[0] ^ c[i]) & p;
+        c[0] ^= t;
+        c[i] ^= t;
+      }
+    }
+  }
+  c[1] ^= c[0];
+  c[2] ^= c[1];
+  uint32_t t = 0;
+  for (uint32_t q = 1u << 20; q > 1; q >>= 1) {
+    if (c[2] & q) t ^= q - 1;
+  }
+  for (auto& v : c) v ^= t;
+  return morton_key(c[2], c[1], c[0]);
+}
+
+}  // namespace
+
+class SpatialSortTest : public testing::Test {
+ public:
+  std::mt19937 gen{6};
+  std::vector<Point3f> points = random_points(gen, 50000, 50.f);
+  ThreadPool pool{3};
+};
+
+TEST_F(SpatialSortTest, MortonInterleavesBits) {
+  EXPECT_THAT(morton_key(1, 0, 0), Eq(1u));
+  EXPECT_THAT(morton_key(0, 1, 0), Eq(2u));
+  EXPECT_THAT(morton_key(0, 0, 1), Eq(4u));
+  EXPECT_THAT(morton_key(3, 0, 1), Eq(0b1101u));
+  ASSERT_THAT(morton_key(0x1fffff, 0x1fffff, 0x1fffff),
+              Eq((uint64_t{1} << 63) - 1));
+  gen.seed(8);
+  std::uniform_int_distribution<uint32_t> coord(0, 0x1fffff);
+  for (int i = 0; i < 1000; ++i) {
+    std::array<uint32_t, 3> c = {coord(gen), coord(gen), coord(gen)};
+    ASSERT_THAT(morton_decode(morton_key(c[0], c[1], c[2])), Eq(c));
+  }
+}
+
+TEST_F(SpatialSortTest, HilbertMatchesSkillingTransform) {
+  gen.seed(9);
+  for (int i = 0; i < 100000; ++i) {
+    uint32_t mask = i < 1000 ? 0xff : 0x1fffff;
+    uint32_t x = gen() & mask, y = gen() & mask, z = gen() & mask;
+    ASSERT_THAT(hilbert_key(x, y, z), Eq(skilling_hilbert(x, y, z)));
+  }
+}
+
+TEST_F(SpatialSortTest, HilbertStepsToNeighbouringCells) {
+  // The first 8x8x8 cells are one octant at that level, visited in a row.
+  std::vector<std::pair<uint64_t, std::array<int, 3>>> cells;
+  for (int x = 0; x < 8; ++x) {
+    for (int y = 0; y < 8; ++y) {
+      for (int z = 0; z < 8; ++z) {
+        cells.push_back({hilbert_key(x, y, z), {x, y, z}});
+      }
+    }
+  }
+  std::sort(cells.begin(), cells.end());
+  for (std::size_t i = 0; i < cells.size(); ++i) {
+    ASSERT_THAT(cells[i].first, Eq(i));
+    if (i == 0) continue;
+    auto [a, b] = std::pair(cells[i - 1].second, cells[i].second);
+    int distance = std::abs(a[0] - b[0]) + std::abs(a[1] - b[1]) +
+                   std::abs(a[2] - b[2]);
+    ASSERT_THAT(distance, Eq(1)) << i;
+  }
+}
+
+TEST_F(SpatialSortTest, RadixSortIsStable) {
+  std::mt19937_64 rng(7);
+  for (std::size_t n : {0u, 1u, 1000u, 300000u}) {
+    std::vector<uint64_t> keys(n);
+    for (auto& k : keys) k = rng() >> (n % 2 ? 40 : 1);  // few and many passes
+    for (std::size_t i = 0; i < n; i += 7) keys[i] = keys[i / 2];
+    std::vector<uint32_t> values(n);
+    std::iota(values.begin(), values.end(), 0u);
+
+    std::vector<std::pair<uint64_t, uint32_t>> expected(n);
+    for (std::size_t i = 0; i < n; ++i) expected[i] = {keys[i], values[i]};
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](auto& a, auto& b) { return a.first < b.first; });
+
+    radix_sort(std::span(keys), std::span(values), pool);
+    for (std::size_t i = 0; i < n; ++i) {
+      ASSERT_THAT(keys[i], Eq(expected[i].first));
+      ASSERT_THAT(values[i], Eq(expected[i].second));
+    }
+  }
+}
+
+TEST_F(SpatialSortTest, OrderFollowsCurve) {
+  for (SpaceCurve curve : {SpaceCurve::morton, SpaceCurve::hilbert}) {
+    auto order = spatial_order(std::span<const Point3f>(points), curve, pool);
+    std::vector<uint64_t> keys(points.size());
+    spatial_keys(std::span<const Point3f>(points),
+                 bounds(std::span<const Point3f>(points)), curve,
+                 std::span(keys), pool);
+    std::vector<uint32_t> sorted(order);
+    std::sort(sorted.begin(), sorted.end());
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+      ASSERT_THAT(sorted[i], Eq(i));
+    }
+    for (std::size_t i = 1; i < order.size(); ++i) {
+      ASSERT_TRUE(keys[order[i - 1]] <= keys[order[i]]);
+    }
+  }
+}
+
+TEST_F(SpatialSortTest, SortReordersAttributes) {
+  std::vector<Point3f> original = points;
+  std::vector<uint32_t> ids(points.size());
+  std::iota(ids.begin(), ids.end(), 0u);
+  std::vector<float> heights(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) heights[i] = points[i].z();
+
+  auto order = spatial_sort(pool, SpaceCurve::hilbert, std::span(points),
+                            std::span(ids), std::span(heights));
+  std::vector<Point3f> gathered(points.size());
+  gather(std::span<const uint32_t>(order), std::span<const Point3f>(original),
+         std::span(gathered));
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    ASSERT_THAT(ids[i], Eq(order[i]));
+    ASSERT_THAT(points[i], Eq(original[order[i]]));
+    ASSERT_THAT(gathered[i], Eq(points[i]));
+    ASSERT_THAT(heights[i], Eq(points[i].z()));
+  }
+  std::vector<int> small(3);
+  ASSERT_THROW(permute(std::span<const uint32_t>(order), std::span(small)),
+               std::invalid_argument);
+}
+
+TEST_F(SpatialSortTest, SortedNeighboursAreClose) {
+  // Mean distance between consecutive points drops by orders of magnitude.
+  auto mean_step = [](const std::vector<Point3f>& p) {
+    double sum = 0.;
+    for (std::size_t i = 1; i < p.size(); ++i) {
+      sum += (p[i] - p[i - 1]).length();
+    }
+    return sum / static_cast<double>(p.size() - 1);
+  };
+  double before = mean_step(points);
+  spatial_sort(SpaceCurve::hilbert, std::span(points));
+  ASSERT_TRUE(mean_step(points) * 20. < before);
+}
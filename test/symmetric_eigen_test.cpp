@@ -0,0 +1,231 @@
+#include "symmetric_eigen.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "kd_tree.h"
+#include "simd.h"
+
+using testing::DoubleNear;
+using testing::Eq;
+using testing::FloatNear;
+using testing::Le;
+
+template <numeric T>
+Vec3<T> times(const Mat3<T>& m, const Vec3<T>& v) {
+  return Vec3<T>(dot(m[0], v), dot(m[1], v), dot(m[2], v));
+}
+
+template <numeric T>
+void expect_same(const Mat3<T>& m1, const Mat3<T>& m2) {
+  for (int r = 0; r < 3; ++r) EXPECT_THAT(m1[r], Eq(m2[r])) << r;
+}
+
+class SymmetricEigenTest : public testing::Test {
+ public:
+  // Q diag(l) Q^T for a random rotation Q.
+  Mat3<double> with_eigenvalues(double l0, double l1, double l2) {
+    Vec3d x = normalized(Vec3d(dist(gen), dist(gen), dist(gen)));
+    Vec3d y = normalized(cross(x, Vec3d(dist(gen), dist(gen), dist(gen))));
+    Vec3d z = cross(x, y);
+    Mat3<double> q(x, y, z);
+    Mat3<double> d(Vec3d(l0, 0, 0), Vec3d(0, l1, 0), Vec3d(0, 0, l2));
+    return q.transpose() * d * q;
+  }
+
+  Mat3<double> random_symmetric() {
+    Mat3<double> m;
+    for (int r = 0; r < 3; ++r) {
+      for (int c = r; c < 3; ++c) m[r][c] = m[c][r] = dist(gen);
+    }
+    return m;
+  }
+
+  // m v = lambda v for every pair, the vectors an orthonormal right-handed
+  // frame and the values ascending.
+  void expect_decomposes(const Mat3<double>& m,
+                         const SymmetricEigen3<double>& e, double tolerance) {
+    EXPECT_THAT(e.values.x(), Le(e.values.y()));
+    EXPECT_THAT(e.values.y(), Le(e.values.z()));
+    for (int i = 0; i < 3; ++i) {
+      const Vec3d& v = e.vectors[i];
+      EXPECT_THAT(v.length(), DoubleNear(1, 1e-14));
+      Vec3d residual = times(m, v) - v * e.values[i];
+      EXPECT_THAT(residual.length(), DoubleNear(0, tolerance)) << i;
+    }
+    EXPECT_THAT(dot(e.vectors[0], e.vectors[1]), DoubleNear(0, 1e-14));
+    EXPECT_THAT(dot(cross(e.vectors[0], e.vectors[1]), e.vectors[2]),
+                DoubleNear(1, 1e-14));
+  }
+
+  std::mt19937 gen{50};
+  std::uniform_real_distribution<double> dist{-1, 1};
+};
+
+TEST_F(SymmetricEigenTest, DecomposesRandomMatrices) {
+  for (int i = 0; i < 1000; ++i) {
+    Mat3<double> m = random_symmetric();
+    expect_decomposes(m, eigen_symmetric(m), 1e-14);
+  }
+}
+
+TEST_F(SymmetricEigenTest, KeepsRepeatedAndClusteredEigenvalues) {
+  for (double gap : {0., 1e-15, 1e-9, 1e-3}) {
+    Mat3<double> m = with_eigenvalues(1, 1 + gap, 3);
+    SymmetricEigen3<double> e = eigen_symmetric(m);
+    expect_decomposes(m, e, 1e-14);
+    EXPECT_THAT(e.values.x(), DoubleNear(1, 1e-14));
+    EXPECT_THAT(e.values.y(), DoubleNear(1 + gap, 1e-14));
+    EXPECT_THAT(e.values.z(), DoubleNear(3, 1e-14));
+  }
+
+  SymmetricEigen3<double> zero = eigen_symmetric(Mat3<double>(0.));
+  EXPECT_THAT(zero.values, Eq(Vec3d(0, 0, 0)));
+  EXPECT_THAT(zero.vectors[0], Eq(Vec3d(1, 0, 0)));
+  EXPECT_THAT(zero.vectors[2], Eq(Vec3d(0, 0, 1)));
+}
+
+TEST_F(SymmetricEigenTest, SolvesSimdLanesAsScalars) {
+  Mat3<float> m[8];
+  for (auto& mi : m) {
+    for (int r = 0; r < 3; ++r) {
+      for (int c = r; c < 3; ++c) {
+        mi[r][c] = mi[c][r] = static_cast<float>(dist(gen));
+      }
+    }
+  }
+  m[3] = Mat3<float>(0.f);
+  Mat3<Simd8f> lanes(0.f);
+  for (int l = 0; l < 8; ++l) {
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 3; ++c) lanes[r][c].set(l, m[l][r][c]);
+    }
+  }
+  SymmetricEigen3<Simd8f> e = eigen_symmetric(lanes);
+  for (int l = 0; l < 8; ++l) {
+    SymmetricEigen3<float> s = eigen_symmetric(m[l]);
+    for (int i = 0; i < 3; ++i) {
+      // The lanes may run a sweep more than the scalar solve.
+      EXPECT_THAT(e.values[i][l], FloatNear(s.values[i], 1e-6f)) << l;
+      EXPECT_THAT(std::abs(dot(Vec3f(e.vectors[i].x()[l], e.vectors[i].y()[l],
+                                     e.vectors[i].z()[l]),
+                               s.vectors[i])),
+                  FloatNear(1, 1e-5f))
+          << l;
+    }
+  }
+}
+
+TEST_F(SymmetricEigenTest, AccumulatesCovariance) {
+  // A plane through a point far from the origin, where E[x^2] - E[x]^2 in
+  // float would lose the spread entirely.
+  Point3f origin(1e4f, -2e4f, 3e4f);
+  Vec3f n = normalized(Vec3f(1, 2, 2));
+  Vec3f u = normalized(cross(n, Vec3f(0, 0, 1)));
+  Vec3f v = cross(n, u);
+  std::vector<Point3f> points;
+  Covariance3<float> c;
+  expect_same(c.matrix(), Mat3<float>(0.f));
+  for (int i = 0; i < 200; ++i) {
+    float a = static_cast<float>(dist(gen)), b = static_cast<float>(dist(gen));
+    points.push_back(origin + u * a + v * (0.5f * b));
+    c.add(points.back());
+  }
+  EXPECT_THAT(c.count(), Eq(200u));
+
+  // Two passes in double.
+  Vec3d mean;
+  for (const auto& p : points) {
+    mean = mean + Vec3d(p.x(), p.y(), p.z()) / 200.;
+  }
+  Mat3<double> expected(0.);
+  for (const auto& p : points) {
+    Vec3d d = Vec3d(p.x(), p.y(), p.z()) - mean;
+    for (int r = 0; r < 3; ++r) {
+      for (int col = 0; col < 3; ++col) expected[r][col] += d[r] * d[col] / 200;
+    }
+  }
+  EXPECT_THAT(c.mean().x(), FloatNear(mean.x(), 1e-3f));
+  EXPECT_THAT(c.mean().z(), FloatNear(mean.z(), 1e-3f));
+  Mat3<float> cov = c.matrix();
+  for (int r = 0; r < 3; ++r) {
+    for (int col = 0; col < 3; ++col) {
+      EXPECT_THAT(cov[r][col], FloatNear(expected[r][col], 1e-6f));
+    }
+  }
+
+  SymmetricEigen3<float> e = eigen_symmetric(cov);
+  EXPECT_THAT(std::abs(dot(e.vectors[0], n)), FloatNear(1, 1e-4f));
+  EXPECT_THAT(std::abs(dot(e.vectors[2], u)), FloatNear(1, 1e-3f));
+}
+
+TEST_F(SymmetricEigenTest, SolvesBatchesWithTails) {
+  ThreadPool pool{3};
+  for (std::size_t n : {0u, 1u, 7u, 1003u, 5000u}) {
+    SymmetricMat3SoA<double> soa;
+    soa.resize(n);
+    for (std::size_t i = 0; i < n; ++i) soa.set(i, random_symmetric());
+    std::vector<SymmetricEigen3<double>> out(n);
+    eigen_symmetric(soa, std::span(out), pool);
+    for (std::size_t i = 0; i < n; ++i) {
+      expect_decomposes(soa.get(i), out[i], 1e-14);
+    }
+  }
+
+  SymmetricMat3SoA<double> soa;
+  soa.resize(2);
+  std::vector<SymmetricEigen3<double>> small(1);
+  EXPECT_THROW(eigen_symmetric(soa, std::span(small), pool),
+               std::out_of_range);
+}
+
+TEST_F(SymmetricEigenTest, FindsNormalsOfNeighborhoods) {
+  // Points on the unit sphere: each neighbourhood's normal is the radius.
+  std::vector<Point3f> points(4000);
+  for (auto& p : points) {
+    Vec3d d = normalized(Vec3d(dist(gen), dist(gen), dist(gen)));
+    p = Point3f(static_cast<float>(d.x()), static_cast<float>(d.y()),
+                static_cast<float>(d.z()));
+  }
+  ThreadPool pool{3};
+  KdTree<float> tree(points, pool);
+  constexpr std::size_t kK = 12;
+  std::vector<Neighbor<float>> knn(points.size() * kK);
+  tree.knn(points, kK, std::span(knn), pool);
+
+  SymmetricMat3SoA<float> cov;
+  neighborhood_covariances<float>(points, knn, kK, cov, pool);
+  ASSERT_THAT(cov.size(), Eq(points.size()));
+  std::vector<SymmetricEigen3<float>> eigen(points.size());
+  eigen_symmetric(cov, std::span(eigen), pool);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    Vec3f radius = points[i] - Point3f();
+    EXPECT_THAT(std::abs(dot(eigen[i].vectors[0], radius)), FloatNear(1, 0.02f))
+        << i;
+  }
+
+  // A radius query gives the same covariances as the knn rows it matches.
+  std::vector<Neighbor<float>> within(points.size() * kK);
+  std::vector<uint32_t> counts(points.size());
+  tree.radius(points, 10.f, kK, std::span(within), std::span(counts), pool);
+  SymmetricMat3SoA<float> cov_radius;
+  neighborhood_covariances<float>(points, within, kK, counts, cov_radius,
+                                  pool);
+  EXPECT_THAT(cov_radius.xx, Eq(cov.xx));
+  EXPECT_THAT(cov_radius.yz, Eq(cov.yz));
+
+  // Padding of rows past the tree's size is skipped.
+  std::span<const Point3f> all(points);
+  KdTree<float> three(all.first(3), pool);
+  std::vector<Neighbor<float>> padded(kK);
+  three.knn(all.first(1), kK, std::span(padded), pool);
+  SymmetricMat3SoA<float> one;
+  neighborhood_covariances<float>(points, padded, kK, one, pool);
+  Covariance3<float> c;
+  for (int i = 0; i < 3; ++i) c.add(points[padded[i].index]);
+  expect_same(one.get(0), c.matrix());
+}
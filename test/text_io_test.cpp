@@ -0,0 +1,136 @@
+#include "text_io.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+
+using testing::ElementsAre;
+using testing::ElementsAreArray;
+using testing::Eq;
+using testing::HasSubstr;
+
+class TextIOTest : public testing::Test {
+ public:
+  std::string obj =
+      "# exported mesh\n"
+      "o cube\n"
+      "v 1 2 3\n"
+      "v -0.5 +4.25 1e-3 1.0\n"
+      "vt 0.5 0.5\n"
+      "vn 0 0 1\n"
+      "\n"
+      "v\t7.5  8 -9\r\n"
+      "vn 0 1 0\n"
+      "f 1//1 2//2 3//1\n";
+};
+
+TEST_F(TextIOTest, ParsesObjVertices) {
+  ASSERT_THAT(parse_points(obj),
+              ElementsAre(Point3f(1.f, 2.f, 3.f), Point3f(-0.5f, 4.25f, 1e-3f),
+                          Point3f(7.5f, 8.f, -9.f)));
+}
+
+TEST_F(TextIOTest, ParsesObjNormals) {
+  ASSERT_THAT(parse_normals(obj),
+              ElementsAre(Normal3f(0.f, 0.f, 1.f), Normal3f(0.f, 1.f, 0.f)));
+}
+
+TEST_F(TextIOTest, ParsesXyzWithExtraColumns) {
+  auto points = parse_points<double>("1.5 2 3 255 0 0\n  4 5 6\n7 8 9");
+  ASSERT_THAT(points, ElementsAre(Point3d(1.5, 2., 3.), Point3d(4., 5., 6.),
+                                  Point3d(7., 8., 9.)));
+}
+
+TEST_F(TextIOTest, ReportsMalformedLine) {
+  try {
+    parse_points("1 2 3\n4 5\n");
+    FAIL();
+  } catch (const std::runtime_error& e) {
+    EXPECT_THAT(e.what(), HasSubstr("line 2"));
+  }
+  EXPECT_THROW(parse_points("v 1 2 x\n"), std::runtime_error);
+  ASSERT_THROW(parse_points("1 2 3abc\n"), std::runtime_error);
+}
+
+TEST_F(TextIOTest, SplitsAtLineBoundaries) {
+  std::string text = "1 2 3\n4 5 6\n7 8 9\n10 11 12";
+  auto pieces = split_lines(text, 3);
+  std::string joined;
+  for (auto piece : pieces) {
+    EXPECT_TRUE(piece.back() == '\n' || piece.data() + piece.size() ==
+                                            text.data() + text.size());
+    joined += piece;
+  }
+  EXPECT_THAT(joined, Eq(text));
+  ASSERT_THAT(split_lines(text, 100).size(), Eq(4u));
+}
+
+TEST_F(TextIOTest, ParsesInParallel) {
+  std::string text;
+  std::vector<Point3f> expected;
+  for (int i = 0; i < 1000; ++i) {
+    expected.emplace_back(i * 0.5f, -i, i * 1e-3f);
+    text += "v " + std::to_string(i * 0.5f) + " " + std::to_string(-i) + " " +
+            std::to_string(i * 1e-3f) + "\n";
+  }
+  auto serial = parse_points(text);
+  ASSERT_THAT(serial.size(), Eq(1000u));
+  EXPECT_THAT(parse_points(text, 4), ElementsAreArray(serial));
+
+  text += "v 1 2\n";
+  try {
+    parse_points(text, 4);
+    FAIL();
+  } catch (const std::runtime_error& e) {
+    EXPECT_THAT(e.what(), HasSubstr("line 1001"));
+  }
+}
+
+TEST_F(TextIOTest, FormatsShortestRoundTrip) {
+  std::vector<Point3f> points = {Point3f(1.f, 0.1f, -2.5e-8f),
+                                 Point3f(1e30f, 3.f, 0.f)};
+  auto text = format_points(std::span<const Point3f>(points));
+  EXPECT_THAT(text, Eq("1 0.1 -2.5e-08\n1e+30 3 0\n"));
+  ASSERT_THAT(parse_points(text), ElementsAreArray(points));
+}
+
+TEST_F(TextIOTest, MatchesFromChars) {
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<uint64_t> mantissa(0, 99999999999999999);
+  std::uniform_int_distribution<int> digits(1, 17), exponent(-20, 20);
+  for (int i = 0; i < 20000; ++i) {
+    auto m = std::to_string(mantissa(gen)).substr(0, digits(gen));
+    auto point = std::min<std::size_t>(m.size(), i % 7);
+    auto s = m.substr(0, m.size() - point) + "." + m.substr(m.size() - point) +
+             "e" + std::to_string(exponent(gen));
+    float expected_f;
+    double expected_d;
+    std::from_chars(s.data(), s.data() + s.size(), expected_f);
+    std::from_chars(s.data(), s.data() + s.size(), expected_d);
+    auto line = s + " " + s + " -" + s;
+    EXPECT_THAT(parse_points(line)[0].x(), Eq(expected_f)) << s;
+    EXPECT_THAT(parse_points<double>(line)[0].z(), Eq(-expected_d)) << s;
+  }
+}
+
+TEST_F(TextIOTest, FormatsIntoBoundedBuffer) {
+  std::vector<Vec3f> values = {Vec3f(1.f, 2.f, 3.f), Vec3f(4.f, 5.f, 6.f),
+                               Vec3f(7.f, 8.f, 9.f)};
+  char buffer[20];
+  auto r = format_points(values, std::span<char>(buffer), "v ");
+  EXPECT_THAT(r.count, Eq(2u));
+  EXPECT_THAT(std::string_view(buffer, r.size), Eq("v 1 2 3\nv 4 5 6\n"));
+
+  r = format_points(std::span<const Vec3f>(values).subspan(2),
+                    std::span<char>(buffer, 7), "v ");
+  ASSERT_THAT(r.count, Eq(0u));
+  ASSERT_THAT(r.size, Eq(0u));
+}
+
+TEST_F(TextIOTest, StreamOutputDoesNotAppendNewline) {
+  std::ostringstream out;
+  out << Vec3f(1.f, 2.f, 3.f) << Normal3f(0.f, 0.f, 1.f);
+  ASSERT_THAT(out.str(), Eq("(1,2,3)(0,0,1)"));
+}
@@ -0,0 +1,152 @@
+#include "thread_pool.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "text_io.h"
+
+using testing::Eq;
+
+class ThreadPoolTest : public testing::Test {
+ public:
+  ThreadPool pool{4};
+};
+
+namespace {
+
+struct CountedTask : detail::PoolTask {
+  explicit CountedTask(std::atomic<int>& c)
+      : detail::PoolTask{[](detail::PoolTask* t) {
+          static_cast<CountedTask*>(t)->count.fetch_add(1);
+        }},
+        count{c} {}
+
+  std::atomic<int>& count;
+};
+
+}  // namespace
+
+TEST_F(ThreadPoolTest, DequeRunsEveryTaskOnceUnderSteals) {
+  constexpr int kTasks = 100000;
+  detail::ChaseLevDeque deque(4);  // grows while thieves are reading
+  std::vector<CountedTask> tasks;
+  std::vector<std::atomic<int>> runs(kTasks);
+  tasks.reserve(kTasks);
+  for (int i = 0; i < kTasks; ++i) tasks.emplace_back(runs[i]);
+
+  std::atomic<int> taken{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < 3; ++t) {
+    thieves.emplace_back([&] {
+      while (!done.load()) {
+        if (auto* task = deque.steal()) {
+          task->run(task);
+          taken.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kTasks; ++i) {
+    deque.push(&tasks[i]);
+    if (i % 3 == 0) {
+      if (auto* task = deque.pop()) {
+        task->run(task);
+        taken.fetch_add(1);
+      }
+    }
+  }
+  while (auto* task = deque.pop()) {
+    task->run(task);
+    taken.fetch_add(1);
+  }
+  while (taken.load() < kTasks) std::this_thread::yield();
+  done = true;
+  for (auto& t : thieves) t.join();
+
+  for (int i = 0; i < kTasks; ++i) ASSERT_THAT(runs[i].load(), Eq(1)) << i;
+}
+
+TEST_F(ThreadPoolTest, ParallelForCoversRangeOnce) {
+  std::vector<std::atomic<int>> hits(100003);
+  parallel_for(pool, 3, hits.size(), 64, [&](std::size_t b, std::size_t e) {
+    EXPECT_TRUE(e - b <= 64);
+    for (std::size_t i = b; i < e; ++i) hits[i].fetch_add(1);
+  });
+  for (std::size_t i = 0; i < hits.size(); ++i) {
+    ASSERT_THAT(hits[i].load(), Eq(i < 3 ? 0 : 1)) << i;
+  }
+}
+
+TEST_F(ThreadPoolTest, NestedLoopsComplete) {
+  std::atomic<long> sum{0};
+  parallel_for(pool, 0, 64, 1, [&](std::size_t b, std::size_t) {
+    parallel_for(pool, 0, 1000, 10, [&](std::size_t i, std::size_t e) {
+      for (; i < e; ++i) sum.fetch_add(static_cast<long>(b * i));
+    });
+  });
+  ASSERT_THAT(sum.load(), Eq(64 * 63 / 2 * (1000 * 999 / 2)));
+}
+
+TEST_F(ThreadPoolTest, RethrowsFirstException) {
+  EXPECT_THROW(parallel_for(pool, 0, 1000, 1,
+                            [](std::size_t b, std::size_t) {
+                              if (b == 500) throw std::logic_error("500");
+                            }),
+               std::logic_error);
+  // Still usable afterwards.
+  std::atomic<int> count{0};
+  parallel_for(pool, 0, 100, 1,
+               [&](std::size_t, std::size_t) { count.fetch_add(1); });
+  ASSERT_THAT(count.load(), Eq(100));
+}
+
+TEST_F(ThreadPoolTest, ReduceIsDeterministic) {
+  std::vector<float> values(1 << 16);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = 1.f / static_cast<float>(i + 1);
+  }
+  auto sum = [&](ThreadPool& p) {
+    return parallel_reduce(
+        p, 0, values.size(), 1000, 0.f,
+        [&](std::size_t b, std::size_t e) {
+          return std::accumulate(values.begin() + b, values.begin() + e, 0.f);
+        },
+        [](float a, float b) { return a + b; });
+  };
+  ThreadPool serial(0);
+  float expected = sum(serial);
+  for (int i = 0; i < 20; ++i) ASSERT_THAT(sum(pool), Eq(expected));
+}
+
+TEST_F(ThreadPoolTest, EmptyPoolRunsOnCaller) {
+  ThreadPool serial(0);
+  ASSERT_THAT(serial.size(), Eq(0u));
+  auto caller = std::this_thread::get_id();
+  int chunks = 0;
+  parallel_for(serial, 0, 10, 3, [&](std::size_t, std::size_t) {
+    EXPECT_THAT(std::this_thread::get_id(), Eq(caller));
+    ++chunks;
+  });
+  ASSERT_THAT(chunks, Eq(4));
+}
+
+TEST_F(ThreadPoolTest, ParsesTextOnPool) {
+  std::string text;
+  for (int i = 0; i < 5000; ++i) {
+    text += "v " + std::to_string(i) + " 1 2\n";
+  }
+  auto points = parse_points(text, pool);
+  ASSERT_THAT(points.size(), Eq(5000u));
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_THAT(points[i].x(), Eq(static_cast<float>(i)));
+  }
+  text.insert(text.size() / 2, "v 1 x 2\n");
+  ASSERT_THROW(parse_points(text, pool), std::runtime_error);
+}
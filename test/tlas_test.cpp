@@ -0,0 +1,142 @@
+#include "tlas.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "random_scene.h"
+
+using testing::Eq;
+using testing::FloatNear;
+
+class TlasTest : public testing::Test {
+ public:
+  TlasTest() {
+    // A cloud of small triangles and a unit quad, placed many times.
+    std::vector<Trianglef> cloud(300);
+    for (auto& t : cloud) t = random_triangle(gen, 1.f, 0.3f);
+    std::vector<Trianglef> quad = {
+        {Point3f(0.f, 0.f, 0.f), Point3f(1.f, 0.f, 0.f),
+         Point3f(1.f, 1.f, 0.f)},
+        {Point3f(0.f, 0.f, 0.f), Point3f(1.f, 1.f, 0.f),
+         Point3f(0.f, 1.f, 0.f)}};
+    meshes.emplace_back(std::span<const Trianglef>(cloud), pool);
+    meshes.emplace_back(std::span<const Trianglef>(quad), pool);
+    triangles = {cloud, quad};
+
+    std::uniform_real_distribution<float> place(-20.f, 20.f),
+        angle(0.f, 6.28f), size(0.5f, 2.f);
+    instances.resize(400);
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+      instances[i].mesh = static_cast<uint32_t>(i % 2);
+      instances[i].object_to_world =
+          translation(place(gen), place(gen), place(gen)) *
+          rotationOverY(angle(gen)) * rotationOverX(angle(gen)) *
+          scale(size(gen), size(gen), size(gen));
+    }
+  }
+
+  // Every placed triangle moved to world space, in one Bvh; flat[i] is
+  // the instance and mesh triangle of entry i.
+  void flatten() {
+    std::vector<Trianglef> world;
+    for (uint32_t i = 0; i < instances.size(); ++i) {
+      const Mat4f& m = instances[i].object_to_world;
+      auto place = [&](const Point3f& p) {
+        Vec4f w = m * Vec4f(p.x(), p.y(), p.z(), 1.f);
+        return Point3f(w.x(), w.y(), w.z());
+      };
+      const auto& mesh = triangles[instances[i].mesh];
+      for (uint32_t j = 0; j < mesh.size(); ++j) {
+        world.push_back({place(mesh[j].a), place(mesh[j].b), place(mesh[j].c)});
+        flat.push_back({i, j});
+      }
+    }
+    flattened = Bvhf(std::span<const Trianglef>(world), pool);
+  }
+
+  Ray random_ray() { return ::random_ray(gen, 25.f); }
+
+  std::mt19937 gen{8};
+  ThreadPool pool{3};
+  std::vector<Bvhf> meshes;
+  std::vector<std::vector<Trianglef>> triangles;
+  std::vector<Instancef> instances;
+  Bvhf flattened;
+  std::vector<std::pair<uint32_t, uint32_t>> flat;
+};
+
+TEST_F(TlasTest, NearestHitMatchesFlattenedScene) {
+  Tlasf tlas(std::span<const Bvhf>(meshes),
+             std::span<const Instancef>(instances), pool);
+  ASSERT_THAT(tlas.size(), Eq(instances.size()));
+  flatten();
+  int hits = 0;
+  for (int i = 0; i < 1000; ++i) {
+    Ray ray = random_ray();
+    if (i % 4 == 0) ray.setMaxRange(15.f);
+    TriangleHit<float> expected = flattened.intersect(ray);
+    InstanceHit<float> found = tlas.intersect(ray);
+    ASSERT_THAT(found.hit(), Eq(expected.hit())) << i;
+    if (!expected.hit()) continue;
+    ++hits;
+    // Rounding differs between spaces; near ties may pick either.
+    ASSERT_THAT(found.t, FloatNear(expected.t, 1e-3f * (1.f + expected.t)))
+        << i;
+    auto [instance, triangle] = flat[expected.triangle];
+    if (found.instance == instance) {
+      ASSERT_THAT(found.triangle, Eq(triangle)) << i;
+    }
+  }
+  EXPECT_TRUE(hits > 100);
+}
+
+TEST_F(TlasTest, OcclusionAndBatchesMatchSingleRays) {
+  Tlasf tlas{std::span<const Bvhf>(meshes),
+             std::span<const Instancef>(instances)};
+  std::vector<Ray> rays(500);
+  for (auto& r : rays) r = random_ray();
+  std::vector<InstanceHit<float>> hits(rays.size());
+  std::vector<uint8_t> blocked(rays.size());
+  tlas.intersect(std::span<const Ray>(rays), std::span(hits), pool);
+  tlas.occluded(std::span<const Ray>(rays), std::span(blocked), pool);
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    ASSERT_THAT(hits[i], Eq(tlas.intersect(rays[i])));
+    ASSERT_THAT(blocked[i], Eq(hits[i].hit()));
+  }
+  std::vector<uint8_t> small(1);
+  ASSERT_THROW(tlas.occluded(std::span<const Ray>(rays), std::span(small)),
+               std::out_of_range);
+}
+
+TEST_F(TlasTest, InstancesAreMovedQuads) {
+  // Quads stacked along z, facing it; the ray meets the nearest first.
+  std::vector<Instancef> stack = {
+      {1, translation(0.f, 0.f, 5.f) * scale(4.f, 4.f, 1.f)},
+      {1, translation(0.f, 0.f, 2.f)},
+      {1, translation(0.f, 0.f, 8.f) * rotationOverZ(0.3f)}};
+  Tlasf tlas{std::span<const Bvhf>(meshes),
+             std::span<const Instancef>(stack)};
+  Ray ray(Point3f(0.5f, 0.5f, 0.f), Vec3f(0.f, 0.f, 2.f));
+  InstanceHit<float> hit = tlas.intersect(ray);
+  ASSERT_THAT(hit.instance, Eq(1u));
+  EXPECT_THAT(hit.t, FloatNear(1.f, 1e-6f));
+  ray.setMinRange(1.5f);
+  EXPECT_THAT(tlas.intersect(ray).instance, Eq(0u));
+  ray.setMaxRange(2.4f);
+  EXPECT_FALSE(tlas.occluded(ray));
+  EXPECT_TRUE(tlas.bounds().contains(Point3f(3.9f, 3.9f, 5.f)));
+}
+
+TEST_F(TlasTest, EmptyAndInvalidInstances) {
+  Tlasf empty{std::span<const Bvhf>(meshes), std::span<const Instancef>()};
+  EXPECT_FALSE(empty.intersect(random_ray()).hit());
+  EXPECT_FALSE(empty.occluded(random_ray()));
+  std::vector<Instancef> bad = {{2, Mat4f()}};
+  ASSERT_THROW(Tlasf(std::span<const Bvhf>(meshes),
+                     std::span<const Instancef>(bad)),
+               std::invalid_argument);
+}
@@ -0,0 +1,78 @@
+#include "transform.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "random_scene.h"
+
+using testing::Eq;
+using testing::FloatNear;
+
+class TransformTest : public testing::Test {
+ public:
+  Mat4f m = translation(1.f, 2.f, 3.f) * scale(2.f, 1.f, 0.5f);
+  std::mt19937 gen{4};
+  std::vector<Point3f> points = random_points(gen, 20000, 5.f);
+  ThreadPool pool{3};
+};
+
+TEST_F(TransformTest, PointsMatchMatrixProduct) {
+  std::vector<Point3f> out(points.size());
+  transform_points(m, std::span<const Point3f>(points), std::span(out), pool);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    const Point3f& p = points[i];
+    Vec4f expected = m * Vec4f(p.x(), p.y(), p.z(), 1.f);
+    ASSERT_THAT(out[i].x(), Eq(expected.x()));
+    ASSERT_THAT(out[i].y(), Eq(expected.y()));
+    ASSERT_THAT(out[i].z(), Eq(expected.z()));
+  }
+}
+
+TEST_F(TransformTest, VectorsIgnoreTranslation) {
+  std::vector<Vec3f> v = {Vec3f(1.f, 1.f, 1.f)};
+  transform_vectors(m, std::span<const Vec3f>(v), std::span(v));
+  ASSERT_THAT(v[0], Eq(Vec3f(2.f, 1.f, 0.5f)));
+}
+
+TEST_F(TransformTest, NormalsStayPerpendicular) {
+  // Plane x + y = 0 with tangent (1, -1, 0) and normal (1, 1, 0).
+  std::vector<Vec3f> tangent = {Vec3f(1.f, -1.f, 0.f)};
+  std::vector<Normal3f> normal = {Normal3f(1.f, 1.f, 0.f)};
+  transform_vectors(m, std::span<const Vec3f>(tangent), std::span(tangent));
+  transform_normals(m, std::span<const Normal3f>(normal), std::span(normal));
+  float d = tangent[0].x() * normal[0].x() + tangent[0].y() * normal[0].y() +
+            tangent[0].z() * normal[0].z();
+  ASSERT_THAT(d, FloatNear(0.f, 1e-6f));
+}
+
+TEST_F(TransformTest, RaysKeepTheirParameters) {
+  std::vector<Ray> rays(points.size());
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    rays[i] = Ray(points[i], Vec3f(1.f, -2.f, 0.5f));
+    rays[i].setMaxRange(static_cast<float>(i));
+  }
+  std::vector<Ray> out(rays.size());
+  transform_rays(m, std::span<const Ray>(rays), std::span(out), pool);
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    ASSERT_THAT(out[i].getMinRange(), Eq(rays[i].getMinRange()));
+    ASSERT_THAT(out[i].getMaxRange(), Eq(rays[i].getMaxRange()));
+    // The point at t maps to the transformed ray's point at t.
+    Point3f p = rays[i].position(3.f);
+    Vec4f expected = m * Vec4f(p.x(), p.y(), p.z(), 1.f);
+    Point3f q = out[i].position(3.f);
+    ASSERT_THAT(q.x(), FloatNear(expected.x(), 1e-4f));
+    ASSERT_THAT(q.y(), FloatNear(expected.y(), 1e-4f));
+    ASSERT_THAT(q.z(), FloatNear(expected.z(), 1e-4f));
+  }
+  ASSERT_THAT(out[0].direction(), Eq(Vec3f(2.f, -2.f, 0.25f)));
+}
+
+TEST_F(TransformTest, RejectsShortOutput) {
+  std::vector<Point3f> out(points.size() - 1);
+  ASSERT_THROW(transform_points(m, std::span<const Point3f>(points),
+                                std::span(out)),
+               std::out_of_range);
+}
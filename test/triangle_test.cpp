@@ -0,0 +1,80 @@
+#include "triangle.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+
+using testing::Eq;
+using testing::FloatNear;
+
+class TriangleTest : public testing::Test {
+ public:
+  Trianglef tri{Point3f(0.f, 0.f, 0.f), Point3f(2.f, 0.f, 0.f),
+                Point3f(0.f, 2.f, 0.f)};
+};
+
+TEST_F(TriangleTest, BoundsAndCentroid) {
+  EXPECT_THAT(tri.bounds(),
+              Eq(AABBf(Point3f(0.f, 0.f, 0.f), Point3f(2.f, 2.f, 0.f))));
+  EXPECT_THAT(tri.centroid(), Eq(Point3f(2.f / 3.f, 2.f / 3.f, 0.f)));
+  EXPECT_THAT(tri.normal(), Eq(Vec3f(0.f, 0.f, 4.f)));
+}
+
+TEST_F(TriangleTest, HitsInsideFromBothSides) {
+  TriangleHit<float> hit;
+  ASSERT_TRUE(intersect(tri, Point3f(0.5f, 1.f, 3.f), Vec3f(0.f, 0.f, -1.f),
+                        0.f, hit));
+  EXPECT_THAT(hit.t, FloatNear(3.f, 1e-6f));
+  EXPECT_THAT(hit.u, FloatNear(0.25f, 1e-6f));
+  EXPECT_THAT(hit.v, FloatNear(0.5f, 1e-6f));
+  EXPECT_FALSE(hit.hit());  // the caller names the triangle
+
+  TriangleHit<float> below;
+  ASSERT_TRUE(intersect(tri, Point3f(0.5f, 1.f, -2.f), Vec3f(0.f, 0.f, 2.f),
+                        0.f, below));
+  EXPECT_THAT(below.t, FloatNear(1.f, 1e-6f));
+}
+
+TEST_F(TriangleTest, MissesOutsideRangeAndEdges) {
+  TriangleHit<float> hit;
+  // Outside the edge u + v = 1.
+  EXPECT_FALSE(intersect(tri, Point3f(1.5f, 1.5f, 1.f),
+                         Vec3f(0.f, 0.f, -1.f), 0.f, hit));
+  // Parallel to the plane.
+  EXPECT_FALSE(intersect(tri, Point3f(0.5f, 0.5f, 1.f),
+                         Vec3f(1.f, 0.f, 0.f), 0.f, hit));
+  // Behind the origin, and before tmin.
+  EXPECT_FALSE(intersect(tri, Point3f(0.5f, 0.5f, 1.f), Vec3f(0.f, 0.f, 1.f),
+                         0.f, hit));
+  EXPECT_FALSE(intersect(tri, Point3f(0.5f, 0.5f, 1.f),
+                         Vec3f(0.f, 0.f, -1.f), 2.f, hit));
+  // Not closer than what was already hit.
+  hit.t = 0.5f;
+  EXPECT_FALSE(intersect(tri, Point3f(0.5f, 0.5f, 1.f),
+                         Vec3f(0.f, 0.f, -1.f), 0.f, hit));
+  EXPECT_THAT(hit.t, Eq(0.5f));
+}
+
+TEST_F(TriangleTest, OccludesWhereIntersectHits) {
+  EXPECT_TRUE(occludes(tri, Point3f(0.5f, 1.f, 3.f), Vec3f(0.f, 0.f, -1.f),
+                       0.f, 4.f));
+  // The range ends just before the triangle, or starts after it.
+  EXPECT_FALSE(occludes(tri, Point3f(0.5f, 1.f, 3.f), Vec3f(0.f, 0.f, -1.f),
+                        0.f, 3.f));
+  EXPECT_FALSE(occludes(tri, Point3f(0.5f, 1.f, 3.f), Vec3f(0.f, 0.f, -1.f),
+                        3.1f, 10.f));
+
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<float> at(-3.f, 3.f), range(0.f, 8.f);
+  for (int i = 0; i < 2000; ++i) {
+    Point3f o(at(gen), at(gen), at(gen));
+    Vec3f d(at(gen), at(gen), at(gen));
+    float tmin = range(gen) * 0.1f, tmax = range(gen);
+    TriangleHit<float> hit;
+    hit.t = tmax;
+    ASSERT_THAT(occludes(tri, o, d, tmin, tmax),
+                Eq(intersect(tri, o, d, tmin, hit)))
+        << i;
+  }
+}
@@ -0,0 +1,77 @@
+#include "vec3_expr.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using testing::Eq;
+using testing::FloatNear;
+
+MATCHER_P2(Vec3Near, v, eps, "") {
+  return fabs(arg.x() - v.x()) < eps && fabs(arg.y() - v.y()) < eps &&
+         fabs(arg.z() - v.z()) < eps;
+}
+
+class Vector3ExprTest : public testing::Test {
+ public:
+  Vec3f a = Vec3f(1.5f, -2.f, 4.f);
+  Vec3f b = Vec3f(0.25f, 3.f, -1.f);
+  Vec3f c = Vec3f(-7.f, 0.5f, 2.f);
+  float eps = 1E-5f;
+};
+
+TEST_F(Vector3ExprTest, EvaluatesArithmetic) {
+  Vec3f sum = expr::lazy(a) + b;
+  EXPECT_THAT(sum, Eq(a + b));
+
+  Vec3f diff = expr::lazy(a) - b;
+  EXPECT_THAT(diff, Eq(a - b));
+
+  Vec3f prod = expr::lazy(a) * b;
+  EXPECT_THAT(prod, Eq(a * b));
+
+  Vec3f neg = -expr::lazy(a);
+  EXPECT_THAT(neg, Eq(-a));
+
+  Vec3f div = expr::lazy(a) / 2.f;
+  ASSERT_THAT(div, Eq(a / 2.f));
+}
+
+TEST_F(Vector3ExprTest, FusesChains) {
+  Vec3f r = expr::lazy(a) + b * 3.f - c * 0.5f;
+  EXPECT_THAT(r, Vec3Near(a + b * 3.f - c * 0.5f, eps));
+
+  r = 2.f * expr::lazy(a) + expr::lazy(b) * c;
+  EXPECT_THAT(r, Vec3Near(a * 2.f + b * c, eps));
+
+  auto v = expr::eval((expr::lazy(a) + b) * (expr::lazy(c) - a) / 4.f);
+  ASSERT_THAT(v, Vec3Near((a + b) * (c - a) / 4.f, eps));
+}
+
+TEST_F(Vector3ExprTest, ComputesDotAndCross) {
+  EXPECT_THAT(expr::dot(expr::lazy(a), b), FloatNear(dot(a, b), eps));
+  EXPECT_THAT(expr::dot(expr::lazy(a) + c, b), FloatNear(dot(a + c, b), eps));
+
+  Vec3f x = expr::cross(expr::lazy(a), b);
+  EXPECT_THAT(x, Vec3Near(cross(a, b), eps));
+
+  Vec3f y = expr::cross(expr::lazy(a) * 2.f, expr::lazy(b) - c);
+  ASSERT_THAT(y, Vec3Near(cross(a * 2.f, b - c), eps));
+}
+
+TEST_F(Vector3ExprTest, ReflectsVector) {
+  auto n = normalized(b);
+  ASSERT_THAT(expr::reflect(a, n), Vec3Near(reflect(a, n), eps));
+}
+
+TEST_F(Vector3ExprTest, RotatesVectorByQuaternion) {
+  auto q = angle_axis(0.8f, Vec3f(1.f, 2.f, -0.5f));
+  ASSERT_THAT(expr::rotate(q, a), Vec3Near(q * a, eps));
+}
+
+TEST_F(Vector3ExprTest, WorksWithDoubles) {
+  auto u = Vec3d(1., 2., 3.);
+  auto v = Vec3d(-1., 0.5, 2.);
+  Vec3d r = expr::lazy(u) * 2. + v;
+  EXPECT_THAT(r, Eq(u * 2. + v));
+  ASSERT_THAT(expr::dot(expr::lazy(u), v), Eq(dot(u, v)));
+}
@@ -0,0 +1,67 @@
+#include "vecn.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "simd.h"
+
+using testing::Eq;
+using testing::FloatEq;
+
+class VectorTest : public testing::Test {
+ public:
+  Vec6d a{1., -2., 3., 0.5, 4., -1.};
+  Vec6d b{2., 1., -1., 4., 0., 3.};
+};
+
+TEST_F(VectorTest, Constructs) {
+  EXPECT_THAT(Vec6f(), Eq(Vec6f::filled(0.f)));
+  EXPECT_THAT(Vec6d::unit(4), Eq(Vec6d(0., 0., 0., 0., 1., 0.)));
+  EXPECT_THAT(Vec6d::generate([](int i) { return i * 2.; }),
+              Eq(Vec6d(0., 2., 4., 6., 8., 10.)));
+  EXPECT_THAT(Vec6d::size(), Eq(6));
+  a[5] = 7.;
+  EXPECT_THAT(a[5], Eq(7.));
+  EXPECT_THAT(a.data()[5], Eq(7.));
+}
+
+TEST_F(VectorTest, Computes) {
+  EXPECT_THAT(a + b, Eq(Vec6d(3., -1., 2., 4.5, 4., 2.)));
+  EXPECT_THAT(a - b, Eq(Vec6d(-1., -3., 4., -3.5, 4., -4.)));
+  EXPECT_THAT(a * b, Eq(Vec6d(2., -2., -3., 2., 0., -3.)));
+  EXPECT_THAT(2. * a, Eq(a + a));
+  EXPECT_THAT(-a / 2., Eq(a * -0.5));
+  EXPECT_THAT(dot(a, b), Eq(-4.));
+  EXPECT_THAT(b.length_squared(), Eq(31.));
+  EXPECT_THAT(normalized(b).length(), testing::DoubleEq(1.));
+  EXPECT_THAT(normalized(Vec6d()), Eq(Vec6d()));
+  EXPECT_TRUE(Vec6d().is_zero() && !a.is_zero());
+  EXPECT_THROW(a / 0., std::runtime_error);
+  a += b;
+  a -= b;
+  a *= 3.;
+  a /= 3.;
+  EXPECT_THAT(a, Eq(Vec6d(1., -2., 3., 0.5, 4., -1.)));
+}
+
+TEST_F(VectorTest, MatchesTheNamedVectors) {
+  Vec3f u(1.5f, -2.f, 0.25f), v(-3.f, 0.5f, 2.f);
+  Vector<float, 3> gu(u), gv(v);
+  EXPECT_THAT(dot(gu, gv), FloatEq(dot(u, v)));
+  EXPECT_THAT(Vec3f(normalized(gu)), Eq(normalized(u)));
+  EXPECT_THAT(Vec3f(gu - gv * 2.f), Eq(u - v * 2.f));
+  EXPECT_THAT(Vec2d(Vector<double, 2>(Vec2d(1., 2.))), Eq(Vec2d(1., 2.)));
+  EXPECT_THAT(Vec4f(Vector<float, 4>(Vec4f(1.f, 2.f, 3.f, 4.f))),
+              Eq(Vec4f(1.f, 2.f, 3.f, 4.f)));
+}
+
+TEST_F(VectorTest, RunsOnSimdLanes) {
+  Vector<Simd4d, 6> lanes = Vector<Simd4d, 6>::generate([&](int i) {
+    Simd4d s(a[i]);
+    s.set(2, b[i]);
+    return s;
+  });
+  Simd4d d = dot(lanes, lanes);
+  EXPECT_THAT(d[0], Eq(dot(a, a)));
+  EXPECT_THAT(d[2], Eq(dot(b, b)));
+}
@@ -0,0 +1,120 @@
+#include "wavefront.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "bvh.h"
+
+using testing::Eq;
+using testing::FloatNear;
+
+class WavefrontTest : public testing::Test {
+ public:
+  WavefrontTest() {
+    // A floor at y = 0 made of two triangles, and a wall at z = -5.
+    triangles = {
+        {Point3f(-10.f, 0.f, -10.f), Point3f(10.f, 0.f, -10.f),
+         Point3f(10.f, 0.f, 10.f)},
+        {Point3f(-10.f, 0.f, -10.f), Point3f(10.f, 0.f, 10.f),
+         Point3f(-10.f, 0.f, 10.f)},
+        {Point3f(-10.f, -1.f, -5.f), Point3f(10.f, -1.f, -5.f),
+         Point3f(0.f, 10.f, -5.f)},
+    };
+  }
+
+  std::vector<Trianglef> triangles;
+  ThreadPool pool{3};
+  Mat4f view = view_transform(Point3f(0.f, 1.f, 5.f), Point3f(0.f, 1.f, 0.f),
+                              Vec3f(0.f, 1.f, 0.f));
+  Mat4f projection = perspective(45.f, 4.f / 3.f, 0.1f, 100.f);
+};
+
+TEST_F(WavefrontTest, CameraRaysLookThroughPixels) {
+  RayQueue queue;
+  generate_camera_rays(view, projection, 64, 48, queue, pool);
+  ASSERT_THAT(queue.count, Eq(64u * 48u));
+  for (std::size_t i = 0; i < queue.count; ++i) {
+    ASSERT_THAT(queue.pixel[i], Eq(i));
+    Vec3f d = queue.ray(i).direction();
+    ASSERT_THAT(d.length(), FloatNear(1.f, 1e-5f));
+    ASSERT_TRUE(d.z() < 0.f);  // forward
+  }
+  // Top left looks up and left, bottom right down and right; the middle
+  // ones straight ahead from the near plane.
+  EXPECT_TRUE(queue.dx[0] < 0.f && queue.dy[0] > 0.f);
+  EXPECT_TRUE(queue.dx[queue.count - 1] > 0.f &&
+              queue.dy[queue.count - 1] < 0.f);
+  Ray centre = queue.ray(24 * 64 + 32);
+  EXPECT_THAT(centre.origin().z(), FloatNear(4.9f, 1e-3f));
+  EXPECT_THAT(centre.direction().z(), FloatNear(-1.f, 1e-3f));
+}
+
+TEST_F(WavefrontTest, ExtendMatchesSingleRays) {
+  Bvhf bvh(std::span<const Trianglef>(triangles), pool);
+  RayQueue queue;
+  generate_camera_rays(view, projection, 32, 32, queue, pool);
+  std::vector<TriangleHit<float>> hits(queue.capacity());
+  extend(bvh, queue, std::span(hits), pool);
+  bool floor = false, wall = false;
+  for (std::size_t i = 0; i < queue.count; ++i) {
+    ASSERT_THAT(hits[i], Eq(bvh.intersect(queue.ray(i))));
+    floor = floor || hits[i].triangle < 2;
+    wall = wall || hits[i].triangle == 2;
+  }
+  EXPECT_TRUE(floor && wall);
+  std::vector<TriangleHit<float>> small(3);
+  ASSERT_THROW(extend(bvh, queue, std::span(small)), std::out_of_range);
+}
+
+TEST_F(WavefrontTest, ShadowRaysStopAtTheirRange) {
+  Bvhf bvh(std::span<const Trianglef>(triangles), pool);
+  RayQueue queue;
+  generate_camera_rays(view, projection, 32, 32, queue, pool);
+  std::vector<uint8_t> blocked(queue.count);
+  occluded(bvh, queue, std::span(blocked), pool);
+  std::size_t hits = 0;
+  for (std::size_t i = 0; i < queue.count; ++i) {
+    ASSERT_THAT(blocked[i], Eq(bvh.intersect(queue.ray(i)).hit()));
+    hits += blocked[i];
+    queue.tmax[i] = 0.5f;
+  }
+  EXPECT_TRUE(hits > queue.count / 2);
+  occluded(bvh, queue, std::span(blocked));
+  for (std::size_t i = 0; i < queue.count; ++i) {
+    ASSERT_THAT(blocked[i], Eq(0));
+  }
+  std::vector<uint8_t> small(3);
+  ASSERT_THROW(occluded(bvh, queue, std::span(small)), std::out_of_range);
+}
+
+TEST_F(WavefrontTest, ShadeAndCompactKeepLivePathsInOrder) {
+  RayQueue a(4000), b;
+  generate_camera_rays(view, projection, 100, 30, a, pool);
+  std::vector<TriangleHit<float>> hits(a.count);
+  // Every third path ends; the others halve their throughput.
+  std::size_t live = shade(
+      a, std::span<const TriangleHit<float>>(hits),
+      [](Path& path, const TriangleHit<float>&) {
+        path.throughput = path.throughput * 0.5f;
+        return path.pixel % 3 != 0;
+      },
+      pool);
+  ASSERT_THAT(live, Eq(2000u));
+  ASSERT_THAT(compact(a, b, pool), Eq(2000u));
+  ASSERT_THAT(b.count, Eq(2000u));
+  for (std::size_t i = 0; i < b.count; ++i) {
+    uint32_t pixel = static_cast<uint32_t>(i / 2 * 3 + i % 2 + 1);
+    ASSERT_THAT(b.pixel[i], Eq(pixel));
+    ASSERT_THAT(b.throughput(i), Eq(Vec3f(0.5f, 0.5f, 0.5f)));
+    ASSERT_THAT(b.ox[i], Eq(a.ox[pixel]));
+  }
+
+  // A second frame reuses the arrays.
+  const float* storage = a.ox.data();
+  generate_camera_rays(view, projection, 100, 30, a, pool);
+  EXPECT_THAT(a.ox.data(), Eq(storage));
+  a.clear();
+  EXPECT_THAT(compact(a, b, pool), Eq(0u));
+}